@@ -1,7 +1,9 @@
 #include <ros/ros.h>
-#include <kinematics_base/kinematics_base.h>
+#include <ikfast_batch_kinematics/batch_kinematics_base.h>
 #include <urdf/model.h>
 #include <arm_kinematics_constraint_aware/ik_fast_solver.h>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
 
 namespace ADEPT_VIPER_S650_arm_1_kinematics
 {
@@ -9,7 +11,7 @@ namespace ADEPT_VIPER_S650_arm_1_kinematics
 //autogenerated file
 #include "ADEPT_VIPER_S650_arm_1_ikfast_output.cpp"
 
-class IKFastKinematicsPlugin : public kinematics::KinematicsBase
+class IKFastKinematicsPlugin : public ikfast_batch_kinematics::BatchKinematicsBase
 {
   std::vector<std::string> joint_names_;
   std::vector<double> joint_min_vector_;
@@ -20,11 +22,17 @@ class IKFastKinematicsPlugin : public kinematics::KinematicsBase
   size_t num_joints_;
   std::vector<int> free_params_;
   void (*fk)(const IKReal* j, IKReal* eetrans, IKReal* eerot);
+  ikfast_batch_kinematics::IKSolutionCache solution_cache_;
+  std::vector<arm_kinematics_constraint_aware::ik_solver_base*> batch_solvers_;
   
 public:
 
   IKFastKinematicsPlugin():ik_solver_(0) {}
-  ~IKFastKinematicsPlugin(){ if(ik_solver_) delete ik_solver_;}
+  ~IKFastKinematicsPlugin(){
+    if(ik_solver_) delete ik_solver_;
+    for(size_t t = 0; t < batch_solvers_.size(); ++t)
+      delete batch_solvers_[t];
+  }
 
   void fillFreeParams(int count, int *array) { free_params_.clear(); for(int i=0; i<count;++i) free_params_.push_back(array[i]); }
   
@@ -120,6 +128,17 @@ public:
     for(size_t i=0; i <num_joints_; ++i)
       ROS_INFO_STREAM(joint_names_[i] << " " << joint_min_vector_[i] << " " << joint_max_vector_[i] << " " << joint_has_limits_vector_[i]);
 
+    // ikfast_solver keeps its solutions, so every batch thread gets its own
+    int cache_size, batch_threads;
+    double cache_resolution;
+    node_handle.param("ik_cache_size", cache_size, 256);
+    node_handle.param("ik_cache_resolution", cache_resolution, 0.005);
+    node_handle.param("batch_threads", batch_threads, (int)boost::thread::hardware_concurrency());
+    solution_cache_.setCapacity(cache_size > 0 ? cache_size : 0);
+    solution_cache_.setResolution(cache_resolution);
+    for(int t = 0; t < std::max(batch_threads, 1); ++t)
+      batch_solvers_.push_back(new arm_kinematics_constraint_aware::ikfast_solver<IKSolution>(ik, num_joints_));
+
     return true;
   }
 
@@ -165,43 +184,9 @@ public:
                      const std::vector<double> &ik_seed_state,
                      std::vector<double> &solution,
                      int &error_code) {
-	
-    std::vector<double> vfree(free_params_.size());
-    for(std::size_t i = 0; i < free_params_.size(); ++i){
-      int p = free_params_[i];
-      //	    ROS_ERROR("%u is %f",p,ik_seed_state[p]);
-      vfree[i] = ik_seed_state[p];
-    }
-
-    KDL::Frame frame;
-    tf::PoseMsgToKDL(ik_pose,frame);
-
-    int numsol = ik_solver_->solve(frame,vfree);
-
-		
-    if(numsol){
-      for(int s = 0; s < numsol; ++s){
-        std::vector<double> sol;
-        ik_solver_->getSolution(s,sol);
-        bool obeys_limits = true;
-        for(unsigned int i = 0; i < sol.size(); i++) {
-          if(joint_has_limits_vector_[i] && (sol[i] < joint_min_vector_[i] || sol[i] > joint_max_vector_[i])) {
-            obeys_limits = false;
-            break;
-          }
-          //ROS_INFO_STREAM("Num " << i << " value " << sol[i] << " has limits " << joint_has_limits_vector_[i] << " " << joint_min_vector_[i] << " " << joint_max_vector_[i]);
-        }
-        if(obeys_limits) {
-          ik_solver_->getSolution(s,solution);
-          error_code = kinematics::SUCCESS;
-          return true;
-        }
-      }
-    }
-	
-    error_code = kinematics::NO_IK_SOLUTION; 
-    return false;
+    return solveClosest(ik_solver_, ik_pose, ik_seed_state, solution, error_code);
   }
+
   bool searchPositionIK(const geometry_msgs::Pose &ik_pose,
                         const std::vector<double> &ik_seed_state,
                         const double &timeout,
@@ -211,82 +196,10 @@ public:
     if(free_params_.size()==0){
       return getPositionIK(ik_pose, ik_seed_state,solution, error_code);
     }
-	
-    KDL::Frame frame;
-    tf::PoseMsgToKDL(ik_pose,frame);
-
-    std::vector<double> vfree(free_params_.size());
-
-    ros::Time maxTime = ros::Time::now() + ros::Duration(timeout);
-    int counter = 0;
-
-    double initial_guess = ik_seed_state[free_params_[0]];
-    vfree[0] = initial_guess;
-
-    int num_positive_increments = (joint_max_vector_[free_params_[0]]-initial_guess)/search_discretization_;
-    int num_negative_increments = (initial_guess-joint_min_vector_[free_params_[0]])/search_discretization_;
 
-    ROS_INFO_STREAM("Free param is " << free_params_[0] << " initial guess is " << initial_guess << " " << num_positive_increments << " " << num_negative_increments);
-
-    while(1) {
-      int numsol = ik_solver_->solve(frame,vfree);
-      
-      //ROS_INFO_STREAM("Solutions number is " << numsol);
-
-      //ROS_INFO("%f",vfree[0]);
-	    
-      if(numsol > 0){
-        for(int s = 0; s < numsol; ++s){
-          std::vector<double> sol;
-          ik_solver_->getSolution(s,sol);
-          bool obeys_limits = true;
-          for(unsigned int i = 0; i < sol.size(); i++) {
-            if(joint_has_limits_vector_[i] && (sol[i] < joint_min_vector_[i] || sol[i] > joint_max_vector_[i])) {
-              obeys_limits = false;
-              break;
-            }
-            //ROS_INFO_STREAM("Num " << i << " value " << sol[i] << " has limits " << joint_has_limits_vector_[i] << " " << joint_min_vector_[i] << " " << joint_max_vector_[i]);
-          }
-          if(obeys_limits) {
-            ik_solver_->getSolution(s,solution);
-            error_code = kinematics::SUCCESS;
-            return true;
-          }
-        }
-      }
-      
-      // if(numsol > 0){
-      //   for(unsigned int i = 0; i < sol.size(); i++) {
-      //     if(i == 0) {
-      //       ik_solver_->getClosestSolution(ik_seed_state,solution);
-      //     } else {
-      //       ik_solver_->getSolution(s,sol);            
-      //     }
-      //   }
-      //   bool obeys_limits = true;
-      //   for(unsigned int i = 0; i < solution.size(); i++) {
-      //     if(joint_has_limits_vector_[i] && (solution[i] < joint_min_vector_[i] || solution[i] > joint_max_vector_[i])) {
-      //       obeys_limits = false;
-      //       break;
-      //     }
-      //     //ROS_INFO_STREAM("Num " << i << " value " << sol[i] << " has limits " << joint_has_limits_vector_[i] << " " << joint_min_vector_[i] << " " << joint_max_vector_[i]);
-      //   }
-      //   if(obeys_limits) {
-      //     error_code = kinematics::SUCCESS;
-      //     return true;
-      //   }
-      // }
-      if(!getCount(counter, num_positive_increments, num_negative_increments)) {
-        error_code = kinematics::NO_IK_SOLUTION; 
-        return false;
-      }
-      
-      vfree[0] = initial_guess+search_discretization_*counter;
-      ROS_DEBUG_STREAM(counter << " " << vfree[0]);
-    }
-    //shouldn't ever get here
-    error_code = kinematics::NO_IK_SOLUTION; 
-    return false;
+    return searchFreeJoint(ik_solver_, ik_pose, ik_seed_state,
+                           joint_min_vector_[free_params_[0]], joint_max_vector_[free_params_[0]],
+                           NULL, solution, error_code);
   }      
 
   bool searchPositionIK(const geometry_msgs::Pose &ik_pose,
@@ -298,6 +211,7 @@ public:
                         int &error_code) {
 
     if(free_params_.size()==0){
+      //TODO - how to check consistency when there are no free params?
       return getPositionIK(ik_pose, ik_seed_state,solution, error_code);
     }
 
@@ -305,85 +219,12 @@ public:
       ROS_WARN_STREAM("Calling consistency search with wrong free param");
       return false;
     }
-	
-    KDL::Frame frame;
-    tf::PoseMsgToKDL(ik_pose,frame);
-
-    std::vector<double> vfree(free_params_.size());
-
-    ros::Time maxTime = ros::Time::now() + ros::Duration(timeout);
-    int counter = 0;
 
     double initial_guess = ik_seed_state[free_params_[0]];
-    vfree[0] = initial_guess;
-
     double max_limit = fmin(joint_max_vector_[free_params_[0]], initial_guess+consistency_limit);
     double min_limit = fmax(joint_min_vector_[free_params_[0]], initial_guess-consistency_limit);
 
-    int num_positive_increments = (int)((max_limit-initial_guess)/search_discretization_);
-    int num_negative_increments = (int)((initial_guess-min_limit)/search_discretization_);
-
-    ROS_DEBUG_STREAM("Free param is " << free_params_[0] << " initial guess is " << initial_guess << " " << num_positive_increments << " " << num_negative_increments);
-
-    while(1) {
-      int numsol = ik_solver_->solve(frame,vfree);
-      
-      //ROS_INFO_STREAM("Solutions number is " << numsol);
-
-      //ROS_INFO("%f",vfree[0]);
-	    
-      if(numsol > 0){
-        for(int s = 0; s < numsol; ++s){
-          std::vector<double> sol;
-          ik_solver_->getSolution(s,sol);
-          bool obeys_limits = true;
-          for(unsigned int i = 0; i < sol.size(); i++) {
-            if(joint_has_limits_vector_[i] && (sol[i] < joint_min_vector_[i] || sol[i] > joint_max_vector_[i])) {
-              obeys_limits = false;
-              break;
-            }
-            //ROS_INFO_STREAM("Num " << i << " value " << sol[i] << " has limits " << joint_has_limits_vector_[i] << " " << joint_min_vector_[i] << " " << joint_max_vector_[i]);
-          }
-          if(obeys_limits) {
-            ik_solver_->getSolution(s,solution);
-            error_code = kinematics::SUCCESS;
-            return true;
-          }
-        }
-      }
-      
-      // if(numsol > 0){
-      //   for(unsigned int i = 0; i < sol.size(); i++) {
-      //     if(i == 0) {
-      //       ik_solver_->getClosestSolution(ik_seed_state,solution);
-      //     } else {
-      //       ik_solver_->getSolution(s,sol);            
-      //     }
-      //   }
-      //   bool obeys_limits = true;
-      //   for(unsigned int i = 0; i < solution.size(); i++) {
-      //     if(joint_has_limits_vector_[i] && (solution[i] < joint_min_vector_[i] || solution[i] > joint_max_vector_[i])) {
-      //       obeys_limits = false;
-      //       break;
-      //     }
-      //     //ROS_INFO_STREAM("Num " << i << " value " << sol[i] << " has limits " << joint_has_limits_vector_[i] << " " << joint_min_vector_[i] << " " << joint_max_vector_[i]);
-      //   }
-      //   if(obeys_limits) {
-      //     error_code = kinematics::SUCCESS;
-      //     return true;
-      //   }
-      // }
-      if(!getCount(counter, num_positive_increments, num_negative_increments)) {
-        error_code = kinematics::NO_IK_SOLUTION; 
-        return false;
-      }
-      
-      vfree[0] = initial_guess+search_discretization_*counter;
-      ROS_DEBUG_STREAM(counter << " " << vfree[0]);
-    }
-    //shouldn't ever get here
-    error_code = kinematics::NO_IK_SOLUTION; 
-    return false;
+    return searchFreeJoint(ik_solver_, ik_pose, ik_seed_state, min_limit, max_limit, NULL, solution, error_code);
   }      
 
   bool searchPositionIK(const geometry_msgs::Pose &ik_pose,
@@ -394,7 +235,7 @@ public:
                         const boost::function<void(const geometry_msgs::Pose &ik_pose,const std::vector<double> &ik_solution,int &error_code)> &solution_callback,
                         int &error_code){
 
-    if(free_params_.size()==0){ 
+    if(free_params_.size()==0){
       if(!getPositionIK(ik_pose, ik_seed_state,solution, error_code)) {
         ROS_DEBUG_STREAM("No solution whatsoever");
         error_code = kinematics::NO_IK_SOLUTION; 
@@ -409,7 +250,7 @@ public:
         return false;
       }
     }
-	
+
     if(!desired_pose_callback.empty())
       desired_pose_callback(ik_pose,ik_seed_state,error_code);
     if(error_code < 0)
@@ -418,75 +259,9 @@ public:
       return false;
     }
 
-    KDL::Frame frame;
-    tf::PoseMsgToKDL(ik_pose,frame);
-
-    std::vector<double> vfree(free_params_.size());
-
-    ros::Time maxTime = ros::Time::now() + ros::Duration(timeout);
-    int counter = 0;
-
-    double initial_guess = ik_seed_state[free_params_[0]];
-    vfree[0] = initial_guess;
-
-    int num_positive_increments = (joint_max_vector_[free_params_[0]]-initial_guess)/search_discretization_;
-    int num_negative_increments = (initial_guess - joint_min_vector_[free_params_[0]])/search_discretization_;
-
-    ROS_DEBUG_STREAM("Free param is " << free_params_[0] << " initial guess is " << initial_guess << " " << num_positive_increments << " " << num_negative_increments);
-
-    unsigned int solvecount = 0;
-    unsigned int countsol = 0;
-
-    ros::WallTime start = ros::WallTime::now();
-
-    std::vector<double> sol;
-    while(1) {
-      int numsol = ik_solver_->solve(frame,vfree);
-      if(solvecount == 0) {
-        if(numsol == 0) {
-          ROS_DEBUG_STREAM("Bad solve time is " << ros::WallTime::now()-start);
-        } else {
-          ROS_DEBUG_STREAM("Good solve time is " << ros::WallTime::now()-start);
-        }
-      }
-      solvecount++;
-      if(numsol > 0){
-        if(solution_callback.empty()){
-          ik_solver_->getClosestSolution(ik_seed_state,solution);
-          error_code = kinematics::SUCCESS;
-          return true;
-        }
-        
-        for(int s = 0; s < numsol; ++s){
-          ik_solver_->getSolution(s,sol);
-          countsol++;
-          bool obeys_limits = true;
-          for(unsigned int i = 0; i < sol.size(); i++) {
-            if(joint_has_limits_vector_[i] && (sol[i] < joint_min_vector_[i] || sol[i] > joint_max_vector_[i])) {
-              obeys_limits = false;
-              break;
-            }
-          }
-          if(obeys_limits) {
-            solution_callback(ik_pose,sol,error_code);
-            if(error_code == kinematics::SUCCESS){
-              solution = sol;
-              ROS_DEBUG_STREAM("Took " << (ros::WallTime::now() - start) << " to return true " << countsol << " " << solvecount);
-              return true;
-            }
-          }
-        }
-      }
-      if(!getCount(counter, num_positive_increments, num_negative_increments)) {
-        error_code = kinematics::NO_IK_SOLUTION; 
-        ROS_DEBUG_STREAM("Took " << (ros::WallTime::now() - start) << " to return false " << countsol << " " << solvecount);
-        return false;
-      }
-      vfree[0] = initial_guess+search_discretization_*counter;
-      ROS_DEBUG_STREAM(counter << " " << vfree[0]);
-    }
-    error_code = kinematics::NO_IK_SOLUTION; 
-    return false;
+    return searchFreeJoint(ik_solver_, ik_pose, ik_seed_state,
+                           joint_min_vector_[free_params_[0]], joint_max_vector_[free_params_[0]],
+                           &solution_callback, solution, error_code);
   }      
 
   bool searchPositionIK(const geometry_msgs::Pose &ik_pose,
@@ -499,7 +274,7 @@ public:
                         const boost::function<void(const geometry_msgs::Pose &ik_pose,const std::vector<double> &ik_solution,int &error_code)> &solution_callback,
                         int &error_code){
 
-    if(free_params_.size()==0){ 
+    if(free_params_.size()==0){
       if(!getPositionIK(ik_pose, ik_seed_state,solution, error_code)) {
         ROS_DEBUG_STREAM("No solution whatsoever");
         error_code = kinematics::NO_IK_SOLUTION; 
@@ -528,79 +303,68 @@ public:
       return false;
     }
 
-    KDL::Frame frame;
-    tf::PoseMsgToKDL(ik_pose,frame);
-
-    std::vector<double> vfree(free_params_.size());
-
-    ros::Time maxTime = ros::Time::now() + ros::Duration(timeout);
-    int counter = 0;
-
     double initial_guess = ik_seed_state[free_params_[0]];
-    vfree[0] = initial_guess;
-
     double max_limit = fmin(joint_max_vector_[free_params_[0]], initial_guess+consistency_limit);
     double min_limit = fmax(joint_min_vector_[free_params_[0]], initial_guess-consistency_limit);
 
-    int num_positive_increments = (int)((max_limit-initial_guess)/search_discretization_);
-    int num_negative_increments = (int)((initial_guess-min_limit)/search_discretization_);
-
-    ROS_DEBUG_STREAM("Free param is " << free_params_[0] << " initial guess is " << initial_guess << " " << num_positive_increments << " " << num_negative_increments);
-
-    unsigned int solvecount = 0;
-    unsigned int countsol = 0;
+    return searchFreeJoint(ik_solver_, ik_pose, ik_seed_state, min_limit, max_limit,
+                           &solution_callback, solution, error_code);
+  }      
 
-    ros::WallTime start = ros::WallTime::now();
+  /**
+   * \brief Batch search, spread over batch_threads solver threads
+   */
+  bool searchPositionIK(const std::vector<geometry_msgs::Pose> &ik_poses,
+                        const std::vector<double> &ik_seed_state,
+                        const double &timeout,
+                        std::vector<std::vector<double> > &solutions,
+                        std::vector<int> &error_codes) {
+
+    solutions.assign(ik_poses.size(), std::vector<double>());
+    error_codes.assign(ik_poses.size(), kinematics::NO_IK_SOLUTION);
+
+    BatchJob job;
+    job.poses = &ik_poses;
+    job.seed = &ik_seed_state;
+    job.timeout = timeout;
+    job.solutions = &solutions;
+    job.error_codes = &error_codes;
+    job.next = 0;
+
+    size_t num_threads = std::min(batch_solvers_.size(), ik_poses.size());
+    if(num_threads <= 1) {
+      batchWorker(ik_solver_, &job);
+    } else {
+      boost::thread_group threads;
+      for(size_t t = 0; t < num_threads; ++t)
+        threads.create_thread(boost::bind(&IKFastKinematicsPlugin::batchWorker, this, batch_solvers_[t], &job));
+      threads.join_all();
+    }
 
-    std::vector<double> sol;
-    while(1) {
-      int numsol = ik_solver_->solve(frame,vfree);
-      if(solvecount == 0) {
-        if(numsol == 0) {
-          ROS_DEBUG_STREAM("Bad solve time is " << ros::WallTime::now()-start);
-        } else {
-          ROS_DEBUG_STREAM("Good solve time is " << ros::WallTime::now()-start);
-        }
-      }
-      solvecount++;
-      if(numsol > 0){
-        if(solution_callback.empty()){
-          ik_solver_->getClosestSolution(ik_seed_state,solution);
-          error_code = kinematics::SUCCESS;
-          return true;
-        }
-        
-        for(int s = 0; s < numsol; ++s){
-          ik_solver_->getSolution(s,sol);
-          countsol++;
-          bool obeys_limits = true;
-          for(unsigned int i = 0; i < sol.size(); i++) {
-            if(joint_has_limits_vector_[i] && (sol[i] < joint_min_vector_[i] || sol[i] > joint_max_vector_[i])) {
-              obeys_limits = false;
-              break;
-            }
-          }
-          if(obeys_limits) {
-            solution_callback(ik_pose,sol,error_code);
-            if(error_code == kinematics::SUCCESS){
-              solution = sol;
-              ROS_DEBUG_STREAM("Took " << (ros::WallTime::now() - start) << " to return true " << countsol << " " << solvecount);
-              return true;
-            }
-          }
-        }
-      }
-      if(!getCount(counter, num_positive_increments, num_negative_increments)) {
-        error_code = kinematics::NO_IK_SOLUTION; 
-        ROS_DEBUG_STREAM("Took " << (ros::WallTime::now() - start) << " to return false " << countsol << " " << solvecount);
+    for(size_t i = 0; i < error_codes.size(); ++i)
+      if(error_codes[i] != kinematics::SUCCESS)
         return false;
-      }
-      vfree[0] = initial_guess+search_discretization_*counter;
-      ROS_DEBUG_STREAM(counter << " " << vfree[0]);
+    return true;
+  }
+
+  bool getTipPose(const std::vector<double> &joint_angles,
+                  geometry_msgs::Pose &pose) {
+    if(joint_angles.size() != num_joints_) {
+      ROS_ERROR("Expected %d joint values, got %d", (int)num_joints_, (int)joint_angles.size());
+      return false;
     }
-    error_code = kinematics::NO_IK_SOLUTION; 
-    return false;
-  }      
+
+    // the fk member is never set, call the generated function
+    KDL::Frame p_out;
+    double eerot[9], eetrans[3];
+    ADEPT_VIPER_S650_arm_1_kinematics::fk(&joint_angles[0],eetrans,eerot);
+    for(int i=0; i<3;++i) p_out.p.data[i] = eetrans[i];
+    for(int i=0; i<9;++i) p_out.M.data[i] = eerot[i];
+    tf::PoseKDLToMsg(p_out,pose);
+    return true;
+  }
+
+  ikfast_batch_kinematics::IKSolutionCache& getSolutionCache() { return solution_cache_; }
 
   bool getPositionFK(const std::vector<std::string> &link_names,
                      const std::vector<double> &joint_angles, 
@@ -633,6 +397,180 @@ public:
   }      
   const std::vector<std::string>& getJointNames() const { return joint_names_; }
   const std::vector<std::string>& getLinkNames() const { return link_names_; }
+
+private:
+
+  /**
+   * \brief Poses shared by the batch solver threads
+   */
+  struct BatchJob
+  {
+    const std::vector<geometry_msgs::Pose> *poses;
+    const std::vector<double> *seed;
+    double timeout;
+    std::vector<std::vector<double> > *solutions;
+    std::vector<int> *error_codes;
+    size_t next;
+    boost::mutex mutex;
+  };
+
+  void batchWorker(arm_kinematics_constraint_aware::ik_solver_base* solver, BatchJob *job) {
+    while(1) {
+      size_t i;
+      {
+        boost::mutex::scoped_lock lock(job->mutex);
+        if(job->next >= job->poses->size())
+          return;
+        i = job->next++;
+      }
+
+      const geometry_msgs::Pose &pose = (*job->poses)[i];
+      if(free_params_.size()==0) {
+        solveClosest(solver, pose, *job->seed, (*job->solutions)[i], (*job->error_codes)[i]);
+      } else {
+        searchFreeJoint(solver, pose, *job->seed,
+                        joint_min_vector_[free_params_[0]], joint_max_vector_[free_params_[0]],
+                        NULL, (*job->solutions)[i], (*job->error_codes)[i]);
+      }
+    }
+  }
+
+  bool obeysLimits(const std::vector<double> &sol) const {
+    for(unsigned int i = 0; i < sol.size(); i++) {
+      if(joint_has_limits_vector_[i] && (sol[i] < joint_min_vector_[i] || sol[i] > joint_max_vector_[i]))
+        return false;
+    }
+    return true;
+  }
+
+  /**
+   * \brief Solves a pose without free joints, taking the solution within the
+   * joint limits closest to the seed
+   */
+  bool solveClosest(arm_kinematics_constraint_aware::ik_solver_base* solver,
+                    const geometry_msgs::Pose &ik_pose,
+                    const std::vector<double> &ik_seed_state,
+                    std::vector<double> &solution,
+                    int &error_code) {
+    std::vector<double> vfree(free_params_.size());
+    for(std::size_t i = 0; i < free_params_.size(); ++i)
+      vfree[i] = ik_seed_state[free_params_[i]];
+
+    KDL::Frame frame;
+    tf::PoseMsgToKDL(ik_pose,frame);
+
+    int numsol = solver->solve(frame,vfree);
+    double best = -1.0;
+    std::vector<double> sol;
+    for(int s = 0; s < numsol; ++s){
+      solver->getSolution(s,sol);
+      if(!obeysLimits(sol))
+        continue;
+      double dist = 0.0;
+      for(unsigned int i = 0; i < sol.size() && i < ik_seed_state.size(); i++)
+        dist += (sol[i]-ik_seed_state[i])*(sol[i]-ik_seed_state[i]);
+      if(best < 0.0 || dist < best) {
+        best = dist;
+        solution = sol;
+      }
+    }
+
+    error_code = best < 0.0 ? kinematics::NO_IK_SOLUTION : kinematics::SUCCESS;
+    return error_code == kinematics::SUCCESS;
+  }
+
+  /**
+   * \brief Solves for one free joint value.
+   * \param solution_callback NULL to accept the first solution within the
+   * joint limits, an empty callback to take the solution closest to the seed,
+   * otherwise the first solution within the limits the callback accepts
+   */
+  bool trySolutions(arm_kinematics_constraint_aware::ik_solver_base* solver,
+                    const geometry_msgs::Pose &ik_pose,
+                    const KDL::Frame &frame,
+                    const std::vector<double> &vfree,
+                    const std::vector<double> &ik_seed_state,
+                    const boost::function<void(const geometry_msgs::Pose &ik_pose,const std::vector<double> &ik_solution,int &error_code)> *solution_callback,
+                    std::vector<double> &solution,
+                    int &error_code) {
+    int numsol = solver->solve(frame,vfree);
+    if(numsol <= 0)
+      return false;
+
+    if(solution_callback != NULL && solution_callback->empty()){
+      solver->getClosestSolution(ik_seed_state,solution);
+      error_code = kinematics::SUCCESS;
+      return true;
+    }
+
+    std::vector<double> sol;
+    for(int s = 0; s < numsol; ++s){
+      solver->getSolution(s,sol);
+      if(!obeysLimits(sol))
+        continue;
+      if(solution_callback != NULL) {
+        (*solution_callback)(ik_pose,sol,error_code);
+        if(error_code != kinematics::SUCCESS)
+          continue;
+      }
+      solution = sol;
+      error_code = kinematics::SUCCESS;
+      return true;
+    }
+    return false;
+  }
+
+  /**
+   * \brief Searches the free joint between min_limit and max_limit. The free
+   * joint value of a cached solution for the same pose is tried first, then
+   * the search steps away from the seed alternating up and down.
+   */
+  bool searchFreeJoint(arm_kinematics_constraint_aware::ik_solver_base* solver,
+                       const geometry_msgs::Pose &ik_pose,
+                       const std::vector<double> &ik_seed_state,
+                       double min_limit,
+                       double max_limit,
+                       const boost::function<void(const geometry_msgs::Pose &ik_pose,const std::vector<double> &ik_solution,int &error_code)> *solution_callback,
+                       std::vector<double> &solution,
+                       int &error_code) {
+    KDL::Frame frame;
+    tf::PoseMsgToKDL(ik_pose,frame);
+
+    int free_joint = free_params_[0];
+    std::vector<double> vfree(free_params_.size());
+    double initial_guess = ik_seed_state[free_joint];
+
+    int num_positive_increments = (int)((max_limit-initial_guess)/search_discretization_);
+    int num_negative_increments = (int)((initial_guess-min_limit)/search_discretization_);
+
+    ROS_DEBUG_STREAM("Free param is " << free_joint << " initial guess is " << initial_guess << " " << num_positive_increments << " " << num_negative_increments);
+
+    std::vector<double> cached;
+    if(solution_cache_.lookup(ik_pose, cached) && cached.size() == num_joints_ &&
+       cached[free_joint] >= min_limit && cached[free_joint] <= max_limit) {
+      vfree[0] = cached[free_joint];
+      if(trySolutions(solver, ik_pose, frame, vfree, ik_seed_state, solution_callback, solution, error_code)) {
+        ROS_DEBUG_STREAM("Solved from cached free joint value " << vfree[0]);
+        return true;
+      }
+    }
+
+    // getCount expects the lower bound as a (non positive) step count
+    int counter = 0;
+    vfree[0] = initial_guess;
+    while(1) {
+      if(trySolutions(solver, ik_pose, frame, vfree, ik_seed_state, solution_callback, solution, error_code)) {
+        solution_cache_.insert(ik_pose, solution);
+        return true;
+      }
+      if(!getCount(counter, num_positive_increments, -num_negative_increments)) {
+        error_code = kinematics::NO_IK_SOLUTION; 
+        return false;
+      }
+      vfree[0] = initial_guess+search_discretization_*counter;
+      ROS_DEBUG_STREAM(counter << " " << vfree[0]);
+    }
+  }
 };
 }
 
@@ -62,6 +62,12 @@ public:
   /**
    * \brief Constructor
    *
+   * The private parameter ~bulk_download (default false) selects whether
+   * trajectories are packed into JointTrajBulkMessage frames or sent one
+   * JointTrajPtMessage per point. Bulk frames need a controller that
+   * understands JOINT_TRAJ_PT_BULK, the V+ server only handles per point
+   * messages.
+   *
    * \param ROS node handle (used for subscribing)
    * \param ROS node handle (used for publishing (to the robot controller))
    */
@@ -71,11 +77,40 @@ public:
 
   void jointTrajectoryCB(const trajectory_msgs::JointTrajectoryConstPtr &msg);
 
+  /**
+   * \brief Downloads a trajectory to the controller
+   *
+   * \param trajectory to download, empty trajectories are ignored
+   */
+  void download(const trajectory_msgs::JointTrajectory &traj);
+
+  void setConnection(industrial::smpl_msg_connection::SmplMsgConnection* robotConnecton)
+  {
+    this->robot_ = robotConnecton;
+  }
+
+  void setBulkDownload(bool bulk_download)
+  {
+    this->bulk_download_ = bulk_download;
+  }
+
 private:
 
+  /**
+   * \brief Sends one JointTrajPtMessage per trajectory point
+   */
+  void downloadPoints(const trajectory_msgs::JointTrajectory &traj);
+
+  /**
+   * \brief Sends the trajectory in JointTrajBulkMessage frames of up to
+   * JointTrajBulkMessage::MAX_POINTS points
+   */
+  void downloadBulk(const trajectory_msgs::JointTrajectory &traj);
+
   industrial::smpl_msg_connection::SmplMsgConnection* robot_;
   ros::Subscriber sub_joint_trajectory_; //subscribe to "command"
   ros::NodeHandle node_;
+  bool bulk_download_;
 
 };
 
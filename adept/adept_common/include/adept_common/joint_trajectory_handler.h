@@ -35,6 +35,7 @@
 #include "simple_message/smpl_msg_connection.h"
 #include "ros/ros.h"
 #include <boost/thread/thread.hpp>
+#include <boost/thread/condition_variable.hpp>
 #include <sensor_msgs/JointState.h>
 #include <trajectory_msgs/JointTrajectory.h>
 
@@ -72,6 +73,11 @@ public:
   /**
    * \brief Constructor
    *
+   * The private parameters ~streaming_window (number of points sent to the
+   * controller before waiting for a reply, default 1) and ~allow_splicing
+   * (append new trajectories to the current one instead of stopping,
+   * default false) select the streaming mode.
+   *
    * \param ROS node handle (used for subscribing)
    * \param ROS node handle (used for publishing (to the robot controller))
    */
@@ -86,15 +92,33 @@ private:
 
   void trajectoryStop();
 
+  /**
+   * \brief Replaces the points of the current trajectory that have not been
+   * sent yet with new_traj, starting at the point of new_traj closest to the
+   * last point sent.  Must be called with the mutex held.
+   */
+  void spliceTrajectory(const trajectory_msgs::JointTrajectory &new_traj);
+
+  /**
+   * \brief Waits for the replies of every point still in flight
+   */
+  void drainReplies();
+
   industrial::smpl_msg_connection::SmplMsgConnection* robot_;
   ros::Subscriber sub_joint_tranectory_; //subscribe to "command"
   ros::NodeHandle node_;
 
   boost::thread* trajectoryHandler_;
   boost::mutex mutex_;int currentPoint;
+  boost::condition_variable trajectory_cond_;
   trajectory_msgs::JointTrajectory current_traj_;
   JointTrajectoryState state_;
 
+  int streaming_window_;
+  bool allow_splicing_;
+  bool stop_requested_;
+  int points_in_flight_;
+
   static const int NUM_OF_JOINTS_ = 6;
 };
 
@@ -0,0 +1,160 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2011, Southwest Research Institute
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 	* Redistributions of source code must retain the above copyright
+ * 	notice, this list of conditions and the following disclaimer.
+ * 	* Redistributions in binary form must reproduce the above copyright
+ * 	notice, this list of conditions and the following disclaimer in the
+ * 	documentation and/or other materials provided with the distribution.
+ * 	* Neither the name of the Southwest Research Institute, nor the names
+ *	of its contributors may be used to endorse or promote products derived
+ *	from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef JOINT_TRAJ_BULK_MESSAGE_H
+#define JOINT_TRAJ_BULK_MESSAGE_H
+
+#include "simple_message/typed_message.h"
+#include "simple_message/simple_message.h"
+#include "simple_message/shared_types.h"
+#include "adept_common/adept.h"
+
+namespace industrial
+{
+namespace joint_traj_bulk_message
+{
+
+/**
+ * \brief Flags marking the first and last frame of a bulk download
+ */
+namespace BulkFlags
+{
+  enum BulkFlag
+  {
+    NONE = 0,
+    START_TRAJECTORY = 1,
+    END_TRAJECTORY = 2
+  };
+}
+typedef BulkFlags::BulkFlag BulkFlag;
+
+/**
+ * \brief Class encapsulating a block of joint trajectory points that are
+ * downloaded in a single simple message.
+ *
+ * The data section always has the same size, whatever the number of valid
+ * points, so the controller can copy it into a fixed buffer:
+ *
+ *   int   first_point                     index of points[0] in the trajectory
+ *   int   flags                           BulkFlags
+ *   int   num_points                      valid entries in points
+ *   MAX_POINTS x
+ *     real  positions[MAX_NUM_JOINTS]     joint positions (rad)
+ *     real  velocity                      joint velocity (0 when unknown)
+ *     real  duration                      time from the previous point (s)
+ *
+ * Unused points are sent as zeros.
+ */
+//* JointTrajBulkMessage
+/**
+ *
+ *
+ * THIS CLASS IS NOT THREAD-SAFE
+ *
+ */
+
+class JointTrajBulkMessage : public industrial::typed_message::TypedMessage
+{
+public:
+
+  /**
+   * \brief Points per message, keeps a frame under 2 KB
+   */
+  static const int MAX_POINTS = 32;
+
+  /**
+   * \brief Joints per point, the same as industrial::joint_data::JointData
+   */
+  static const int MAX_NUM_JOINTS = 10;
+
+  /**
+   * \brief Default constructor
+   *
+   * This method creates an empty message.
+   *
+   */
+  JointTrajBulkMessage(void);
+  /**
+   * \brief Destructor
+   *
+   */
+  ~JointTrajBulkMessage(void);
+  /**
+   * \brief Initializes message from a simple message
+   *
+   * \param simple message to construct from
+   *
+   * \return true if message successfully initialized, otherwise false
+   */
+  bool init(industrial::simple_message::SimpleMessage & msg);
+
+  /**
+   * \brief Initializes a new message
+   *
+   */
+  void init();
+
+  /**
+   * \brief Appends a point to the message
+   *
+   * \param joint positions (at most MAX_NUM_JOINTS are used)
+   * \param number of joint positions
+   * \param velocity
+   * \param time from the previous point
+   *
+   * \return false if the message is full
+   */
+  bool addPoint(const industrial::shared_types::shared_real *positions, int num_joints,
+                industrial::shared_types::shared_real velocity, industrial::shared_types::shared_real duration);
+
+  // Overrides - SimpleSerialize
+  bool load(industrial::byte_array::ByteArray *buffer);
+  bool unload(industrial::byte_array::ByteArray *buffer);
+
+  unsigned int byteLength()
+  {
+    return 3 * sizeof(industrial::shared_types::shared_int)
+        + MAX_POINTS * (MAX_NUM_JOINTS + 2) * sizeof(industrial::shared_types::shared_real);
+  }
+
+  industrial::shared_types::shared_int first_point_;
+  industrial::shared_types::shared_int flags_;
+  industrial::shared_types::shared_int num_points_;
+  industrial::shared_types::shared_real positions_[MAX_POINTS][MAX_NUM_JOINTS];
+  industrial::shared_types::shared_real velocities_[MAX_POINTS];
+  industrial::shared_types::shared_real durations_[MAX_POINTS];
+
+};
+
+}
+}
+
+#endif /* JOINT_TRAJ_BULK_MESSAGE_H */
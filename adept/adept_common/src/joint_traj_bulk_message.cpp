@@ -0,0 +1,146 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2011, Southwest Research Institute
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 	* Redistributions of source code must retain the above copyright
+ * 	notice, this list of conditions and the following disclaimer.
+ * 	* Redistributions in binary form must reproduce the above copyright
+ * 	notice, this list of conditions and the following disclaimer in the
+ * 	documentation and/or other materials provided with the distribution.
+ * 	* Neither the name of the Southwest Research Institute, nor the names
+ *	of its contributors may be used to endorse or promote products derived
+ *	from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "adept_common/adept.h"
+#include "adept_common/messages/joint_traj_bulk_message.h"
+#include "simple_message/byte_array.h"
+#include "simple_message/log_wrapper.h"
+
+using namespace industrial::shared_types;
+using namespace industrial::byte_array;
+using namespace industrial::simple_message;
+using namespace industrial::adept;
+
+namespace industrial
+{
+namespace joint_traj_bulk_message
+{
+
+JointTrajBulkMessage::JointTrajBulkMessage(void)
+{
+  this->setMessageType(AdeptMsgTypes::JOINT_TRAJ_PT_BULK);
+  this->init();
+}
+
+JointTrajBulkMessage::~JointTrajBulkMessage(void)
+{
+
+}
+
+bool JointTrajBulkMessage::init(industrial::simple_message::SimpleMessage & msg)
+{
+  this->setMessageType(AdeptMsgTypes::JOINT_TRAJ_PT_BULK);
+  this->init();
+  return this->unload(&msg.getData());
+}
+
+void JointTrajBulkMessage::init()
+{
+  this->first_point_ = 0;
+  this->flags_ = BulkFlags::NONE;
+  this->num_points_ = 0;
+  for (int i = 0; i < MAX_POINTS; i++)
+  {
+    for (int j = 0; j < MAX_NUM_JOINTS; j++)
+    {
+      this->positions_[i][j] = 0.0;
+    }
+    this->velocities_[i] = 0.0;
+    this->durations_[i] = 0.0;
+  }
+}
+
+bool JointTrajBulkMessage::addPoint(const shared_real *positions, int num_joints, shared_real velocity,
+                                    shared_real duration)
+{
+  if (this->num_points_ >= MAX_POINTS)
+  {
+    return false;
+  }
+  for (int j = 0; j < MAX_NUM_JOINTS; j++)
+  {
+    this->positions_[this->num_points_][j] = j < num_joints ? positions[j] : 0.0;
+  }
+  this->velocities_[this->num_points_] = velocity;
+  this->durations_[this->num_points_] = duration;
+  this->num_points_++;
+  return true;
+}
+
+bool JointTrajBulkMessage::load(ByteArray *buffer)
+{
+  LOG_COMM("Executing joint trajectory bulk message load");
+  bool rtn = buffer->load(this->first_point_) && buffer->load(this->flags_) && buffer->load(this->num_points_);
+  for (int i = 0; rtn && i < MAX_POINTS; i++)
+  {
+    for (int j = 0; rtn && j < MAX_NUM_JOINTS; j++)
+    {
+      rtn = buffer->load(this->positions_[i][j]);
+    }
+    rtn = rtn && buffer->load(this->velocities_[i]) && buffer->load(this->durations_[i]);
+  }
+
+  if (!rtn)
+  {
+    LOG_ERROR("Failed to load joint trajectory bulk data");
+  }
+  return rtn;
+}
+
+bool JointTrajBulkMessage::unload(ByteArray *buffer)
+{
+  // Byte arrays unload from the back, so the fields come out in reverse
+  LOG_COMM("Executing joint trajectory bulk message unload");
+  bool rtn = true;
+  for (int i = MAX_POINTS - 1; rtn && i >= 0; i--)
+  {
+    rtn = buffer->unload(this->durations_[i]) && buffer->unload(this->velocities_[i]);
+    for (int j = MAX_NUM_JOINTS - 1; rtn && j >= 0; j--)
+    {
+      rtn = buffer->unload(this->positions_[i][j]);
+    }
+  }
+  rtn = rtn && buffer->unload(this->num_points_) && buffer->unload(this->flags_) && buffer->unload(this->first_point_);
+
+  if (rtn && (this->num_points_ < 0 || this->num_points_ > MAX_POINTS))
+  {
+    LOG_ERROR("Invalid number of points in bulk message: %d", this->num_points_);
+    rtn = false;
+  }
+  if (!rtn)
+  {
+    LOG_ERROR("Failed to unload joint trajectory bulk data");
+  }
+  return rtn;
+}
+
+}
+}
@@ -0,0 +1,204 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2011, Southwest Research Institute
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 	* Redistributions of source code must retain the above copyright
+ * 	notice, this list of conditions and the following disclaimer.
+ * 	* Redistributions in binary form must reproduce the above copyright
+ * 	notice, this list of conditions and the following disclaimer in the
+ * 	documentation and/or other materials provided with the distribution.
+ * 	* Neither the name of the Southwest Research Institute, nor the names
+ *	of its contributors may be used to endorse or promote products derived
+ *	from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Loopback benchmark for trajectory download.  A stand-in controller
+// runs on a local socket, decodes every downloaded point and checks it
+// against the sent trajectory, for both the per point and the bulk message.
+// usage: joint_traj_download_benchmark [num_points] [port]
+
+#include "adept_common/joint_trajectory_downloader.h"
+#include "adept_common/messages/joint_traj_bulk_message.h"
+#include "simple_message/joint_data.h"
+#include "simple_message/joint_traj_pt.h"
+#include "simple_message/messages/joint_traj_pt_message.h"
+#include "simple_message/socket/simple_socket.h"
+#include "simple_message/socket/tcp_client.h"
+#include "simple_message/socket/tcp_server.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <sstream>
+#include <boost/thread/thread.hpp>
+
+using namespace industrial::simple_message;
+using namespace industrial::shared_types;
+using namespace industrial::joint_data;
+using namespace industrial::joint_traj_pt;
+using namespace industrial::joint_traj_pt_message;
+using namespace industrial::joint_traj_bulk_message;
+using namespace industrial::adept;
+
+static const int NUM_JOINTS = 6;
+
+/**
+ * \brief Result of one download as seen by the stand-in controller
+ */
+struct DownloadStats
+{
+  int points;
+  int frames;
+  int errors;
+  ros::WallTime end;
+};
+
+bool checkPoint(const trajectory_msgs::JointTrajectory &traj, int index, const shared_real *positions)
+{
+  if (index < 0 || index >= traj.points.size())
+  {
+    return false;
+  }
+  for (int j = 0; j < NUM_JOINTS; j++)
+  {
+    if ((shared_real)traj.points[index].positions[j] != positions[j])
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * \brief Accepts one connection and receives points until the end of the
+ * trajectory, validating every decoded position
+ */
+void controllerStandIn(industrial::tcp_server::TcpServer *server, const trajectory_msgs::JointTrajectory *traj,
+                       DownloadStats *stats)
+{
+  SimpleMessage msg;
+  JointTrajPtMessage ptMsg;
+  JointTrajBulkMessage bulkMsg;
+  shared_real positions[JointTrajBulkMessage::MAX_NUM_JOINTS];
+  bool done = false;
+
+  stats->points = 0;
+  stats->frames = 0;
+  stats->errors = 0;
+  server->makeConnect();
+  while (!done && server->receiveMsg(msg))
+  {
+    stats->frames++;
+    if (AdeptMsgTypes::JOINT_TRAJ_PT_BULK == msg.getMessageType())
+    {
+      if (!bulkMsg.init(msg))
+      {
+        stats->errors++;
+        continue;
+      }
+      for (int i = 0; i < bulkMsg.num_points_; i++)
+      {
+        if (!checkPoint(*traj, bulkMsg.first_point_ + i, bulkMsg.positions_[i]))
+        {
+          stats->errors++;
+        }
+        stats->points++;
+      }
+      done = bulkMsg.flags_ & BulkFlags::END_TRAJECTORY;
+    }
+    else
+    {
+      JointData data;
+      ptMsg.init(msg);
+      ptMsg.point_.getJointPosition(data);
+      for (int j = 0; j < NUM_JOINTS; j++)
+      {
+        data.getJoint(j, positions[j]);
+      }
+      if (!checkPoint(*traj, stats->points, positions))
+      {
+        stats->errors++;
+      }
+      stats->points++;
+      done = SpecialSeqValues::END_TRAJECTORY == ptMsg.point_.getSequence();
+    }
+  }
+  stats->end = ros::WallTime::now();
+}
+
+void runDownload(int port, bool bulk, const trajectory_msgs::JointTrajectory &traj)
+{
+  industrial::tcp_server::TcpServer server;
+  industrial::tcp_client::TcpClient client;
+  adept::joint_trajectory_downloader::JointTrajectoryDownloader downloader;
+  DownloadStats stats;
+  char ip[] = "127.0.0.1";
+
+  server.init(port);
+  boost::thread controller(boost::bind(&controllerStandIn, &server, &traj, &stats));
+
+  client.init(ip, port);
+  while (!client.makeConnect())
+  {
+    ros::WallDuration(0.01).sleep();
+  }
+
+  downloader.setConnection(&client);
+  downloader.setBulkDownload(bulk);
+  ros::WallTime start = ros::WallTime::now();
+  downloader.download(traj);
+  controller.join();
+
+  double elapsed = (stats.end - start).toSec();
+  ROS_INFO("%s download: %d points in %d frames, %.2f ms, %.0f points/s, %d mismatched points",
+           bulk ? "bulk" : "per point", stats.points, stats.frames, elapsed * 1000.0,
+           stats.points / elapsed, stats.errors);
+}
+
+int main(int argc, char** argv)
+{
+  ros::Time::init();
+  int num_points = argc > 1 ? atoi(argv[1]) : 1000;
+  int port = argc > 2 ? atoi(argv[2]) : 11500;
+
+  // Smooth joint space motion with distinct values for every joint and point
+  trajectory_msgs::JointTrajectory traj;
+  for (int j = 0; j < NUM_JOINTS; j++)
+  {
+    std::stringstream name;
+    name << "joint_" << j + 1;
+    traj.joint_names.push_back(name.str());
+  }
+  traj.points.resize(num_points);
+  for (int i = 0; i < num_points; i++)
+  {
+    traj.points[i].positions.resize(NUM_JOINTS);
+    for (int j = 0; j < NUM_JOINTS; j++)
+    {
+      traj.points[i].positions[j] = sin(0.01 * i + j) * (1.0 + 0.1 * j);
+    }
+    traj.points[i].time_from_start = ros::Duration(0.01 * i);
+  }
+
+  // Each run uses its own port so a socket in TIME_WAIT does not get in the way
+  runDownload(port, false, traj);
+  runDownload(port + 1, true, traj);
+
+  return 0;
+}
@@ -33,19 +33,24 @@
 #include "simple_message/joint_traj_pt.h"
 #include "simple_message/messages/joint_traj_pt_message.h"
 #include "simple_message/smpl_msg_connection.h"
+#include "adept_common/messages/joint_traj_bulk_message.h"
+#include <algorithm>
 
 using namespace industrial::smpl_msg_connection;
 using namespace industrial::joint_data;
 using namespace industrial::joint_traj_pt;
 using namespace industrial::joint_traj_pt_message;
 using namespace industrial::simple_message;
+using namespace industrial::shared_types;
+using namespace industrial::joint_traj_bulk_message;
 
 
 namespace adept
 {
 namespace joint_trajectory_downloader
 {
-JointTrajectoryDownloader::JointTrajectoryDownloader()
+JointTrajectoryDownloader::JointTrajectoryDownloader() :
+		robot_(NULL), bulk_download_(false)
 {
 }
 
@@ -57,7 +62,11 @@ JointTrajectoryDownloader::JointTrajectoryDownloader(ros::NodeHandle &n,
 	this->sub_joint_trajectory_ = this->node_.subscribe("command",
 			0, &JointTrajectoryDownloader::jointTrajectoryCB, this);
 	this->robot_ = robotConnecton;
-	ROS_INFO("Joint trajectory downloader node initialized");
+
+	ros::NodeHandle pn("~");
+	pn.param("bulk_download", this->bulk_download_, false);
+	ROS_INFO("Joint trajectory downloader node initialized (%s download)",
+			this->bulk_download_ ? "bulk" : "per point");
 }
 
 JointTrajectoryDownloader::~JointTrajectoryDownloader()
@@ -85,16 +94,39 @@ void JointTrajectoryDownloader::jointTrajectoryCB(
 		return;
 	}
   */
-	for (int i = 0; i < msg->points.size(); i++)
+	download(*msg);
+}
+
+void JointTrajectoryDownloader::download(
+		const trajectory_msgs::JointTrajectory &traj)
+{
+	if (traj.points.empty())
+	{
+		ROS_INFO("Empty trajectory received, nothing is downloaded");
+		return;
+	}
+
+	if (this->bulk_download_)
+	{
+		downloadBulk(traj);
+	}
+	else
+	{
+		downloadPoints(traj);
+	}
+}
+
+void JointTrajectoryDownloader::downloadPoints(
+		const trajectory_msgs::JointTrajectory &traj)
+{
+	for (int i = 0; i < traj.points.size(); i++)
 	{
 		ROS_INFO("Sending joints trajectory point[%d]", i);
 
 		JointTrajPt jPt;
 		JointTrajPtMessage jMsg;
 		SimpleMessage topic;
-		trajectory_msgs::JointTrajectoryPoint pt;
-
-		pt = msg->points[i];
+		const trajectory_msgs::JointTrajectoryPoint &pt = traj.points[i];
 
 		// The first and last sequence values must be given a special sequence
 		// value
@@ -103,21 +135,20 @@ void JointTrajectoryDownloader::jointTrajectoryCB(
 			ROS_DEBUG("First trajectory point, setting special sequence value");
 			jPt.setSequence(SpecialSeqValues::START_TRAJECTORY_DOWNLOAD);
 		}
-		else if (msg->points.size() - 1 == i)
+		else if (traj.points.size() - 1 == i)
 		{
 			ROS_DEBUG("Last trajectory point, setting special sequence value");
-			jMsg.point_.setSequence(SpecialSeqValues::END_TRAJECTORY);
+			jPt.setSequence(SpecialSeqValues::END_TRAJECTORY);
 		}
 		else
 		{
-			jMsg.point_.setSequence(i);
+			jPt.setSequence(i);
 		}
 
 		// Copy position data to local variable
 		JointData data;
-		for (int j = 0; j < msg->joint_names.size(); j++)
+		for (int j = 0; j < traj.joint_names.size() && j < pt.positions.size(); j++)
 		{
-			pt = msg->points[j];
 			data.setJoint(j, pt.positions[j]);
 		}
 
@@ -139,6 +170,56 @@ void JointTrajectoryDownloader::jointTrajectoryCB(
 	}
 }
 
+void JointTrajectoryDownloader::downloadBulk(
+		const trajectory_msgs::JointTrajectory &traj)
+{
+	const int num_points = traj.points.size();
+	const int num_joints = std::min((int)traj.joint_names.size(), (int)JointTrajBulkMessage::MAX_NUM_JOINTS);
+	shared_real positions[JointTrajBulkMessage::MAX_NUM_JOINTS];
+	JointTrajBulkMessage bMsg;
+	SimpleMessage topic;
+
+	for (int first = 0; first < num_points; first += JointTrajBulkMessage::MAX_POINTS)
+	{
+		bMsg.init();
+		bMsg.first_point_ = first;
+		if (0 == first)
+		{
+			bMsg.flags_ |= BulkFlags::START_TRAJECTORY;
+		}
+
+		int i = first;
+		for (; i < num_points && i < first + JointTrajBulkMessage::MAX_POINTS; i++)
+		{
+			const trajectory_msgs::JointTrajectoryPoint &pt = traj.points[i];
+			for (int j = 0; j < num_joints; j++)
+			{
+				positions[j] = j < pt.positions.size() ? pt.positions[j] : 0.0;
+			}
+			double duration = 0.0;
+			if (i > 0)
+			{
+				duration = (pt.time_from_start - traj.points[i - 1].time_from_start).toSec();
+			}
+			bMsg.addPoint(positions, num_joints, 0.0, duration);
+		}
+		if (num_points == i)
+		{
+			bMsg.flags_ |= BulkFlags::END_TRAJECTORY;
+		}
+
+		bMsg.toTopic(topic);
+		if (this->robot_->sendMsg(topic))
+		{
+			ROS_INFO("Points[%d-%d] sent to controller", first, i - 1);
+		}
+		else
+		{
+			ROS_WARN("Failed sent joint points[%d-%d], skipping points", first, i - 1);
+		}
+	}
+}
+
 } //joint_trajectory_handler
 } //motoman
 
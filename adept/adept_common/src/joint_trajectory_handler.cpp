@@ -32,6 +32,7 @@
 #include "adept_common/joint_trajectory_handler.h"
 #include "simple_message/messages/joint_message.h"
 #include "simple_message/smpl_msg_connection.h"
+#include <algorithm>
 
 using namespace industrial::smpl_msg_connection;
 using namespace industrial::joint_message;
@@ -50,12 +51,25 @@ JointTrajectoryHandler::JointTrajectoryHandler(ros::NodeHandle &n, SmplMsgConnec
 {
   ROS_INFO("Constructor joint trajectory handler node");
 
+  ros::NodeHandle pn("~");
+  pn.param("streaming_window", this->streaming_window_, 1);
+  pn.param("allow_splicing", this->allow_splicing_, false);
+  if (this->streaming_window_ < 1)
+  {
+    ROS_WARN("Invalid streaming window %d, using 1", this->streaming_window_);
+    this->streaming_window_ = 1;
+  }
+  ROS_INFO("Streaming window: %d point(s), splicing %s", this->streaming_window_,
+           this->allow_splicing_ ? "enabled" : "disabled");
+
   this->mutex_.lock();
   this->sub_joint_tranectory_ = this->node_.subscribe("command", 0, &JointTrajectoryHandler::jointTrajectoryCB,
                                                       this);
   this->robot_ = robotConnecton;
   this->currentPoint = 0;
   this->state_ = JointTrajectoryStates::IDLE;
+  this->stop_requested_ = false;
+  this->points_in_flight_ = 0;
   this->trajectoryHandler_ =
       new boost::thread(boost::bind(&JointTrajectoryHandler::trajectoryHandler, this));
   ROS_INFO("Unlocking mutex");
@@ -65,6 +79,10 @@ JointTrajectoryHandler::JointTrajectoryHandler(ros::NodeHandle &n, SmplMsgConnec
 JointTrajectoryHandler::~JointTrajectoryHandler()
 {  
   trajectoryStop();
+  {
+    boost::mutex::scoped_lock lock(this->mutex_);
+    this->state_ = JointTrajectoryStates::IDLE;
+  }
   this->sub_joint_tranectory_.shutdown();
   delete this->trajectoryHandler_;
 }
@@ -72,20 +90,30 @@ JointTrajectoryHandler::~JointTrajectoryHandler()
 void JointTrajectoryHandler::jointTrajectoryCB(const trajectory_msgs::JointTrajectoryConstPtr &msg)
 {
   ROS_INFO("Receiving joint trajctory message");
-  this->mutex_.lock();
+  boost::mutex::scoped_lock lock(this->mutex_);
   ROS_INFO("Processing joint trajctory message (mutex acquired)");
   ROS_DEBUG("Current state is: %d", this->state_);
+
+  // The controller connection is only used by the handler thread, so a stop
+  // is requested here and sent from there.
   if (JointTrajectoryStates::IDLE != this->state_)
   {
     if (msg->points.empty())
     {
       ROS_INFO("Empty trajectory received, canceling current trajectory");
+      this->stop_requested_ = true;
+      this->state_ = JointTrajectoryStates::IDLE;
+    }
+    else if (this->allow_splicing_)
+    {
+      spliceTrajectory(*msg);
     }
     else
     {
-      ROS_ERROR("Trajectory splicing not yet implemented, stopping current motion.");
+      ROS_ERROR("Trajectory splicing disabled, stopping current motion.");
+      this->stop_requested_ = true;
+      this->state_ = JointTrajectoryStates::IDLE;
     }
-    trajectoryStop();
   }
   else
   {
@@ -112,7 +140,43 @@ void JointTrajectoryHandler::jointTrajectoryCB(const trajectory_msgs::JointTraje
       this->state_ = JointTrajectoryStates::STREAMING;
     }
   }
-  this->mutex_.unlock();
+  this->trajectory_cond_.notify_one();
+}
+
+void JointTrajectoryHandler::spliceTrajectory(const trajectory_msgs::JointTrajectory &new_traj)
+{
+  // Points already sent are committed on the controller, everything after
+  // them is replaced.  The new trajectory is entered at its point closest to
+  // the last committed one so the arm does not move back to the start of a
+  // trajectory planned from an earlier state.
+  size_t splice = 0;
+  if (this->currentPoint > 0)
+  {
+    const trajectory_msgs::JointTrajectoryPoint &last = this->current_traj_.points[this->currentPoint - 1];
+    double best = -1.0;
+    for (size_t i = 0; i < new_traj.points.size(); i++)
+    {
+      double d = 0.0;
+      size_t n = std::min(last.positions.size(), new_traj.points[i].positions.size());
+      for (size_t j = 0; j < n; j++)
+      {
+        double e = new_traj.points[i].positions[j] - last.positions[j];
+        d += e * e;
+      }
+      if (best < 0.0 || d < best)
+      {
+        best = d;
+        splice = i;
+      }
+    }
+  }
+
+  ROS_INFO("Splicing trajectory of size %d at point[%d] after point[%d]",
+           (int)new_traj.points.size(), (int)splice, this->currentPoint);
+  this->current_traj_.points.resize(this->currentPoint);
+  this->current_traj_.points.insert(this->current_traj_.points.end(), new_traj.points.begin() + splice,
+                                    new_traj.points.end());
+  this->current_traj_.joint_names = new_traj.joint_names;
 }
 
 void JointTrajectoryHandler::trajectoryHandler()
@@ -120,54 +184,52 @@ void JointTrajectoryHandler::trajectoryHandler()
   JointMessage jMsg;
   SimpleMessage msg;
   SimpleMessage reply;
-  trajectory_msgs::JointTrajectoryPoint pt;
+  std::vector<trajectory_msgs::JointTrajectoryPoint> window;
+  int firstPoint = 0;
   ROS_INFO("Starting joint trajectory handler state");
   while (ros::ok())
   {
-    this->mutex_.lock();
+    if (!this->robot_->isConnected())
+    {
+      ROS_INFO("Connecting to robot motion server");
+      this->robot_->makeConnect();
+      this->points_in_flight_ = 0;
+      ros::Duration(0.005).sleep();
+      continue;
+    }
 
-    if (this->robot_->isConnected())
+    bool stop = false;
+    window.clear();
     {
-      
-      //TODO: These variables should be moved outside of this loop
-      //so that we aren't contantly reinitializing them.
-      JointMessage jMsg;
-      SimpleMessage msg;
-      SimpleMessage reply;
-      trajectory_msgs::JointTrajectoryPoint pt;
+      boost::mutex::scoped_lock lock(this->mutex_);
+
+      // Sleep until a trajectory arrives, the timeout only keeps ros::ok()
+      // and the connection checked.
+      if (JointTrajectoryStates::IDLE == this->state_ && !this->stop_requested_ && 0 == this->points_in_flight_)
+      {
+        this->trajectory_cond_.timed_wait(lock, boost::posix_time::milliseconds(250));
+      }
+
+      stop = this->stop_requested_;
+      this->stop_requested_ = false;
+
       switch (this->state_)
       {
         case JointTrajectoryStates::IDLE:
-          ros::Duration(0.250).sleep();
           break;
 
-
         case JointTrajectoryStates::STREAMING:
-          if (this->currentPoint < this->current_traj_.points.size())
+          // Copy up to a full window of points, the sending is done without
+          // the lock so new trajectories can be spliced in meanwhile.
+          firstPoint = this->currentPoint;
+          while (this->points_in_flight_ + (int)window.size() < this->streaming_window_
+              && this->currentPoint < this->current_traj_.points.size())
           {
-	          ROS_INFO("Streaming joints point[%d]", this->currentPoint);
-            pt = this->current_traj_.points[this->currentPoint];
-            
-            jMsg.setSequence(this->currentPoint);
-
-            for (int i = 0; i < this->current_traj_.joint_names.size(); i++)
-            {
-              jMsg.getJoints().setJoint(i, pt.positions[i]);
-            }
-            
-            jMsg.toRequest(msg);
-            ROS_DEBUG("Sending joint point");
-            if (this->robot_->sendAndReceiveMsg(msg, reply))
-            {
-              ROS_INFO("Point[%d] sent to controller", this->currentPoint);
-              this->currentPoint++;
-            }
-            else
-            {
-	           ROS_WARN("Failed sent joint point, will try again");
-            }
+            window.push_back(this->current_traj_.points[this->currentPoint]);
+            this->currentPoint++;
           }
-          else
+          if (window.empty() && 0 == this->points_in_flight_
+              && this->currentPoint >= this->current_traj_.points.size())
           {
             ROS_INFO("Trajectory streaming complete, setting state to IDLE");
             this->state_ = JointTrajectoryStates::IDLE;
@@ -179,22 +241,76 @@ void JointTrajectoryHandler::trajectoryHandler()
           this->state_ = JointTrajectoryStates::IDLE;
           break;
       }
+    }
 
+    if (stop)
+    {
+      drainReplies();
+      trajectoryStop();
+      continue;
     }
-    else
+
+    int sent = 0;
+    for (; sent < (int)window.size(); sent++)
     {
-      ROS_INFO("Connecting to robot motion server");
-      this->robot_->makeConnect();
+      const trajectory_msgs::JointTrajectoryPoint &pt = window[sent];
+      ROS_INFO("Streaming joints point[%d]", firstPoint + sent);
+      jMsg.setSequence(firstPoint + sent);
+      for (int i = 0; i < pt.positions.size() && i < NUM_OF_JOINTS_; i++)
+      {
+        jMsg.getJoints().setJoint(i, pt.positions[i]);
+      }
+
+      jMsg.toRequest(msg);
+      ROS_DEBUG("Sending joint point");
+      if (!this->robot_->sendMsg(msg))
+      {
+        ROS_WARN("Failed sent joint point, will try again");
+        break;
+      }
+      this->points_in_flight_++;
     }
 
-    this->mutex_.unlock();
-    ros::Duration(0.005).sleep();
+    if (sent < (int)window.size())
+    {
+      // Rewind to the first point that did not go out, unless the
+      // trajectory was replaced or canceled in the meantime.
+      boost::mutex::scoped_lock lock(this->mutex_);
+      if (JointTrajectoryStates::STREAMING == this->state_ && this->currentPoint == firstPoint + (int)window.size())
+      {
+        this->currentPoint = firstPoint + sent;
+      }
+    }
+
+    // Block on the oldest reply only, the rest of the window stays queued on
+    // the controller while it executes the current motion.
+    if (this->points_in_flight_ > 0)
+    {
+      if (this->robot_->receiveMsg(reply))
+      {
+        ROS_DEBUG("Point reply received (%d still in flight)", this->points_in_flight_ - 1);
+      }
+      else
+      {
+        ROS_WARN("Failed to receive joint point reply");
+      }
+      this->points_in_flight_--;
+    }
   }
 
   ROS_WARN("Exiting trajectory handler thread");
 }
 
-
+void JointTrajectoryHandler::drainReplies()
+{
+  SimpleMessage reply;
+  while (this->points_in_flight_ > 0 && this->robot_->isConnected())
+  {
+    this->robot_->receiveMsg(reply);
+    this->points_in_flight_--;
+  }
+  this->points_in_flight_ = 0;
+}
 
 void JointTrajectoryHandler::trajectoryStop()
 {
@@ -207,14 +323,14 @@ void JointTrajectoryHandler::trajectoryStop()
   jMsg.toRequest(msg);
   ROS_DEBUG("Sending stop command");
   this->robot_->sendAndReceiveMsg(msg, reply);
-  ROS_DEBUG("Stop command sent, entring idle mode");
-  this->state_ = JointTrajectoryStates::IDLE;
+  // The state is left alone: whoever requested the stop already set IDLE under
+  // mutex_, and a trajectory accepted since then must keep streaming.
+  ROS_DEBUG("Stop command sent");
 }
 
 
 
 
-
 } //joint_trajectory_handler
 } //motoman
 
@@ -1,114 +1,28 @@
-#include <pcl/ModelCoefficients.h>
-#include <pcl/point_types.h>
-#include <pcl/io/pcd_io.h>
-#include <pcl/filters/extract_indices.h>
-#include <pcl/filters/voxel_grid.h>
-#include <pcl/features/normal_3d.h>
-#include <pcl/kdtree/kdtree.h>
-#include <pcl/sample_consensus/method_types.h>
-#include <pcl/sample_consensus/model_types.h>
-#include <pcl/segmentation/sac_segmentation.h>
-#include <pcl/segmentation/extract_clusters.h>
+#include <nrg_object_recognition/euclidean_segmentation.h>
 
 
 int 
-SegmentCloud(sensor_msgs::PointCloud2 rawCloud, std::vector<pcl::PointCloud<pcl::PointXYZ>::Ptr> & cloudSegments)
+SegmentCloud(const sensor_msgs::PointCloud2 &rawCloud, std::vector<pcl::PointCloud<pcl::PointXYZ>::Ptr> & cloudSegments)
 {
-  // Read in the cloud data
-  pcl::PointCloud<pcl::PointXYZ>::Ptr cloud (new pcl::PointCloud<pcl::PointXYZ>), cloud_f (new pcl::PointCloud<pcl::PointXYZ>);
-  std::cout << "In SegmentCloud, reading PointCloud2 msg" << std::endl;
-  pcl::fromROSMsg(rawCloud, *cloud);
-  
-  // Create the filtering object: downsample the dataset using a leaf size of 1cm
-  pcl::VoxelGrid<pcl::PointXYZ> vg;
-  pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_filtered (new pcl::PointCloud<pcl::PointXYZ>), cloud_filtered_0 (new pcl::PointCloud<pcl::PointXYZ>);
-  vg.setInputCloud (cloud);
-  vg.setLeafSize (0.001f, 0.001f, 0.001f);
-  vg.filter (*cloud_filtered_0);
-
-  // Create the segmentation object for the planar model and set all the parameters
-  pcl::SACSegmentation<pcl::PointXYZ> seg;
-  pcl::PointIndices::Ptr inliers (new pcl::PointIndices);
-  pcl::ModelCoefficients::Ptr coefficients (new pcl::ModelCoefficients);
-  pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_plane (new pcl::PointCloud<pcl::PointXYZ> ());
-  pcl::PCDWriter writer;
-  seg.setOptimizeCoefficients (true);
-  seg.setModelType (pcl::SACMODEL_PLANE);
-  seg.setMethodType (pcl::SAC_RANSAC);
-  seg.setMaxIterations (100);
-  seg.setDistanceThreshold (0.02);
-  
-    //Spatial filter.
-  cloud_filtered->resize(0);
-  //Parameters
- float min_x = -.2, max_x = .2;
- float min_y = -.5, max_y = .5;
- float min_z = .55, max_z = 1.15;
- 
- for(pcl::PointCloud<pcl::PointXYZ>::iterator position=cloud_filtered_0->begin(); position!=cloud_filtered_0->end(); position++){
-    if(position->x > min_x && position->x < max_x && position->y > min_y && position->y < max_y && position->z > min_z && position->z < max_z)
-      cloud_filtered->push_back(*position);
-  }
-
-  std::cout << "num points in spatially filtered cloud: " << cloud_filtered->points.size() << std::endl;
-  int i=0, nr_points = (int) cloud_filtered->points.size ();
-  while (cloud_filtered->points.size () > 0.3 * nr_points)
-  {
-    // Segment the largest planar component from the remaining cloud
-    seg.setInputCloud (cloud_filtered);
-    seg.segment (*inliers, *coefficients);
-    if (inliers->indices.size () == 0)
-    {
-      std::cout << "Could not estimate a planar model for the given dataset." << std::endl;
-      break;
-    }
-
-    std::cout << "extracting planar inliers..."  << std::endl;
-    // Extract the planar inliers from the input cloud
-    pcl::ExtractIndices<pcl::PointXYZ> extract;
-    extract.setInputCloud (cloud_filtered);
-    extract.setIndices (inliers);
-    extract.setNegative (false);
+  //Kept across calls so the segmentation buffers are reused.
+  static EuclideanSegmentation segmenter;
+  EuclideanSegmentation::Parameters &params = segmenter.getParameters();
+  params.leaf_size = 0.001f;
+  params.min_x = -.2; params.max_x = .2;
+  params.min_y = -.5; params.max_y = .5;
+  params.min_z = .55; params.max_z = 1.15;
+  params.plane_max_iterations = 100;
+  params.plane_distance_threshold = 0.02;
+  params.remaining_fraction = 0.3;
+  params.cluster_tolerance = 0.02; // 2cm
+  params.min_cluster_size = 0;
+  params.max_cluster_size = 25000;
 
-    // Write the planar inliers to disk
-    extract.filter (*cloud_plane);
-    std::cout << "done."  << std::endl;
-    std::cout << "PointCloud representing the planar component: " << cloud_plane->points.size () << " data points." << std::endl;
-
-    std::cout << "Removing tabletop..."  << std::endl;
-    // Remove the planar inliers, extract the rest
-    extract.setNegative (true);
-    extract.filter (*cloud_f);
-    cloud_filtered = cloud_f;
-    std::cout << "done."  << std::endl;
-  }
-
-     std::cout << "Number of points in remaining clusters: " << cloud_filtered->points.size()  << std::endl;
-  // Creating the KdTree object for the search method of the extraction
-  pcl::search::KdTree<pcl::PointXYZ>::Ptr tree (new pcl::search::KdTree<pcl::PointXYZ>);
-  tree->setInputCloud (cloud_filtered);
-
-  std::vector<pcl::PointIndices> cluster_indices;
-  pcl::EuclideanClusterExtraction<pcl::PointXYZ> ec;
-  ec.setClusterTolerance (0.02); // 2cm
-  ec.setMinClusterSize (0);
-  ec.setMaxClusterSize (25000);
-  ec.setSearchMethod (tree);
-  ec.setInputCloud (cloud_filtered);
-  ec.extract (cluster_indices);
-
-  int j = 0;
-  for (std::vector<pcl::PointIndices>::const_iterator it = cluster_indices.begin (); it != cluster_indices.end (); ++it)
-  {
-    pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_cluster (new pcl::PointCloud<pcl::PointXYZ>);
-    for (std::vector<int>::const_iterator pit = it->indices.begin (); pit != it->indices.end (); pit++)
-      cloud_cluster->points.push_back (cloud_filtered->points[*pit]); //*
-    cloud_cluster->width = cloud_cluster->points.size ();
-    cloud_cluster->height = 1;
-    cloud_cluster->is_dense = true;
-    cloudSegments.push_back(cloud_cluster);
-    j++;
-  }
+  std::cout << "In SegmentCloud, reading PointCloud2 msg" << std::endl;
+  segmenter.segment(rawCloud);
+  std::cout << "num points in spatially filtered cloud: " << segmenter.getBoundedIndices().size() << std::endl;
+  std::cout << "Number of points in remaining clusters: " << segmenter.getRemainingIndices().size()  << std::endl;
+  segmenter.getClusters(cloudSegments);
   
   return (0);
 }
@@ -13,7 +13,7 @@
 #include "data_collection/process_cloud.h"
 #include "euclidean_segmentation.h"
 #include "nrg_object_recognition/segmentation.h"
-#include "cph.h"
+#include <nrg_object_recognition/cph.h>
 
   ros::ServiceClient seg_client;
   
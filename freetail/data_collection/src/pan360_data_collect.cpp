@@ -8,15 +8,21 @@
 
 ros::Publisher pan_pub;
 ros::ServiceClient pan_client;
-sensor_msgs::PointCloud2 cloud_to_process;
+sensor_msgs::PointCloud2::ConstPtr cloud_to_process; //latest cloud, only the pointer is kept
 
-void kinect_cb(sensor_msgs::PointCloud2 fromKinect)
+void kinect_cb(const sensor_msgs::PointCloud2::ConstPtr &fromKinect)
 {
 cloud_to_process = fromKinect;
 }
 
 bool rotate_cb(data_collection::dataCollect::Request &req, data_collection::dataCollect::Response &res)
 {
+if(!cloud_to_process)
+{
+ROS_ERROR("No cloud received yet");
+return false;
+}
+
 std_msgs::UInt16 command;
 command.data=0;
 data_collection::process_cloud srv;
@@ -27,7 +33,7 @@ while(command.data<360)
 {
 ros::Rate loop_rate(.1);
 
-srv.request.in_cloud = cloud_to_process;
+srv.request.in_cloud = *cloud_to_process;
 srv.request.angle = command.data;
 pan_client.call(srv);
 srv.response.result = 1;
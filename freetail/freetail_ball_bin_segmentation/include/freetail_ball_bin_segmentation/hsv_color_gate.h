@@ -0,0 +1,166 @@
+#ifndef FREETAIL_BALL_BIN_SEGMENTATION_HSV_COLOR_GATE_H
+#define FREETAIL_BALL_BIN_SEGMENTATION_HSV_COLOR_GATE_H
+
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#include <algorithm>
+#include <vector>
+#include <cmath>
+#include <stdint.h>
+
+/**
+ * Selects the points of a cloud whose color falls inside a hue/saturation window.
+ *
+ * Hue and saturation follow the hexagonal definition used by the ball/bin segmentor:
+ *   alpha = (2r - g - b)/2, beta = sqrt(3)/2 (g - b), hue = atan2(beta, alpha) (radians), saturation = |(alpha, beta)|/max(r,g,b)
+ * Both tests are done on squared quantities after rotating (alpha, beta) to the center of the hue window, so the
+ * per point loop has no atan2, sqrt or branches and is vectorized by the compiler.  Points are removed with a
+ * single stable compaction pass.
+ */
+class HSVColorGate
+{
+public:
+
+	HSVColorGate(float hueMin = -1.0f, float hueMax = 1.0f, float satMin = 0.3f, float satMax = 1.0e6f)
+	{
+		setHueWindow(hueMin,hueMax);
+		setSaturationWindow(satMin,satMax);
+	}
+
+	/**
+	 * \brief Hue window in radians, hueMin <= hueMax within [-pi, pi]
+	 */
+	void setHueWindow(float hueMin, float hueMax)
+	{
+		hue_min_ = hueMin;
+		hue_max_ = hueMax;
+		double center = 0.5*(hueMin + hueMax);
+		double halfWidth = 0.5*(hueMax - hueMin);
+		cos_center_ = std::cos(center);
+		sin_center_ = std::sin(center);
+		cos_half_width_ = std::cos(halfWidth);
+
+		// grays have no hue, atan2(0,0) = 0 puts them at hue 0
+		gray_in_hue_ = (hueMin <= 0.0f) && (0.0f <= hueMax);
+	}
+
+	/**
+	 * \brief Saturation window, a point matches when satMin < saturation <= satMax
+	 */
+	void setSaturationWindow(float satMin, float satMax)
+	{
+		sat_min_ = satMin;
+		sat_max_ = satMax;
+	}
+
+	/**
+	 * \brief Sets mask[i] to 1 for the points inside the window and to 0 otherwise, returns the number of matches
+	 */
+	template <typename PointT>
+	int computeMask(const pcl::PointCloud<PointT> &cloud, std::vector<uint8_t> &mask)
+	{
+		const int n = cloud.points.size();
+		mask.resize(n);
+		if(n == 0)
+		{
+			return 0;
+		}
+
+		// unpack the colors into planar buffers first so the gating loop only sees contiguous floats
+		if((int)red_.size() < n)
+		{
+			red_.resize(n); green_.resize(n); blue_.resize(n);
+		}
+		float *r = &red_[0], *g = &green_[0], *b = &blue_[0];
+		for(int i = 0; i < n; i++)
+		{
+			r[i] = cloud.points[i].r;
+			g[i] = cloud.points[i].g;
+			b[i] = cloud.points[i].b;
+		}
+
+		// the 1/255 scale of the original cancels in both tests
+		const float halfSqrt3 = 0.8660254f;
+		const float cosC = cos_center_, sinC = sin_center_;
+		const float cosW = cos_half_width_, cosW2 = cos_half_width_*cos_half_width_;
+		const float satMin2 = sat_min_ > 0.0f ? sat_min_*sat_min_ : -1.0f;
+		const float satMax2 = sat_max_*sat_max_;
+		const bool grayInHue = gray_in_hue_;
+		uint8_t *m = &mask[0];
+		int matches = 0;
+		for(int i = 0; i < n; i++)
+		{
+			float alpha = r[i] - 0.5f*(g[i] + b[i]);
+			float beta = halfSqrt3*(g[i] - b[i]);
+			float rho2 = alpha*alpha + beta*beta;
+			float v = std::max(std::max(r[i],g[i]),b[i]);
+			float v2 = v*v;
+
+			// |hue - center| <= halfWidth  <=>  cos(hue - center) >= cos(halfWidth)
+			float a = alpha*cosC + beta*sinC;
+			bool inHue = cosW >= 0.0f ? (a >= 0.0f && a*a >= rho2*cosW2) : (a >= 0.0f || a*a <= rho2*cosW2);
+			inHue = rho2 > 0.0f ? inHue : grayInHue;
+			bool inSat = (rho2 > satMin2*v2) && (rho2 <= satMax2*v2);
+			m[i] = (uint8_t)(inHue & inSat);
+			matches += m[i];
+		}
+		return matches;
+	}
+
+	/**
+	 * \brief Removes the points inside the window keeping the order of the rest, returns the number removed
+	 */
+	template <typename PointT>
+	int removeMatching(pcl::PointCloud<PointT> &cloud)
+	{
+		return filter(cloud,true);
+	}
+
+	/**
+	 * \brief Removes the points outside the window keeping the order of the rest, returns the number removed
+	 */
+	template <typename PointT>
+	int keepMatching(pcl::PointCloud<PointT> &cloud)
+	{
+		return filter(cloud,false);
+	}
+
+	float getHueMin() const { return hue_min_; }
+	float getHueMax() const { return hue_max_; }
+	float getSaturationMin() const { return sat_min_; }
+	float getSaturationMax() const { return sat_max_; }
+
+protected:
+
+	template <typename PointT>
+	int filter(pcl::PointCloud<PointT> &cloud, bool removeMatches)
+	{
+		computeMask(cloud,mask_);
+		const uint8_t drop = removeMatches ? 1 : 0;
+		std::size_t kept = 0;
+		for(std::size_t i = 0; i < cloud.points.size(); i++)
+		{
+			if(mask_[i] != drop)
+			{
+				cloud.points[kept++] = cloud.points[i];
+			}
+		}
+
+		int removed = cloud.points.size() - kept;
+		cloud.points.resize(kept);
+		cloud.width = kept;
+		cloud.height = 1;
+		return removed;
+	}
+
+	float hue_min_, hue_max_;
+	float sat_min_, sat_max_;
+	float cos_center_, sin_center_, cos_half_width_;
+	bool gray_in_hue_;
+
+	// scratch buffers, they only grow so repeated calls do not allocate
+	std::vector<float> red_, green_, blue_;
+	std::vector<uint8_t> mask_;
+};
+
+#endif
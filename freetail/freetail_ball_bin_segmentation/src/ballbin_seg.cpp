@@ -35,6 +35,8 @@ using namespace std;
 #include <pcl/segmentation/sac_segmentation.h>
 #include <pcl/segmentation/extract_clusters.h>
 
+#include <freetail_ball_bin_segmentation/hsv_color_gate.h>
+
 #include "/opt/ros/fuerte/stacks/pr2_object_manipulation/perception/tabletop_object_detector/srv_gen/cpp/include/tabletop_object_detector/TabletopSegmentation.h"
 #include "/home/cgomez/ros/fuerte/swri-ros-pkg/freetail/freetail_ball_bin_segmentation/srv_gen/cpp/include/freetail_ball_bin_segmentation/BallBinSegmentation.h"
 
@@ -53,6 +55,9 @@ private:
 	//
 	std::string base_link_;
 
+	//! Color window of the bin, points inside it are removed from the cluster
+	HSVColorGate bin_gate_;
+
 
 	//! Service server for ball/bin segmentation
 	ros::ServiceServer ballbin_segmentation_srv_;
@@ -89,6 +94,14 @@ public:
     //initialize operational flags
     priv_nh_.param<std::string>("base_link", base_link_, "");
 
+    //hexagonal hue in radians and saturation of the red bin
+    double hue_min, hue_max, sat_min;
+    priv_nh_.param<double>("bin_hue_min", hue_min, -1.0);
+    priv_nh_.param<double>("bin_hue_max", hue_max, 1.0);
+    priv_nh_.param<double>("bin_saturation_min", sat_min, 0.3);
+    bin_gate_.setHueWindow(hue_min, hue_max);
+    bin_gate_.setSaturationWindow(sat_min, 1.0e6);
+
 	}
 
   //! Empty stub
@@ -152,53 +165,7 @@ void BallBinSegmentor::processCloud(const sensor_msgs::PointCloud2 &cloud,
   pcl::fromROSMsg(bincluster,PCxyzrgb);
 
   ROS_INFO("Cluster of bin with balls - %d points", (int)PCxyzrgb.width);
-    //ROS_INFO("Cluster of bin with balls - height %d", (int)PCxyzrgb.height);
-    //width - the total number of points in the cloud (equal with POINTS see below) for unorganized datasets
-    int pcsize=PCxyzrgb.width;
-    std::vector<int> ivec;
-    for (int count=0; count < pcsize; count++)
-    {
-  	  float r1, g1, b1;
-  	  r1=PCxyzrgb.at(count).r;
-  	  g1=PCxyzrgb.at(count).g;
-
-  	  //convert RGB to HSV
-  	  float r, g, b;
-  	  r=r1/255.0; g=g1/255.0; b=b1/255.0;
-  	  float M, m, C;
-  	  M=max(max(r,g),b);
-  	  m=min(min(r,g),b);
-  	  C=M-m;
-	  float I=(r+g+b)/3.0;
-	  float S3=1-(m/I);
-
-	  double alpha = 0.5*(2*r-g-b);
-	  double beta = (sqrt(3)/2.0)*(g-b);
-	  double H2 = atan2(beta, alpha);
-	  double C2 = sqrt((alpha*alpha)+(beta*beta));
-
-	  float S2, V2;
-	  V2=M;
-	  if (C2==0.0)
-	  	  {
-	  		  S2=0.0;
-	  	  }
-	  	  else
-	  	  {
-	  		  S2=C2/V2;
-	  	  }
-
-	  if (H2<=1 && H2>=-1 && S2>0.3)
-	  {
-		  ivec.push_back(count);
-
-	  }
-
-  }
-  for (int i=0; i < ivec.size(); i++)
-    {
-	  PCxyzrgb.erase(PCxyzrgb.begin()+ivec[i]);
-    }
+  bin_gate_.removeMatching(PCxyzrgb);
 
   ROS_INFO("Cluster of balls - %d points", (int)PCxyzrgb.width);
   response.result = response.SUCCESS;
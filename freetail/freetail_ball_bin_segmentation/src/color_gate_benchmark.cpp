@@ -0,0 +1,105 @@
+//color_gate_benchmark.cpp
+//Times the red bin removal of ballbin_seg before and after HSVColorGate on random Kinect sized clouds.
+//The old erase loop is quadratic, so it is only run on the smaller clouds.
+//usage: color_gate_benchmark [max_legacy_points]
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+
+#include <algorithm>
+#include <iostream>
+#include <cstdlib>
+#include <math.h>
+#include <sys/time.h>
+
+#include <freetail_ball_bin_segmentation/hsv_color_gate.h>
+
+double now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+/** \brief The color test of ballbin_seg as it was, one point at a time in double precision */
+bool legacyIsRed(float r1, float g1, float b1)
+{
+  float r=r1/255.0, g=g1/255.0, b=b1/255.0;
+  float M=std::max(std::max(r,g),b);
+  double alpha = 0.5*(2*r-g-b);
+  double beta = (sqrt(3)/2.0)*(g-b);
+  double H2 = atan2(beta, alpha);
+  double C2 = sqrt((alpha*alpha)+(beta*beta));
+  float S2 = C2==0.0 ? 0.0 : C2/M;
+  return (H2<=1 && H2>=-1 && S2>0.3);
+}
+
+/** \brief The removal of ballbin_seg as it was, including the shifting indices. Indices that have shifted
+  * past the end are skipped, the original erased beyond the end of the cloud there.
+  */
+void legacyRemove(pcl::PointCloud<pcl::PointXYZRGB> &cloud)
+{
+  std::vector<int> ivec;
+  for(int count=0; count < (int)cloud.points.size(); count++)
+    if(legacyIsRed(cloud.points[count].r, cloud.points[count].g, cloud.points[count].b))
+      ivec.push_back(count);
+  for(unsigned int i=0; i < ivec.size(); i++)
+    if(ivec[i] < (int)cloud.points.size())
+      cloud.erase(cloud.begin()+ivec[i]);
+}
+
+void makeCloud(unsigned int size, pcl::PointCloud<pcl::PointXYZRGB> &cloud)
+{
+  cloud.points.resize(size);
+  cloud.width = size;
+  cloud.height = 1;
+  for(unsigned int i=0; i<size; i++){
+    cloud.points[i].x = i;
+    cloud.points[i].y = cloud.points[i].z = 0.0f;
+    cloud.points[i].r = rand()%256;
+    cloud.points[i].g = rand()%256;
+    cloud.points[i].b = rand()%256;
+  }
+}
+
+/** \brief Number of red points left in the cloud */
+int countRed(const pcl::PointCloud<pcl::PointXYZRGB> &cloud)
+{
+  int red = 0;
+  for(unsigned int i=0; i<cloud.points.size(); i++)
+    red += legacyIsRed(cloud.points[i].r, cloud.points[i].g, cloud.points[i].b);
+  return red;
+}
+
+int main(int argc, char **argv)
+{
+  unsigned int max_legacy = argc > 1 ? atoi(argv[1]) : 80000;
+  srand(0);
+
+  HSVColorGate gate(-1.0f, 1.0f, 0.3f);
+  const unsigned int sizes[] = {10000, 20000, 40000, 80000, 160000, 307200};
+  for(unsigned int s=0; s<sizeof(sizes)/sizeof(sizes[0]); s++){
+    pcl::PointCloud<pcl::PointXYZRGB> cloud, filtered;
+    makeCloud(sizes[s], cloud);
+
+    const int repeats = 10;
+    double start = now();
+    for(int r=0; r<repeats; r++){
+      filtered = cloud;
+      gate.removeMatching(filtered);
+    }
+    double gate_time = (now() - start)/repeats;
+    std::cout << sizes[s] << " points: gate " << gate_time*1000.0 << " ms, "
+              << filtered.points.size() << " kept, " << countRed(filtered) << " red left";
+
+    if(sizes[s] <= max_legacy){
+      filtered = cloud;
+      start = now();
+      legacyRemove(filtered);
+      double legacy_time = now() - start;
+      std::cout << "; legacy " << legacy_time*1000.0 << " ms (" << legacy_time/gate_time << "x), "
+                << filtered.points.size() << " kept, " << countRed(filtered) << " red left";
+    }
+    std::cout << "\n";
+  }
+  return(0);
+}
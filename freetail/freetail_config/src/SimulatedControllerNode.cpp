@@ -9,6 +9,10 @@
  *  	It subscribes to the topic "command" of type "trajectory_msgs/JointTrajectory"
  *  	It publishes the topic "state" of type "pr2_controllers_msgs/JointTrajectoryControllerState"
  *  	The command and state topics are published and advertised by the joint_trajectory_action server
+ *  	Trajectories run on a separate execution thread that publishes the interpolated state at "~feedback_rate" Hz.
+ *  	A new trajectory preempts the one being executed, an empty trajectory stops the arm at its current position.
+ *  	"~time_scale" sets how fast trajectory time runs relative to ros time (2.0 executes twice as fast), values <= 0
+ *  	jump straight to the last point of each trajectory.  Timing follows /use_sim_time like the rest of the node.
  */
 
 #include <ros/ros.h>
@@ -20,12 +24,17 @@
 #include <sensor_msgs/JointState.h>
 #include <control_msgs/FollowJointTrajectoryFeedback.h>
 #include <boost/foreach.hpp>
+#include <boost/thread.hpp>
 
 const std::string CONTROLLER_STATE_TOPIC_NAME = "state";
 const std::string CONTROLLER_FEEDBACK_TOPIC_NAME = "feedback_states";
 const std::string JOINT_TRAJECTORY_TOPIC_NAME = "command";
 const std::string JOINT_STATE_TOPIC_NAME = "joint_states";
 const std::string JOINT_NAMES_PARAM_NAME = "/joint_trajectory_action/joints";
+const std::string TIME_SCALE_PARAM_NAME = "time_scale";
+const std::string FEEDBACK_RATE_PARAM_NAME = "feedback_rate";
+const double DEFAULT_TIME_SCALE = 1.0f;
+const double DEFAULT_FEEDBACK_RATE = 20.0f;
 
 class SimulatedController
 {
@@ -36,8 +45,10 @@ public:
 	_JointStatePubTopic(JOINT_STATE_TOPIC_NAME),
 	_JointTrajSubsTopic(JOINT_TRAJECTORY_TOPIC_NAME),
 	_JointNames(),
+	_TimeScale(DEFAULT_TIME_SCALE),
+	_FeedbackRate(DEFAULT_FEEDBACK_RATE),
 	_LastJointState(),
-	_ProcessingRequest(false)
+	_NewTrajectory(false)
 	{
 
 	}
@@ -97,104 +108,195 @@ public:
 		sensor_msgs::JointState st = _LastJointState;
 		updateLastStateFeedbackMessages(st);
 
+		// execution parameters
+		ros::NodeHandle ph("~");
+		ph.param(TIME_SCALE_PARAM_NAME,_TimeScale,_TimeScale);
+		ph.param(FEEDBACK_RATE_PARAM_NAME,_FeedbackRate,_FeedbackRate);
+		if(_FeedbackRate <= 0.0f)
+		{
+			ROS_WARN_STREAM(nodeName<<": Invalid feedback rate "<<_FeedbackRate<<", using "<<DEFAULT_FEEDBACK_RATE);
+			_FeedbackRate = DEFAULT_FEEDBACK_RATE;
+		}
+
+		if(_TimeScale > 0.0f)
+		{
+			ROS_INFO_STREAM(nodeName<<": Executing trajectories at "<<_TimeScale<<"x ros time, publishing state at "
+					<<_FeedbackRate<<" Hz");
+		}
+		else
+		{
+			ROS_INFO_STREAM(nodeName<<": Executing trajectories instantly, publishing state at "<<_FeedbackRate<<" Hz");
+		}
+
 		_JointTrajSubscriber = nh.subscribe(_JointTrajSubsTopic,1,&SimulatedController::callbackJointTrajectory,this);
 		_ControllerStatePublisher = nh.advertise<pr2_controllers_msgs::JointTrajectoryControllerState>(_CntrlStatePubTopic,
 				1);
 		_ControllerFeedbackPublisher = nh.advertise<control_msgs::FollowJointTrajectoryFeedback>(_ControlFeedbackPubTopic,1);
 		_JointStatePublisher = nh.advertise<sensor_msgs::JointState>(_JointStatePubTopic,1);
-		_StatusUpdateTimer = nh.createTimer(ros::Duration(1.0f),&SimulatedController::broadcastState,this);
+		_ExecutionThread = boost::thread(boost::bind(&SimulatedController::executeTrajectories,this));
 		ros::spin();
+
+		_ExecutionThread.interrupt();
+		_ExecutionThread.join();
 	}
 
-	void broadcastState(const ros::TimerEvent &evnt)
+	void callbackJointTrajectory(const trajectory_msgs::JointTrajectory::ConstPtr &msg)
 	{
-		//pr2_controllers_msgs::JointTrajectoryControllerState state;
-		if(_ProcessingRequest)
-		{
-			return;
-		}
-		else
-		{
-			_LastControllerJointState.header.stamp = _LastControllerTrajState.header.stamp =  ros::Time::now();
-			_LastJointState.header.stamp = ros::Time::now();
-			_ControllerStatePublisher.publish(_LastControllerJointState);
-			_ControllerFeedbackPublisher.publish(_LastControllerTrajState);
-			_JointStatePublisher.publish(_LastJointState);
-		}
+		// handing the trajectory over to the execution thread, it replaces the one in progress on the next cycle
+		boost::mutex::scoped_lock lock(_TrajectoryMutex);
+		_PendingTrajectory = msg;
+		_NewTrajectory = true;
 	}
 
-	void callbackJointTrajectory(const trajectory_msgs::JointTrajectory::ConstPtr &msg)
+protected:
+
+	void executeTrajectories()
 	{
 		std::string nodeName = ros::this_node::getName();
+		ros::Rate rate(_FeedbackRate);
+		trajectory_msgs::JointTrajectory::ConstPtr trajectory;
+		std::vector<double> startPositions;
+		ros::Time startTime;
+		const ros::Duration printInterval(2.0f);
+		ros::Time printStartTime;
 
-
-		if(msg->points.empty())
-		{
-			_ProcessingRequest = false;
-			return;
-		}
-		else
+		while(ros::ok() && !boost::this_thread::interruption_requested())
 		{
-			_ProcessingRequest = true;
-		}
+			// picking up the last trajectory received
+			trajectory_msgs::JointTrajectory::ConstPtr request;
+			bool newTrajectory = false;
+			{
+				boost::mutex::scoped_lock lock(_TrajectoryMutex);
+				std::swap(newTrajectory,_NewTrajectory);
+				request.swap(_PendingTrajectory);
+			}
 
-		ROS_INFO_STREAM(nodeName<<": Starting joint trajectory execution, "
-				<<msg->points.size()<<" points in requested trajectory");
+			if(newTrajectory)
+			{
+				if(trajectory)
+				{
+					ROS_WARN_STREAM(nodeName<<": Joint trajectory execution preempted by new request");
+				}
 
-		// the messages below contain the same information, but the are expected by different joint trajectory action servers
-		pr2_controllers_msgs::JointTrajectoryControllerState state;
-		control_msgs::FollowJointTrajectoryFeedback feedback;
+				if(request->points.empty())
+				{
+					ROS_INFO_STREAM(nodeName<<": Empty trajectory received, stopping at current position");
+					trajectory.reset();
+				}
+				else
+				{
+					ROS_INFO_STREAM(nodeName<<": Starting joint trajectory execution, "
+							<<request->points.size()<<" points in requested trajectory");
+					trajectory = request;
+					startPositions = _LastJointState.position;
+					startTime = printStartTime = ros::Time::now();
+				}
+			}
 
-		trajectory_msgs::JointTrajectoryPoint error;
-		state.joint_names = feedback.joint_names = _JointNames;
-		error.positions = std::vector<double>(state.joint_names.size(),0.0f);
-		state.error = feedback.error = error;
+			if(trajectory)
+			{
+				double endTime = trajectory->points.back().time_from_start.toSec();
+				double elapsed = _TimeScale > 0.0f ? (ros::Time::now() - startTime).toSec() * _TimeScale : endTime;
 
-		sensor_msgs::JointState jointState;
-		jointState.name = state.joint_names;
+				trajectory_msgs::JointTrajectoryPoint point;
+				interpolateTrajectory(*trajectory,startPositions,elapsed,point);
+				publishState(point);
 
-		//jointState.effort = std::vector<double>(state.joint_names.size(),0.0f);
+				if(elapsed >= endTime)
+				{
+					ROS_INFO_STREAM(nodeName<<": Finished joint trajectory execution after "
+							<<(ros::Time::now() - startTime).toSec()<<" seconds");
+					trajectory.reset();
+				}
+				else if(ros::Time::now() - printStartTime > printInterval)
+				{
+					ROS_INFO_STREAM(nodeName<<": Executed "<<elapsed<<" of "<<endTime<<" trajectory seconds");
+					printStartTime = ros::Time::now();
+				}
+			}
+			else
+			{
+				publishLastState();
+			}
 
-		// publishing controller and joint states
-		ros::Duration duration(0.0f);
-		const ros::Duration printInterval(2.0f);
-		ros::Time printStartTime = ros::Time::now();
-		int counter = 0;
-		BOOST_FOREACH(trajectory_msgs::JointTrajectoryPoint point,msg->points)
+			rate.sleep();
+		}
+	}
+
+	/*
+	 * Linear interpolation of positions and velocities at the given trajectory time, the positions the arm had when
+	 * the trajectory was received precede the first point.
+	 */
+	void interpolateTrajectory(const trajectory_msgs::JointTrajectory &trajectory,const std::vector<double> &startPositions,
+			double time,trajectory_msgs::JointTrajectoryPoint &point)
+	{
+		const std::vector<trajectory_msgs::JointTrajectoryPoint> &points = trajectory.points;
+		std::size_t next = 0;
+		while(next < points.size() && points[next].time_from_start.toSec() <= time)
 		{
-			//trajectory_msgs::JointTrajectoryPoint point = msg->points[i];
-			state.desired = feedback.desired = point;
-			state.actual = feedback.actual = point;
-			jointState.position = state.desired.positions;
-			jointState.velocity = state.desired.velocities;
+			next++;
+		}
+
+		if(next == points.size())
+		{
+			point = points.back();
+			return;
+		}
 
-			(point.time_from_start - duration).sleep();
-			duration = point.time_from_start;
+		const trajectory_msgs::JointTrajectoryPoint &to = points[next];
+		trajectory_msgs::JointTrajectoryPoint from;
+		if(next > 0)
+		{
+			from = points[next - 1];
+		}
+		else
+		{
+			from.positions = startPositions;
+			from.velocities = std::vector<double>(startPositions.size(),0.0f);
+			from.time_from_start = ros::Duration(0.0f);
+		}
 
-			state.header.stamp = feedback.header.stamp = ros::Time::now();
-			jointState.header.stamp = ros::Time::now();
+		point = to;
+		point.time_from_start = ros::Duration(time);
+		if(from.positions.size() != to.positions.size())
+		{
+			return;
+		}
 
-			_ControllerStatePublisher.publish(state);
-			_ControllerFeedbackPublisher.publish(feedback);
-			_JointStatePublisher.publish(jointState);
+		double span = (to.time_from_start - from.time_from_start).toSec();
+		double t = span > 0.0f ? (time - from.time_from_start.toSec())/span : 1.0f;
+		for(std::size_t i = 0; i < to.positions.size(); i++)
+		{
+			point.positions[i] = from.positions[i] + t * (to.positions[i] - from.positions[i]);
+		}
 
-			if(ros::Time::now() - printStartTime > printInterval)
+		if(from.velocities.size() == to.velocities.size())
+		{
+			for(std::size_t i = 0; i < to.velocities.size(); i++)
 			{
-				ROS_INFO_STREAM(nodeName<<": Executed "<<
-						counter<<" joint trajectory points after "<<point.time_from_start.sec<<" seconds");
-				printStartTime = ros::Time::now();
+				point.velocities[i] = from.velocities[i] + t * (to.velocities[i] - from.velocities[i]);
 			}
-			counter++;
 		}
+	}
 
-		ROS_INFO_STREAM(nodeName<<": Finished joint trajectory execution, ");
-
+	void publishState(const trajectory_msgs::JointTrajectoryPoint &point)
+	{
+		sensor_msgs::JointState jointState;
+		jointState.name = _JointNames;
+		jointState.position = point.positions;
+		jointState.velocity = point.velocities;
 		updateLastStateFeedbackMessages(jointState);
-		//_LastJointState = jointState;
-		_ProcessingRequest = false;
+		publishLastState();
 	}
 
-protected:
+	void publishLastState()
+	{
+		_LastControllerJointState.header.stamp = _LastControllerTrajState.header.stamp =  ros::Time::now();
+		_LastJointState.header.stamp = ros::Time::now();
+		_ControllerStatePublisher.publish(_LastControllerJointState);
+		_ControllerFeedbackPublisher.publish(_LastControllerTrajState);
+		_JointStatePublisher.publish(_LastJointState);
+	}
 
 	void updateLastStateFeedbackMessages(const sensor_msgs::JointState &st)
 	{
@@ -222,7 +324,6 @@ protected:
 	ros::Publisher _ControllerStatePublisher;
 	ros::Publisher _JointStatePublisher;
 	ros::Publisher _ControllerFeedbackPublisher;
-	ros::Timer _StatusUpdateTimer;
 
 	// topic names
 	std::string _CntrlStatePubTopic;
@@ -232,14 +333,19 @@ protected:
 
 	// ros parameters
 	std::vector<std::string> _JointNames;
+	double _TimeScale;
+	double _FeedbackRate;
 
 	// last states
 	sensor_msgs::JointState _LastJointState;
 	control_msgs::FollowJointTrajectoryFeedback _LastControllerTrajState;
 	pr2_controllers_msgs::JointTrajectoryControllerState _LastControllerJointState;
 
-	// others
-	bool _ProcessingRequest;
+	// execution thread, the last states above are only touched by it once it is running
+	boost::thread _ExecutionThread;
+	boost::mutex _TrajectoryMutex;
+	trajectory_msgs::JointTrajectory::ConstPtr _PendingTrajectory;
+	bool _NewTrajectory;
 };
 
 int main(int argc, char** argv)
@@ -10,6 +10,7 @@
 
 #include <object_manipulation_msgs/GraspPlanning.h>
 #include <string.h>
+#include <vector>
 
 class GraspPlannerInterface
 {
@@ -19,6 +20,24 @@ public:
 	virtual std::string getPlannerName() = 0;
 	virtual void fetchParameters(bool useNodeNamespace) = 0;
 
+	// plans each request on its own, a failed request gets an error code in its response.
+	// Returns false if any request failed.  Planners that can plan concurrently override this.
+	virtual bool planGrasps(std::vector<object_manipulation_msgs::GraspPlanning::Request> &reqs,
+			std::vector<object_manipulation_msgs::GraspPlanning::Response> &res)
+	{
+		bool success = true;
+		res.resize(reqs.size());
+		for(unsigned int i = 0; i < reqs.size(); i++)
+		{
+			if(!planGrasp(reqs[i],res[i]))
+			{
+				res[i].error_code.value = object_manipulation_msgs::GraspPlanningErrorCode::OTHER_ERROR;
+				success = false;
+			}
+		}
+		return success;
+	}
+
 protected:
 };
 
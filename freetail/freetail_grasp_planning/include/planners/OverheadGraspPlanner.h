@@ -25,6 +25,8 @@ const std::string PARAM_NAME_NUM_CANDIDATE_GRASPS = "/num_returned_candidate_gra
 const std::string PARAM_NAME_GRASP_IN_WORLD_COORDINATES = "grasp_pose_in_world_coordinates";
 const std::string PARAM_NAME_SEARCH_RADIUS = "/search_radius";
 const std::string PARAM_NAME_APPROACH_VECTOR = "/approach_vector";
+const std::string PARAM_NAME_LOG_TOP_PLANE_POINTS = "/log_top_plane_points";
+const std::string PARAM_NAME_BATCH_THREADS = "/batch_threads";
 
 
 // default ros parameter values
@@ -34,6 +36,8 @@ const double PARAM_DEFAULT_SEARCH_RADIUS = 0.005; //0.5 cm
 const int PARAM_DEFAULT_NUM_CANDIDATE_GRASPS = 8;
 const bool PARAM_DEFAULT_GRASP_IN_WORLD_COORDINATES = true; //
 const tf::Vector3 PARAM_DEFAULT_APPROACH_VECTOR = tf::Vector3(0.0f,0.0f,-1.0f);  // in world coordinates
+const bool PARAM_DEFAULT_LOG_TOP_PLANE_POINTS = false; // prints every point found on the top plane
+const int PARAM_DEFAULT_BATCH_THREADS = 0; // 0 uses one thread per core
 
 // other defaults
 const std::string GRASP_PLANNER_NAME = "OverheadGraspPlanner";
@@ -52,6 +56,9 @@ public:
 		int NumCandidateGrasps;
 		bool GraspInWorldCoordinates;
 		tf::Vector3 ApproachVector; // in world coordinates
+		bool UsingDefaultApproachVector;
+		bool LogTopPlanePoints;
+		int BatchThreads;
 	};
 
 	OverheadGraspPlanner();
@@ -59,17 +66,23 @@ public:
 
 	bool planGrasp(object_manipulation_msgs::GraspPlanning::Request &req,
 			object_manipulation_msgs::GraspPlanning::Response &res);
+	bool planGrasps(std::vector<object_manipulation_msgs::GraspPlanning::Request> &reqs,
+			std::vector<object_manipulation_msgs::GraspPlanning::Response> &res);
 	std::string getPlannerName();
 	void fetchParameters(bool useNodeNamespace);
 
 protected:
+
+	// plans with a snapshot of the parameters, so several requests can be planned concurrently
+	bool planGrasp(const object_manipulation_msgs::GraspPlanning::Request &req,
+			object_manipulation_msgs::GraspPlanning::Response &res,const ParameterVals &params);
+	void planGraspsWorker(std::vector<object_manipulation_msgs::GraspPlanning::Request> &reqs,
+			std::vector<object_manipulation_msgs::GraspPlanning::Response> &res,std::vector<char> &success,
+			unsigned int &nextRequest,const ParameterVals &params);
+
 	static const std::string _GraspPlannerName;
-	std::string _WorldFrameId;
 	ParameterVals _ParamVals;
 	tf::TransformListener _tfListener;
-
-	// computational members
-	bool _UsingDefaultApproachVector;
 };
 
 #endif /* OVERHEADGRASPPLANNER_H_ */
@@ -15,8 +15,10 @@
 #include <planners/OverheadGraspPlanner.h>
 #include <geometry_msgs/Polygon.h>
 #include <geometry_msgs/PolygonStamped.h>
+#include <freetail_grasp_planning/GraspPlanningBatch.h>
 
 const std::string SERVICE_NAME = "plan_point_cluster_grasp";
+const std::string BATCH_SERVICE_NAME = "plan_point_cluster_grasp_batch";
 const std::string POSE_PUBLISH_TOPIC_NAME = "grasp_poses";
 const std::string PLANE_PUBLISH_TOPIC_NAME = "contact_plane";
 const std::string PARAM_NAME_PUBLISH_RESULTS = "publish_results";
@@ -29,6 +31,8 @@ public:
 	void finish();
 	bool serviceCallback(object_manipulation_msgs::GraspPlanning::Request &request,
 			object_manipulation_msgs::GraspPlanning::Response &response);
+	bool batchServiceCallback(freetail_grasp_planning::GraspPlanningBatch::Request &request,
+			freetail_grasp_planning::GraspPlanningBatch::Response &response);
 
 	void timerCallback(const ros::TimerEvent &evnt);
 
@@ -39,6 +43,7 @@ protected:
 
 	GraspPlannerInterface *_GraspPlanner;
 	ros::ServiceServer _ServiceServer;
+	ros::ServiceServer _BatchServiceServer;
 	ros::Publisher _PosePublisher;
 	ros::Publisher _PlanePublisher;
 	ros::Timer _PublishTimer;
@@ -47,6 +52,7 @@ protected:
 	std::string _PosePubTopic;
 	std::string _PlanePubTopic;
 	std::string _ServiceName;
+	std::string _BatchServiceName;
 
 	// from ros parameter server
 	bool _PublishResults;
@@ -55,6 +61,8 @@ protected:
 	bool _ResultsSet;
 	geometry_msgs::PolygonStamped _LastValidTablePolygonMsg;
 	geometry_msgs::PoseStamped _LastValidGraspPoseMsg;
+
+	void storeLastValidResults(const std::string &worldFrameId,const std::vector<object_manipulation_msgs::Grasp> &grasps);
 };
 
 #endif /* GRASPPLANNERSERVER_H_ */
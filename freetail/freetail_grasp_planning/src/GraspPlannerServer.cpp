@@ -14,6 +14,7 @@
 GraspPlannerServer::GraspPlannerServer():
 _GraspPlanner(0),
 _ServiceName(SERVICE_NAME),
+_BatchServiceName(BATCH_SERVICE_NAME),
 _PublishResults(false),
 _PosePubTopic(POSE_PUBLISH_TOPIC_NAME),
 _PlanePubTopic(PLANE_PUBLISH_TOPIC_NAME),
@@ -41,6 +42,8 @@ void GraspPlannerServer::init()
 	// setting up ros server
 	_ServiceServer = nh.advertiseService(_ServiceName,&GraspPlannerServer::serviceCallback,this);
 	ROS_INFO("%s",std::string(_GraspPlanner->getPlannerName() + " advertising service: " + _ServiceName).c_str());
+	_BatchServiceServer = nh.advertiseService(_BatchServiceName,&GraspPlannerServer::batchServiceCallback,this);
+	ROS_INFO("%s",std::string(_GraspPlanner->getPlannerName() + " advertising service: " + _BatchServiceName).c_str());
 
 	// setting up ros timer
 	_PublishTimer = nh.createTimer(ros::Duration(_PublishInterval),&GraspPlannerServer::timerCallback,this);
@@ -69,24 +72,7 @@ bool GraspPlannerServer::serviceCallback(object_manipulation_msgs::GraspPlanning
 
 		if(success)
 		{
-			std::string worldFrameId = req.target.reference_frame_id;
-
-			// storing last valid grasp pose
-			_LastValidGraspPoseMsg.header.frame_id = worldFrameId;
-			_LastValidGraspPoseMsg.pose = geometry_msgs::Pose();
-
-			if(res.grasps.size() > 0)
-			{
-				_LastValidGraspPoseMsg.pose = res.grasps[0].grasp_pose;
-			}
-
-			// storing last valid contact plane grasp contact plane
-			tf::Transform transform = tf::Transform::getIdentity();
-			tf::poseMsgToTF(res.grasps[0].grasp_pose,transform);
-			_LastValidTablePolygonMsg.header.frame_id = worldFrameId;
-			_LastValidTablePolygonMsg.polygon = GraspPlannerServer::createPlanePolygon(transform,0.2f,0.2f);
-
-			_ResultsSet = true;
+			storeLastValidResults(req.target.reference_frame_id,res.grasps);
 		}
 
 		return success;
@@ -97,6 +83,67 @@ bool GraspPlannerServer::serviceCallback(object_manipulation_msgs::GraspPlanning
 	}
 }
 
+bool GraspPlannerServer::batchServiceCallback(freetail_grasp_planning::GraspPlanningBatch::Request &req,
+		freetail_grasp_planning::GraspPlanningBatch::Response &res)
+{
+	if(!_GraspPlanner)
+	{
+		return false;
+	}
+
+	std::vector<object_manipulation_msgs::GraspPlanning::Request> requests(req.targets.size());
+	std::vector<object_manipulation_msgs::GraspPlanning::Response> responses;
+	for(unsigned int i = 0; i < req.targets.size(); i++)
+	{
+		requests[i].arm_name = req.arm_name;
+		requests[i].target = req.targets[i];
+	}
+
+	// a target that fails is reported in its error code, the call itself only fails without a planner
+	_GraspPlanner->planGrasps(requests,responses);
+
+	res.results.resize(responses.size());
+	for(unsigned int i = 0; i < responses.size(); i++)
+	{
+		res.results[i].grasps = responses[i].grasps;
+		res.results[i].error_code = responses[i].error_code;
+	}
+
+	// the first target planned is the one published
+	for(unsigned int i = 0; i < responses.size(); i++)
+	{
+		if(responses[i].error_code.value == object_manipulation_msgs::GraspPlanningErrorCode::SUCCESS)
+		{
+			storeLastValidResults(requests[i].target.reference_frame_id,responses[i].grasps);
+			break;
+		}
+	}
+
+	return true;
+}
+
+void GraspPlannerServer::storeLastValidResults(const std::string &worldFrameId,
+		const std::vector<object_manipulation_msgs::Grasp> &grasps)
+{
+	// storing last valid grasp pose
+	_LastValidGraspPoseMsg.header.frame_id = worldFrameId;
+	_LastValidGraspPoseMsg.pose = geometry_msgs::Pose();
+
+	if(grasps.empty())
+	{
+		return;
+	}
+	_LastValidGraspPoseMsg.pose = grasps[0].grasp_pose;
+
+	// storing last valid contact plane grasp contact plane
+	tf::Transform transform = tf::Transform::getIdentity();
+	tf::poseMsgToTF(grasps[0].grasp_pose,transform);
+	_LastValidTablePolygonMsg.header.frame_id = worldFrameId;
+	_LastValidTablePolygonMsg.polygon = GraspPlannerServer::createPlanePolygon(transform,0.2f,0.2f);
+
+	_ResultsSet = true;
+}
+
 void GraspPlannerServer::timerCallback(const ros::TimerEvent &evnt)
 {
 	// retrieving parameter from ros
@@ -7,27 +7,74 @@
 
 #include <planners/OverheadGraspPlanner.h>
 #include <sensor_msgs/PointCloud.h>
-#include <sensor_msgs/PointCloud2.h>
-#include <sensor_msgs/point_cloud_conversion.h>
-#include <pcl/point_cloud.h>
-#include <pcl_ros/point_cloud.h>
 #include <tf/LinearMath/Scalar.h>
 #include <ros/console.h>
-#include <tf_conversions/tf_eigen.h>
-#include <pcl/common/transforms.h>
-#include <pcl/ModelCoefficients.h>
-#include <pcl/surface/convex_hull.h>
-#include <pcl/segmentation/extract_clusters.h>
-#include <pcl/filters/passthrough.h>
-#include <pcl/filters/project_inliers.h>
-#include <pcl/filters/extract_indices.h>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/foreach.hpp>
+#include <algorithm>
 #include <cmath>
 
 const std::string OverheadGraspPlanner::_GraspPlannerName = GRASP_PLANNER_NAME;
-typedef pcl::PointCloud<pcl::PointXYZ> PclCloud;
+
+/*	Finds the points of the cluster within proximity of its highest point, after transforming them by transform.
+ * 	The cluster is read once: the highest point so far is tracked while the points near it are collected, and the
+ * 	collected points that fall out of range as the highest point rises are dropped from time to time.  The points
+ * 	found keep the cluster's order.
+ */
+static bool extractTopSurface(const sensor_msgs::PointCloud &cluster,const tf::Transform &transform,double proximity,
+		std::vector<tf::Vector3> &topPoints,tf::Vector3 &pointMin,tf::Vector3 &pointMax)
+{
+	topPoints.clear();
+	if(cluster.points.empty())
+	{
+		return false;
+	}
+
+	proximity = std::abs(proximity);
+	pointMin = pointMax = transform(tf::Vector3(cluster.points[0].x,cluster.points[0].y,cluster.points[0].z));
+	std::size_t pruneSize = 64;
+	for(std::size_t i = 0; i < cluster.points.size(); i++)
+	{
+		const geometry_msgs::Point32 &p = cluster.points[i];
+		tf::Vector3 point = transform(tf::Vector3(p.x,p.y,p.z));
+		pointMin.setMin(point);
+		pointMax.setMax(point);
+
+		if(point.z() >= pointMax.z() - proximity)
+		{
+			topPoints.push_back(point);
+		}
+
+		if(topPoints.size() >= pruneSize)
+		{
+			std::size_t kept = 0;
+			for(std::size_t j = 0; j < topPoints.size(); j++)
+			{
+				if(topPoints[j].z() >= pointMax.z() - proximity)
+				{
+					topPoints[kept++] = topPoints[j];
+				}
+			}
+			topPoints.resize(kept);
+			pruneSize = std::max<std::size_t>(pruneSize,2*kept);
+		}
+	}
+
+	std::size_t kept = 0;
+	for(std::size_t j = 0; j < topPoints.size(); j++)
+	{
+		if(topPoints[j].z() >= pointMax.z() - proximity)
+		{
+			topPoints[kept++] = topPoints[j];
+		}
+	}
+	topPoints.resize(kept);
+	return !topPoints.empty();
+}
+
 OverheadGraspPlanner::OverheadGraspPlanner():
 _ParamVals(ParameterVals()),
-_WorldFrameId("/NO_PARENT"),
 _tfListener()
 {
 	// TODO Auto-generated constructor stub
@@ -57,15 +104,19 @@ void OverheadGraspPlanner::fetchParameters(bool useNodeNamespace)
 				PARAM_DEFAULT_NUM_CANDIDATE_GRASPS);
 	ros::param::param(paramNamespace + PARAM_NAME_GRASP_IN_WORLD_COORDINATES,_ParamVals.GraspInWorldCoordinates,
 				PARAM_DEFAULT_GRASP_IN_WORLD_COORDINATES);
+	ros::param::param(paramNamespace + PARAM_NAME_LOG_TOP_PLANE_POINTS,_ParamVals.LogTopPlanePoints,
+				PARAM_DEFAULT_LOG_TOP_PLANE_POINTS);
+	ros::param::param(paramNamespace + PARAM_NAME_BATCH_THREADS,_ParamVals.BatchThreads,
+				PARAM_DEFAULT_BATCH_THREADS);
 
 	// checking if param containing z vector values exists
 	XmlRpc::XmlRpcValue list;
-	_UsingDefaultApproachVector = true;
+	_ParamVals.UsingDefaultApproachVector = true;
 	_ParamVals.ApproachVector = PARAM_DEFAULT_APPROACH_VECTOR;
 
 	// additional error checking
 	bool valid = false;
-	_UsingDefaultApproachVector = !valid;
+	_ParamVals.UsingDefaultApproachVector = !valid;
 	_ParamVals.ApproachVector = _ParamVals.ApproachVector.normalize();
 	if(ros::param::has(paramNamespace + PARAM_NAME_APPROACH_VECTOR))
 	{
@@ -86,7 +137,7 @@ void OverheadGraspPlanner::fetchParameters(bool useNodeNamespace)
 			return;
 		}
 
-		_UsingDefaultApproachVector = !valid;
+		_ParamVals.UsingDefaultApproachVector = !valid;
 		if(valid)
 		{
 			// converting into vector3 object
@@ -97,7 +148,7 @@ void OverheadGraspPlanner::fetchParameters(bool useNodeNamespace)
 					ROS_WARN("%s",std::string("Value in '" + paramNamespace + PARAM_NAME_APPROACH_VECTOR + "'is invalid, using default").c_str());
 					valid = false;
 					_ParamVals.ApproachVector = PARAM_DEFAULT_APPROACH_VECTOR;
-					_UsingDefaultApproachVector = !valid;
+					_ParamVals.UsingDefaultApproachVector = !valid;
 					return;
 				}
 				_ParamVals.ApproachVector.m_floats[i] = static_cast<double>(list[i]);
@@ -117,31 +168,77 @@ bool OverheadGraspPlanner::planGrasp(object_manipulation_msgs::GraspPlanning::Re
 	// updating parameters
 	fetchParameters(true);
 
+	return planGrasp(req,res,_ParamVals);
+}
+
+bool OverheadGraspPlanner::planGrasps(std::vector<object_manipulation_msgs::GraspPlanning::Request> &reqs,
+		std::vector<object_manipulation_msgs::GraspPlanning::Response> &res)
+{
+	// parameters are fetched once for the whole batch
+	fetchParameters(true);
+	const ParameterVals params = _ParamVals;
+
+	res.assign(reqs.size(),object_manipulation_msgs::GraspPlanning::Response());
+	std::vector<char> success(reqs.size(),0);
+	unsigned int nextRequest = 0;
+
+	unsigned int numThreads = params.BatchThreads > 0 ? params.BatchThreads :
+			std::max(1u,boost::thread::hardware_concurrency());
+	numThreads = std::min<unsigned int>(numThreads,reqs.size());
+	if(numThreads <= 1)
+	{
+		planGraspsWorker(reqs,res,success,nextRequest,params);
+	}
+	else
+	{
+		boost::thread_group threads;
+		for(unsigned int i = 0; i < numThreads; i++)
+		{
+			threads.create_thread(boost::bind(&OverheadGraspPlanner::planGraspsWorker,this,boost::ref(reqs),
+					boost::ref(res),boost::ref(success),boost::ref(nextRequest),boost::cref(params)));
+		}
+		threads.join_all();
+	}
+
+	return std::find(success.begin(),success.end(),0) == success.end();
+}
+
+void OverheadGraspPlanner::planGraspsWorker(std::vector<object_manipulation_msgs::GraspPlanning::Request> &reqs,
+		std::vector<object_manipulation_msgs::GraspPlanning::Response> &res,std::vector<char> &success,
+		unsigned int &nextRequest,const ParameterVals &params)
+{
+	for(unsigned int i = __sync_fetch_and_add(&nextRequest,1); i < reqs.size(); i = __sync_fetch_and_add(&nextRequest,1))
+	{
+		success[i] = planGrasp(reqs[i],res[i],params);
+		if(!success[i])
+		{
+			res[i].grasps.clear();
+			res[i].error_code.value = object_manipulation_msgs::GraspPlanningErrorCode::OTHER_ERROR;
+		}
+	}
+}
+
+bool OverheadGraspPlanner::planGrasp(const object_manipulation_msgs::GraspPlanning::Request &req,
+		object_manipulation_msgs::GraspPlanning::Response &res,const ParameterVals &params)
+{
 	// local variables
-	ros::NodeHandle nh;
 	std::stringstream stdOut;
 
-	// converting message to pcl type
-	sensor_msgs::PointCloud2 inCloudMsg;
-	sensor_msgs::convertPointCloudToPointCloud2(req.target.cluster,inCloudMsg);
-	PclCloud cloud = PclCloud(),transformedCloud = PclCloud();
-	pcl::fromROSMsg(inCloudMsg,cloud);
-
 	// ---------------------------------------------------------------------------------------------------------------
 	// -------------------------------- resolving cluster reference frame in world coordinates
 	tf::StampedTransform clusterTf; clusterTf.setIdentity();// will be modified if alternate approach direction is used
 	tf::StampedTransform clusterTfInWorld; // will remain fixed
 	std::string clusterFrameId = req.target.cluster.header.frame_id;
-	_WorldFrameId = req.target.reference_frame_id;
+	std::string worldFrameId = req.target.reference_frame_id;
 	try
 	{
-		_tfListener.lookupTransform(_WorldFrameId ,clusterFrameId,
+		_tfListener.lookupTransform(worldFrameId ,clusterFrameId,
 				ros::Time(0),clusterTf);
 	}
 	catch(tf::TransformException ex)
 	{
 		ROS_ERROR("%s",std::string(getPlannerName() + " , failed to resolve transform from " +
-				_WorldFrameId + " to " + clusterFrameId + " \n\t\t" + " tf error msg: " +  ex.what()).c_str());
+				worldFrameId + " to " + clusterFrameId + " \n\t\t" + " tf error msg: " +  ex.what()).c_str());
 		ROS_WARN("%s",std::string(getPlannerName() + ": Will use Identity as cluster transform").c_str());
 		clusterTf.setData(tf::Transform::getIdentity());
 	}
@@ -151,12 +248,12 @@ bool OverheadGraspPlanner::planGrasp(object_manipulation_msgs::GraspPlanning::Re
 	// -------------------------------- transforming to alternate approach vector
 	// This transformation will allow finding the highest point relative to the opposite direction of the approach vector
 	tf::Transform approachTf;approachTf.setIdentity();
-	if(!_UsingDefaultApproachVector)
+	if(!params.UsingDefaultApproachVector)
 	{
 		// use cros-product and matrix inverse in order to compute transform with modified z-direction (approach vector)
 		// use the negative of the modified z-direction vector for all computations.
 		tf::Matrix3x3 rotMat;rotMat.setIdentity();
-		tf::Vector3 zVec = -_ParamVals.ApproachVector.normalize();
+		tf::Vector3 zVec = -params.ApproachVector.normalized();
 
 		// checking that both z vectors have different directions
 		tfScalar tolerance = 0.01f;
@@ -191,132 +288,79 @@ bool OverheadGraspPlanner::planGrasp(object_manipulation_msgs::GraspPlanning::Re
 	}
 
 	// ---------------------------------------------------------------------------------------------------------------
-	// -------------------------------- transforming to correct reference frame --------------------------------------
-	Eigen::Affine3d tfEigen;
-	tf::TransformTFToEigen(clusterTf,tfEigen);
-	pcl::transformPointCloud(cloud,cloud,Eigen::Affine3f(tfEigen));
-
-	// finding bounding box
-	pcl::PointXYZ pointMax, pointMin;
-	pcl::getMinMax3D(cloud,pointMin,pointMax);
+	// -------------------------------- finding points near or on top plane ------------------------------------------
+	// the cluster is transformed to the approach frame point by point, it is not copied
+	std::vector<tf::Vector3> topPoints;
+	tf::Vector3 pointMin, pointMax;
+	topPoints.reserve(64);
+	if(!extractTopSurface(req.target.cluster,clusterTf,params.PlaneProximityThreshold,topPoints,pointMin,pointMax))
+	{
+		stdOut<<getPlannerName()<< ": Found not points on top plane, canceling request";
+		ROS_INFO("%s",stdOut.str().c_str());stdOut.str("");
+		return false;
+	}
 
 	// extracting highest point from bounding box
-	double maxZ = pointMax.z;
-	stdOut << getPlannerName() << ": Found Min Point at x: "<<pointMin.x<<", y: "<<pointMin.y<<", z: " << pointMin.z;
+	double maxZ = pointMax.z();
+	stdOut << getPlannerName() << ": Found Min Point at x: "<<pointMin.x()<<", y: "<<pointMin.y()<<", z: " << pointMin.z();
 	ROS_INFO("%s",stdOut.str().c_str());stdOut.str("");
-	stdOut << getPlannerName() << ": Found Max Point at x: "<<pointMax.x<<", y: "<<pointMax.y<<", z: " << maxZ;
+	stdOut << getPlannerName() << ": Found Max Point at x: "<<pointMax.x()<<", y: "<<pointMax.y()<<", z: " << maxZ;
 	ROS_INFO("%s",stdOut.str().c_str());stdOut.str("");
 
-	// ---------------------------------------------------------------------------------------------------------------
-	// finding points near or on top plane
-	PclCloud::Ptr planeCloud  = boost::make_shared<PclCloud>();
-	pcl::PassThrough<pcl::PointXYZ> passFilter;
-	passFilter.setInputCloud(boost::make_shared<PclCloud>(cloud));
-	passFilter.setFilterFieldName("z");
-	passFilter.setFilterLimits(maxZ - std::abs(_ParamVals.PlaneProximityThreshold),
-			maxZ + std::abs(_ParamVals.PlaneProximityThreshold));
-	passFilter.filter(*planeCloud);
-	if(planeCloud->size() > 0)
+	stdOut << getPlannerName() << ": Found " << topPoints.size()<<" points at a proximity of "
+			<<params.PlaneProximityThreshold << " to top plane";
+	if(params.LogTopPlanePoints)
 	{
-		stdOut << getPlannerName() << ": Found " << planeCloud->size()<<" points at a proximity of "
-				<<_ParamVals.PlaneProximityThreshold << " to top plane";
 		// printing found points
-		BOOST_FOREACH(pcl::PointXYZ point,*planeCloud)
+		BOOST_FOREACH(const tf::Vector3 &point,topPoints)
 		{
-			stdOut<<"\n\t"<<"x: "<<point.x<<", y: "<<point.y<<", z: "<<point.z;
+			stdOut<<"\n\t"<<"x: "<<point.x()<<", y: "<<point.y()<<", z: "<<point.z();
 		}
-		ROS_INFO("%s",stdOut.str().c_str());stdOut.str("");
-	}
-	else
-	{
-		stdOut<<getPlannerName()<< ": Found not points on top plane, canceling request";
-		ROS_INFO("%s",stdOut.str().c_str());stdOut.str("");
-		return false;
 	}
+	ROS_INFO("%s",stdOut.str().c_str());stdOut.str("");
 
 	// ---------------------------------------------------------------------------------------------------------------
-	// projecting filtered points onto top plane
-	// defining plane coefficients
-	tf::Vector3 normal = tf::Vector3(0.0f,0.0f,1.0f);
-	double offset = -normal.dot(tf::Vector3(0.0f,0.0f,maxZ));
-	pcl::ModelCoefficients::Ptr coefficients = boost::make_shared<pcl::ModelCoefficients>();
-	coefficients->values.resize(4);
-	coefficients->values[0] = normal.getX();
-	coefficients->values[1] = normal.getY();
-	coefficients->values[2] = normal.getZ();
-	coefficients->values[3] = offset;
-	stdOut << getPlannerName() << ": Created Contact Plane with coefficients: " << coefficients->values[0]
-		   << ", "	<< coefficients->values[1] << ", " << coefficients->values[2] << ", " << coefficients->values[3];
+	// projecting filtered points onto the top plane (z = maxZ), only their x and y are used from here on
+	stdOut << getPlannerName() << ": Created Contact Plane with coefficients: 0, 0, 1, " << -maxZ;
 	ROS_INFO("%s",stdOut.str().c_str());stdOut.str("");
 
-	// projecting points
-	PclCloud::Ptr projectedCloud = boost::make_shared<PclCloud>();
-	pcl::ProjectInliers<pcl::PointXYZ> projectObj;
-	projectObj.setModelType(pcl::SACMODEL_PLANE);
-	projectObj.setInputCloud(planeCloud);
-	projectObj.setModelCoefficients(coefficients);
-	projectObj.filter(*projectedCloud);
-
-
 	// finding all points within a search radius
 	/*	This search attempts to find points that belong to the same object while removing those that are not part
-	 * of the object of interest but were found to be close enough to the plane.
+	 * of the object of interest but were found to be close enough to the plane.  The neighborhood of the first
+	 * projected point is kept, it always contains at least that point.
 	*/
-	if(_ParamVals.SearchRadius > 0) // skip if search radius <= 0 and use all points instead
+	double sumX = 0, sumY = 0;
+	unsigned int numPoints = 0;
+	if(params.SearchRadius > 0) // skip if search radius <= 0 and use all points instead
 	{
-		bool continueSearch = true;
-		unsigned int index = 0;
-		pcl::search::KdTree<pcl::PointXYZ>::Ptr searchTree = boost::make_shared<pcl::search::KdTree<pcl::PointXYZ> >();
-		std::vector<int> indices;
-		std::vector<float> sqDistances;
-		searchTree->setInputCloud(projectedCloud);
-
-		while(continueSearch)
+		const tf::Vector3 &seed = topPoints[0];
+		const double sqRadius = params.SearchRadius * params.SearchRadius;
+		BOOST_FOREACH(const tf::Vector3 &point,topPoints)
 		{
-			int found = searchTree->radiusSearch(projectedCloud->points[index],
-					_ParamVals.SearchRadius,indices,sqDistances);
-
-			if(found > 0)
+			double dx = point.x() - seed.x(), dy = point.y() - seed.y();
+			if(dx*dx + dy*dy <= sqRadius)
 			{
-				continueSearch = false;
-			}
-			else
-			{
-				index++;
-				if(index == projectedCloud->points.size())
-				{
-					ROS_ERROR_STREAM(getPlannerName() << ": Did not find points within search radius: " <<
-							_ParamVals.SearchRadius <<",  exiting");
-
-					res.grasps = std::vector<object_manipulation_msgs::Grasp>();
-					res.error_code.value = object_manipulation_msgs::GraspPlanningErrorCode::OTHER_ERROR;
-
-					return false;
-				}
+				sumX += point.x(); sumY += point.y();
+				numPoints++;
 			}
 		}
 
-		// extracting points
-		pcl::PointIndices::Ptr inliers = boost::make_shared<pcl::PointIndices>();
-		inliers->indices = indices;
-		pcl::ExtractIndices<pcl::PointXYZ> extractObj;
-		extractObj.setInputCloud(projectedCloud);
-		extractObj.setIndices(inliers);
-		extractObj.setNegative(false);
-		extractObj.filter(*projectedCloud);
-
-		stdOut << getPlannerName() << ": Found " << projectedCloud->size() << " points within search radius: " <<
-				_ParamVals.SearchRadius;
+		stdOut << getPlannerName() << ": Found " << numPoints << " points within search radius: " <<
+				params.SearchRadius;
 		ROS_INFO("%s",stdOut.str().c_str());stdOut.str("");
 	}
 	else
 	{
 		ROS_INFO_STREAM(getPlannerName()<<": search radius <= 0, skipping search and using all points found instead");
+		BOOST_FOREACH(const tf::Vector3 &point,topPoints)
+		{
+			sumX += point.x(); sumY += point.y();
+		}
+		numPoints = topPoints.size();
 	}
 
 	// finding centroid of projected point cloud (should work well for objects with relative degree of symmetry)
-	Eigen::Vector4f centroid;
-	pcl::compute3DCentroid(*projectedCloud,centroid);
+	tf::Vector3 centroid(sumX/numPoints,sumY/numPoints,maxZ);
 	stdOut << getPlannerName() << ": Found centroid at: x = " << centroid[0] << ", y = " << centroid[1] << ", z = " << centroid[2];
 	ROS_INFO("%s",stdOut.str().c_str());stdOut.str("");
 
@@ -335,12 +379,12 @@ bool OverheadGraspPlanner::planGrasp(object_manipulation_msgs::GraspPlanning::Re
 	graspTf.setOrigin(tf::Vector3(centroid[0],centroid[1],centroid[2]));
 	graspTf.setRotation(rot);
 
-	if(_UsingDefaultApproachVector)
+	if(params.UsingDefaultApproachVector)
 	{
 		graspTf = approachTf*graspTf; // transforming to world coordinates
 	}
 
-	if(!_ParamVals.GraspInWorldCoordinates) // transform to object coordinates
+	if(!params.GraspInWorldCoordinates) // transform to object coordinates
 	{
 		graspTf = clusterTfInWorld.inverse()*graspTf;
 	}
@@ -349,9 +393,9 @@ bool OverheadGraspPlanner::planGrasp(object_manipulation_msgs::GraspPlanning::Re
 	std::vector<object_manipulation_msgs::Grasp> grasps;
 
 	// computing additional candidate transforms
-	if(_ParamVals.NumCandidateGrasps > 1)
+	if(params.NumCandidateGrasps > 1)
 	{
-		int numGrasps = _ParamVals.NumCandidateGrasps;
+		int numGrasps = params.NumCandidateGrasps;
 		tfScalar angle = tfScalar(2*M_PI/(double(numGrasps)));
 		tf::Transform rotatedGraspTf = graspTf;
 		for(int i = 1; i < numGrasps - 1;i++)
@@ -368,8 +412,8 @@ bool OverheadGraspPlanner::planGrasp(object_manipulation_msgs::GraspPlanning::Re
 			candidateGrasp.grasp_pose.position.z = rotatedGraspTf.getOrigin().getZ();
 			candidateGrasp.grasp_posture = jointsGrasp;
 			candidateGrasp.pre_grasp_posture = jointsPreGrasp;
-			candidateGrasp.desired_approach_distance = _ParamVals.DefaultPregraspDistance;
-			candidateGrasp.min_approach_distance = _ParamVals.DefaultPregraspDistance;
+			candidateGrasp.desired_approach_distance = params.DefaultPregraspDistance;
+			candidateGrasp.min_approach_distance = params.DefaultPregraspDistance;
 
 			// adding grasp
 			grasps.push_back(candidateGrasp);
@@ -385,8 +429,8 @@ bool OverheadGraspPlanner::planGrasp(object_manipulation_msgs::GraspPlanning::Re
 		candidateGrasp.grasp_pose.position.z = graspTf.getOrigin().getZ();
 		candidateGrasp.grasp_posture = jointsGrasp;
 		candidateGrasp.pre_grasp_posture = jointsPreGrasp;
-		candidateGrasp.desired_approach_distance = _ParamVals.DefaultPregraspDistance;
-		candidateGrasp.min_approach_distance = _ParamVals.DefaultPregraspDistance;
+		candidateGrasp.desired_approach_distance = params.DefaultPregraspDistance;
+		candidateGrasp.min_approach_distance = params.DefaultPregraspDistance;
 
 		// adding grasp
 		grasps.push_back(candidateGrasp);
@@ -0,0 +1,135 @@
+/*
+ * BenchmarkOverheadGraspPlanner.cpp
+ *
+ *  Times OverheadGraspPlanner::planGrasps on recorded clusters, on one thread and on the batch threads.
+ *  usage: BenchmarkOverheadGraspPlanner <cluster pcd directory> [repetitions] [batch threads]
+ *  Needs a running roscore, the planner reads its parameters from this node's namespace.
+ */
+
+#include <ros/ros.h>
+#include <ros/console.h>
+#include <planners/OverheadGraspPlanner.h>
+#include <pcl/io/pcd_io.h>
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+#include <algorithm>
+#include <cmath>
+
+const std::string FRAME_ID = "base_link";
+
+bool loadClusters(const boost::filesystem::path &dir,std::vector<object_manipulation_msgs::GraspPlanning::Request> &reqs,
+		unsigned int &numPoints)
+{
+	std::vector<boost::filesystem::path> files;
+	for(boost::filesystem::directory_iterator it(dir); it != boost::filesystem::directory_iterator(); ++it)
+	{
+		if(boost::filesystem::is_regular_file(it->status()) && boost::filesystem::extension(it->path()) == ".pcd")
+		{
+			files.push_back(it->path());
+		}
+	}
+	std::sort(files.begin(),files.end());
+
+	numPoints = 0;
+	for(unsigned int i = 0; i < files.size(); i++)
+	{
+		pcl::PointCloud<pcl::PointXYZ> cloud;
+		if(pcl::io::loadPCDFile(files[i].string(),cloud) == -1 || cloud.points.empty())
+		{
+			ROS_WARN_STREAM("Skipping "<<files[i].string());
+			continue;
+		}
+
+		// clusters are given in the world frame, so no transform is needed to plan them
+		object_manipulation_msgs::GraspPlanning::Request req;
+		req.target.reference_frame_id = FRAME_ID;
+		req.target.cluster.header.frame_id = FRAME_ID;
+		req.target.cluster.points.resize(cloud.points.size());
+		for(unsigned int j = 0; j < cloud.points.size(); j++)
+		{
+			req.target.cluster.points[j].x = cloud.points[j].x;
+			req.target.cluster.points[j].y = cloud.points[j].y;
+			req.target.cluster.points[j].z = cloud.points[j].z;
+		}
+		reqs.push_back(req);
+		numPoints += cloud.points.size();
+	}
+	return !reqs.empty();
+}
+
+int main(int argc,char** argv)
+{
+	ros::init(argc,argv,"benchmark_overhead_grasp_planner");
+	ros::NodeHandle nh;
+
+	if(argc < 2)
+	{
+		ROS_ERROR("usage: BenchmarkOverheadGraspPlanner <cluster pcd directory> [repetitions] [batch threads]");
+		return 1;
+	}
+	int repetitions = argc > 2 ? boost::lexical_cast<int>(argv[2]) : 10;
+	int threads = argc > 3 ? boost::lexical_cast<int>(argv[3]) : 0;
+
+	std::vector<object_manipulation_msgs::GraspPlanning::Request> reqs;
+	unsigned int numPoints = 0;
+	if(!loadClusters(argv[1],reqs,numPoints))
+	{
+		ROS_ERROR_STREAM("No clusters found in "<<argv[1]);
+		return 1;
+	}
+
+	// the planner logs every step, only the timings are of interest here
+	const std::string batchThreadsParam = ros::this_node::getName() + PARAM_NAME_BATCH_THREADS;
+	if(ros::console::set_logger_level(ROSCONSOLE_DEFAULT_NAME,ros::console::levels::Warn))
+	{
+		ros::console::notifyLoggerLevelsChanged();
+	}
+
+	OverheadGraspPlanner planner;
+	std::vector<object_manipulation_msgs::GraspPlanning::Response> sequential(reqs.size()), batch;
+
+	// both runs go through planGrasps so the parameters are fetched once per batch in each
+	ros::param::set(batchThreadsParam,1);
+	ros::WallTime start = ros::WallTime::now();
+	for(int r = 0; r < repetitions; r++)
+	{
+		planner.planGrasps(reqs,sequential);
+	}
+	double sequentialTime = (ros::WallTime::now() - start).toSec();
+
+	ros::param::set(batchThreadsParam,threads);
+	start = ros::WallTime::now();
+	for(int r = 0; r < repetitions; r++)
+	{
+		planner.planGrasps(reqs,batch);
+	}
+	double batchTime = (ros::WallTime::now() - start).toSec();
+
+	// both modes have to plan the same grasps
+	unsigned int mismatches = 0;
+	for(unsigned int i = 0; i < reqs.size(); i++)
+	{
+		bool same = sequential[i].grasps.size() == batch[i].grasps.size();
+		for(unsigned int j = 0; same && j < batch[i].grasps.size(); j++)
+		{
+			const geometry_msgs::Point &a = sequential[i].grasps[j].grasp_pose.position;
+			const geometry_msgs::Point &b = batch[i].grasps[j].grasp_pose.position;
+			same = std::abs(a.x - b.x) < 1e-6 && std::abs(a.y - b.y) < 1e-6 && std::abs(a.z - b.z) < 1e-6;
+		}
+		mismatches += same ? 0 : 1;
+	}
+
+	// same thread count planGrasps uses
+	unsigned int usedThreads = threads > 0 ? threads : std::max(1u,boost::thread::hardware_concurrency());
+	usedThreads = std::min<unsigned int>(usedThreads,reqs.size());
+
+	const double plans = double(repetitions * reqs.size());
+	std::cout<<reqs.size()<<" clusters, "<<numPoints/reqs.size()<<" points on average, "<<repetitions<<" repetitions\n";
+	std::cout<<"1 thread:  "<<1000.0*sequentialTime/plans<<" ms per cluster\n";
+	std::cout<<usedThreads<<" threads: "<<1000.0*batchTime/plans<<" ms per cluster, speedup "
+			<<sequentialTime/batchTime<<"\n";
+	std::cout<<mismatches<<" clusters planned differently\n";
+
+	return mismatches == 0 ? 0 : 1;
+}
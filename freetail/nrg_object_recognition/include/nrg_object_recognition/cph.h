@@ -0,0 +1,178 @@
+//cph.h
+//Cylindrical projection histogram (CPH) feature, shared by the recognition and data collection packages.
+#ifndef NRG_OBJECT_RECOGNITION_CPH_H
+#define NRG_OBJECT_RECOGNITION_CPH_H
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/common/transforms.h>
+#include <pcl/io/pcd_io.h>
+#include <iostream>
+#include <vector>
+#include <math.h>
+
+#define PI 3.14159265
+
+/** \brief Computes the CPH of a cluster: a histogram of points binned by height (y) and by angle
+  * around the vertical axis through the bounding box center, scaled to the largest extent of
+  * the cluster and followed by the three bounding box sizes (in cm).
+  *
+  * The point data is gathered into reused structure-of-arrays buffers so that the bounding box,
+  * bin and angle loops are branch-light and can be vectorized by the compiler. Angles come from
+  * a polynomial atan2; points that land within the approximation error of a bin edge are
+  * re-binned with the exact atan2, so the output is identical to the original implementation.
+  */
+class CPHEstimation{
+
+public:
+
+  CPHEstimation(){
+   num_ybins = 5;
+   num_cbins = 180;
+   hist.resize(num_ybins * num_cbins,0);
+   centroid.resize(3,0);
+  };
+
+  CPHEstimation(int num_y, int num_c){
+   num_ybins = num_y;
+   num_cbins = num_c;
+   hist.resize(num_ybins * num_cbins,0);
+   centroid.resize(3,0);
+  };
+
+  bool setInputCloud(pcl::PointCloud<pcl::PointXYZ>::Ptr inputCloud){
+   cloud = inputCloud;
+   return 1;
+  };
+
+  /** \brief Length of the feature returned by compute() */
+  int getFeatureSize() const { return num_ybins*num_cbins + 3; };
+
+  /** \brief Number of points binned with the exact atan2 during the last compute() */
+  unsigned int getExactFallbackCount() const { return exact_fallbacks; };
+
+int compute(std::vector<float> &result){
+  const unsigned int n = cloud->size();
+  const pcl::PointXYZ *points = n > 0 ? &cloud->points[0] : NULL;
+
+  //Scratch buffers only grow, so repeated calls do not allocate.
+  if(px.size() < n){
+    px.resize(n); py.resize(n); pz.resize(n);
+    ybin.resize(n); angle.resize(n);
+  }
+
+  //Gather into SoA and compute the bouding box size in the same pass.
+  //The maxima start at 0 and the minima at 100 as in the original feature, the trained
+  //models depend on it.
+  float x_max=0, x_min=100, y_max=0, y_min = 100, z_max=0, z_min=100;
+  float *x = n > 0 ? &px[0] : NULL, *y = n > 0 ? &py[0] : NULL, *z = n > 0 ? &pz[0] : NULL;
+  for(unsigned int i=0; i<n; i++){
+    x[i] = points[i].x;
+    y[i] = points[i].y;
+    z[i] = points[i].z;
+    x_max = x[i] > x_max ? x[i] : x_max;
+    x_min = x[i] < x_min ? x[i] : x_min;
+    y_max = y[i] > y_max ? y[i] : y_max;
+    y_min = y[i] < y_min ? y[i] : y_min;
+    z_max = z[i] > z_max ? z[i] : z_max;
+    z_min = z[i] < z_min ? z[i] : z_min;
+  }
+
+  x_size = (x_max - x_min);
+  y_size = (y_max - y_min);
+  z_size = (z_max - z_min);
+
+  float max_size = x_size;
+  if(y_size > max_size)
+    max_size = y_size;
+  if(z_size > max_size)
+    max_size = z_size;
+  max_size*=100;
+
+  centroid[0] = x_min + x_size/2;
+  centroid[1] = y_min + y_size/2;
+  centroid[2] = z_min + z_size/2;
+
+  //compute feature
+  const int hist_size = num_cbins*num_ybins;
+  hist.assign(hist_size, 0.0f);
+  const float dy = y_size/num_ybins;
+  const float dc = 2*PI/num_cbins;
+  const float cx = centroid[0], cz = centroid[2];
+
+  //Height bin and approximate angle, no branches so this loop vectorizes.
+  float *yb = n > 0 ? &ybin[0] : NULL, *ang = n > 0 ? &angle[0] : NULL;
+  for(unsigned int i=0; i<n; i++){
+    yb[i] = (y[i]-y_min)/dy;
+    ang[i] = fastAtan2(z[i]-cz, x[i]-cx);
+  }
+
+  //Binning; a bin edge closer than the approximation error is resolved with the exact atan2.
+  //The margin is an order of magnitude above the polynomial error to also cover float rounding.
+  const double atan2_max_error = 1e-4;
+  const double edge_margin = atan2_max_error/(double)dc;
+  float max_peak = 0;
+  exact_fallbacks = 0;
+  for(unsigned int i=0; i<n; i++){
+    double t = (PI+ang[i])/dc;
+    double ft = floor(t);
+    double frac = t - ft;
+    int c;
+    if(frac >= edge_margin && frac <= 1.0 - edge_margin){
+      c = (int)ft;
+    }
+    else{
+      c = floor((PI+atan2(z[i]-cz,x[i]-cx))/dc);
+      exact_fallbacks++;
+    }
+    int b = (int)floor(yb[i])*num_cbins+c;
+    if((unsigned int)b < (unsigned int)hist_size){
+      float v = hist[b] += 1.0f;
+      if(v > max_peak)
+        max_peak = v;
+    }
+  }
+
+  //Rescale cph to largest spatial extent:
+  float scaleFactor = max_size/max_peak;
+  for(int i=0; i<hist_size; i++){
+    hist[i]*=scaleFactor;
+  }
+
+  //Stick size onto the end and BAM! scale variance.
+  result.resize(hist_size + 3);
+  std::copy(hist.begin(), hist.end(), result.begin());
+  result[hist_size] = x_size*100;
+  result[hist_size+1] = y_size*100;
+  result[hist_size+2] = z_size*100;
+  return result.size();
+};
+
+  /** \brief Polynomial atan2 (Abramowitz & Stegun 4.4.49), absolute error below 1e-5 rad.
+    * Returns NaN for (0,0) so that the caller falls back to the exact atan2.
+    */
+  static inline float fastAtan2(float y, float x){
+    float ax = fabsf(x), ay = fabsf(y);
+    float mx = ax > ay ? ax : ay;
+    float mn = ax > ay ? ay : ax;
+    float a = mn/mx;
+    float s = a*a;
+    float r = a*(0.9998660f + s*(-0.3302995f + s*(0.1801410f + s*(-0.0851330f + s*0.0208351f))));
+    r = ay > ax ? 1.57079637f - r : r;
+    r = x < 0 ? 3.14159274f - r : r;
+    r = y < 0 ? -r : r;
+    return r;
+  };
+
+private:
+
+  std::vector<float> hist;
+  pcl::PointCloud<pcl::PointXYZ>::Ptr cloud, result;
+  int num_ybins, num_cbins;
+  float x_size, y_size, z_size;
+  std::vector<float> centroid;
+  std::vector<float> px, py, pz, ybin, angle;
+  unsigned int exact_fallbacks;
+};
+
+#endif
@@ -0,0 +1,317 @@
+//euclidean_segmentation.h
+//Tabletop euclidean segmentation, shared by the recognition and data collection packages.
+#ifndef NRG_OBJECT_RECOGNITION_EUCLIDEAN_SEGMENTATION_H
+#define NRG_OBJECT_RECOGNITION_EUCLIDEAN_SEGMENTATION_H
+
+#include <pcl/ModelCoefficients.h>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/common/io.h>
+#include <pcl/filters/voxel_grid.h>
+#include <pcl/kdtree/kdtree.h>
+#include <pcl/sample_consensus/method_types.h>
+#include <pcl/sample_consensus/model_types.h>
+#include <pcl/segmentation/sac_segmentation.h>
+#include <pcl/segmentation/extract_clusters.h>
+#include <pcl/ros/conversions.h>
+#include <sensor_msgs/PointCloud2.h>
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+/** \brief Removes the dominant planes from a cloud and splits what is left into euclidean clusters.
+  *
+  * The cloud is voxel filtered once; everything after that works on index sets into the filtered
+  * cloud: the spatial filter, each RANSAC plane fit and the clustering only pass indices around, and
+  * clusters are copied out once at the end.  The filtered cloud, the index sets and the search tree
+  * are members, so a segmenter that is kept alive across frames does not reallocate them.
+  *
+  * With more than one thread the clusters are found as the connected components of the radius
+  * graph: the neighbor searches, which are the bulk of the work, are split over the threads, each
+  * thread joins its neighbors in its own union-find forest, and the forests are merged at the end.
+  * The clusters are the same as the ones pcl::EuclideanClusterExtraction returns.
+  */
+class EuclideanSegmentation{
+
+public:
+
+  typedef pcl::PointCloud<pcl::PointXYZ> PointCloud;
+
+  struct Parameters{
+
+    Parameters(){
+      leaf_size = 0.01f;
+      min_x = -0.7f; max_x = 0.7f;
+      min_y = -0.1f; max_y = 10.0f;
+      min_z = 0.0f; max_z = 1.2f;
+      plane_max_iterations = 100;
+      plane_distance_threshold = 0.02;
+      remaining_fraction = 0.3f;
+      min_remaining_points = 0;
+      cluster_tolerance = 0.02;
+      min_cluster_size = 0;
+      max_cluster_size = 25000;
+      num_threads = 1;
+    };
+
+    float leaf_size;
+    //Points strictly inside the box are kept, unless spatial_filter is set.
+    float min_x, max_x, min_y, max_y, min_z, max_z;
+    boost::function<bool (const pcl::PointXYZ&)> spatial_filter;
+    int plane_max_iterations;
+    double plane_distance_threshold;
+    //Planes are removed while more than this fraction of the spatially filtered points remain.
+    float remaining_fraction;
+    //Segmentation fails when no more than this many points are left after plane removal.
+    unsigned int min_remaining_points;
+    double cluster_tolerance;
+    int min_cluster_size;
+    int max_cluster_size;
+    //Threads used to extract the clusters, 1 uses pcl::EuclideanClusterExtraction.
+    int num_threads;
+  };
+
+  EuclideanSegmentation()
+    : cloud(new PointCloud), filtered(new PointCloud), remaining(new std::vector<int>),
+      tree(new pcl::search::KdTree<pcl::PointXYZ>){
+  };
+
+  EuclideanSegmentation(const Parameters &p)
+    : params(p), cloud(new PointCloud), filtered(new PointCloud), remaining(new std::vector<int>),
+      tree(new pcl::search::KdTree<pcl::PointXYZ>){
+  };
+
+  Parameters &getParameters(){ return params; };
+  const Parameters &getParameters() const { return params; };
+
+  /** \brief Segments a sensor cloud, returns false when too few points are left for clustering */
+  bool segment(const sensor_msgs::PointCloud2 &rawCloud){
+    pcl::fromROSMsg(rawCloud, *cloud);
+    return segmentCloud(cloud);
+  };
+
+  bool segment(const PointCloud::ConstPtr &rawCloud){
+    return segmentCloud(rawCloud);
+  };
+
+  /** \brief The voxel filtered cloud all index sets refer to */
+  const PointCloud::Ptr &getFilteredCloud() const { return filtered; };
+  /** \brief Points that passed the spatial filter */
+  const std::vector<int> &getBoundedIndices() const { return bounded; };
+  /** \brief Inliers of the last plane removed */
+  const std::vector<int> &getPlaneIndices() const { return plane.indices; };
+  /** \brief Points left after plane removal */
+  const std::vector<int> &getRemainingIndices() const { return *remaining; };
+  /** \brief Clusters from the last segment() call, largest first */
+  const std::vector<pcl::PointIndices> &getClusterIndices() const { return cluster_indices; };
+
+  void getCloud(const std::vector<int> &indices, PointCloud &out) const {
+    pcl::copyPointCloud(*filtered, indices, out);
+    out.is_dense = true;
+  };
+
+  /** \brief Appends one cloud per cluster */
+  void getClusters(std::vector<PointCloud::Ptr> &clusters) const {
+    clusters.reserve(clusters.size() + cluster_indices.size());
+    for(unsigned int i=0; i<cluster_indices.size(); i++){
+      PointCloud::Ptr cluster(new PointCloud);
+      getCloud(cluster_indices[i].indices, *cluster);
+      clusters.push_back(cluster);
+    }
+  };
+
+protected:
+
+  bool segmentCloud(const PointCloud::ConstPtr &input){
+    cluster_indices.clear();
+    plane.indices.clear();
+
+    vg.setInputCloud(input);
+    vg.setLeafSize(params.leaf_size, params.leaf_size, params.leaf_size);
+    vg.filter(*filtered);
+
+    bounded.clear();
+    const unsigned int n = filtered->points.size();
+    for(unsigned int i=0; i<n; i++){
+      const pcl::PointXYZ &p = filtered->points[i];
+      bool inside = params.spatial_filter ? params.spatial_filter(p) :
+        (p.x > params.min_x && p.x < params.max_x && p.y > params.min_y && p.y < params.max_y &&
+         p.z > params.min_z && p.z < params.max_z);
+      if(inside)
+        bounded.push_back(i);
+    }
+    *remaining = bounded;
+
+    removePlanes();
+
+    if(remaining->size() <= params.min_remaining_points || remaining->empty())
+      return false;
+
+    if(params.num_threads > 1)
+      extractClustersParallel();
+    else
+      extractClusters();
+    return true;
+  };
+
+  void removePlanes(){
+    seg.setOptimizeCoefficients(true);
+    seg.setModelType(pcl::SACMODEL_PLANE);
+    seg.setMethodType(pcl::SAC_RANSAC);
+    seg.setMaxIterations(params.plane_max_iterations);
+    seg.setDistanceThreshold(params.plane_distance_threshold);
+    seg.setInputCloud(filtered);
+
+    const unsigned int nr_points = bounded.size();
+    while(remaining->size() > params.remaining_fraction * nr_points){
+      //The fit only visits the remaining points, the inliers come back as indices into the filtered cloud.
+      seg.setIndices(remaining);
+      seg.segment(inliers, coefficients);
+      if(inliers.indices.size() == 0){
+        std::cout << "Could not estimate a planar model for the given dataset." << std::endl;
+        break;
+      }
+
+      std::sort(inliers.indices.begin(), inliers.indices.end());
+      scratch.clear();
+      std::set_difference(remaining->begin(), remaining->end(), inliers.indices.begin(), inliers.indices.end(),
+                          std::back_inserter(scratch));
+      remaining->swap(scratch);
+      plane.indices.swap(inliers.indices);
+    }
+  };
+
+  void extractClusters(){
+    pcl::EuclideanClusterExtraction<pcl::PointXYZ> ec;
+    ec.setClusterTolerance(params.cluster_tolerance);
+    ec.setMinClusterSize(params.min_cluster_size);
+    ec.setMaxClusterSize(params.max_cluster_size);
+    ec.setSearchMethod(tree);
+    ec.setInputCloud(filtered);
+    ec.setIndices(remaining);
+    ec.extract(cluster_indices);
+  };
+
+  static int findRoot(std::vector<int> &parents, int i){
+    while(parents[i] != i){
+      parents[i] = parents[parents[i]];
+      i = parents[i];
+    }
+    return i;
+  };
+
+  static void join(std::vector<int> &parents, int a, int b){
+    a = findRoot(parents, a);
+    b = findRoot(parents, b);
+    if(a != b)
+      parents[std::max(a, b)] = std::min(a, b);
+  };
+
+  //Joins every point in [begin, end) of the remaining points with its neighbors.  The search tree
+  //is only read here, so the threads share it.
+  void joinNeighbors(unsigned int begin, unsigned int end, std::vector<int> &parents) const {
+    std::vector<int> nn_indices;
+    std::vector<float> nn_distances;
+    for(unsigned int i=begin; i<end; i++){
+      const int index = (*remaining)[i];
+      tree->radiusSearch(filtered->points[index], params.cluster_tolerance, nn_indices, nn_distances);
+      for(unsigned int j=0; j<nn_indices.size(); j++){
+        if(nn_indices[j] > index)
+          join(parents, index, nn_indices[j]);
+      }
+    }
+  };
+
+  static bool compareClusterSize(const pcl::PointIndices &a, const pcl::PointIndices &b){
+    return a.indices.size() > b.indices.size();
+  };
+
+  void extractClustersParallel(){
+    tree->setInputCloud(filtered, remaining);
+
+    const unsigned int n = filtered->points.size();
+    const unsigned int m = remaining->size();
+    const unsigned int num_threads = std::min<unsigned int>(params.num_threads, m);
+    if(forests.size() < num_threads)
+      forests.resize(num_threads);
+    for(unsigned int t=0; t<num_threads; t++){
+      forests[t].resize(n);
+      for(unsigned int i=0; i<m; i++)
+        forests[t][(*remaining)[i]] = (*remaining)[i];
+    }
+
+    boost::thread_group threads;
+    for(unsigned int t=1; t<num_threads; t++)
+      threads.create_thread(boost::bind(&EuclideanSegmentation::joinNeighbors, this,
+                                        t*m/num_threads, (t+1)*m/num_threads, boost::ref(forests[t])));
+    joinNeighbors(0, m/num_threads, forests[0]);
+    threads.join_all();
+
+    //Two points are in the same cluster if any thread joined them.
+    std::vector<int> &parents = forests[0];
+    for(unsigned int t=1; t<num_threads; t++){
+      for(unsigned int i=0; i<m; i++){
+        const int index = (*remaining)[i];
+        join(parents, index, findRoot(forests[t], index));
+      }
+    }
+
+    //Roots are the smallest index of their cluster, so they are labeled before their members.
+    labels.resize(n);
+    sizes.clear();
+    for(unsigned int i=0; i<m; i++){
+      const int index = (*remaining)[i];
+      const int root = findRoot(parents, index);
+      if(root == index){
+        labels[index] = sizes.size();
+        sizes.push_back(0);
+      }
+      sizes[labels[root]]++;
+    }
+
+    slots.assign(sizes.size(), -1);
+    for(unsigned int c=0; c<sizes.size(); c++){
+      if(sizes[c] >= params.min_cluster_size && sizes[c] <= params.max_cluster_size){
+        slots[c] = cluster_indices.size();
+        cluster_indices.push_back(pcl::PointIndices());
+        cluster_indices.back().header = filtered->header;
+        cluster_indices.back().indices.reserve(sizes[c]);
+      }
+    }
+    for(unsigned int i=0; i<m; i++){
+      const int index = (*remaining)[i];
+      const int slot = slots[labels[findRoot(parents, index)]];
+      if(slot >= 0)
+        cluster_indices[slot].indices.push_back(index);
+    }
+    std::sort(cluster_indices.begin(), cluster_indices.end(), compareClusterSize);
+  };
+
+  Parameters params;
+
+  pcl::VoxelGrid<pcl::PointXYZ> vg;
+  pcl::SACSegmentation<pcl::PointXYZ> seg;
+  pcl::PointIndices inliers;
+  pcl::ModelCoefficients coefficients;
+
+  //Buffers reused from frame to frame.
+  PointCloud::Ptr cloud;
+  PointCloud::Ptr filtered;
+  std::vector<int> bounded;
+  pcl::IndicesPtr remaining;
+  std::vector<int> scratch;
+  pcl::PointIndices plane;
+  pcl::search::KdTree<pcl::PointXYZ>::Ptr tree;
+  std::vector<pcl::PointIndices> cluster_indices;
+  std::vector<std::vector<int> > forests;
+  std::vector<int> labels;
+  std::vector<int> sizes;
+  std::vector<int> slots;
+};
+
+#endif
@@ -0,0 +1,261 @@
+//feature_database.h
+//Single file training set: one row per training view, written by generate_features and build_feature_database
+//and mapped read only by the recognition nodes.
+#ifndef NRG_OBJECT_RECOGNITION_FEATURE_DATABASE_H
+#define NRG_OBJECT_RECOGNITION_FEATURE_DATABASE_H
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace nrg_object_recognition
+{
+
+static const char FEATURE_DATABASE_MAGIC[8] = {'N','R','G','F','E','A','T','\0'};
+static const uint32_t FEATURE_DATABASE_VERSION = 1;
+//The feature matrix starts on a multiple of this, so it can be used in place once the file is mapped.
+static const uint64_t FEATURE_DATABASE_ALIGNMENT = 64;
+
+/** \brief Fixed size header at the start of a feature database.
+  *
+  * The file is laid out as the header, the row names as consecutive null terminated strings and then the
+  * rows x cols float matrix, row major and aligned to FEATURE_DATABASE_ALIGNMENT. Offsets are from the start
+  * of the file; a serialized index may follow the matrix, index_bytes is 0 when there is none.
+  */
+struct FeatureDatabaseHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t rows;
+  uint32_t cols;
+  uint32_t flags;
+  uint64_t names_offset;
+  uint64_t names_bytes;
+  uint64_t data_offset;
+  uint64_t index_offset;
+  uint64_t index_bytes;
+};
+
+inline uint64_t
+alignFeatureOffset (uint64_t offset)
+{
+  return ((offset + FEATURE_DATABASE_ALIGNMENT - 1) / FEATURE_DATABASE_ALIGNMENT * FEATURE_DATABASE_ALIGNMENT);
+}
+
+/** \brief Checks the magic and version and that every section lies within a file of file_size bytes */
+inline bool
+validFeatureDatabaseHeader (const FeatureDatabaseHeader &header, uint64_t file_size)
+{
+  if (memcmp (header.magic, FEATURE_DATABASE_MAGIC, sizeof (header.magic)) != 0 ||
+      header.version != FEATURE_DATABASE_VERSION)
+    return (false);
+  const uint64_t data_bytes = (uint64_t)header.rows * header.cols * sizeof (float);
+  return (header.names_offset >= sizeof (FeatureDatabaseHeader) &&
+          header.names_offset + header.names_bytes <= header.data_offset &&
+          header.data_offset % FEATURE_DATABASE_ALIGNMENT == 0 &&
+          header.data_offset + data_bytes <= file_size &&
+          (header.index_bytes == 0 ||
+           (header.index_offset >= header.data_offset + data_bytes && header.index_offset + header.index_bytes <= file_size)));
+}
+
+/** \brief Writes names.size () rows of cols features from data to file.
+  * The database is written next to file and renamed over it once complete, so readers and interrupted runs
+  * never see a partial file.
+  */
+inline bool
+saveFeatureDatabase (const std::string &file, const std::vector<std::string> &names, const std::vector<float> &data,
+                     unsigned int cols)
+{
+  if (data.size () != names.size () * cols)
+    return (false);
+
+  FeatureDatabaseHeader header;
+  memset (&header, 0, sizeof (header));
+  memcpy (header.magic, FEATURE_DATABASE_MAGIC, sizeof (header.magic));
+  header.version = FEATURE_DATABASE_VERSION;
+  header.rows = names.size ();
+  header.cols = cols;
+  header.names_offset = sizeof (header);
+  for (unsigned int i = 0; i < names.size (); i++)
+    header.names_bytes += names[i].size () + 1;
+  header.data_offset = alignFeatureOffset (header.names_offset + header.names_bytes);
+
+  const std::string partial = file + ".partial";
+  std::ofstream out (partial.c_str (), std::ios::binary | std::ios::trunc);
+  if (!out.is_open ())
+    return (false);
+  out.write ((const char*)&header, sizeof (header));
+  for (unsigned int i = 0; i < names.size (); i++)
+    out.write (names[i].c_str (), names[i].size () + 1);
+  const std::vector<char> padding (header.data_offset - header.names_offset - header.names_bytes, 0);
+  if (!padding.empty ())
+    out.write (&padding[0], padding.size ());
+  if (!data.empty ())
+    out.write ((const char*)&data[0], data.size () * sizeof (float));
+  out.close ();
+  if (!out)
+    return (false);
+
+  return (rename (partial.c_str (), file.c_str ()) == 0);
+}
+
+/** \brief Reads a whole feature database into memory, returns false if file is missing or not a valid database */
+inline bool
+loadFeatureDatabase (const std::string &file, std::vector<std::string> &names, std::vector<float> &data,
+                     unsigned int &cols)
+{
+  std::ifstream in (file.c_str (), std::ios::binary);
+  if (!in.is_open ())
+    return (false);
+  in.seekg (0, std::ios::end);
+  const uint64_t file_size = in.tellg ();
+  in.seekg (0, std::ios::beg);
+
+  FeatureDatabaseHeader header;
+  if (file_size < sizeof (header) || !in.read ((char*)&header, sizeof (header)) ||
+      !validFeatureDatabaseHeader (header, file_size))
+    return (false);
+
+  std::vector<char> name_block (header.names_bytes + 1, '\0');
+  in.seekg (header.names_offset);
+  if (header.names_bytes > 0 && !in.read (&name_block[0], header.names_bytes))
+    return (false);
+  names.clear ();
+  const char *name = &name_block[0];
+  for (unsigned int i = 0; i < header.rows; i++)
+  {
+    if (name >= &name_block[0] + header.names_bytes)
+      return (false);
+    names.push_back (name);
+    name += names.back ().size () + 1;
+  }
+
+  cols = header.cols;
+  data.resize ((size_t)header.rows * header.cols);
+  in.seekg (header.data_offset);
+  return (data.empty () || (bool)in.read ((char*)&data[0], data.size () * sizeof (float)));
+}
+
+/** \brief Read only view of a feature database mapped into memory.
+  *
+  * The matrix and the names are used in place, so opening a database only touches its header and name table, and
+  * every process that maps the same file shares one copy of its pages.
+  */
+class FeatureDatabase
+{
+public:
+
+  FeatureDatabase () :
+    mapping_(NULL), size_(0), header_(NULL)
+  {
+  };
+
+  ~FeatureDatabase ()
+  {
+    close ();
+  };
+
+  bool
+  open (const std::string &file)
+  {
+    close ();
+    int fd = ::open (file.c_str (), O_RDONLY);
+    if (fd < 0)
+      return (false);
+    struct stat info;
+    if (fstat (fd, &info) != 0 || (uint64_t)info.st_size < sizeof (FeatureDatabaseHeader))
+    {
+      ::close (fd);
+      return (false);
+    }
+    size_ = info.st_size;
+    mapping_ = mmap (NULL, size_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close (fd);
+    if (mapping_ == MAP_FAILED)
+    {
+      mapping_ = NULL;
+      return (false);
+    }
+
+    header_ = (const FeatureDatabaseHeader*)mapping_;
+    if (!validFeatureDatabaseHeader (*header_, size_) || !indexNames ())
+    {
+      close ();
+      return (false);
+    }
+    //The whole matrix is read by the first search, start paging it in now.
+    const size_t page = sysconf (_SC_PAGESIZE);
+    const size_t begin = header_->data_offset / page * page;
+    madvise ((char*)mapping_ + begin, size_ - begin, MADV_WILLNEED);
+    file_ = file;
+    return (true);
+  };
+
+  void
+  close ()
+  {
+    if (mapping_ != NULL)
+      munmap (mapping_, size_);
+    mapping_ = NULL;
+    size_ = 0;
+    header_ = NULL;
+    names_.clear ();
+    file_.clear ();
+  };
+
+  bool isOpen () const { return (mapping_ != NULL); };
+  const std::string &getFileName () const { return (file_); };
+  unsigned int getRows () const { return (header_ == NULL ? 0 : header_->rows); };
+  unsigned int getCols () const { return (header_ == NULL ? 0 : header_->cols); };
+
+  /** \brief The rows x cols matrix, valid until the database is closed */
+  const float *
+  getData () const
+  {
+    return (header_ == NULL ? NULL : (const float*)((const char*)mapping_ + header_->data_offset));
+  };
+
+  /** \brief Name of a row, the path of its feature file relative to the training directory */
+  const char *getName (unsigned int row) const { return (names_[row]); };
+
+private:
+
+  FeatureDatabase (const FeatureDatabase&);
+  FeatureDatabase& operator= (const FeatureDatabase&);
+
+  bool
+  indexNames ()
+  {
+    const char *name = (const char*)mapping_ + header_->names_offset;
+    const char *end = name + header_->names_bytes;
+    names_.resize (header_->rows);
+    for (unsigned int i = 0; i < header_->rows; i++)
+    {
+      const char *terminator = (const char*)memchr (name, '\0', end - name);
+      if (terminator == NULL)
+        return (false);
+      names_[i] = name;
+      name = terminator + 1;
+    }
+    return (true);
+  };
+
+  void *mapping_;
+  size_t size_;
+  const FeatureDatabaseHeader *header_;
+  std::vector<const char*> names_;
+  std::string file_;
+};
+
+}
+
+#endif
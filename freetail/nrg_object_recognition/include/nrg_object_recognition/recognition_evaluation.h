@@ -0,0 +1,354 @@
+//recognition_evaluation.h
+//Offline evaluation of the CPH and VFH recognizers: the test clouds are loaded and featurized once,
+//matched against the training set in one batched query and every threshold is scored from those matches.
+#ifndef NRG_OBJECT_RECOGNITION_RECOGNITION_EVALUATION_H
+#define NRG_OBJECT_RECOGNITION_RECOGNITION_EVALUATION_H
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/io/pcd_io.h>
+#include <pcl/features/vfh.h>
+#include <pcl/features/normal_3d.h>
+#include <pcl/console/print.h>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <flann/flann.h>
+
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/variate_generator.hpp>
+
+#include <nrg_object_recognition/cph.h>
+
+namespace nrg_object_recognition
+{
+
+enum RecognitionMethod
+{
+  METHOD_CPH = 0, METHOD_VFH = 1
+};
+
+/** \brief Label of a training or test file named <label>_<angle>[_vfh].<ext> */
+inline std::string
+labelFromFileName (const boost::filesystem::path &path)
+{
+  std::string name = path.filename ().string ();
+  name.erase (name.rfind ("."));
+  if (name.size () > 4 && name.compare (name.size () - 4, 4, "_vfh") == 0)
+    name.erase (name.size () - 4);
+  return (name.substr (0, name.rfind ("_")));
+}
+
+/** \brief CPH of a cluster with the bins used by cph_recognition_node */
+inline void
+computeCPHFeature (const pcl::PointCloud<pcl::PointXYZ>::Ptr &cluster, CPHEstimation &cph, std::vector<float> &feature)
+{
+  cph.setInputCloud (cluster);
+  cph.compute (feature);
+}
+
+/** \brief VFH of a cluster with the normal radius used by vfh_recognition_node */
+inline void
+computeVFHFeature (const pcl::PointCloud<pcl::PointXYZ>::Ptr &cluster, std::vector<float> &feature)
+{
+  pcl::NormalEstimation<pcl::PointXYZ, pcl::Normal> ne;
+  ne.setInputCloud (cluster);
+  pcl::search::KdTree<pcl::PointXYZ>::Ptr treeNorm (new pcl::search::KdTree<pcl::PointXYZ> ());
+  ne.setSearchMethod (treeNorm);
+  pcl::PointCloud<pcl::Normal>::Ptr cloud_normals (new pcl::PointCloud<pcl::Normal>);
+  ne.setRadiusSearch (0.03);
+  ne.compute (*cloud_normals);
+
+  pcl::VFHEstimation<pcl::PointXYZ, pcl::Normal, pcl::VFHSignature308> vfh;
+  vfh.setInputCloud (cluster);
+  vfh.setInputNormals (cloud_normals);
+  pcl::search::KdTree<pcl::PointXYZ>::Ptr tree (new pcl::search::KdTree<pcl::PointXYZ> ());
+  vfh.setSearchMethod (tree);
+  pcl::PointCloud<pcl::VFHSignature308> vfhs;
+  vfh.compute (vfhs);
+
+  feature.assign (vfhs.points[0].histogram, vfhs.points[0].histogram + 308);
+}
+
+/** \brief Reads a training feature: a whitespace separated CPH (.csv) or a single point VFH cloud (.pcd) */
+inline bool
+loadTrainingFeature (const boost::filesystem::path &path, RecognitionMethod method, unsigned int hist_size,
+                     std::vector<float> &feature)
+{
+  if (method == METHOD_VFH)
+  {
+    pcl::PointCloud<pcl::VFHSignature308> point;
+    if (pcl::io::loadPCDFile (path.string (), point) < 0 || point.points.size () != 1)
+      return (false);
+    feature.assign (point.points[0].histogram, point.points[0].histogram + 308);
+    return (true);
+  }
+
+  std::ifstream featureFile (path.string ().c_str ());
+  if (!featureFile.is_open ())
+    return (false);
+  feature.resize (hist_size);
+  for (unsigned int i = 0; i < hist_size; i++)
+    featureFile >> feature[i];
+  return (true);
+}
+
+/** \brief Result of the nearest neighbor query of one noisy test sample */
+struct EvaluationMatch
+{
+  int true_class;       //index of the test cloud label in the class list
+  int matched_class;    //index of the nearest training label, -1 if it is not in the class list
+  float distance;       //chi square distance to the nearest training feature
+};
+
+/** \brief Rates and confusion matrix of one class at one rejection threshold.
+  * The confusion matrix has a row per true class and a column per predicted class, the last column counts
+  * the samples rejected because their nearest match was at or beyond the threshold.
+  */
+struct ThresholdResult
+{
+  float threshold;
+  float false_positive_rate;
+  float true_positive_rate;
+  std::vector<std::vector<int> > confusion;
+};
+
+/** \brief Holds the test clouds, the training features and the matches of the last evaluation.
+  *
+  * Every test cloud is read from disk once. evaluate() featurizes num_samples noisy copies of each cloud on
+  * num_threads threads and matches all of them against the training set in a single FLANN call, so scoring
+  * a new threshold does not touch the clouds or the recognizers again.
+  */
+class RecognitionEvaluator
+{
+public:
+
+  RecognitionEvaluator (const std::map<std::string, int> &class_map) :
+    class_map_(class_map), method_(METHOD_CPH), num_ybins_(5), num_cbins_(72)
+  {
+  };
+
+  int getHistSize () const { return (method_ == METHOD_VFH ? 308 : num_ybins_*num_cbins_ + 3); };
+  unsigned int getNumTestClouds () const { return test_clouds_.size (); };
+  unsigned int getNumTrainingModels () const { return training_labels_.size (); };
+  const std::vector<EvaluationMatch>& getMatches () const { return matches_; };
+
+  /** \brief Loads every .pcd below dir as a test cloud, labeled by its file name */
+  void
+  loadTestClouds (const boost::filesystem::path &dir)
+  {
+    test_clouds_.clear ();
+    test_classes_.clear ();
+    if (!boost::filesystem::is_directory (dir))
+      return;
+
+    for (boost::filesystem::directory_iterator it (dir); it != boost::filesystem::directory_iterator (); ++it)
+    {
+      if (!boost::filesystem::is_regular_file (it->status ()) || boost::filesystem::extension (it->path ()) != ".pcd")
+        continue;
+
+      pcl::PointCloud<pcl::PointXYZ>::Ptr cluster (new pcl::PointCloud<pcl::PointXYZ>);
+      if (pcl::io::loadPCDFile (it->path ().string (), *cluster) < 0 || cluster->points.empty ())
+        continue;
+      test_clouds_.push_back (cluster);
+      test_classes_.push_back (classIndex (labelFromFileName (it->path ())));
+    }
+  };
+
+  /** \brief Recursively loads the training features of method below dir and builds the index used by evaluate() */
+  bool
+  loadTrainingData (const boost::filesystem::path &dir, RecognitionMethod method)
+  {
+    method_ = method;
+    training_labels_.clear ();
+    training_features_.clear ();
+    matches_.clear ();
+    loadTrainingDir (dir, method == METHOD_VFH ? ".pcd" : ".csv");
+    return (!training_labels_.empty ());
+  };
+
+  /** \brief Featurizes num_samples copies of every test cloud with gaussian noise of noise_level added to z and
+    * finds the nearest training feature of each.
+    * \param seed the noise of sample i is drawn from a generator seeded with seed + i, so the result does
+    * not depend on num_threads
+    */
+  void
+  evaluate (unsigned int num_samples, float noise_level, unsigned int num_threads, unsigned int seed)
+  {
+    matches_.clear ();
+    const unsigned int hist_size = getHistSize ();
+    const unsigned int total = test_clouds_.size () * num_samples;
+    if (total == 0 || training_labels_.empty ())
+      return;
+
+    std::vector<float> queries (total * hist_size, 0.0f);
+    num_threads = std::max (1u, std::min (num_threads, total));
+    boost::thread_group workers;
+    for (unsigned int t = 0; t < num_threads; t++)
+      workers.create_thread (boost::bind (&RecognitionEvaluator::featurizeSamples, this, t, num_threads,
+                                          num_samples, noise_level, seed, &queries));
+    workers.join_all ();
+
+    flann::Matrix<float> data (&training_features_[0], training_labels_.size (), hist_size);
+    flann::Index<flann::ChiSquareDistance<float> > index (data, flann::LinearIndexParams ());
+    index.buildIndex ();
+
+    std::vector<int> indices (total);
+    std::vector<float> distances (total);
+    flann::Matrix<float> q (&queries[0], total, hist_size);
+    flann::Matrix<int> ind (&indices[0], total, 1);
+    flann::Matrix<float> dist (&distances[0], total, 1);
+    index.knnSearch (q, ind, dist, 1, flann::SearchParams (512));
+
+    matches_.resize (total);
+    for (unsigned int i = 0; i < total; i++)
+    {
+      matches_[i].true_class = test_classes_[i / num_samples];
+      matches_[i].matched_class = training_labels_[indices[i]];
+      matches_[i].distance = distances[i];
+    }
+  };
+
+  /** \brief Scores the matches of the last evaluate() at every threshold.
+    * A sample is recognized as its nearest match when that match is closer than the threshold, as the
+    * recognition services do; the rates are those of object_class against all other classes.
+    * \param thresholds increasing rejection thresholds
+    */
+  void
+  scoreThresholds (int object_class, const std::vector<float> &thresholds, std::vector<ThresholdResult> &results) const
+  {
+    const int k = class_map_.size ();
+    results.resize (thresholds.size ());
+
+    //Sorting by distance lets a single sweep add the samples accepted by each larger threshold.
+    std::vector<std::pair<float, unsigned int> > order (matches_.size ());
+    for (unsigned int i = 0; i < matches_.size (); i++)
+      order[i] = std::make_pair (matches_[i].distance, i);
+    std::sort (order.begin (), order.end ());
+
+    std::vector<std::vector<int> > confusion (k, std::vector<int> (k + 1, 0));
+    int total_true = 0, total_false = 0;
+    for (unsigned int i = 0; i < matches_.size (); i++)
+    {
+      if (matches_[i].true_class < 0)
+        continue;
+      confusion[matches_[i].true_class][k]++;
+      if (matches_[i].true_class == object_class)
+        total_true++;
+      else
+        total_false++;
+    }
+
+    int true_positives = 0, false_positives = 0;
+    unsigned int next = 0;
+    for (unsigned int t = 0; t < thresholds.size (); t++)
+    {
+      for (; next < order.size () && order[next].first < thresholds[t]; next++)
+      {
+        const EvaluationMatch &m = matches_[order[next].second];
+        if (m.true_class < 0 || m.matched_class < 0)
+          continue;
+        confusion[m.true_class][k]--;
+        confusion[m.true_class][m.matched_class]++;
+        if (m.matched_class == object_class)
+        {
+          if (m.true_class == object_class)
+            true_positives++;
+          else
+            false_positives++;
+        }
+      }
+
+      results[t].threshold = thresholds[t];
+      results[t].false_positive_rate = total_false > 0 ? float (false_positives)/float (total_false) : 0.0f;
+      results[t].true_positive_rate = total_true > 0 ? float (true_positives)/float (total_true) : 0.0f;
+      results[t].confusion = confusion;
+    }
+  };
+
+private:
+
+  int
+  classIndex (const std::string &label) const
+  {
+    std::map<std::string, int>::const_iterator it = class_map_.find (label);
+    return (it == class_map_.end () ? -1 : it->second);
+  };
+
+  void
+  loadTrainingDir (const boost::filesystem::path &dir, const std::string &extension)
+  {
+    if (!boost::filesystem::is_directory (dir))
+      return;
+
+    std::vector<float> feature;
+    for (boost::filesystem::directory_iterator it (dir); it != boost::filesystem::directory_iterator (); ++it)
+    {
+      if (boost::filesystem::is_directory (it->status ()))
+      {
+        loadTrainingDir (it->path (), extension);
+      }
+      else if (boost::filesystem::is_regular_file (it->status ()) && boost::filesystem::extension (it->path ()) == extension &&
+               loadTrainingFeature (it->path (), method_, getHistSize (), feature))
+      {
+        training_labels_.push_back (classIndex (labelFromFileName (it->path ())));
+        training_features_.insert (training_features_.end (), feature.begin (), feature.end ());
+      }
+    }
+  };
+
+  /** \brief Worker: featurizes samples thread, thread + num_threads, ... into their rows of queries */
+  void
+  featurizeSamples (unsigned int thread, unsigned int num_threads, unsigned int num_samples, float noise_level,
+                    unsigned int seed, std::vector<float> *queries) const
+  {
+    const unsigned int hist_size = getHistSize ();
+    const unsigned int total = test_clouds_.size () * num_samples;
+    CPHEstimation cph (num_ybins_, num_cbins_);
+    pcl::PointCloud<pcl::PointXYZ>::Ptr noisy (new pcl::PointCloud<pcl::PointXYZ>);
+    std::vector<float> feature;
+
+    for (unsigned int i = thread; i < total; i += num_threads)
+    {
+      boost::mt19937 mers (seed + i);
+      boost::normal_distribution<float> dist (0, noise_level);
+      boost::variate_generator<boost::mt19937&, boost::normal_distribution<float> > noise (mers, dist);
+
+      *noisy = *test_clouds_[i / num_samples];
+      for (size_t idx = 0; idx < noisy->points.size (); idx++)
+        noisy->points[idx].z += noise ();
+
+      if (method_ == METHOD_VFH)
+        computeVFHFeature (noisy, feature);
+      else
+        computeCPHFeature (noisy, cph, feature);
+
+      if (feature.size () == hist_size)
+        std::copy (feature.begin (), feature.end (), queries->begin () + i * hist_size);
+    }
+  };
+
+  std::map<std::string, int> class_map_;
+  RecognitionMethod method_;
+  int num_ybins_, num_cbins_;
+
+  std::vector<pcl::PointCloud<pcl::PointXYZ>::Ptr> test_clouds_;
+  std::vector<int> test_classes_;
+
+  std::vector<int> training_labels_;
+  std::vector<float> training_features_;
+
+  std::vector<EvaluationMatch> matches_;
+};
+
+}
+
+#endif
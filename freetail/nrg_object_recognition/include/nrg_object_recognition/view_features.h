@@ -0,0 +1,103 @@
+//view_features.h
+//VFH and CPH of a training view, used by the offline feature generation tools.
+#ifndef NRG_OBJECT_RECOGNITION_VIEW_FEATURES_H
+#define NRG_OBJECT_RECOGNITION_VIEW_FEATURES_H
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/features/vfh.h>
+#include <pcl/features/normal_3d.h>
+
+#include <sys/time.h>
+#include <vector>
+
+#include <nrg_object_recognition/cph.h>
+
+namespace nrg_object_recognition
+{
+
+/** \brief Computes the features of one view from a single normal estimate.
+  *
+  * The normals are estimated once per view and shared with the VFH estimation, and the estimators, search tree,
+  * normals and output cloud are kept between views. An instance is not thread safe, use one per thread.
+  */
+class ViewFeatureEstimation
+{
+public:
+
+  ViewFeatureEstimation (int num_ybins = 5, int num_cbins = 72, double normal_radius = 0.03) :
+    cph_(num_ybins, num_cbins),
+    tree_(new pcl::search::KdTree<pcl::PointXYZ> ()),
+    normals_(new pcl::PointCloud<pcl::Normal>),
+    normal_time_(0), vfh_time_(0), cph_time_(0)
+  {
+    ne_.setSearchMethod (tree_);
+    ne_.setRadiusSearch (normal_radius);
+    vfh_.setSearchMethod (tree_);
+  };
+
+  int getCPHSize () const { return (cph_.getFeatureSize ()); };
+  static int getVFHSize () { return (308); };
+
+  /** \brief Computes the VFH of cloud, and its CPH unless cph is NULL.
+    * \return false if the cloud is empty or VFH did not produce a signature
+    */
+  bool
+  compute (const pcl::PointCloud<pcl::PointXYZ>::Ptr &cloud, std::vector<float> &vfh, std::vector<float> *cph)
+  {
+    if (cloud->points.empty ())
+      return (false);
+
+    double start = now ();
+    ne_.setInputCloud (cloud);
+    ne_.compute (*normals_);
+    normal_time_ = now () - start;
+
+    start = now ();
+    vfh_.setInputCloud (cloud);
+    vfh_.setInputNormals (normals_);
+    vfh_.compute (vfhs_);
+    vfh_time_ = now () - start;
+    if (vfhs_.points.size () != 1)
+      return (false);
+    vfh.assign (vfhs_.points[0].histogram, vfhs_.points[0].histogram + getVFHSize ());
+
+    if (cph != NULL)
+    {
+      start = now ();
+      cph_.setInputCloud (cloud);
+      cph_.compute (*cph);
+      cph_time_ = now () - start;
+    }
+    return (true);
+  };
+
+  /** \brief Wall time of the steps of the last compute (), in seconds */
+  double getNormalTime () const { return (normal_time_); };
+  double getVFHTime () const { return (vfh_time_); };
+  double getCPHTime () const { return (cph_time_); };
+
+private:
+
+  static double
+  now ()
+  {
+    timeval t;
+    gettimeofday (&t, NULL);
+    return (t.tv_sec + 1e-6*t.tv_usec);
+  };
+
+  pcl::NormalEstimation<pcl::PointXYZ, pcl::Normal> ne_;
+  pcl::VFHEstimation<pcl::PointXYZ, pcl::Normal, pcl::VFHSignature308> vfh_;
+  CPHEstimation cph_;
+
+  pcl::search::KdTree<pcl::PointXYZ>::Ptr tree_;
+  pcl::PointCloud<pcl::Normal>::Ptr normals_;
+  pcl::PointCloud<pcl::VFHSignature308> vfhs_;
+
+  double normal_time_, vfh_time_, cph_time_;
+};
+
+}
+
+#endif
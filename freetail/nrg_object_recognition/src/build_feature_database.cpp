@@ -0,0 +1,90 @@
+//build_feature_database.cpp
+//Packs an existing training directory of per view CPH (.csv) or VFH (_vfh.pcd) files into a single feature
+//database that the recognition nodes map instead of parsing every file at start up.
+//Rows are sorted by name, which is the file path relative to the training directory.
+//usage: build_feature_database <training directory> <cph|vfh> [database file]
+//The database is written to <training directory>/cph_features.db or vfh_features.db by default.
+#include <pcl/console/print.h>
+#include <iostream>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <nrg_object_recognition/cph.h>
+#include <nrg_object_recognition/feature_database.h>
+#include <nrg_object_recognition/recognition_evaluation.h>
+
+using namespace nrg_object_recognition;
+
+typedef std::pair<std::string, std::vector<float> > training_feature;
+
+bool
+compareFeatureNames (const training_feature &a, const training_feature &b)
+{
+  return (a.first < b.first);
+}
+
+void
+loadFeatures (const boost::filesystem::path &dir, const std::string &prefix, RecognitionMethod method, unsigned int cols,
+              std::vector<training_feature> &features)
+{
+  const std::string extension = method == METHOD_VFH ? ".pcd" : ".csv";
+  for (boost::filesystem::directory_iterator it (dir); it != boost::filesystem::directory_iterator (); ++it)
+  {
+    const std::string file_name = it->path ().filename ().string ();
+    if (boost::filesystem::is_directory (it->status ()))
+    {
+      pcl::console::print_highlight ("Loading %s (%lu models loaded so far).\n", it->path ().string ().c_str (),
+                                     (unsigned long)features.size ());
+      loadFeatures (it->path (), prefix + file_name + "/", method, cols, features);
+    }
+    else if (boost::filesystem::is_regular_file (it->status ()) && boost::filesystem::extension (it->path ()) == extension)
+    {
+      training_feature feature;
+      feature.first = prefix + file_name;
+      if (loadTrainingFeature (it->path (), method, cols, feature.second))
+        features.push_back (feature);
+    }
+  }
+}
+
+int
+main (int argc, char **argv)
+{
+  if (argc < 3 || (std::string (argv[2]) != "cph" && std::string (argv[2]) != "vfh"))
+  {
+    std::cout << "usage: build_feature_database <training directory> <cph|vfh> [database file]" << std::endl;
+    return (-1);
+  }
+  const boost::filesystem::path dir (argv[1]);
+  const RecognitionMethod method = std::string (argv[2]) == "vfh" ? METHOD_VFH : METHOD_CPH;
+  const std::string file = argc > 3 ? std::string (argv[3]) :
+      (dir / (method == METHOD_VFH ? "vfh_features.db" : "cph_features.db")).string ();
+  const unsigned int cols = method == METHOD_VFH ? 308 : CPHEstimation (5, 72).getFeatureSize ();
+  if (!boost::filesystem::is_directory (dir))
+  {
+    pcl::console::print_error ("%s is not a directory\n", dir.string ().c_str ());
+    return (-1);
+  }
+
+  std::vector<training_feature> features;
+  loadFeatures (dir, "", method, cols, features);
+  std::sort (features.begin (), features.end (), compareFeatureNames);
+
+  std::vector<std::string> names (features.size ());
+  std::vector<float> data;
+  data.reserve (features.size () * cols);
+  for (unsigned int i = 0; i < features.size (); i++)
+  {
+    names[i] = features[i].first;
+    data.insert (data.end (), features[i].second.begin (), features[i].second.end ());
+  }
+
+  if (!saveFeatureDatabase (file, names, data, cols))
+  {
+    pcl::console::print_error ("Could not write %s\n", file.c_str ());
+    return (-1);
+  }
+  pcl::console::print_info ("Wrote %d x %d features to %s\n", (int)names.size (), (int)cols, file.c_str ());
+  return (0);
+}
@@ -0,0 +1,154 @@
+//cph_benchmark.cpp
+//Times CPHEstimation::compute against the original per-point implementation on clusters of
+//10k to 500k points and checks that both produce the same feature.
+//usage: cph_benchmark [cluster.pcd]
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/io/pcd_io.h>
+
+#include <iostream>
+#include <vector>
+#include <math.h>
+#include <sys/time.h>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real.hpp>
+#include <boost/random/variate_generator.hpp>
+
+#include <nrg_object_recognition/cph.h>
+
+/** \brief The CPH computation as it was before the shared implementation, kept as reference */
+void
+legacyCompute(pcl::PointCloud<pcl::PointXYZ>::Ptr cloud, int num_ybins, int num_cbins, std::vector<float> &result)
+{
+  float x_max=0, x_min=100, y_max=0, y_min = 100, z_max=0, z_min=100;
+  for(unsigned int i=0; i<cloud->size(); i++){
+    if(cloud->points.at(i).x > x_max)
+      x_max = cloud->points.at(i).x;
+    if(cloud->points.at(i).x < x_min)
+      x_min = cloud->points.at(i).x;
+    if(cloud->points.at(i).y > y_max)
+      y_max = cloud->points.at(i).y;
+    if(cloud->points.at(i).y < y_min)
+      y_min = cloud->points.at(i).y;
+    if(cloud->points.at(i).z > z_max)
+      z_max = cloud->points.at(i).z;
+    if(cloud->points.at(i).z < z_min)
+      z_min = cloud->points.at(i).z;
+  }
+  float x_size = (x_max - x_min);
+  float y_size = (y_max - y_min);
+  float z_size = (z_max - z_min);
+  float max_size = x_size;
+  if(y_size > max_size)
+    max_size = y_size;
+  if(z_size > max_size)
+    max_size = z_size;
+  max_size*=100;
+
+  std::vector<float> centroid(3);
+  centroid.at(0) = x_min + x_size/2;
+  centroid.at(1) = y_min + y_size/2;
+  centroid.at(2) = z_min + z_size/2;
+
+  std::vector<float> hist;
+  hist.resize(num_cbins*num_ybins, 0.0f);
+  int y,c;
+  float dy = y_size/num_ybins;
+  float dc = 2*PI/num_cbins;
+  for(unsigned int i=0; i<cloud->size(); i++){
+    y = floor((cloud->points.at(i).y-y_min)/dy);
+    c = floor((PI+atan2(cloud->points.at(i).z-centroid.at(2),cloud->points.at(i).x-centroid.at(0)))/dc);
+    if(y*num_cbins+c < hist.size())
+      hist.at(y*num_cbins+c)+=1.0f;
+  }
+  float max_peak = 0;
+  for(unsigned int i=0; i<hist.size(); i++){
+    if(hist.at(i) > max_peak)
+     max_peak = (float)hist.at(i);
+  }
+  float scaleFactor = max_size/max_peak;
+  for(unsigned int i=0; i<hist.size(); i++){
+    hist.at(i)*=scaleFactor;
+  }
+  hist.push_back(x_size*100);
+  hist.push_back(y_size*100);
+  hist.push_back(z_size*100);
+  result = hist;
+}
+
+double
+now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+/** \brief Random points on the surface of a cylinder of the size of a typical part */
+void
+makeCluster(unsigned int size, boost::mt19937 &rng, pcl::PointCloud<pcl::PointXYZ> &cluster)
+{
+  boost::uniform_real<float> unit(0.0f, 1.0f);
+  boost::variate_generator<boost::mt19937&, boost::uniform_real<float> > rand(rng, unit);
+  cluster.points.resize(size);
+  cluster.width = size;
+  cluster.height = 1;
+  for(unsigned int i=0; i<size; i++){
+    float a = 2*PI*rand();
+    cluster.points[i].x = 0.8f + 0.04f*cos(a) + 0.002f*rand();
+    cluster.points[i].y = -0.3f + 0.1f*rand();
+    cluster.points[i].z = 1.1f + 0.04f*sin(a) + 0.002f*rand();
+  }
+}
+
+void
+runBenchmark(pcl::PointCloud<pcl::PointXYZ>::Ptr cluster, CPHEstimation &cph, int repeats)
+{
+  std::vector<float> expected, feature;
+  double start = now();
+  for(int r=0; r<repeats; r++)
+    legacyCompute(cluster, 5, 72, expected);
+  double legacy_time = (now() - start)/repeats;
+
+  cph.setInputCloud(cluster);
+  start = now();
+  for(int r=0; r<repeats; r++)
+    cph.compute(feature);
+  double new_time = (now() - start)/repeats;
+
+  bool identical = expected.size() == feature.size();
+  float max_diff = 0;
+  for(unsigned int i=0; identical && i<feature.size(); i++){
+    if(expected[i] != feature[i])
+      identical = false;
+    max_diff = std::max(max_diff, fabsf(expected[i] - feature[i]));
+  }
+
+  std::cout << cluster->size() << " points: legacy " << legacy_time*1000.0 << " ms, shared "
+            << new_time*1000.0 << " ms (" << legacy_time/new_time << "x), "
+            << cph.getExactFallbackCount() << " exact atan2 fallbacks, "
+            << (identical ? "bit-for-bit identical" : "MISMATCH") << ", max diff " << max_diff << "\n";
+}
+
+int main(int argc, char **argv)
+{
+  CPHEstimation cph(5,72);
+
+  if(argc > 1){
+    pcl::PointCloud<pcl::PointXYZ>::Ptr cluster (new pcl::PointCloud<pcl::PointXYZ>);
+    if(pcl::io::loadPCDFile(argv[1], *cluster) < 0)
+      return(1);
+    runBenchmark(cluster, cph, 20);
+    return(0);
+  }
+
+  boost::mt19937 rng(0);
+  const unsigned int sizes[] = {10000, 50000, 100000, 250000, 500000};
+  for(unsigned int s=0; s<sizeof(sizes)/sizeof(sizes[0]); s++){
+    pcl::PointCloud<pcl::PointXYZ>::Ptr cluster (new pcl::PointCloud<pcl::PointXYZ>);
+    makeCluster(sizes[s], rng, *cluster);
+    runBenchmark(cluster, cph, 10);
+  }
+  return(0);
+}
@@ -20,7 +20,7 @@
 
 #include "ros/ros.h"
 #include "sensor_msgs/PointCloud2.h"
-#include "cph.h"
+#include <nrg_object_recognition/cph.h>
 
 
 
@@ -29,7 +29,6 @@ std::vector<cph_model> models;
 flann::Matrix<int> k_indices;
 flann::Matrix<float> k_distances;
 flann::Matrix<float> *data;
-sensor_msgs::PointCloud2 fromKinect;
 ros::Publisher pub;
 std::ofstream outFile;
 int segCount = 0;
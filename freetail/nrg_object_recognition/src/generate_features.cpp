@@ -1,131 +1,290 @@
+//generate_features.cpp
+//Computes the VFH and CPH training features of every view below a directory of segmented clouds.
+//
+//The output directory mirrors the cloud directory with a <view>.csv CPH and a <view>_vfh.pcd VFH per view, and
+//holds cph_features.db and vfh_features.db with the features of all views in one matrix each. Views are featurized
+//on several threads; each cloud is loaded and its normals estimated once for both descriptors. features.manifest
+//records the size and modification time of every featurized cloud as it completes, so a later (or interrupted)
+//run only featurizes the views that were added or changed.
+//usage: generate_features <pcd directory> <output directory> [num threads]
 #include <pcl/point_types.h>
 #include <pcl/point_cloud.h>
-#include <pcl/common/transforms.h>
-#include <pcl/console/parse.h>
 #include <pcl/console/print.h>
 #include <pcl/io/pcd_io.h>
-#include <pcl/features/vfh.h>
-#include <pcl/features/normal_3d.h>
 #include <iostream>
 #include <fstream>
-#include "cph.h"
+#include <algorithm>
+#include <cstdlib>
+#include <map>
 #include <sys/time.h>
+#include <boost/bind.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <nrg_object_recognition/feature_database.h>
+#include <nrg_object_recognition/recognition_evaluation.h>
+#include <nrg_object_recognition/view_features.h>
 
-std::stringstream outFileName;
-std::ofstream outFile, timeFile;
+using namespace nrg_object_recognition;
 
-  //Feature timing:
-  int start, stop, numRuns=0;;
-  double runTime = 0;
+const std::string MANIFEST_FILE = "features.manifest";
+const std::string CPH_DATABASE_FILE = "cph_features.db";
+const std::string VFH_DATABASE_FILE = "vfh_features.db";
+const std::string TIME_FILE = "time.csv";
 
-void extractFeatures (const boost::filesystem::path &base_dir, const std::string &extension)
+/** \brief A segmented training cloud and its features */
+struct TrainingView
 {
-  int writeIndex = 0;
-  if (!boost::filesystem::exists (base_dir) && !boost::filesystem::is_directory (base_dir))
-    return;
-  
-  timeFile.open("time.csv");
-  for (boost::filesystem::directory_iterator it (base_dir); it != boost::filesystem::directory_iterator (); ++it)
+  std::string name;                 //path below the pcd directory without the extension
+  boost::filesystem::path source;
+  uintmax_t size;
+  std::time_t modified;
+  bool valid;                       //features were computed or restored
+  bool computed;                    //featurized in this run
+  std::vector<float> vfh, cph;
+  unsigned int points;
+  double normal_time, vfh_time, cph_time;
+
+  std::string cphFile () const { return (name + ".csv"); };
+  std::string vfhFile () const { return (name + "_vfh.pcd"); };
+};
+
+/** \brief Size and modification time of a cloud when it was last featurized */
+typedef std::map<std::string, std::pair<uintmax_t, std::time_t> > Manifest;
+
+boost::mutex manifest_mutex;
+std::ofstream manifest_file;
+
+double
+now ()
+{
+  timeval t;
+  gettimeofday (&t, NULL);
+  return (t.tv_sec + 1e-6*t.tv_usec);
+}
+
+/** \brief Recursively lists every .pcd below dir, VFH outputs excluded */
+void
+collectViews (const boost::filesystem::path &dir, const std::string &prefix, std::vector<TrainingView> &views)
+{
+  for (boost::filesystem::directory_iterator it (dir); it != boost::filesystem::directory_iterator (); ++it)
   {
+    const std::string file_name = it->path ().filename ().string ();
     if (boost::filesystem::is_directory (it->status ()))
     {
-//       std::stringstream ss;
-//       ss << it->path ();
-      extractFeatures (it->path (), extension);
+      collectViews (it->path (), prefix + file_name + "/", views);
     }
-    if (boost::filesystem::is_regular_file (it->status ()) && boost::filesystem::extension (it->path ()) == extension)
+    else if (boost::filesystem::is_regular_file (it->status ()) && boost::filesystem::extension (it->path ()) == ".pcd" &&
+             file_name.find ("_vfh.pcd") == std::string::npos)
     {
-      //pcl::PointCloud<pcl::PointXYZ>::Ptr  raw_cloud (new pcl::PointCloud<pcl::PointXYZ>);
-      pcl::PointCloud<pcl::PointXYZ>::Ptr  cloud (new pcl::PointCloud<pcl::PointXYZ>);
-      std::stringstream inFile;
-      inFile.str("");
-      inFile << "temp2/" << it->path().filename().c_str();
-      pcl::io::loadPCDFile (inFile.str().c_str(), *cloud);
-      
-       //Write vfh feature to file: 
-      std::stringstream fileName_ss;
-      pcl::VFHEstimation<pcl::PointXYZ, pcl::Normal, pcl::VFHSignature308> vfh;
-      vfh.setInputCloud (cloud);
-      
-      //Estimate normals:
-      pcl::NormalEstimation<pcl::PointXYZ, pcl::Normal> ne;
-      ne.setInputCloud (cloud);
-      pcl::search::KdTree<pcl::PointXYZ>::Ptr tree (new pcl::search::KdTree<pcl::PointXYZ> ());
-      ne.setSearchMethod (tree);
-      pcl::PointCloud<pcl::Normal>::Ptr cloud_normals (new pcl::PointCloud<pcl::Normal>);
-      ne.setRadiusSearch (0.03);
-      
-      runTime = 0;
-      start = clock();
-      ne.compute (*cloud_normals);
-      stop = clock();
-      runTime += (double)(stop-start)/CLOCKS_PER_SEC;
-      
-      vfh.setInputNormals (cloud_normals);
-      //Estimate vfh:
-      vfh.setSearchMethod (tree);
-      pcl::PointCloud<pcl::VFHSignature308>::Ptr vfhs (new pcl::PointCloud<pcl::VFHSignature308> ());
-      
-      // Compute the feature
-      start = clock();
-      vfh.compute (*vfhs);
-      stop = clock();
-      runTime += (double)(stop-start)/CLOCKS_PER_SEC;
-      timeFile << cloud->points.size() << " " << runTime*1000.0 << " ";
-      std::cout << runTime << " ";
-      runTime = 0;
-      
-      //Write to file: (objectName_angle_vfh.pcd)
-      fileName_ss.str("");
-      //std::cout << "writing vfh descriptor to file...\n";
-      fileName_ss << "temp/" << it->path().filename().c_str();
-      std::string vfhOutString(fileName_ss.str());
-      vfhOutString.insert(vfhOutString.rfind("."), "_vfh");
-      pcl::io::savePCDFile(vfhOutString, *vfhs);
-      //std::cout << "done.\n";
-    
-      //Extract CPH signature: 
-      std::vector<float> feature;
-      CPHEstimation cph(5,72);
-      cph.setInputCloud(cloud);
-      
-      // Compute the feature
-      start = clock();
-      cph.compute(feature);
-      stop = clock();
-      runTime += (double)(stop-start)/CLOCKS_PER_SEC;
-      timeFile << runTime*1000.0 << std::endl;
-      std::cout << runTime*1e6 << std::endl;
-      runTime=0;
-      
-      //Write feature to file
-      outFileName << "temp/" << it->path().filename().c_str();
-      //std::cout << "Read file: " << outFileName.str() << std::endl;;
-      std::string outString(outFileName.str());
-      outString.replace(outString.end()-3, outString.end(), "csv");
-      outFile.open(outString.c_str());
-      for(unsigned int j=0; j<feature.size(); j++){
-	outFile << feature.at(j) << " "; 
-      }
-      outFile.close();
-      outFileName.str("");
-      writeIndex++;
+      TrainingView view;
+      view.name = prefix + it->path ().stem ().string ();
+      view.source = it->path ();
+      view.size = boost::filesystem::file_size (it->path ());
+      view.modified = boost::filesystem::last_write_time (it->path ());
+      view.valid = false;
+      view.computed = false;
+      view.points = 0;
+      view.normal_time = view.vfh_time = view.cph_time = 0;
+      views.push_back (view);
     }
   }
-  timeFile.close();
+}
+
+bool
+compareViewNames (const TrainingView &a, const TrainingView &b)
+{
+  return (a.name < b.name);
+}
+
+/** \brief Reads the manifest, each line is "<size> <modification time> <name>", later lines win */
+void
+readManifest (const boost::filesystem::path &file, Manifest &manifest)
+{
+  std::ifstream in (file.string ().c_str ());
+  uintmax_t size;
+  std::time_t modified;
+  std::string name;
+  while (in >> size >> modified && std::getline (in >> std::ws, name))
+    manifest[name] = std::make_pair (size, modified);
+}
+
+void
+writeManifestLine (std::ostream &out, const TrainingView &view)
+{
+  out << view.size << " " << view.modified << " " << view.name << "\n";
+}
+
+/** \brief Maps every row name of a feature database to its row, empty if there is no usable database */
+void
+readDatabase (const boost::filesystem::path &file, unsigned int cols, std::vector<float> &data,
+              std::map<std::string, unsigned int> &rows)
+{
+  std::vector<std::string> names;
+  unsigned int file_cols;
+  if (!loadFeatureDatabase (file.string (), names, data, file_cols) || file_cols != cols)
+    return;
+  for (unsigned int i = 0; i < names.size (); i++)
+    rows[names[i]] = i;
+}
+
+/** \brief Takes the features of a view from the previous database, or else from its per view files */
+bool
+restoreFeatures (const boost::filesystem::path &out_dir, const std::string &file, const std::vector<float> &data,
+                 const std::map<std::string, unsigned int> &rows, RecognitionMethod method, unsigned int cols,
+                 std::vector<float> &feature)
+{
+  std::map<std::string, unsigned int>::const_iterator row = rows.find (file);
+  if (row != rows.end ())
+  {
+    feature.assign (data.begin () + row->second * cols, data.begin () + (row->second + 1) * cols);
+    return (true);
+  }
+  return (boost::filesystem::exists (out_dir / file) && loadTrainingFeature (out_dir / file, method, cols, feature));
+}
+
+/** \brief Worker: featurizes views until the job list is exhausted, jobs are taken with an atomic counter */
+void
+computeViews (std::vector<TrainingView> *views, const std::vector<unsigned int> *jobs, volatile unsigned int *next_job,
+              const boost::filesystem::path *out_dir)
+{
+  ViewFeatureEstimation estimation (5, 72);
+  pcl::PointCloud<pcl::PointXYZ>::Ptr cloud (new pcl::PointCloud<pcl::PointXYZ>);
+  pcl::PointCloud<pcl::VFHSignature308> vfh_point;
+  vfh_point.points.resize (1);
+  vfh_point.width = 1;
+  vfh_point.height = 1;
+
+  for (unsigned int job = __sync_fetch_and_add (next_job, 1); job < jobs->size (); job = __sync_fetch_and_add (next_job, 1))
+  {
+    TrainingView &view = (*views)[(*jobs)[job]];
+    if (pcl::io::loadPCDFile (view.source.string (), *cloud) < 0 || !estimation.compute (cloud, view.vfh, &view.cph))
+    {
+      pcl::console::print_warn ("Could not featurize %s\n", view.source.string ().c_str ());
+      continue;
+    }
+    view.points = cloud->points.size ();
+    view.normal_time = estimation.getNormalTime ();
+    view.vfh_time = estimation.getVFHTime ();
+    view.cph_time = estimation.getCPHTime ();
+
+    std::copy (view.vfh.begin (), view.vfh.end (), vfh_point.points[0].histogram);
+    pcl::io::savePCDFile ((*out_dir / view.vfhFile ()).string (), vfh_point);
+
+    std::ofstream cph_file ((*out_dir / view.cphFile ()).string ().c_str ());
+    for (unsigned int j = 0; j < view.cph.size (); j++)
+      cph_file << view.cph[j] << " ";
+    cph_file.close ();
+
+    //Only views whose files are complete are recorded, an interrupted run resumes after them.
+    view.valid = true;
+    view.computed = true;
+    boost::mutex::scoped_lock lock (manifest_mutex);
+    writeManifestLine (manifest_file, view);
+    manifest_file.flush ();
+  }
+}
+
+/** \brief Writes the features of every valid view, in name order, to a database */
+bool
+writeDatabase (const boost::filesystem::path &file, const std::vector<TrainingView> &views, RecognitionMethod method,
+               unsigned int cols)
+{
+  std::vector<std::string> names;
+  std::vector<float> data;
+  data.reserve (views.size () * cols);
+  for (unsigned int i = 0; i < views.size (); i++)
+  {
+    if (!views[i].valid)
+      continue;
+    const std::vector<float> &feature = method == METHOD_VFH ? views[i].vfh : views[i].cph;
+    names.push_back (method == METHOD_VFH ? views[i].vfhFile () : views[i].cphFile ());
+    data.insert (data.end (), feature.begin (), feature.end ());
+  }
+  if (!saveFeatureDatabase (file.string (), names, data, cols))
+  {
+    pcl::console::print_error ("Could not write %s\n", file.string ().c_str ());
+    return (false);
+  }
+  pcl::console::print_info ("Wrote %d x %d features to %s\n", (int)names.size (), (int)cols, file.string ().c_str ());
+  return (true);
 }
 
 int main (int argc, char** argv)
 {
-  outFileName.str("");
-  
-  extractFeatures(argv[1], ".pcd");
-  
-  return(0);
+  if (argc < 3)
+  {
+    std::cout << "usage: generate_features <pcd directory> <output directory> [num threads]" << std::endl;
+    return (-1);
+  }
+  const boost::filesystem::path pcd_dir (argv[1]), out_dir (argv[2]);
+  const unsigned int num_threads = argc > 3 ? std::max (1, atoi (argv[3])) : std::max (1u, boost::thread::hardware_concurrency ());
+  if (!boost::filesystem::is_directory (pcd_dir))
+  {
+    pcl::console::print_error ("%s is not a directory\n", pcd_dir.string ().c_str ());
+    return (-1);
+  }
+
+  std::vector<TrainingView> views;
+  collectViews (pcd_dir, "", views);
+  std::sort (views.begin (), views.end (), compareViewNames);
+
+  //Unchanged views keep the features of the previous run.
+  const int cph_size = ViewFeatureEstimation (5, 72).getCPHSize ();
+  const int vfh_size = ViewFeatureEstimation::getVFHSize ();
+  Manifest manifest;
+  readManifest (out_dir / MANIFEST_FILE, manifest);
+  std::vector<float> cph_data, vfh_data;
+  std::map<std::string, unsigned int> cph_rows, vfh_rows;
+  readDatabase (out_dir / CPH_DATABASE_FILE, cph_size, cph_data, cph_rows);
+  readDatabase (out_dir / VFH_DATABASE_FILE, vfh_size, vfh_data, vfh_rows);
+
+  std::vector<unsigned int> jobs;
+  for (unsigned int i = 0; i < views.size (); i++)
+  {
+    TrainingView &view = views[i];
+    Manifest::const_iterator entry = manifest.find (view.name);
+    view.valid = entry != manifest.end () && entry->second.first == view.size && entry->second.second == view.modified &&
+        restoreFeatures (out_dir, view.cphFile (), cph_data, cph_rows, METHOD_CPH, cph_size, view.cph) &&
+        restoreFeatures (out_dir, view.vfhFile (), vfh_data, vfh_rows, METHOD_VFH, vfh_size, view.vfh);
+    if (!view.valid)
+    {
+      jobs.push_back (i);
+      boost::filesystem::create_directories ((out_dir / view.name).parent_path ());
+    }
+  }
+  cph_data.clear ();
+  vfh_data.clear ();
+  pcl::console::print_highlight ("%d views, %d unchanged, featurizing %d on %d threads\n", (int)views.size (),
+                                 (int)(views.size () - jobs.size ()), (int)jobs.size (), (int)num_threads);
+
+  boost::filesystem::create_directories (out_dir);
+  manifest_file.open ((out_dir / MANIFEST_FILE).string ().c_str (), std::ios::app);
+  double start = now ();
+  volatile unsigned int next_job = 0;
+  boost::thread_group workers;
+  for (unsigned int t = 0; t < std::min<unsigned int> (num_threads, jobs.size ()); t++)
+    workers.create_thread (boost::bind (&computeViews, &views, &jobs, &next_job, &out_dir));
+  workers.join_all ();
+  manifest_file.close ();
+  pcl::console::print_highlight ("Featurized %d views in %f s\n", (int)jobs.size (), now () - start);
+
+  //Compacts the manifest to the views that exist now.
+  const std::string manifest_partial = (out_dir / MANIFEST_FILE).string () + ".partial";
+  std::ofstream compacted (manifest_partial.c_str ());
+  std::ofstream time_file ((out_dir / TIME_FILE).string ().c_str ());
+  for (unsigned int i = 0; i < views.size (); i++)
+  {
+    if (views[i].valid)
+      writeManifestLine (compacted, views[i]);
+    if (views[i].computed)
+      time_file << views[i].points << " " << (views[i].normal_time + views[i].vfh_time)*1000.0 << " "
+                << views[i].cph_time*1000.0 << std::endl;
+  }
+  compacted.close ();
+  rename (manifest_partial.c_str (), (out_dir / MANIFEST_FILE).string ().c_str ());
+
+  bool written = writeDatabase (out_dir / CPH_DATABASE_FILE, views, METHOD_CPH, cph_size);
+  written = writeDatabase (out_dir / VFH_DATABASE_FILE, views, METHOD_VFH, vfh_size) && written;
+  return (written ? 0 : -1);
 }
- 
-  
- 
- 
-  
@@ -20,7 +20,8 @@
 #include <boost/random/normal_distribution.hpp>
 #include <boost/random/variate_generator.hpp>
 
-#include "cph.h"
+#include <nrg_object_recognition/cph.h>
+#include <nrg_object_recognition/recognition_evaluation.h>
 #include "nrg_object_recognition/run_data.h"
 #include "nrg_object_recognition/recognition.h"
 #include "nrg_object_recognition/segmentation.h"
@@ -35,9 +36,15 @@ int k;
 
 ros::Publisher pan_pub;
 ros::Publisher rec_pub;
-sensor_msgs::PointCloud2 cloud_to_process;
+sensor_msgs::PointCloud2::ConstPtr cloud_to_process; //latest cloud, only the pointer is kept
 
-void kinect_cb(sensor_msgs::PointCloud2 fromKinect)
+//offline ROC evaluation
+boost::shared_ptr<nrg_object_recognition::RecognitionEvaluator> evaluator;
+nrg_object_recognition::RecognitionMethod evaluator_method;
+std::string cph_training_dir, vfh_training_dir;
+int roc_threads;
+
+void kinect_cb(const sensor_msgs::PointCloud2::ConstPtr &fromKinect)
 {
 cloud_to_process = fromKinect;
 }
@@ -220,6 +227,11 @@ bool live_cb(nrg_object_recognition::run_data::Request &main_request,
   
    pan_pub.publish(command);
    loop_rate.sleep();
+   ros::spinOnce();
+   if(!cloud_to_process){
+     ROS_WARN("Live test: no cloud received yet");
+     return false;
+   }
   
   std::string objectName = main_request.object_name;
   std::vector<float> pcc_row(k,0); //will hold class conditional probabilities. P(c|testObject)
@@ -257,8 +269,8 @@ bool live_cb(nrg_object_recognition::run_data::Request &main_request,
       for(unsigned int j=0; j<main_request.num_samples; j++){
       
 	//Call segmentation service...
-	std::cout << "time stamp of cloud being processed: " << cloud_to_process.header.stamp << std::endl;
-	seg_srv.request.scene = cloud_to_process;
+	std::cout << "time stamp of cloud being processed: " << cloud_to_process->header.stamp << std::endl;
+	seg_srv.request.scene = *cloud_to_process;
 	seg_srv.request.min_x = -.75, seg_srv.request.max_x = .4;
 	seg_srv.request.min_y = -5, seg_srv.request.max_y = .5;
 	seg_srv.request.min_z = 0.0, seg_srv.request.max_z = 1.15;
@@ -402,83 +414,70 @@ bool roc_cb(nrg_object_recognition::run_data::Request &main_request,
 	    nrg_object_recognition::run_data::Response &main_response)
 {  
   std::string objectName = main_request.object_name;
-  std::stringstream fileName;
-  std::vector<float> pcc_row(k,0); //will hold class conditional probabilities. P(c|testObject)
-  std::vector<float> filtered_result(k,0); //holds filtered result.
-  
-  nrg_object_recognition::recognition rec_srv;
-  int num_false=0, total_true=0, total_false=0;
-  std::ofstream roc_file;
-  roc_file.open("ROC_data.csv");
+  std::map<std::string, int>::iterator object_class = classMap.find(objectName);
+  if(object_class == classMap.end()){
+    ROS_ERROR("ROC: %s is not in classes.list", objectName.c_str());
+    return(0);
+  }
+  nrg_object_recognition::RecognitionMethod method = main_request.method == 1 ?
+    nrg_object_recognition::METHOD_VFH : nrg_object_recognition::METHOD_CPH;
   
-   //Noise generator:
-  boost::mt19937 mers;
-  mers.seed(static_cast<unsigned int>(std::time(0)));
-  boost::normal_distribution<float> dist(0, main_request.noise_level);
-  boost::variate_generator<boost::mt19937 , boost::normal_distribution<float> > noise(mers,dist);
+  //The test clouds are read once and kept for later requests, the training set only changes with the method.
+  if(!evaluator){
+    evaluator.reset(new nrg_object_recognition::RecognitionEvaluator(classMap));
+    evaluator->loadTestClouds("test");
+  }
+  if(evaluator->getNumTrainingModels() == 0 || evaluator_method != method){
+    std::string training_dir = method == nrg_object_recognition::METHOD_VFH ? vfh_training_dir : cph_training_dir;
+    if(!evaluator->loadTrainingData(training_dir, method)){
+      ROS_ERROR("ROC: no training features found in %s", training_dir.c_str());
+      return(0);
+    }
+    evaluator_method = method;
+  }
   
   std::cout << "generating ROC data...\n"; 
   
-  //For several thresholds:
-  for(unsigned int thresh = 0; thresh < 5000; thresh += 50){
-    num_false=0; total_false=0; total_true=0;
-    //For each test file:
-    for(boost::filesystem::directory_iterator it ("test"); it != boost::filesystem::directory_iterator (); ++it){
-      if (boost::filesystem::is_regular_file (it->status ()) && boost::filesystem::extension (it->path ()) == ".pcd")
-      {    
-	//Hold results:
-	std::string label;
-	int z;
-	
-	//Read .pcd file.
-	fileName.str("");
-	fileName << "test/" << it->path().filename().c_str();
-	//std::cout << "reading file: " << fileName.str() << std::endl;
-	pcl::PointCloud<pcl::PointXYZ>::Ptr cluster (new pcl::PointCloud<pcl::PointXYZ>);
-	pcl::io::loadPCDFile (fileName.str(), *cluster);
-	
-	//check to see if it is a true instance or a false instance:
-	std::string fileNameString = fileName.str();
-	label.assign(fileNameString.begin(), fileNameString.begin()+fileNameString.rfind("_"));
-	std::cout << label << std::endl;
-	if(label == objectName)
-	  total_true++;
-	else
-	  total_false++;
-	
-	
-	//Add noise to the z channel.
-	for(size_t idx = 0; idx < cluster->points.size(); idx++){
-	  cluster->points[idx].z += noise();
-	}
-	
-	pcl::toROSMsg(*cluster, rec_srv.request.cluster);
-	rec_srv.request.threshold = thresh; //()
-	
-	if(main_request.method == 0){
-	  cph_client.call(rec_srv); 
-	}
-	else if(main_request.method == 1){
-	  vfh_client.call(rec_srv); 
-	}
-	
-	//Increment appropriate row.
-	z = classMap[rec_srv.response.label];
-	pcc_row.at(z)++;
-	
-      }
-    }
-    for (unsigned int i = 0; i< pcc_row.size(); i++){
-     if(i != classMap[objectName])
-       num_false += pcc_row.at(i);
-    }
+  //Every test cloud is featurized once per noisy sample, all thresholds are scored from the same matches.
+  unsigned int num_samples = main_request.num_samples > 0 ? main_request.num_samples : 1;
+  evaluator->evaluate(num_samples, main_request.noise_level, roc_threads, static_cast<unsigned int>(std::time(0)));
+  
+  std::vector<float> thresholds;
+  for(unsigned int thresh = 0; thresh < 5000; thresh += 50)
+    thresholds.push_back(thresh);
+  std::vector<nrg_object_recognition::ThresholdResult> results;
+  evaluator->scoreThresholds(object_class->second, thresholds, results);
+  
+  std::ofstream roc_file;
+  roc_file.open("ROC_data.csv");
+  std::ofstream confusion_file;
+  confusion_file.open("confusion_data.csv");
+  for(unsigned int t = 0; t < results.size(); t++){
+    roc_file << results[t].threshold << "," << results[t].false_positive_rate << "," << results[t].true_positive_rate << std::endl;
     
-    float FPR = float(num_false)/float(total_false);
-    float TPR = float(pcc_row.at(classMap[objectName]))/float(total_true);
-    roc_file << thresh << FPR << TPR << std::endl;
+    //one line per threshold: the threshold followed by the confusion matrix in row major order
+    confusion_file << results[t].threshold;
+    for(unsigned int i = 0; i < results[t].confusion.size(); i++)
+      for(unsigned int j = 0; j < results[t].confusion[i].size(); j++)
+        confusion_file << "," << results[t].confusion[i][j];
+    confusion_file << std::endl;
   }
   roc_file.close();
-  std::cout << "done.\n";  
+  confusion_file.close();
+  
+  //Report the recognition distribution of the object at the largest threshold.
+  const std::vector<int> &object_row = results.back().confusion.at(object_class->second);
+  int object_total = 0;
+  for(unsigned int i = 0; i < object_row.size(); i++)
+    object_total += object_row[i];
+  std::vector<float> pcc_row(k,0);
+  for(unsigned int i = 0; i < pcc_row.size() && object_total > 0; i++)
+    pcc_row.at(i) = float(object_row[i])/object_total;
+  main_response.rec_rate = results.back().true_positive_rate;
+  main_response.prob_dist = pcc_row;
+  
+  std::cout << "done (" << evaluator->getMatches().size() << " samples from " << evaluator->getNumTestClouds()
+            << " test clouds).\n";  
   return(1);
 }
 
@@ -488,9 +487,15 @@ int main(int argc, char **argv)
   
   ros::init(argc, argv, "main_dataset_node");
   ros::NodeHandle n;  
+  ros::NodeHandle pn("~");
+  pn.param("cph_training_dir", cph_training_dir, std::string("data"));
+  pn.param("vfh_training_dir", vfh_training_dir, std::string("data"));
+  pn.param("roc_threads", roc_threads, (int)boost::thread::hardware_concurrency());
+  roc_threads = roc_threads > 0 ? roc_threads : 1;
   
   ros::ServiceServer offline_serv = n.advertiseService("/run_test", test_cb);
   ros::ServiceServer live_serv = n.advertiseService("/live_test", live_cb);
+  ros::ServiceServer roc_serv = n.advertiseService("/run_roc", roc_cb);
   cph_client = n.serviceClient<nrg_object_recognition::recognition>("cph_recognition");
   vfh_client = n.serviceClient<nrg_object_recognition::recognition>("vfh_recognition");
   seg_client = n.serviceClient<nrg_object_recognition::segmentation>("segmentation");
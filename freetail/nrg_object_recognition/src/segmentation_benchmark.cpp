@@ -0,0 +1,210 @@
+//segmentation_benchmark.cpp
+//Times EuclideanSegmentation, with one and with several cluster extraction threads, against the
+//original copy based segmentation on recorded scenes and checks that all of them find the same clusters.
+//The scenes are segmented with the kinect settings of vfh_recognition and the close range settings of
+//data_collection.
+//usage: segmentation_benchmark scene.pcd [scene.pcd ...]
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/io/pcd_io.h>
+#include <pcl/filters/extract_indices.h>
+
+#include <iostream>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <sys/time.h>
+
+#include <boost/lexical_cast.hpp>
+
+#include <nrg_object_recognition/euclidean_segmentation.h>
+
+const int NUM_RUNS = 10;
+
+typedef pcl::PointCloud<pcl::PointXYZ> PointCloud;
+
+/** \brief The segmentation as it was before the shared implementation, kept as reference */
+int
+legacySegmentCloud(PointCloud::Ptr cloud, const EuclideanSegmentation::Parameters &params, std::vector<PointCloud::Ptr> &cloudSegments)
+{
+  PointCloud::Ptr cloud_f (new PointCloud);
+  pcl::VoxelGrid<pcl::PointXYZ> vg;
+  PointCloud::Ptr cloud_filtered (new PointCloud), cloud_filtered_0 (new PointCloud);
+  vg.setInputCloud (cloud);
+  vg.setLeafSize (params.leaf_size, params.leaf_size, params.leaf_size);
+  vg.filter (*cloud_filtered_0);
+
+  pcl::SACSegmentation<pcl::PointXYZ> seg;
+  pcl::PointIndices::Ptr inliers (new pcl::PointIndices);
+  pcl::ModelCoefficients::Ptr coefficients (new pcl::ModelCoefficients);
+  PointCloud::Ptr cloud_plane (new PointCloud ());
+  seg.setOptimizeCoefficients (true);
+  seg.setModelType (pcl::SACMODEL_PLANE);
+  seg.setMethodType (pcl::SAC_RANSAC);
+  seg.setMaxIterations (params.plane_max_iterations);
+  seg.setDistanceThreshold (params.plane_distance_threshold);
+
+  cloud_filtered->resize(0);
+  for(PointCloud::iterator position=cloud_filtered_0->begin(); position!=cloud_filtered_0->end(); position++){
+    if(position->x > params.min_x && position->x < params.max_x && position->y > params.min_y &&
+       position->y < params.max_y && position->z > params.min_z && position->z < params.max_z)
+      cloud_filtered->push_back(*position);
+  }
+
+  int nr_points = (int) cloud_filtered->points.size ();
+  while (cloud_filtered->points.size () > params.remaining_fraction * nr_points)
+  {
+    seg.setInputCloud (cloud_filtered);
+    seg.segment (*inliers, *coefficients);
+    if (inliers->indices.size () == 0)
+      break;
+
+    pcl::ExtractIndices<pcl::PointXYZ> extract;
+    extract.setInputCloud (cloud_filtered);
+    extract.setIndices (inliers);
+    extract.setNegative (false);
+    extract.filter (*cloud_plane);
+
+    extract.setNegative (true);
+    extract.filter (*cloud_f);
+    cloud_filtered = cloud_f;
+  }
+  if(cloud_filtered->points.size() <= params.min_remaining_points || cloud_filtered->points.empty())
+    return -1;
+
+  pcl::search::KdTree<pcl::PointXYZ>::Ptr tree (new pcl::search::KdTree<pcl::PointXYZ>);
+  tree->setInputCloud (cloud_filtered);
+
+  std::vector<pcl::PointIndices> cluster_indices;
+  pcl::EuclideanClusterExtraction<pcl::PointXYZ> ec;
+  ec.setClusterTolerance (params.cluster_tolerance);
+  ec.setMinClusterSize (params.min_cluster_size);
+  ec.setMaxClusterSize (params.max_cluster_size);
+  ec.setSearchMethod (tree);
+  ec.setInputCloud (cloud_filtered);
+  ec.extract (cluster_indices);
+
+  for (std::vector<pcl::PointIndices>::const_iterator it = cluster_indices.begin (); it != cluster_indices.end (); ++it)
+  {
+    PointCloud::Ptr cloud_cluster (new PointCloud);
+    for (std::vector<int>::const_iterator pit = it->indices.begin (); pit != it->indices.end (); pit++)
+      cloud_cluster->points.push_back (cloud_filtered->points[*pit]);
+    cloud_cluster->width = cloud_cluster->points.size ();
+    cloud_cluster->height = 1;
+    cloud_cluster->is_dense = true;
+    cloudSegments.push_back(cloud_cluster);
+  }
+  return (1);
+}
+
+double
+now()
+{
+  timeval t;
+  gettimeofday(&t, NULL);
+  return t.tv_sec + 1e-6*t.tv_usec;
+}
+
+/** \brief Cluster sizes, largest first, so that clusters of equal size may come in any order */
+std::vector<unsigned int>
+clusterSizes(const std::vector<PointCloud::Ptr> &clusters)
+{
+  std::vector<unsigned int> sizes;
+  for(unsigned int i=0; i<clusters.size(); i++)
+    sizes.push_back(clusters[i]->size());
+  std::sort(sizes.rbegin(), sizes.rend());
+  return sizes;
+}
+
+bool
+sameClusters(const std::vector<PointCloud::Ptr> &a, const std::vector<PointCloud::Ptr> &b)
+{
+  return clusterSizes(a) == clusterSizes(b);
+}
+
+void
+report(const std::string &name, double elapsed, double reference, const std::vector<PointCloud::Ptr> &clusters, bool same)
+{
+  std::cout << "  " << name << ": " << 1e3*elapsed/NUM_RUNS << " ms/scene";
+  if(reference > 0)
+    std::cout << " (" << reference/elapsed << "x)";
+  std::cout << ", " << clusters.size() << " clusters";
+  if(!clusters.empty())
+    std::cout << ", largest " << clusters[0]->size() << " points";
+  std::cout << (same ? "" : ", CLUSTERS DIFFER FROM THE ORIGINAL") << std::endl;
+}
+
+bool
+benchmark(PointCloud::Ptr scene, const EuclideanSegmentation::Parameters &params)
+{
+  std::vector<PointCloud::Ptr> legacy;
+  double start = now();
+  for(int i=0; i<NUM_RUNS; i++){
+    legacy.clear();
+    legacySegmentCloud(scene, params, legacy);
+  }
+  double legacy_time = now() - start;
+  report("original", legacy_time, 0, legacy, true);
+
+  bool same = true;
+  int threads[] = {1, (int)std::max(2u, boost::thread::hardware_concurrency())};
+  for(int t=0; t<2; t++){
+    EuclideanSegmentation::Parameters p = params;
+    p.num_threads = threads[t];
+    EuclideanSegmentation segmenter(p);
+    std::vector<PointCloud::Ptr> clusters;
+    start = now();
+    for(int i=0; i<NUM_RUNS; i++){
+      clusters.clear();
+      segmenter.segment(scene);
+      segmenter.getClusters(clusters);
+    }
+    double elapsed = now() - start;
+    bool matches = sameClusters(legacy, clusters);
+    report(threads[t] == 1 ? std::string("shared, 1 thread") :
+           "shared, " + boost::lexical_cast<std::string>(threads[t]) + " threads", elapsed, legacy_time, clusters, matches);
+    same = same && matches;
+  }
+  return same;
+}
+
+int
+main(int argc, char **argv)
+{
+  if(argc < 2){
+    std::cout << "usage: segmentation_benchmark scene.pcd [scene.pcd ...]" << std::endl;
+    return 1;
+  }
+
+  //vfh_recognition
+  EuclideanSegmentation::Parameters kinect;
+  kinect.leaf_size = 0.01f;
+  kinect.min_x = -.7; kinect.max_x = .7;
+  kinect.min_y = -.1; kinect.max_y = 10;
+  kinect.min_z = 0; kinect.max_z = 1.2;
+  kinect.min_remaining_points = 100;
+  kinect.min_cluster_size = 100;
+
+  //data_collection
+  EuclideanSegmentation::Parameters close_range;
+  close_range.leaf_size = 0.001f;
+  close_range.min_x = -.2; close_range.max_x = .2;
+  close_range.min_y = -.5; close_range.max_y = .5;
+  close_range.min_z = .55; close_range.max_z = 1.15;
+
+  bool same = true;
+  for(int i=1; i<argc; i++){
+    PointCloud::Ptr scene(new PointCloud);
+    if(pcl::io::loadPCDFile(argv[i], *scene) < 0){
+      std::cout << "could not read " << argv[i] << std::endl;
+      continue;
+    }
+    std::cout << argv[i] << ", " << scene->size() << " points" << std::endl;
+    std::cout << " kinect settings" << std::endl;
+    same = benchmark(scene, kinect) && same;
+    std::cout << " close range settings" << std::endl;
+    same = benchmark(scene, close_range) && same;
+  }
+
+  return same ? 0 : 1;
+}
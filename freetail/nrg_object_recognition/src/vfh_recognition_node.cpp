@@ -31,7 +31,6 @@ flann::Matrix<int> k_indices;
 flann::Matrix<float> k_distances;
 flann::Matrix<float> *data;
 //ros::Publisher recognized_pub;
-sensor_msgs::PointCloud2 fromKinect;
 ros::Publisher pub;
 
 /** \brief Search for the closest k neighbors
@@ -24,6 +24,8 @@ namespace RosParams
 		static const std::string RecognitionSimilarityThreshold = "Recognition/SimilarityThreshold";
 		static const std::string RecognitionNumNeighbors = "Recognition/NumberOfNeighbors";
 		static const std::string RecognitionNormalEstimationRadius = "Recognition/NormalEstimationRadius";
+		static const std::string RecognitionParallelFeatures = "Recognition/ParallelFeatures";
+		static const std::string RecognitionNumThreads = "Recognition/NumberOfThreads";
 		static const std::string SegmentationMaxIterations = "Segmentation/MaxIterations";
 		static const std::string SegmentationDistanceThreshold = "Segmentation/DistanceThreshold";
 		static const std::string SegmentationLeafSizeX = "Segmentation/LeafSize/X";
@@ -53,6 +55,8 @@ namespace RosParams
 		static const int RecognitionNumNeighbors = 1;
 		static const double RecognitionSimilarityThreshold = 100.0f;
 		static const double RecognitionNormalEstimationRadius = 0.03f;
+		static const bool RecognitionParallelFeatures = true;
+		static const int RecognitionNumThreads = 0; // 0 uses one thread per core
 
 		static const int SegmentationMaxIterations = 100;
 		static const double SegmentationDistanceThreshold = 0.02f;
@@ -85,6 +89,8 @@ namespace RosParams
 				RecognitionNumNeighbors = 0;
 				RecognitionSimilarityThreshold = 0;
 				RecognitionNormalEstimationRadius = 0;
+				RecognitionParallelFeatures = false;
+				RecognitionNumThreads = 0;
 
 				SegmentationMaxIterations = 0;
 				SegmentationDistanceThreshold = 0;
@@ -113,6 +119,8 @@ namespace RosParams
 		int RecognitionNumNeighbors;
 		double RecognitionSimilarityThreshold;
 		double RecognitionNormalEstimationRadius;
+		bool RecognitionParallelFeatures;
+		int RecognitionNumThreads;
 
 		int SegmentationMaxIterations;
 		double SegmentationDistanceThreshold;
@@ -157,10 +165,10 @@ protected:
 int alignTemplate (pcl::PointCloud<pcl::PointXYZ>::Ptr cloud, std::string modelName,
 		pcl::PointCloud<pcl::PointXYZ>::Ptr transformed_cloud, Eigen::Matrix4f &objectToView);
 
-int SegmentCloud(sensor_msgs::PointCloud2 rawCloud, std::vector<pcl::PointCloud<pcl::PointXYZ>::Ptr> & cloudSegments);
+int SegmentCloud(const sensor_msgs::PointCloud2 &rawCloud, std::vector<pcl::PointCloud<pcl::PointXYZ>::Ptr> & cloudSegments);
 
-int SegmentCloud(sensor_msgs::PointCloud2 rawCloud, std::vector<pcl::PointCloud<pcl::PointXYZ>::Ptr> & cloudSegments,RosParametersList &params);
+int SegmentCloud(const sensor_msgs::PointCloud2 &rawCloud, std::vector<pcl::PointCloud<pcl::PointXYZ>::Ptr> & cloudSegments,RosParametersList &params);
 
-int SegmentCloud(sensor_msgs::PointCloud2 rawCloud, std::vector<pcl::PointCloud<pcl::PointXYZ>::Ptr> & cloudSegments, pcl::PointCloud<pcl::PointXYZ>::Ptr table, RosParametersList &params);
+int SegmentCloud(const sensor_msgs::PointCloud2 &rawCloud, std::vector<pcl::PointCloud<pcl::PointXYZ>::Ptr> & cloudSegments, pcl::PointCloud<pcl::PointXYZ>::Ptr table, RosParametersList &params);
 
 #endif
@@ -0,0 +1,56 @@
+#ifndef LATEST_MESSAGE_H
+#define LATEST_MESSAGE_H
+
+#include <ros/ros.h>
+#include <string>
+#include <boost/shared_ptr.hpp>
+
+/*
+ * Keeps the last message received on a topic without copying it.
+ * The subscription callback only swaps a shared pointer, so a 10 MB point cloud at 30 Hz costs nothing until
+ * a service actually reads it.  The swap uses the boost shared_ptr atomic access functions, so the callback and
+ * the services may run on different AsyncSpinner threads and never wait on each other for more than the swap.
+ */
+template <class MessageType>
+class LatestMessage
+{
+public:
+	typedef boost::shared_ptr<const MessageType> ConstPtr;
+
+	LatestMessage()
+	{
+
+	}
+
+	ros::Subscriber subscribe(ros::NodeHandle &nh,const std::string &topic)
+	{
+		return nh.subscribe(topic,1,&LatestMessage::callback,this);
+	}
+
+	void callback(const ConstPtr &msg)
+	{
+		boost::atomic_store(&latest_,msg);
+	}
+
+	// the returned message stays valid for as long as the pointer is held, even if newer ones arrive
+	ConstPtr get() const
+	{
+		return boost::atomic_load(&latest_);
+	}
+
+	void clear()
+	{
+		boost::atomic_store(&latest_,ConstPtr());
+	}
+
+protected:
+
+	ConstPtr latest_;
+
+private:
+
+	LatestMessage(const LatestMessage&);
+	LatestMessage& operator=(const LatestMessage&);
+};
+
+#endif
@@ -40,6 +40,8 @@ void RosParametersList::loadParams(ros::NodeHandle &nh,bool useRelativeNamespace
 	nh.param<int>(paramScope + Names::RecognitionNumNeighbors,Vals.RecognitionNumNeighbors,Defaults::RecognitionNumNeighbors);
 	nh.param<double>(paramScope + Names::RecognitionSimilarityThreshold,Vals.RecognitionSimilarityThreshold,Defaults::RecognitionSimilarityThreshold);
 	nh.param<double>(paramScope + Names::RecognitionNormalEstimationRadius,Vals.RecognitionNormalEstimationRadius,Defaults::RecognitionNormalEstimationRadius);
+	nh.param<bool>(paramScope + Names::RecognitionParallelFeatures,Vals.RecognitionParallelFeatures,Defaults::RecognitionParallelFeatures);
+	nh.param<int>(paramScope + Names::RecognitionNumThreads,Vals.RecognitionNumThreads,Defaults::RecognitionNumThreads);
 
 	nh.param<int>(paramScope + Names::SegmentationMaxIterations,Vals.SegmentationMaxIterations,Defaults::SegmentationMaxIterations);
 	nh.param<double>(paramScope + Names::SegmentationDistanceThreshold,Vals.SegmentationDistanceThreshold,Defaults::SegmentationLeafSizeX);
@@ -87,6 +89,8 @@ void RosParametersList::loadParams(bool useRelativeNamespace)
 	ros::param::param<int>(paramScope + Names::RecognitionNumNeighbors,Vals.RecognitionNumNeighbors,Defaults::RecognitionNumNeighbors);
 	ros::param::param<double>(paramScope + Names::RecognitionSimilarityThreshold,Vals.RecognitionSimilarityThreshold,Defaults::RecognitionSimilarityThreshold);
 	ros::param::param<double>(paramScope + Names::RecognitionNormalEstimationRadius,Vals.RecognitionNormalEstimationRadius,Defaults::RecognitionNormalEstimationRadius);
+	ros::param::param<bool>(paramScope + Names::RecognitionParallelFeatures,Vals.RecognitionParallelFeatures,Defaults::RecognitionParallelFeatures);
+	ros::param::param<int>(paramScope + Names::RecognitionNumThreads,Vals.RecognitionNumThreads,Defaults::RecognitionNumThreads);
 
 	ros::param::param<int>(paramScope + Names::SegmentationMaxIterations,Vals.SegmentationMaxIterations,Defaults::SegmentationMaxIterations);
 	ros::param::param<double>(paramScope + Names::SegmentationDistanceThreshold,Vals.SegmentationDistanceThreshold,Defaults::SegmentationLeafSizeX);
@@ -10,6 +10,7 @@
 #include <boost/filesystem.hpp>
 #include <pcl/features/vfh.h>
 #include <pcl/features/normal_3d.h>
+#include <nrg_object_recognition/view_features.h>
 
 
 //typedef std::pair<std::string, std::vector<float> > vfh_model;
@@ -31,6 +32,13 @@ main (int argc, char** argv)
   fileName.str("");
 
   //Point cloud with 1 point that contains the VFHSignature308.
+  pcl::PointCloud<pcl::VFHSignature308>::Ptr vfhs (new pcl::PointCloud<pcl::VFHSignature308> ());
+  vfhs->points.resize (1);
+  vfhs->width = 1;
+  vfhs->height = 1;
+
+  //Normals, estimators and search tree are reused for every instance.
+  nrg_object_recognition::ViewFeatureEstimation estimation;
 
   for(unsigned int i = 1; i < numInstances; i++)
   {
@@ -46,30 +54,15 @@ main (int argc, char** argv)
       std::cout << "model cloud has no points!" << std::endl;
 
 
-    //Extract VFH signature: /
-    // Create the VFH estimation class, and pass the input dataset+normals to it
-    pcl::VFHEstimation<pcl::PointXYZ, pcl::Normal, pcl::VFHSignature308> vfh;
-    vfh.setInputCloud (cloud);
-
-    //Estimate normals:
-    pcl::NormalEstimation<pcl::PointXYZ, pcl::Normal> ne;
-    ne.setInputCloud (cloud);
-    pcl::search::KdTree<pcl::PointXYZ>::Ptr tree (new pcl::search::KdTree<pcl::PointXYZ> ());
-    ne.setSearchMethod (tree);
-    pcl::PointCloud<pcl::Normal>::Ptr cloud_normals (new pcl::PointCloud<pcl::Normal>);
-    ne.setRadiusSearch (0.03);
-    ne.compute (*cloud_normals);
-    vfh.setInputNormals (cloud_normals);
-
-    // Create an empty kdtree representation, and pass it to the FPFH estimation object.
-    // Its content will be filled inside the object, based on the given input dataset (as no other search surface is given).
-    vfh.setSearchMethod (tree);
-
-    // Output datasets
-    pcl::PointCloud<pcl::VFHSignature308>::Ptr vfhs (new pcl::PointCloud<pcl::VFHSignature308> ());
-
-    // Compute the features
-    vfh.compute (*vfhs);
+    //Extract VFH signature:
+    std::vector<float> feature;
+    if (!estimation.compute (cloud, feature, NULL))
+    {
+      std::cout << "could not compute the VFH of " << fileName.str() << std::endl;
+      fileName.str("");
+      continue;
+    }
+    std::copy (feature.begin (), feature.end (), vfhs->points[0].histogram);
 
     //Write to file
     outFileName << objectName << "_" << i <<"_vfh.pcd";
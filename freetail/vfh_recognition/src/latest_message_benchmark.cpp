@@ -0,0 +1,109 @@
+//latest_message_benchmark.cpp
+//Feeds 640x480 XYZRGB clouds at 30 Hz through the old copy-by-value callback and through LatestMessage while a
+//second thread reads the latest cloud as the segmentation service would, and reports the callback cost.
+//usage: latest_message_benchmark [num_frames] [reads_per_second]
+
+#include "ros/ros.h"
+#include "sensor_msgs/PointCloud2.h"
+#include <vfh_recognition/latest_message.h>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <iostream>
+#include <cstdlib>
+
+sensor_msgs::PointCloud2 fromKinect;
+LatestMessage<sensor_msgs::PointCloud2> LATEST_CLOUD;
+boost::mutex COPY_MUTEX;
+volatile bool READING = true;
+
+// the callback signature used by the nodes before, roscpp copies the message into the argument
+void kinect_cb(const sensor_msgs::PointCloud2 inCloud)
+{
+  boost::mutex::scoped_lock lock(COPY_MUTEX);
+  fromKinect = inCloud;
+}
+
+void copyReader(double rate, unsigned long *reads)
+{
+  ros::WallRate r(rate);
+  while(READING){
+    {
+      boost::mutex::scoped_lock lock(COPY_MUTEX);
+      sensor_msgs::PointCloud2 cloud = fromKinect;
+      *reads += cloud.data.size() > 0;
+    }
+    r.sleep();
+  }
+}
+
+void latestReader(double rate, unsigned long *reads)
+{
+  ros::WallRate r(rate);
+  while(READING){
+    LatestMessage<sensor_msgs::PointCloud2>::ConstPtr cloud = LATEST_CLOUD.get();
+    *reads += cloud && cloud->data.size() > 0;
+    r.sleep();
+  }
+}
+
+sensor_msgs::PointCloud2::Ptr makeFrame(unsigned int seq)
+{
+  sensor_msgs::PointCloud2::Ptr frame(new sensor_msgs::PointCloud2);
+  frame->header.seq = seq;
+  frame->height = 480;
+  frame->width = 640;
+  frame->point_step = 32;
+  frame->row_step = frame->point_step*frame->width;
+  frame->data.resize(frame->row_step*frame->height, (uint8_t)seq);
+  return frame;
+}
+
+// returns the average callback time in seconds
+double run(bool latest, int num_frames, double read_rate, unsigned long &reads)
+{
+  // frames are built ahead so only the callbacks are timed
+  std::vector<sensor_msgs::PointCloud2::ConstPtr> frames;
+  for(int i=0; i<3; i++)
+    frames.push_back(makeFrame(i));
+
+  reads = 0;
+  READING = true;
+  boost::thread reader(latest ? latestReader : copyReader, read_rate, &reads);
+
+  ros::WallRate rate(30.0);
+  ros::WallDuration busy(0.0);
+  for(int i=0; i<num_frames; i++){
+    const sensor_msgs::PointCloud2::ConstPtr &frame = frames[i % frames.size()];
+    ros::WallTime start = ros::WallTime::now();
+    if(latest)
+      LATEST_CLOUD.callback(frame);
+    else
+      kinect_cb(*frame);
+    busy += ros::WallTime::now() - start;
+    rate.sleep();
+  }
+
+  READING = false;
+  reader.join();
+  return busy.toSec()/num_frames;
+}
+
+int main(int argc, char **argv)
+{
+  ros::Time::init();
+  int num_frames = argc > 1 ? atoi(argv[1]) : 300;
+  double read_rate = argc > 2 ? atof(argv[2]) : 1.0;
+  double frame_mb = makeFrame(0)->data.size()/(1024.0*1024.0);
+
+  unsigned long copy_reads, latest_reads;
+  double copy_time = run(false, num_frames, read_rate, copy_reads);
+  double latest_time = run(true, num_frames, read_rate, latest_reads);
+
+  // the by-value callback copies each frame twice: into the argument and into the global
+  std::cout << num_frames << " frames of " << frame_mb << " MB at 30 Hz\n"
+            << "copy by value: " << copy_time*1e3 << " ms/frame (" << copy_time*30*100 << "% of a core), "
+            << 2*frame_mb*30 << " MB/s copied, " << copy_reads << " reads\n"
+            << "latest frame:  " << latest_time*1e3 << " ms/frame (" << latest_time*30*100 << "% of a core), "
+            << "0 MB/s copied, " << latest_reads << " reads\n";
+  return(0);
+}
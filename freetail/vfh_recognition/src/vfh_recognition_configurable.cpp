@@ -51,38 +51,75 @@
 #include <tabletop_object_detector/TabletopSegmentation.h>
 #include <tabletop_object_detector/TabletopObjectRecognition.h>
 #include <boost/filesystem.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
 #include <vfh_recognition/SupportClasses.h>
+#include <nrg_object_recognition/feature_database.h>
 
 // global variables
 typedef std::pair<std::string, std::vector<float> > vfh_model;
+typedef flann::Index<flann::ChiSquareDistance<float> > vfh_index;
 std::vector<vfh_model> models;
-flann::Matrix<int> k_indices;
-flann::Matrix<float> k_distances;
 flann::Matrix<float> *data;
+vfh_index *index_ptr = NULL;
+//training features mapped from vfh_features.db, when the input directory has one
+nrg_object_recognition::FeatureDatabase database;
 //ros::Publisher recognized_pub;
-sensor_msgs::PointCloud2 fromKinect;
 ros::Publisher pub;
 RosParametersList ROS_PARAMS = RosParametersList();
 
-/** \brief Search for the closest k neighbors
-  * \param index the tree
-  * \param model the query model
-  * \param k the number of neighbors to search for
-  * \param indices the resultant neighbor indices
-  * \param distances the resultant neighbor distances
+/** \brief Normal and VFH estimators owned by one feature worker.  The search tree is shared by
+  * both estimators and, like the estimators, is kept for the life of the node.
   */
-inline void
-nearestKSearch (flann::Index<flann::ChiSquareDistance<float> > &index, const vfh_model &model,
-                int k, flann::Matrix<int> &indices, flann::Matrix<float> &distances)
+struct FeatureWorker
 {
-  // Query point
-  flann::Matrix<float> p = flann::Matrix<float>(new float[model.second.size ()], 1, model.second.size ());
-  memcpy (&p.ptr ()[0], &model.second[0], p.cols * p.rows * sizeof (float));
-
-  indices = flann::Matrix<int>(new int[k], 1, k);
-  distances = flann::Matrix<float>(new float[k], 1, k);
-  index.knnSearch (p, indices, distances, k, flann::SearchParams (512));
-  delete[] p.ptr ();
+  FeatureWorker() :
+    tree (new pcl::search::KdTree<pcl::PointXYZ> ()),
+    normals (new pcl::PointCloud<pcl::Normal>),
+    vfhs (new pcl::PointCloud<pcl::VFHSignature308> ())
+  {
+    ne.setSearchMethod (tree);
+    vfh.setSearchMethod (tree);
+  }
+
+  pcl::search::KdTree<pcl::PointXYZ>::Ptr tree;
+  pcl::NormalEstimation<pcl::PointXYZ, pcl::Normal> ne;
+  pcl::VFHEstimation<pcl::PointXYZ, pcl::Normal, pcl::VFHSignature308> vfh;
+  pcl::PointCloud<pcl::Normal>::Ptr normals;
+  pcl::PointCloud<pcl::VFHSignature308>::Ptr vfhs;
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+std::vector<boost::shared_ptr<FeatureWorker> > feature_workers;
+
+/** \brief Computes the VFH signature of every cloud handed out by next_cluster into its row of features.
+  */
+void
+computeFeatures (FeatureWorker &worker, const std::vector<pcl::PointCloud<pcl::PointXYZ>::Ptr> &clouds,
+                 unsigned int &next_cluster, boost::mutex &next_mutex, flann::Matrix<float> &features)
+{
+  while(true)
+  {
+    unsigned int i;
+    {
+      boost::mutex::scoped_lock lock(next_mutex);
+      if(next_cluster >= clouds.size())
+        return;
+      i = next_cluster++;
+    }
+
+    //Estimate normals:
+    worker.ne.setInputCloud (clouds[i]);
+    worker.ne.setRadiusSearch (ROS_PARAMS.Vals.RecognitionNormalEstimationRadius);
+    worker.ne.compute (*worker.normals);
+
+    //VFH estimation
+    worker.vfh.setInputCloud (clouds[i]);
+    worker.vfh.setInputNormals (worker.normals);
+    worker.vfh.compute (*worker.vfhs);
+
+    std::copy(worker.vfhs->points[0].histogram, worker.vfhs->points[0].histogram + features.cols, features[i]);
+  }
 }
 
 /** \brief Load the list of file model names from an ASCII file
@@ -181,21 +218,16 @@ loadFeatureModels (const boost::filesystem::path &base_dir, const std::string &e
 bool recognize_cb(tabletop_object_detector::TabletopObjectRecognition::Request &srv_request,
 		  tabletop_object_detector::TabletopObjectRecognition::Response &srv_response)
 {
-
-  //build kdtree index
-  flann::Index<flann::ChiSquareDistance<float> > index (*data, flann::LinearIndexParams ());
-   index.buildIndex ();
+  ros::WallTime start_time = ros::WallTime::now();
 
   //clear any models in the response:
   srv_response.models.resize(0);
 
-  // Create the VFH estimation class, and pass the input dataset+normals to it
-  pcl::VFHEstimation<pcl::PointXYZ, pcl::Normal, pcl::VFHSignature308> vfh;
   std::vector<pcl::PointCloud<pcl::PointXYZ>::Ptr> clouds;
-  pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_ptr (new pcl::PointCloud<pcl::PointXYZ> ());
   std::cout << "loading " << srv_request.clusters.size() << " clusters into clouds vector... \n";
   clouds.resize(0);
   for(unsigned int i=0; i<srv_request.clusters.size(); i++){
+    pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_ptr (new pcl::PointCloud<pcl::PointXYZ> ());
     cloud_ptr->resize(srv_request.clusters.at(i).points.size());
     for(unsigned int j=0; j<srv_request.clusters.at(i).points.size(); j++){
       cloud_ptr->points.at(j).x = srv_request.clusters.at(i).points.at(j).x;
@@ -206,6 +238,42 @@ bool recognize_cb(tabletop_object_detector::TabletopObjectRecognition::Request &
   }
   std::cout << "done.\n";
   std::cout.flush();
+  if(clouds.empty())
+    return(1);
+
+  //Normals and VFH signatures for all clusters, spread over the feature workers
+  flann::Matrix<float> features(new float[clouds.size()*data->cols], clouds.size(), data->cols);
+  unsigned int next_cluster = 0;
+  boost::mutex next_mutex;
+  unsigned int num_threads = std::min(feature_workers.size(), clouds.size());
+  if(num_threads <= 1)
+  {
+    computeFeatures(*feature_workers[0], clouds, next_cluster, next_mutex, features);
+  }
+  else
+  {
+    boost::thread_group threads;
+    for(unsigned int t=0; t<num_threads; t++)
+    {
+      threads.create_thread(boost::bind(&computeFeatures, boost::ref(*feature_workers[t]), boost::cref(clouds),
+                                        boost::ref(next_cluster), boost::ref(next_mutex), boost::ref(features)));
+    }
+    threads.join_all();
+  }
+  ros::WallTime features_time = ros::WallTime::now();
+
+  //Algorithm parameters
+  float thresh = 150; //similarity threshold
+  int k = 1; //number of neighbors
+
+  //KNN classification of all clusters against the index built at start up
+  std::vector<int> indices(clouds.size()*k);
+  std::vector<float> distances(clouds.size()*k);
+  flann::Matrix<int> k_indices(&indices[0], clouds.size(), k);
+  flann::Matrix<float> k_distances(&distances[0], clouds.size(), k);
+  index_ptr->knnSearch (features, k_indices, k_distances, k, flann::SearchParams (512));
+  delete[] features.ptr();
+
   //For storing results:
   pcl::PointCloud<pcl::PointXYZ>::Ptr aligned_template (new pcl::PointCloud<pcl::PointXYZ>);
   sensor_msgs::PointCloud2 recognized_msg;
@@ -214,50 +282,12 @@ bool recognize_cb(tabletop_object_detector::TabletopObjectRecognition::Request &
   //For each segment passed in:
   std::cout << "Classifying each segment passed to recognition node... \n";
   for(unsigned int segment_it = 0; segment_it < clouds.size(); segment_it++){
-    vfh.setInputCloud (clouds.at(segment_it));
-    std::cout << "estimating normals... ";
-    //Estimate normals:
-    pcl::NormalEstimation<pcl::PointXYZ, pcl::Normal> ne;
-    ne.setInputCloud (clouds.at(segment_it));
-    pcl::search::KdTree<pcl::PointXYZ>::Ptr treeNorm (new pcl::search::KdTree<pcl::PointXYZ> ());
-    ne.setSearchMethod (treeNorm);
-    pcl::PointCloud<pcl::Normal>::Ptr cloud_normals (new pcl::PointCloud<pcl::Normal>);
-    ne.setRadiusSearch (0.03);
-    ne.compute (*cloud_normals);
-    std::cout << "done.\n";
-
-    std::cout << "computing feature... ";
-    //VFH estimation
-    vfh.setInputNormals (cloud_normals);
-    pcl::search::KdTree<pcl::PointXYZ>::Ptr tree (new pcl::search::KdTree<pcl::PointXYZ> ());
-    vfh.setSearchMethod (tree);
-    pcl::PointCloud<pcl::VFHSignature308>::Ptr vfhs (new pcl::PointCloud<pcl::VFHSignature308> ());
-    vfh.compute (*vfhs);
-    std::cout << "done.\n";
-
-    //Load histogram
-    vfh_model histogram;
-    histogram.second.resize(308);
-    for (size_t i = 0; i < 308; ++i)
-      {
-	histogram.second[i] = vfhs->points[0].histogram[i];
-      }
-
-    //Algorithm parameters
-    float thresh = 150; //similarity threshold
-    int k = 1; //number of neighbors
-
-    //KNN classification
-    flann::Index<flann::ChiSquareDistance<float> > index (*data, flann::LinearIndexParams ());
-    index.buildIndex ();
-    nearestKSearch (index, histogram, k, k_indices, k_distances);
-
     //If model match is close enough, do finer pose estimation by RANSAC fitting.
     
-    if(k_distances[0][0] < thresh){
+    if(k_distances[segment_it][0] < thresh){
       numFound++;
       //Load nearest match
-      std::string cloud_name = models.at(k_indices[0][0]).first;
+      std::string cloud_name = models.at(k_indices[segment_it][0]).first;
 
       //Extract object label and view number from file name:
       cloud_name.erase(cloud_name.end()-8, cloud_name.end()-4);
@@ -290,7 +320,7 @@ bool recognize_cb(tabletop_object_detector::TabletopObjectRecognition::Request &
       //PoseStamped
         //Header
       srv_response.models[numFound-1].model_list[0].pose.header.seq = 1; //Don't know what this is, but it's set.
-      srv_response.models[numFound-1].model_list[0].pose.header.stamp = fromKinect.header.stamp;
+      srv_response.models[numFound-1].model_list[0].pose.header.stamp = srv_request.clusters.at(segment_it).header.stamp;
       srv_response.models[numFound-1].model_list[0].pose.header.frame_id = "/camera_depth_optical_frame";// perhaps it be best to return the frame id of the point cloud
         //Pose
           //Position:
@@ -309,6 +339,11 @@ bool recognize_cb(tabletop_object_detector::TabletopObjectRecognition::Request &
 
   }//end segment iterator
 
+  ros::WallTime end_time = ros::WallTime::now();
+  ROS_INFO("Recognized %d clusters with %d threads: features %f s, total %f s",
+           (int)clouds.size(), std::max(1, (int)num_threads), (features_time - start_time).toSec(),
+           (end_time - start_time).toSec());
+
   return(1);
 }
 
@@ -321,24 +356,53 @@ int main(int argc, char **argv)
   // fetching values from ros parameter server
   ROS_PARAMS.loadParams(n,true);
 
-  //loadFeatureModels ("data", ".pcd", models);
-  loadFeatureModels(ROS_PARAMS.Vals.InputDataDirectory,
+  const boost::filesystem::path database_file =
+      boost::filesystem::path(ROS_PARAMS.Vals.InputDataDirectory) / "vfh_features.db";
+  if(database.open(database_file.string()) && database.getCols() == 308 && database.getRows() > 0)
+  {
+    //Use the mapped matrix in place, only the names are needed per model
+    models.resize(database.getRows());
+    for (size_t i = 0; i < models.size(); ++i)
+      models[i].first = (boost::filesystem::path(ROS_PARAMS.Vals.InputDataDirectory) / database.getName(i)).string();
+    data = new flann::Matrix<float> (const_cast<float*>(database.getData()), database.getRows(), database.getCols());
+    pcl::console::print_highlight ("Mapped %d VFH models from %s\n", (int)models.size (), database_file.string().c_str());
+  }
+  else
+  {
+    database.close();
+    //loadFeatureModels ("data", ".pcd", models);
+    loadFeatureModels(ROS_PARAMS.Vals.InputDataDirectory,
 		  ROS_PARAMS.Vals.InputDataExtension,
 		  models);
 
-  pcl::console::print_highlight ("Loaded %d VFH models. Creating training data\n",
-      (int)models.size ());
-
-  // Convert data into FLANN format
-  data = new flann::Matrix<float> (new float[models.size () * models[0].second.size ()], models.size (), models[0].second.size ());
+    pcl::console::print_highlight ("Loaded %d VFH models. Creating training data\n",
+        (int)models.size ());
 
+    // Convert data into FLANN format
+    data = new flann::Matrix<float> (new float[models.size () * models[0].second.size ()], models.size (), models[0].second.size ());
+    for (size_t i = 0; i < data->rows; ++i)
+      for (size_t j = 0; j < data->cols; ++j)
+        *(data->ptr()+(i*data->cols + j)) = models[i].second[j];
+  }
   std::cout << "data size: [" << data->rows << " , " << data->cols << "]\n";
-  for (size_t i = 0; i < data->rows; ++i)
-    for (size_t j = 0; j < data->cols; ++j)
-      *(data->ptr()+(i*data->cols + j)) = models[i].second[j];
+
+  //build the knn index once, every request queries it
+  index_ptr = new vfh_index (*data, flann::LinearIndexParams ());
+  index_ptr->buildIndex ();
 
   pcl::console::print_error ("Training data loaded.\n");
 
+  //feature workers, one per thread
+  unsigned int num_workers = 1;
+  if(ROS_PARAMS.Vals.RecognitionParallelFeatures)
+  {
+    num_workers = ROS_PARAMS.Vals.RecognitionNumThreads > 0 ? ROS_PARAMS.Vals.RecognitionNumThreads :
+        std::max(1u, boost::thread::hardware_concurrency());
+  }
+  for(unsigned int i=0; i<num_workers; i++)
+    feature_workers.push_back(boost::shared_ptr<FeatureWorker>(new FeatureWorker()));
+  ROS_INFO("Computing cluster features with %d threads", (int)num_workers);
+
   //ros::Subscriber sub = n.subscribe("/camera/depth_registered/points", 1, kinect_cb);
   //ros::Subscriber sub = n.subscribe(ROS_PARAMS.Vals.InputCloudTopicName, 1, kinect_cb);
   //ros::ServiceServer serv = n.advertiseService("/object_recognition", recognize_cb);
@@ -17,6 +17,7 @@
 #include <pcl/ModelCoefficients.h>
 #include "vfh_recognition/Recognize.h"
 #include <vfh_recognition/SupportClasses.h>
+#include <vfh_recognition/latest_message.h>
 #include <tabletop_object_detector/TabletopSegmentation.h>
 #include <tabletop_object_detector/TabletopObjectRecognition.h>
 #include <boost/filesystem.hpp>
@@ -29,7 +30,7 @@ flann::Matrix<int> k_indices;
 flann::Matrix<float> k_distances;
 flann::Matrix<float> *data;
 //ros::Publisher recognized_pub;
-sensor_msgs::PointCloud2 fromKinect;
+LatestMessage<sensor_msgs::PointCloud2> LATEST_CLOUD;
 ros::Publisher pub;
 
 /** \brief Search for the closest k neighbors
@@ -162,7 +163,12 @@ bool recognize_cb(tabletop_object_detector::TabletopObjectRecognition::Request &
   std::vector<pcl::PointCloud<pcl::PointXYZ>::Ptr> clouds;
   
   //Euclidean segmentation:
-  SegmentCloud(fromKinect, clouds);
+  LatestMessage<sensor_msgs::PointCloud2>::ConstPtr fromKinect = LATEST_CLOUD.get();
+  if(!fromKinect){
+    ROS_WARN("Recognition: no cloud received yet");
+    return(0);
+  }
+  SegmentCloud(*fromKinect, clouds);
  
   //For storing results:
   pcl::PointCloud<pcl::PointXYZ>::Ptr aligned_template (new pcl::PointCloud<pcl::PointXYZ>);
@@ -242,7 +248,7 @@ bool recognize_cb(tabletop_object_detector::TabletopObjectRecognition::Request &
       //PoseStamped
         //Header
       srv_response.models[numFound-1].model_list[0].pose.header.seq = 1; //Don't know what this is, but it's set.
-      srv_response.models[numFound-1].model_list[0].pose.header.stamp = fromKinect.header.stamp;
+      srv_response.models[numFound-1].model_list[0].pose.header.stamp = fromKinect->header.stamp;
       srv_response.models[numFound-1].model_list[0].pose.header.frame_id = "/camera_depth_optical_frame";
         //Pose
           //Position:
@@ -263,11 +269,6 @@ bool recognize_cb(tabletop_object_detector::TabletopObjectRecognition::Request &
   return(1);
 }
 
-void kinect_cb(const sensor_msgs::PointCloud2 inCloud)
-{
-  fromKinect = inCloud;
-}
-
 int main(int argc, char **argv)
 {
   
@@ -288,7 +289,7 @@ int main(int argc, char **argv)
     
   pcl::console::print_error ("Training data loaded.\n");
   
-  ros::Subscriber sub = n.subscribe("/camera/depth_registered/points", 1, kinect_cb);
+  ros::Subscriber sub = LATEST_CLOUD.subscribe(n, "/camera/depth_registered/points");
   
   ros::ServiceServer serv = n.advertiseService("/object_recognition", recognize_cb);
   ROS_INFO("Recognition node ready.");
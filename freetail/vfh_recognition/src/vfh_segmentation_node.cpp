@@ -46,9 +46,10 @@
 #include <tabletop_object_detector/TabletopSegmentation.h>
 #include <tabletop_object_detector/TabletopObjectRecognition.h>
 #include <vfh_recognition/SupportClasses.h>
+#include <vfh_recognition/latest_message.h>
 
 // global variables
-sensor_msgs::PointCloud2 fromKinect;
+LatestMessage<sensor_msgs::PointCloud2> LATEST_CLOUD;
 RosParametersList ROS_PARAMS = RosParametersList();
 
 
@@ -58,7 +59,13 @@ bool segment_cb(tabletop_object_detector::TabletopSegmentation::Request &srv_req
   std::vector<pcl::PointCloud<pcl::PointXYZ>::Ptr> clusters;
   pcl::PointCloud<pcl::PointXYZ>::Ptr table;
 
-  SegmentCloud(fromKinect, clusters, table, ROS_PARAMS);
+  //The cloud is only decoded here, newer clouds may arrive while it is being segmented.
+  LatestMessage<sensor_msgs::PointCloud2>::ConstPtr fromKinect = LATEST_CLOUD.get();
+  if(!fromKinect){
+    ROS_WARN("Segmentation: no cloud received yet");
+    return(0);
+  }
+  SegmentCloud(*fromKinect, clusters, table, ROS_PARAMS);
   //Need to modify above function to return table.
   
 //   Eigen::Vector4f centroid;
@@ -103,7 +110,7 @@ bool segment_cb(tabletop_object_detector::TabletopSegmentation::Request &srv_req
   srv_response.clusters.resize(clusters.size());
   for(unsigned int i=0; i< clusters.size(); i++){
    srv_response.clusters.at(i).header.frame_id = "/camera_depth_optical_frame"; //This will be loaded from the parameter server
-   srv_response.clusters.at(i).header.stamp = fromKinect.header.stamp;
+   srv_response.clusters.at(i).header.stamp = fromKinect->header.stamp;
    srv_response.clusters.at(i).points.resize(clusters.at(i)->points.size());
    for(unsigned int j=0; j< clusters.at(i)->points.size(); j++){ 
       srv_response.clusters.at(i).points.at(j).x = clusters.at(i)->points.at(j).x;
@@ -116,11 +123,6 @@ bool segment_cb(tabletop_object_detector::TabletopSegmentation::Request &srv_req
   return(1);
 }
 
-void kinect_cb(const sensor_msgs::PointCloud2 inCloud)
-{
-  fromKinect = inCloud;
-}
-
 int main(int argc, char **argv)
 {
 
@@ -131,12 +133,16 @@ int main(int argc, char **argv)
   ROS_PARAMS.loadParams(n,true);
 
   //ros::Subscriber sub = n.subscribe("/camera/depth_registered/points", 1, kinect_cb);
-  ros::Subscriber sub = n.subscribe(ROS_PARAMS.Vals.InputCloudTopicName, 1, kinect_cb);
+  ros::Subscriber sub = LATEST_CLOUD.subscribe(n, ROS_PARAMS.Vals.InputCloudTopicName);
 
   //ros::ServiceServer serv = n.advertiseService("/object_recognition", recognize_cb);
   ros::ServiceServer serv = n.advertiseService(ROS_PARAMS.Vals.SegmentationServiceName, segment_cb);
   ROS_INFO("Segmentation node ready.");
-  ros::spin();
+
+  //clouds keep arriving on one thread while a request is segmented on the other
+  ros::AsyncSpinner spinner(2);
+  spinner.start();
+  ros::waitForShutdown();
 
 
 }
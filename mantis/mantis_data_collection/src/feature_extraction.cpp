@@ -17,7 +17,7 @@
 #include "mantis_data_collection/process_cloud.h"
 #include "euclidean_segmentation.h"
 #include "nrg_object_recognition/segmentation.h"
-#include "cph.h"
+#include <nrg_object_recognition/cph.h>
 
 #include "tabletop_object_detector/Table.h"
 #include "mantis_perception/mantis_segmentation.h"
@@ -10,15 +10,21 @@
 ros::Publisher pan_pub;
 ros::Publisher vis_pub;
 ros::ServiceClient pan_client;
-sensor_msgs::PointCloud2 cloud_to_process;
+sensor_msgs::PointCloud2::ConstPtr cloud_to_process; //latest cloud, only the pointer is kept
 
-void kinect_cb(sensor_msgs::PointCloud2 fromKinect)
+void kinect_cb(const sensor_msgs::PointCloud2::ConstPtr &fromKinect)
 {
 	cloud_to_process = fromKinect;
 }
 
 bool rotate_cb(mantis_data_collection::dataCollect::Request &req, mantis_data_collection::dataCollect::Response &res)
 {
+if(!cloud_to_process)
+{
+ROS_ERROR("No cloud received yet");
+return false;
+}
+
 std_msgs::UInt16 command;
 command.data=0;
 mantis_data_collection::process_cloud srv;
@@ -31,7 +37,7 @@ command.data = req.delta;
 //{
 //ros::Rate loop_rate(.1);
 
-srv.request.in_cloud = cloud_to_process;
+srv.request.in_cloud = *cloud_to_process;
 srv.request.angle = command.data;
 pan_client.call(srv);
 srv.response.result = 1;
@@ -17,13 +17,13 @@
 //ros::Publisher pan_pub;
 //ros::Publisher vis_pub;
 ros::ServiceClient cloud_process_client;
-sensor_msgs::PointCloud2 cloud_to_process;
+sensor_msgs::PointCloud2::ConstPtr cloud_to_process; //latest cloud, only the pointer is kept
 sensor_msgs::JointState last_joint_state;
 bool joint_state_initialized = false;
 typedef actionlib::SimpleActionClient<control_msgs::FollowJointTrajectoryAction> Client;
 
 
-void kinect_cb(sensor_msgs::PointCloud2 fromKinect)
+void kinect_cb(const sensor_msgs::PointCloud2::ConstPtr &fromKinect)
 {
 	cloud_to_process = fromKinect;
 }
@@ -88,14 +88,21 @@ int main(int argc, char **argv)
         	mantis_data_collection::process_cloud srv;
 
         	srv.request.objectName = object_name_;
-        	srv.request.in_cloud = cloud_to_process;
         	double request_angle=joint_angle*180.0/3.14+180.0;
         	srv.request.angle = std::floor(request_angle);
-        	ROS_INFO_STREAM("Sending object "<<object_name_<< " with angle "<<std::floor(request_angle)<<" to feature extractor");
-        	//pan_client.call(srv);
-        	if (!cloud_process_client.call(srv))
+        	if (!cloud_to_process)
         	    {
-        	      ROS_ERROR("Call to feature extractor/cloud processor service failed");
+        	      ROS_ERROR("No cloud received yet, skipping angle %f", std::floor(request_angle));
+        	    }
+        	else
+        	    {
+        	      srv.request.in_cloud = *cloud_to_process;
+        	      ROS_INFO_STREAM("Sending object "<<object_name_<< " with angle "<<std::floor(request_angle)<<" to feature extractor");
+        	      //pan_client.call(srv);
+        	      if (!cloud_process_client.call(srv))
+        	        {
+        	          ROS_ERROR("Call to feature extractor/cloud processor service failed");
+        	        }
         	    }
 
         	srv.response.result = 1;
@@ -11,14 +11,20 @@
 #include <object_manipulation_tools/robot_navigators/RobotNavigator.h>
 #include <perception_tools/segmentation/SphereSegmentation.h>
 #include <mantis_object_manipulation/zone_selection/PickPlaceZoneSelector.h>
+#include <mantis_object_manipulation/utils/StageLatencyMonitor.h>
 #include <mantis_perception/mantis_recognition.h>
 #include <object_manipulation_tools/manipulation_utils/Utilities.h>
+#include <arm_kinematics_constraint_aware/arm_kinematics_solver_constraint_aware.h>
+#include <kinematics_base/kinematics_base.h>
+#include <pluginlib/class_loader.h>
 #include <boost/thread/mutex.hpp>
+#include <boost/shared_ptr.hpp>
 
 static const std::string PARAM_NAME_NUM_GRASP_ATTEMTPTS = "num_of_grasp_attempts";
 static const std::string PARAM_NAME_NEW_GRASP_RETREAT_DISTANCE = "new_grasp_attempt_retreat_distance";
 static const std::string PARAM_NAME_NEW_GRASP_OFFSET = "new_grasp_attempt_offset";
 static const std::string PARAM_NAME_ATTACHED_OBJECT_BB_SIDE = "attached_object_bb_side";
+static const std::string PARAM_NAME_PLACE_IK_THREADS = "place_ik_threads";
 
 class AutomatedPickerRobotNavigator: public RobotNavigator
 {
@@ -67,6 +73,25 @@ public:
 		std::vector<double> SideAngles;
 	};
 
+	// ik problems of a place feasibility sweep, shared by the worker threads under its mutex
+	struct PlaceIkSweep
+	{
+		std::vector<std::vector<geometry_msgs::Pose> > WristPoses; // place pose followed by the retreat via points, one entry per grasp candidate
+		std::vector<int> Solved; // poses solved per candidate, -1 once one of them fails
+		std::vector<int> FailedPose;
+		std::vector<int> ErrorCodes;
+		std::vector<sensor_msgs::JointState> PlaceSolutions;
+		std::size_t NextProblem;
+		int BestCandidate; // lowest candidate with all poses solved, -1 while there is none
+		boost::mutex Mutex;
+	};
+
+	struct PlaceIkWorker
+	{
+		arm_kinematics_constraint_aware::ArmKinematicsSolverConstraintAware *IkSolver;
+		boost::shared_ptr<planning_models::KinematicState> State; // seed state owned by this worker
+	};
+
 public:
 
 	AutomatedPickerRobotNavigator();
@@ -95,6 +120,11 @@ protected:
 	// and saves the place sequence move for later execution
 	virtual bool createCandidateGoalPoses(std::vector<geometry_msgs::PoseStamped> &placePoses);
 	bool findIkSolutionForPlacePoses();
+	void setupPlaceIkSolvers(); // loads the per thread ik solvers, called by the first findIkSolutionForPlacePoses
+	void solvePlaceIkProblems(PlaceIkWorker *worker,PlaceIkSweep *sweep);
+
+	// stages must be registered before the latency monitor is started at the end of setup
+	virtual void addLatencyStages();
 
 	virtual bool moveArmToSide();
 	virtual bool moveArmThroughPickSequence();
@@ -119,6 +149,7 @@ protected:
 	double offset_from_first_grasp_;// distance from original pick grasp to used in new pick attempt
 	double recovery_retreat_distance_;
 	double attached_obj_bb_side_;
+	int place_ik_threads_; // 0 uses one thread per core
 
 	// segmentation
 	SphereSegmentation sphere_segmentation_;
@@ -147,6 +178,16 @@ protected:
 	// threading
 	boost::mutex marker_array_mutex_;
 
+	// place ik feasibility, each thread gets its own solver since the ik plugins keep their solutions internally
+	boost::shared_ptr<pluginlib::ClassLoader<kinematics::KinematicsBase> > kinematics_loader_;
+	std::vector<boost::shared_ptr<kinematics::KinematicsBase> > place_ik_plugins_;
+	std::vector<boost::shared_ptr<arm_kinematics_constraint_aware::ArmKinematicsSolverConstraintAware> > place_ik_solvers_;
+	int place_ik_candidate_; // grasp candidate picked by the last call to findIkSolutionForPlacePoses
+	sensor_msgs::JointState place_ik_solution_;
+
+	// per stage latency and outcome, published on the stage_latency topic
+	StageLatencyMonitor latency_monitor_;
+
 };
 
 #endif /* AUTOMATEDPICKERROBOTNAVIGATOR_H_ */
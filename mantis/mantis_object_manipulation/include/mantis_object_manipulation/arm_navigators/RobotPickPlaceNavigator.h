@@ -63,7 +63,9 @@
 #include <object_manipulation_tools/controller_utils/GraspPoseControllerHandler.h>
 #include <object_manipulation_tools/manipulation_utils/PlaceSequenceValidator.h>
 #include <perception_tools/segmentation/SphereSegmentation.h>
+#include <mantis_object_manipulation/utils/StageLatencyMonitor.h>
 #include <tf/transform_listener.h>
+#include <boost/thread/thread.hpp>
 
 typedef actionlib::SimpleActionClient<object_manipulation_msgs::GraspHandPostureExecutionAction>  GraspActionServerClient;
 
@@ -104,6 +106,7 @@ const std::string PARAM_NAME_MODEL_DATABASE_SERVICE = "model_database_service_na
 const std::string PARAM_NAME_PLANNING_SCENE_SERVICE = "planning_scene_service_name";
 const std::string PARAM_NAME_IK_PLUGING = "arm_inverse_kinematics_plugin";
 const std::string PARAM_NAME_JOINT_STATES_TOPIC = "joint_state_topic";
+const std::string PARAM_NAME_PIPELINED_CYCLE = "pipelined_cycle";
 
 class RobotPickPlaceNavigator
 {
@@ -276,6 +279,26 @@ public:
 		std::vector<double> SideAngles;
 	};
 
+	/*
+	 * Segmentation and recognition service responses, kept apart from the navigator state so that they can be
+	 * produced on a separate thread while the arm is still executing.
+	 */
+	struct PerceptionResults
+	{
+	public:
+		PerceptionResults()
+		:Succeeded(false)
+		{
+
+		}
+
+		bool Succeeded;
+		tabletop_object_detector::TabletopSegmentation::Response Segmentation;
+		tabletop_object_detector::TabletopObjectRecognition::Response Recognition;
+		household_objects_database_msgs::GetModelDescription::Response ModelDescription;
+		ros::WallDuration Duration;
+	};
+
 public:
 
 	enum ConfigurationFlags
@@ -336,6 +359,7 @@ protected:
 		bool attemptPlaceSequence(const std::string& group_name,const object_manipulator::PlaceExecutionInfo& pei);
 
 	// demo monitoring
+		void setupLatencyMonitor();
 		void startCycleTimer();
 		void printTiming();
 
@@ -370,6 +394,24 @@ protected:
 		bool performSegmentation();
 		bool performSphereSegmentation();// operates on the results produced by performSegmentation
 		bool performRecognition();// operates on the results produced by performSegmentation
+
+		/* Pipelined perception
+		 * With the "pipelined_cycle" parameter set, runFullPickPlace starts segmentation and recognition of the next
+		 * cycle on a background thread as soon as the arm reaches the place location, and picks the results up at the
+		 * start of the next cycle instead of calling the services again.
+		 */
+		bool callSegmentationService(tabletop_object_detector::TabletopSegmentation::Response &segmentation);
+		bool callRecognitionService(const tabletop_object_detector::Table &table,
+				const std::vector<sensor_msgs::PointCloud> &clusters,
+				tabletop_object_detector::TabletopObjectRecognition::Response &recognition,
+				household_objects_database_msgs::GetModelDescription::Response &description);
+		void storeSegmentationResults(const tabletop_object_detector::TabletopSegmentation::Response &segmentation);
+		void storeRecognitionResults(const tabletop_object_detector::TabletopObjectRecognition::Response &recognition,
+				const household_objects_database_msgs::GetModelDescription::Response &description);
+		void startBackgroundPerception();
+		void runBackgroundPerception();
+		bool applyBackgroundPerception(); // returns false when the results are missing or no longer match the scene
+		void discardBackgroundPerception();
 		bool performGraspPlanning();
 //		bool performPathPlanning();
 //		bool performTrajectoryFilter();
@@ -470,6 +512,15 @@ protected:
 	  ros::WallDuration motion_planning_duration_;
 	  ros::WallDuration trajectory_filtering_duration_;
 	  ros::WallDuration grasp_planning_duration_;
+	  ros::WallDuration overlapped_perception_duration_; // perception time hidden behind arm execution
+	  StageLatencyMonitor latency_monitor_;
+	  bool cycle_in_progress_;
+
+	  // pipelined perception
+	  bool pipelined_cycle_;
+	  boost::thread background_perception_thread_;
+	  bool background_perception_started_;
+	  PerceptionResults background_perception_;
 
 	  ros::Publisher attached_object_publisher_;
 
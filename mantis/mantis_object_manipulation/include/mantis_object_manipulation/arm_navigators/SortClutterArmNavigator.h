@@ -41,12 +41,14 @@ protected:
 	virtual bool moveArmThroughPlaceSequence();
 	virtual bool performPlaceGraspPlanning(); // place pose grasp planning that uses recognition data
 	virtual bool performPlaceGraspPlanning(GoalLocation &goal);
+	virtual void addLatencyStages();
 
 	// subclass methods
 	bool performGraspPlanningForSorting();
 	bool performGraspPlanningForClutter();
 	bool performGraspPlanningForSingulation();
 	void clearResultsFromLastSrvCall();
+	static std::string getTaskStageName(uint32_t taskCode);
 	bool moveArmThroughPickPlaceSequence();
 
 	// service callbacks
@@ -0,0 +1,58 @@
+/*
+ * SensorDataRedirect.h
+ *
+ *  Republishes the point clouds of an openni sensor under a different frame id, optionally throttled and
+ *  downsampled.  Used by both the sensor_data_redirect_node executable and the SensorDataRedirectNodelet.
+ */
+
+#ifndef SENSORDATAREDIRECT_H_
+#define SENSORDATAREDIRECT_H_
+
+#include <ros/ros.h>
+#include <sensor_msgs/PointCloud2.h>
+
+// list of ros parameter names
+static const std::string POINT_CLOUD2_FRAME_ID_PARAM = "point_cloud2_frame_id";
+static const std::string POINT_CLOUD2_THROTTLE_RATE_PARAM = "throttle_rate";
+static const std::string POINT_CLOUD2_DOWNSAMPLE_STEP_PARAM = "downsample_step";
+
+// topic names
+static const std::string POINT_CLOUD2_TOPIC_IN = "cloud_in";
+static const std::string POINT_CLOUD2_TOPIC_OUT = "cloud_out";
+
+class SensorDataRedirect
+{
+public:
+	SensorDataRedirect();
+	virtual ~SensorDataRedirect();
+
+	/*
+	 * Topics are resolved in nh and parameters are read from pnh, falling back to nh for the frame id
+	 */
+	void init(ros::NodeHandle &nh,ros::NodeHandle &pnh);
+
+	/*
+	 * The message is taken as non-const so that roscpp only copies it when another callback in this process needs
+	 * the original.  Re-stamping then touches the header alone and the same buffer is handed to the publisher,
+	 * which does not copy it for subscribers in the same process.
+	 */
+	void pointCloud2SubsCallback(const sensor_msgs::PointCloud2Ptr &msg);
+
+	/*
+	 * Keeps every step-th column and row of an organized cloud, or every step-th point of an unorganized one
+	 */
+	static void downsample(const sensor_msgs::PointCloud2 &cloudIn,int step,sensor_msgs::PointCloud2 &cloudOut);
+
+protected:
+
+	ros::Subscriber point_cloud2_subs_;
+	ros::Publisher point_cloud2_publ_;
+	ros::Time last_publish_stamp_;
+
+	// ros parameters
+	std::string point_cloud_2_frame_id_;
+	double throttle_rate_; // Hz, 0 republishes every cloud
+	int downsample_step_; // 1 republishes every point
+};
+
+#endif /* SENSORDATAREDIRECT_H_ */
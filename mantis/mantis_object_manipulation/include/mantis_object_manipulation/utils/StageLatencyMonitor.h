@@ -0,0 +1,165 @@
+/*
+ * StageLatencyMonitor.h
+ *
+ *  Per-stage latency histograms and success/failure counts for the arm navigators.
+ */
+
+#ifndef STAGELATENCYMONITOR_H_
+#define STAGELATENCYMONITOR_H_
+
+#include <ros/ros.h>
+#include <mantis_object_manipulation/LatencySummary.h>
+#include <boost/shared_ptr.hpp>
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// stage names shared by the navigators
+static const std::string STAGE_CYCLE = "cycle";
+static const std::string STAGE_SEGMENTATION = "segmentation";
+static const std::string STAGE_RECOGNITION = "recognition";
+static const std::string STAGE_PLANNING_SCENE = "planning_scene";
+static const std::string STAGE_MOTION_PLANNING = "motion_planning";
+static const std::string STAGE_TRAJECTORY_FILTERING = "trajectory_filtering";
+static const std::string STAGE_GRASP_PLANNING = "grasp_planning";
+static const std::string STAGE_EXECUTION = "execution";
+static const std::string STAGE_PICK = "pick";
+static const std::string STAGE_PLACE = "place";
+static const std::string STAGE_MOVE_TO_SIDE = "move_to_side";
+
+// ros param names, relative to the namespace passed to StageLatencyMonitor::start
+static const std::string PARAM_NAME_LATENCY_PUBLISH_PERIOD = "latency_publish_period";
+static const std::string PARAM_NAME_LATENCY_CSV_FILE = "latency_csv_file";
+static const std::string DEFAULT_LATENCY_TOPIC = "stage_latency";
+
+/*
+ * Log-linear histogram of durations in microseconds, in the manner of HdrHistogram.  Each power of two is split into
+ * 16 sub-buckets so that percentiles are within ~3% of the true value from 1 us up to ~19 hours.  Recording is a
+ * couple of atomic increments, so it can be called from any thread without locking.
+ */
+class LatencyHistogram
+{
+public:
+	static const int SUB_BUCKET_BITS = 4;
+	static const int MAX_EXPONENT = 36;
+	static const int NUM_BUCKETS = (2 << SUB_BUCKET_BITS) + (MAX_EXPONENT - SUB_BUCKET_BITS - 1)*(1 << SUB_BUCKET_BITS);
+
+	LatencyHistogram();
+
+	void record(uint64_t usecs);
+	void reset();
+
+	uint64_t getCount() const;
+	double getMean() const; // seconds
+	double getMax() const; // seconds
+	double getPercentile(double percentile) const; // seconds, percentile in [0,100]
+
+	// lowest value in microseconds that falls into the bucket
+	static uint64_t getBucketLowerBound(int bucket);
+	static int getBucketIndex(uint64_t usecs);
+
+protected:
+	volatile uint64_t counts_[NUM_BUCKETS];
+	volatile uint64_t total_count_;
+	volatile uint64_t total_usecs_;
+	volatile uint64_t max_usecs_;
+};
+
+/*
+ * Latency and outcome of each manipulation stage.
+ * Stages are registered by name before start() is called; from then on record() only reads the stage map, so the
+ * navigator and its action/service callback threads can record concurrently.  A summary of all stages is published
+ * periodically as a LatencySummary message and written to a csv file when the monitor is destroyed.
+ */
+class StageLatencyMonitor
+{
+public:
+
+	/*
+	 * Times a stage from construction to destruction, records a failure unless setSucceeded(true) was called
+	 */
+	class ScopedStage
+	{
+	public:
+		ScopedStage(StageLatencyMonitor &monitor,const std::string &stage)
+		:monitor_(monitor),
+		 stage_(stage),
+		 start_(ros::WallTime::now()),
+		 succeeded_(false)
+		{
+
+		}
+
+		~ScopedStage()
+		{
+			monitor_.record(stage_,ros::WallTime::now() - start_,succeeded_);
+		}
+
+		bool setSucceeded(bool succeeded)
+		{
+			succeeded_ = succeeded;
+			return succeeded;
+		}
+
+	protected:
+		StageLatencyMonitor &monitor_;
+		std::string stage_;
+		ros::WallTime start_;
+		bool succeeded_;
+	};
+
+public:
+	StageLatencyMonitor();
+	virtual ~StageLatencyMonitor();
+
+	void addStage(const std::string &stage);
+
+	// reads the publishing period and csv file name from the parameter server and starts publishing
+	void start(const std::string &nameSpace,const std::string &topic = DEFAULT_LATENCY_TOPIC);
+
+	void record(const std::string &stage,const ros::WallDuration &duration,bool succeeded);
+
+	// records the time elapsed since start and passes the outcome through
+	bool recordSince(const std::string &stage,const ros::WallTime &start,bool succeeded)
+	{
+		record(stage,ros::WallTime::now() - start,succeeded);
+		return succeeded;
+	}
+
+	void getSummary(mantis_object_manipulation::LatencySummary &summary) const;
+	bool writeCsv(const std::string &fileName) const;
+
+protected:
+
+	struct Stage
+	{
+		Stage()
+		:Successes(0),
+		 Failures(0)
+		{
+
+		}
+
+		LatencyHistogram Histogram;
+		volatile uint64_t Successes;
+		volatile uint64_t Failures;
+	};
+
+	void callbackPublishSummary(const ros::TimerEvent &evnt);
+
+protected:
+
+	std::map<std::string,boost::shared_ptr<Stage> > stages_;
+	std::vector<std::string> stage_order_; // registration order, used for reporting
+	bool started_;
+
+	ros::Publisher summary_pub_;
+	ros::Timer summary_timer_;
+
+	// ros parameters
+	double publish_period_;
+	std::string csv_file_;
+};
+
+#endif /* STAGELATENCYMONITOR_H_ */
@@ -16,6 +16,8 @@
 #include <arm_navigation_msgs/Shape.h>
 #include <arm_navigation_msgs/PlanningScene.h>
 #include <ros/ros.h>
+#include <boost/unordered_map.hpp>
+#include <algorithm>
 #include <typeinfo>
 
 // paramters used by the tabletop segmentation service
@@ -220,6 +222,137 @@ public:
 		std::string Tag;
 	};
 
+	/*
+	 * Uniform grid over the bounds of the objects placed in a zone.  Each object is registered in every cell
+	 * that its footprint touches so that an overlap query only tests the objects sharing a cell with the
+	 * query bounds instead of every object in the zone.
+	 */
+	struct ObjectGrid
+	{
+	public:
+
+		ObjectGrid(double cellSize = 0.05f)
+		:cell_size_(cellSize)
+		{
+
+		}
+
+		void setCellSize(double cellSize)
+		{
+			cell_size_ = (cellSize > 0.001f) ? cellSize : 0.001f;
+			std::vector<ZoneBounds> bounds;
+			bounds.swap(bounds_);
+			clear();
+			for(std::size_t i = 0; i < bounds.size(); i++)
+			{
+				insert(bounds[i]);
+			}
+		}
+
+		void insert(const ZoneBounds &bounds)
+		{
+			int index = (int)bounds_.size();
+			bounds_.push_back(bounds);
+
+			int xMin,xMax,yMin,yMax;
+			getCellRange(bounds,xMin,xMax,yMin,yMax);
+			for(int x = xMin; x <= xMax; x++)
+			{
+				for(int y = yMin; y <= yMax; y++)
+				{
+					cells_[CellKey(x,y)].push_back(index);
+				}
+			}
+		}
+
+		// objects always leave a zone in the reverse order in which they were added
+		void removeLast()
+		{
+			if(bounds_.empty())
+			{
+				return;
+			}
+
+			int index = (int)bounds_.size() - 1;
+			int xMin,xMax,yMin,yMax;
+			getCellRange(bounds_.back(),xMin,xMax,yMin,yMax);
+			for(int x = xMin; x <= xMax; x++)
+			{
+				for(int y = yMin; y <= yMax; y++)
+				{
+					CellMap::iterator cell = cells_.find(CellKey(x,y));
+					if(cell == cells_.end())
+					{
+						continue;
+					}
+
+					std::vector<int> &indices = cell->second;
+					indices.erase(std::remove(indices.begin(),indices.end(),index),indices.end());
+					if(indices.empty())
+					{
+						cells_.erase(cell);
+					}
+				}
+			}
+			bounds_.pop_back();
+		}
+
+		void clear()
+		{
+			bounds_.clear();
+			cells_.clear();
+		}
+
+		bool intersectsAny(const ZoneBounds &bounds) const
+		{
+			int xMin,xMax,yMin,yMax;
+			getCellRange(bounds,xMin,xMax,yMin,yMax);
+			for(int x = xMin; x <= xMax; x++)
+			{
+				for(int y = yMin; y <= yMax; y++)
+				{
+					CellMap::const_iterator cell = cells_.find(CellKey(x,y));
+					if(cell == cells_.end())
+					{
+						continue;
+					}
+
+					const std::vector<int> &indices = cell->second;
+					for(std::size_t i = 0; i < indices.size(); i++)
+					{
+						if(ZoneBounds::intersect(bounds,bounds_[indices[i]]))
+						{
+							return true;
+						}
+					}
+				}
+			}
+			return false;
+		}
+
+		std::size_t size() const
+		{
+			return bounds_.size();
+		}
+
+	protected:
+
+		typedef std::pair<int,int> CellKey;
+		typedef boost::unordered_map<CellKey,std::vector<int> > CellMap;
+
+		void getCellRange(const ZoneBounds &bounds,int &xMin,int &xMax,int &yMin,int &yMax) const
+		{
+			xMin = (int)std::floor(bounds.XMin/cell_size_);
+			xMax = (int)std::floor(bounds.XMax/cell_size_);
+			yMin = (int)std::floor(bounds.YMin/cell_size_);
+			yMax = (int)std::floor(bounds.YMax/cell_size_);
+		}
+
+		double cell_size_;
+		std::vector<ZoneBounds> bounds_;
+		CellMap cells_;
+	};
+
 	struct PlaceZone : public ZoneBounds
 	{
 	public:
@@ -240,6 +373,7 @@ public:
 		 ReleaseDistanceFromTable(0.02),// 2cm
 		 MinObjectSpacing(0.05f),
 		 MaxObjectSpacing(0.08f),
+		 UseObjectGrid(true),
 		 objects_in_zone_()
 		{
 			srand(time(NULL));
@@ -252,6 +386,7 @@ public:
 		 ReleaseDistanceFromTable(0.02),// 2cm
 		 MinObjectSpacing(0.05f),
 		 MaxObjectSpacing(0.08f),
+		 UseObjectGrid(true),
 		 objects_in_zone_()
 		{
 
@@ -319,9 +454,17 @@ public:
 
 		void removeLastObjectAdded()
 		{
+			if(objects_in_zone_.empty())
+			{
+				return;
+			}
 			objects_in_zone_.pop_back();
+			object_grid_.removeLast();
 		}
 
+		// true when the bounds overlap any object already placed in this zone
+		bool overlapsObjectInZone(const ZoneBounds &bounds) const;
+
 		bool isIdInZone(int i);
 
 		bool generateNextLocationCandidates(std::vector<geometry_msgs::PoseStamped> &placePoses,std::vector<PlaceZone* > &otherZones);
@@ -386,6 +529,7 @@ public:
 		double MaxObjectSpacing; // maximum distance between two objects inside goal region as measured from their local origin
 		int NextLocationGenMode; // one of the supported enumeration values that determines how to generate the next location
 		std::vector<int> Ids; // Array of object id's allowed in this zone
+		bool UseObjectGrid; // look up overlaps in the object grid instead of testing every object in the zone
 
 	protected:
 
@@ -400,10 +544,14 @@ public:
 		bool generateNextPlacePoseInCircle(std::vector<geometry_msgs::PoseStamped> &placePoses,std::vector<PlaceZone* > &otherZones);
 
 		// check overlaps with object in theses zones.
-		bool checkOverlaps(ZoneBounds &nextObjBounds,std::vector<PlaceZone* > zones);
+		bool checkOverlaps(const ZoneBounds &nextObjBounds,const std::vector<PlaceZone* > &zones) const;
+
+		// stores the object in the zone and in its grid
+		void addObjectToZone(const ObjectDetails &obj);
 
 		// general zone member
 		std::vector<ObjectDetails> objects_in_zone_; // array of transforms and size for each object in zone
+		ObjectGrid object_grid_; // same objects as objects_in_zone_, binned by location
 		ObjectDetails next_object_details_;
 
 		// grid mode members
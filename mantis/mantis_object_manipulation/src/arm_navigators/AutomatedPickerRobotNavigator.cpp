@@ -11,6 +11,8 @@
 #include <mantis_object_manipulation/arm_navigators/AutomatedPickerRobotNavigator.h>
 #include <mantis_perception/mantis_recognition.h>
 #include <boost/foreach.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
 #include <algorithm>
 
 std::string AutomatedPickerRobotNavigator::MARKER_SEGMENTED_OBJECT = "segmented_obj";
@@ -28,7 +30,9 @@ AutomatedPickerRobotNavigator::AutomatedPickerRobotNavigator()
  num_of_grasp_attempts_(4),
  offset_from_first_grasp_(0.01f), //1 cm
  attached_obj_bb_side_(0.1f),
- recovery_retreat_distance_(0.05f)
+ recovery_retreat_distance_(0.05f),
+ place_ik_threads_(0),
+ place_ik_candidate_(-1)
 {
 	// TODO Auto-generated constructor stub
 	GOAL_NAMESPACE = NODE_NAME + "/" + GOAL_NAMESPACE;
@@ -143,6 +147,12 @@ void AutomatedPickerRobotNavigator::setup()
 		updateMarkerArrayMsg();
 	}
 
+	ROS_INFO_STREAM(NODE_NAME<<": Setting up latency monitor");
+	{
+		addLatencyStages();
+		latency_monitor_.start(NAVIGATOR_NAMESPACE);
+	}
+
 	ROS_INFO_STREAM(NODE_NAME<<" Setting up grasp planning data");
 	{
 		// storing grasp pickup goal to be used later during pick move sequence execution
@@ -182,6 +192,19 @@ void AutomatedPickerRobotNavigator::fetchParameters(std::string nameSpace)
 			offset_from_first_grasp_);
 	ros::param::param(nameSpace + "/" + PARAM_NAME_NEW_GRASP_RETREAT_DISTANCE,recovery_retreat_distance_,
 			recovery_retreat_distance_);
+	ros::param::param(nameSpace + "/" + PARAM_NAME_PLACE_IK_THREADS,place_ik_threads_,
+			place_ik_threads_);
+}
+
+void AutomatedPickerRobotNavigator::addLatencyStages()
+{
+	latency_monitor_.addStage(STAGE_CYCLE);
+	latency_monitor_.addStage(STAGE_SEGMENTATION);
+	latency_monitor_.addStage(STAGE_RECOGNITION);
+	latency_monitor_.addStage(STAGE_GRASP_PLANNING);
+	latency_monitor_.addStage(STAGE_PICK);
+	latency_monitor_.addStage(STAGE_PLACE);
+	latency_monitor_.addStage(STAGE_MOVE_TO_SIDE);
 }
 
 void AutomatedPickerRobotNavigator::run()
@@ -202,8 +225,12 @@ void AutomatedPickerRobotNavigator::run()
 	{
 	    startCycleTimer();
 
+	    // a cycle left through any of the continue statements below is recorded as failed
+	    StageLatencyMonitor::ScopedStage cycle(latency_monitor_,STAGE_CYCLE);
+	    ros::WallTime stage_start = ros::WallTime::now();
+
 		ROS_INFO_STREAM(NODE_NAME + ": Segmentation stage started");
-		if(!performSegmentation())
+		if(!latency_monitor_.recordSince(STAGE_SEGMENTATION,stage_start,performSegmentation()))
 		{
 		  ROS_WARN_STREAM(NODE_NAME<<": Segmentation stage failed");
 		  continue;
@@ -211,7 +238,8 @@ void AutomatedPickerRobotNavigator::run()
 		ROS_INFO_STREAM(NODE_NAME << " Segmentation stage completed");
 
 		ROS_INFO_STREAM(NODE_NAME << ": Recognition stage started");
-		if(!performRecognition())
+		stage_start = ros::WallTime::now();
+		if(!latency_monitor_.recordSince(STAGE_RECOGNITION,stage_start,performRecognition()))
 		{
 			ROS_WARN_STREAM(NODE_NAME << ": Recognition stage failed");
 			continue;
@@ -222,7 +250,8 @@ void AutomatedPickerRobotNavigator::run()
 		}
 
 		ROS_INFO_STREAM(NODE_NAME << ": Grasp Planning stage started");
-		if(!performGraspPlanning())
+		stage_start = ros::WallTime::now();
+		if(!latency_monitor_.recordSince(STAGE_GRASP_PLANNING,stage_start,performGraspPlanning()))
 		{
 			//zone_selector_.removeLastObjectAdded();
 			ROS_ERROR_STREAM(NODE_NAME<<": Grasp Planning stage failed");
@@ -234,7 +263,8 @@ void AutomatedPickerRobotNavigator::run()
 		}
 
 		ROS_INFO_STREAM(NODE_NAME << ": Grasp Pickup stage started");
-		if(!moveArmThroughPickSequence())
+		stage_start = ros::WallTime::now();
+		if(!latency_monitor_.recordSince(STAGE_PICK,stage_start,moveArmThroughPickSequence()))
 		{
 		  ROS_WARN_STREAM(NODE_NAME << ": Grasp Pickup stage failed");
 		  moveArmToSide();
@@ -246,7 +276,8 @@ void AutomatedPickerRobotNavigator::run()
 		}
 
 		ROS_INFO_STREAM(NODE_NAME + ": Grasp Place stage started");
-		if(!moveArmThroughPlaceSequence())
+		stage_start = ros::WallTime::now();
+		if(!latency_monitor_.recordSince(STAGE_PLACE,stage_start,moveArmThroughPlaceSequence()))
 		{
 			ROS_WARN_STREAM(NODE_NAME << ": Grasp Place stage failed");
 			moveArmToSide();
@@ -257,11 +288,13 @@ void AutomatedPickerRobotNavigator::run()
 			ROS_INFO_STREAM(NODE_NAME << ": Grasp Place stage completed");
 		}
 
-		if(!moveArmToSide())
+		stage_start = ros::WallTime::now();
+		if(!latency_monitor_.recordSince(STAGE_MOVE_TO_SIDE,stage_start,moveArmToSide()))
 		{
 			ROS_WARN_STREAM(NODE_NAME << ": Side moved failed");
 		}
 
+	    cycle.setSucceeded(true);
 	    printTiming();
 	  }
 }
@@ -782,8 +815,109 @@ bool AutomatedPickerRobotNavigator::moveArmThroughPlaceSequence()
 	return true;
 }
 
+void AutomatedPickerRobotNavigator::setupPlaceIkSolvers()
+{
+	int numThreads = place_ik_threads_ > 0 ? place_ik_threads_ : boost::thread::hardware_concurrency();
+	kinematics_loader_.reset(new pluginlib::ClassLoader<kinematics::KinematicsBase>("kinematics_base","kinematics::KinematicsBase"));
+	for(int i = 0; i < numThreads; i++)
+	{
+		boost::shared_ptr<kinematics::KinematicsBase> plugin;
+		try
+		{
+			plugin.reset(kinematics_loader_->createClassInstance(ik_plugin_name_));
+		}
+		catch(pluginlib::PluginlibException &e)
+		{
+			ROS_ERROR_STREAM(NODE_NAME<<": Could not load ik plugin "<<ik_plugin_name_<<" for place ik thread "<<i<<": "<<e.what());
+			break;
+		}
+
+		boost::shared_ptr<arm_kinematics_constraint_aware::ArmKinematicsSolverConstraintAware> solver(
+				new arm_kinematics_constraint_aware::ArmKinematicsSolverConstraintAware(plugin.get(),&cm_,arm_group_name_));
+		if(!solver->isActive())
+		{
+			ROS_ERROR_STREAM(NODE_NAME<<": Ik solver for place ik thread "<<i<<" failed to initialize");
+			break;
+		}
+
+		place_ik_plugins_.push_back(plugin);
+		place_ik_solvers_.push_back(solver);
+	}
+
+	ROS_INFO_STREAM(NODE_NAME<<": Place ik feasibility will run on "<<std::max<std::size_t>(place_ik_solvers_.size(),1)<<" threads");
+}
+
+void AutomatedPickerRobotNavigator::solvePlaceIkProblems(PlaceIkWorker *worker,PlaceIkSweep *sweep)
+{
+	const std::size_t posesPerCandidate = sweep->WristPoses.empty() ? 0 : sweep->WristPoses[0].size();
+	const std::size_t numProblems = sweep->WristPoses.size() * posesPerCandidate;
+	sensor_msgs::JointState jointSolution;
+	arm_navigation_msgs::ArmNavigationErrorCodes errorCode;
+
+	while(true)
+	{
+		// problems are handed out candidate by candidate, skipping candidates that already failed
+		// or that come after a candidate known to be feasible
+		std::size_t candidate = 0, pose = 0;
+		bool found = false;
+		{
+			boost::mutex::scoped_lock lock(sweep->Mutex);
+			while(!found && sweep->NextProblem < numProblems)
+			{
+				candidate = sweep->NextProblem / posesPerCandidate;
+				pose = sweep->NextProblem % posesPerCandidate;
+				sweep->NextProblem++;
+				found = sweep->Solved[candidate] >= 0 &&
+						(sweep->BestCandidate < 0 || (int)candidate < sweep->BestCandidate);
+			}
+		}
+
+		if(!found)
+		{
+			break;
+		}
+
+		bool solved = worker->IkSolver->getPositionIK(sweep->WristPoses[candidate][pose],
+				worker->State.get(),jointSolution,errorCode);
+
+		boost::mutex::scoped_lock lock(sweep->Mutex);
+		if(sweep->Solved[candidate] < 0)
+		{
+			continue;
+		}
+
+		if(!solved)
+		{
+			sweep->Solved[candidate] = -1;
+			sweep->FailedPose[candidate] = pose;
+			sweep->ErrorCodes[candidate] = errorCode.val;
+			continue;
+		}
+
+		if(pose == 0)
+		{
+			sweep->PlaceSolutions[candidate] = jointSolution;
+		}
+
+		sweep->Solved[candidate]++;
+		if(sweep->Solved[candidate] == (int)posesPerCandidate &&
+				(sweep->BestCandidate < 0 || (int)candidate < sweep->BestCandidate))
+		{
+			sweep->BestCandidate = candidate;
+		}
+	}
+}
+
 bool AutomatedPickerRobotNavigator::findIkSolutionForPlacePoses()
 {
+	// the per thread solvers are only loaded once a sweep is actually requested
+	if(!kinematics_loader_)
+	{
+		setupPlaceIkSolvers();
+	}
+
+	ros::WallTime start_time = ros::WallTime::now();
+
 	// obtaining model id string
 	household_objects_database_msgs::DatabaseModelPose &modelPose = recognized_models_[0].model_list[0];
 	std::string modelId = makeCollisionObjectNameFromModelId(modelPose.model_id);
@@ -792,12 +926,7 @@ bool AutomatedPickerRobotNavigator::findIkSolutionForPlacePoses()
 	tf::StampedTransform world_in_base_tf;
 	tf::Transform wrist_in_object_tf, object_in_world_tf;
 	tf::Transform wrist_in_base_tf;
-	geometry_msgs::Pose wrist_in_base_pose;
-
-	// declaring argument and result variables
-	sensor_msgs::JointState jointSolution;
-	arm_navigation_msgs::ArmNavigationErrorCodes errorCode;
-	arm_navigation_msgs::Constraints emp;
+	tf::Transform interpolated_tf;
 	int num_via_points = 10;
 	double retreat_increment = grasp_place_goal_.approach.desired_distance/num_via_points;
 	tf::Vector3 retreat_direction; tf::vector3MsgToTF(grasp_place_goal_.approach.direction.vector,retreat_direction);
@@ -811,61 +940,78 @@ bool AutomatedPickerRobotNavigator::findIkSolutionForPlacePoses()
 	// conversion from pose to tf
 	tf::poseMsgToTF(candidate_place_poses_[0].pose,object_in_world_tf);
 
-
 	//updateCurrentJointStateToLastTrajectoryPoint(last_trajectory_execution_data_vector_[0].recorded_trajectory_);
 
+	// generating the place pose and the interpolated retreat via points of every grasp candidate
+	// (see PlaceSequenceValidator.cpp 335)
+	PlaceIkSweep sweep;
+	sweep.WristPoses.resize(grasp_candidates_.size(),std::vector<geometry_msgs::Pose>(num_via_points + 1));
+	sweep.Solved.assign(grasp_candidates_.size(),0);
+	sweep.FailedPose.assign(grasp_candidates_.size(),-1);
+	sweep.ErrorCodes.assign(grasp_candidates_.size(),0);
+	sweep.PlaceSolutions.resize(grasp_candidates_.size());
+	sweep.NextProblem = 0;
+	sweep.BestCandidate = -1;
 	for(std::size_t i = 0; i < grasp_candidates_.size(); i++)
 	{
 		tf::poseMsgToTF(grasp_candidates_[i].grasp_pose,wrist_in_object_tf);
-		wrist_in_base_tf = world_in_base_tf*object_in_world_tf*wrist_in_object_tf;
-		tf::poseTFToMsg(wrist_in_base_tf,wrist_in_base_pose);
-
-		//adjusting planning scene state for pre-grasp
-		std::map<std::string, double> pre_grasp_values;
-//		for(unsigned int j = 0; j < grasp_candidates_[i].pre_grasp_posture.name.size(); j++)
-//		{
-//			pre_grasp_values[grasp_candidates_[i].pre_grasp_posture.name[j]] = grasp_candidates_[i].pre_grasp_posture.position[j];
-//		}
-		current_robot_state_->setKinematicState(pre_grasp_values);
-
-		if(place_tester_->getIkSolverMap()[arm_group_name_]->getPositionIK(wrist_in_base_pose,
-				current_robot_state_,jointSolution,errorCode))
-		{
-			ROS_INFO_STREAM(NODE_NAME<<": Ik solution for place location found, will test via points to pregrasp");
-
-			// checking interpolated trajectory (see PlaceSequenceValidator.cpp 335)
-			//place_tester_->getIkSolverMap()[arm_group_name_]->getinterpolateIKDirectional();
-			tf::Transform interpolated_tf;
-			bool all_pass = true;
-			for(int j = 1; j <= num_via_points; j++)
-			{
-				// applying incremental translation transform
-				interpolated_tf = tf::Transform(tf::Quaternion::getIdentity(),retreat_direction*(retreat_increment * j));
-				wrist_in_base_tf = world_in_base_tf*(object_in_world_tf * interpolated_tf)*wrist_in_object_tf;
-
-				tf::poseTFToMsg(wrist_in_base_tf,wrist_in_base_pose);
-				if(!place_tester_->getIkSolverMap()[arm_group_name_]->getPositionIK(wrist_in_base_pose,
-								current_robot_state_,jointSolution,errorCode))
-				{
-					ROS_ERROR_STREAM(NODE_NAME<<" Ik solution for interpolated pose not found");
-					all_pass = false;
-					break;
-				}
-			}
+		for(int j = 0; j <= num_via_points; j++)
+		{
+			// applying incremental translation transform
+			interpolated_tf = tf::Transform(tf::Quaternion::getIdentity(),retreat_direction*(retreat_increment * j));
+			wrist_in_base_tf = world_in_base_tf*(object_in_world_tf * interpolated_tf)*wrist_in_object_tf;
+			tf::poseTFToMsg(wrist_in_base_tf,sweep.WristPoses[i][j]);
+		}
+	}
 
-			if(all_pass)
-			{
-				return true;
-			}
+	// every worker seeds its solver from its own copy of the current state, all copies are equal so the
+	// outcome does not depend on which thread solves which pose
+	std::vector<PlaceIkWorker> workers(std::max<std::size_t>(place_ik_solvers_.size(),1));
+	for(std::size_t i = 0; i < workers.size(); i++)
+	{
+		workers[i].IkSolver = place_ik_solvers_.empty() ? place_tester_->getIkSolverMap()[arm_group_name_]
+				: place_ik_solvers_[i].get();
+		workers[i].State.reset(new planning_models::KinematicState(*current_robot_state_));
+	}
+
+	boost::thread_group threads;
+	for(std::size_t i = 1; i < workers.size(); i++)
+	{
+		threads.create_thread(boost::bind(&AutomatedPickerRobotNavigator::solvePlaceIkProblems,this,&workers[i],&sweep));
+	}
+	solvePlaceIkProblems(&workers[0],&sweep);
+	threads.join_all();
 
+	// reporting in candidate order up to the one picked
+	std::size_t lastReported = sweep.BestCandidate < 0 ? grasp_candidates_.size() : sweep.BestCandidate;
+	for(std::size_t i = 0; i < lastReported; i++)
+	{
+		if(sweep.FailedPose[i] == 0)
+		{
+			ROS_ERROR_STREAM(NODE_NAME<<": Ik solution for place location of grasp candidate "<<i<<" not found, error code "
+					<<sweep.ErrorCodes[i]);
 		}
-		else
+		else if(sweep.FailedPose[i] > 0)
 		{
-			ROS_ERROR_STREAM(NODE_NAME<<": Ik solution for place location not found, error code "<<errorCode.val);
+			ROS_ERROR_STREAM(NODE_NAME<<" Ik solution for interpolated pose "<<sweep.FailedPose[i]<<" of grasp candidate "
+					<<i<<" not found");
 		}
+	}
 
+	place_ik_candidate_ = sweep.BestCandidate;
+	ros::WallDuration sweep_duration = ros::WallTime::now()-start_time;
+	grasp_planning_duration_ += sweep_duration;
+	ROS_INFO_STREAM(NODE_NAME<<": Place ik sweep over "<<grasp_candidates_.size()<<" candidates on "<<workers.size()
+			<<" threads took "<<sweep_duration.toSec());
+
+	if(sweep.BestCandidate < 0)
+	{
+		return false;
 	}
-	return false;
+
+	ROS_INFO_STREAM(NODE_NAME<<": Ik solutions for place location and via points found for grasp candidate "<<sweep.BestCandidate);
+	place_ik_solution_ = sweep.PlaceSolutions[sweep.BestCandidate];
+	return true;
 }
 
 bool AutomatedPickerRobotNavigator::createCandidateGoalPoses(std::vector<geometry_msgs::PoseStamped> &placePoses)
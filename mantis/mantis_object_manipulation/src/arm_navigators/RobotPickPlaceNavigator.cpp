@@ -75,12 +75,16 @@ void RobotPickPlaceNavigator::fetchParameters(std::string nameSpace)
 	ros::param::param(nameSpace + "/" + PARAM_NAME_PLANNING_SCENE_SERVICE,planning_scene_service_,DEFAULT_PLANNING_SCENE_SERVICE);
 	ros::param::param(nameSpace + "/" + PARAM_NAME_IK_PLUGING,ik_plugin_name_,DEFAULT_IK_PLUGING);
 	ros::param::param(nameSpace + "/" + PARAM_NAME_JOINT_STATES_TOPIC,joint_states_topic_,DEFAULT_JOINT_STATES_TOPIC);
+	ros::param::param(nameSpace + "/" + PARAM_NAME_PIPELINED_CYCLE,pipelined_cycle_,false);
 }
 
 RobotPickPlaceNavigator::RobotPickPlaceNavigator(ConfigurationFlags flag)
 :configuration_type_(flag),
  cm_("robot_description"),
- current_robot_state_(NULL)
+ current_robot_state_(NULL),
+ pipelined_cycle_(false),
+ background_perception_started_(false),
+ cycle_in_progress_(false)
 {
 	ros::NodeHandle nh;
 
@@ -94,7 +98,7 @@ RobotPickPlaceNavigator::RobotPickPlaceNavigator(ConfigurationFlags flag)
 
 RobotPickPlaceNavigator::~RobotPickPlaceNavigator()
 {
-	// TODO Auto-generated destructor stub
+	discardBackgroundPerception();
 }
 
 void RobotPickPlaceNavigator::setup()
@@ -206,6 +210,8 @@ void RobotPickPlaceNavigator::setup()
 		marker.id = 0; MarkerMap.insert(std::make_pair(MARKER_SEGMENTED_OBJ,marker));
 		marker.id = 1; MarkerMap.insert(std::make_pair(MARKER_ATTACHED_OBJ,marker));
 	}
+
+	setupLatencyMonitor();
 }
 
 void RobotPickPlaceNavigator::setupBallPickingDemo()
@@ -299,6 +305,8 @@ void RobotPickPlaceNavigator::setupBallPickingDemo()
 		marker.id = 0; MarkerMap.insert(std::make_pair(MARKER_SEGMENTED_OBJ,marker));
 		marker.id = 1; MarkerMap.insert(std::make_pair(MARKER_ATTACHED_OBJ,marker));
 	}
+
+	setupLatencyMonitor();
 }
 
 void RobotPickPlaceNavigator::setupRecognitionOnly()
@@ -388,6 +396,7 @@ void RobotPickPlaceNavigator::updateCurrentJointStateToLastTrajectoryPoint(const
 
 bool RobotPickPlaceNavigator::getAndSetPlanningScene()
 {
+  StageLatencyMonitor::ScopedStage stage(latency_monitor_,STAGE_PLANNING_SCENE);
   ros::WallTime start_time = ros::WallTime::now();
   arm_navigation_msgs::SetPlanningSceneDiff::Request planning_scene_req;
   arm_navigation_msgs::SetPlanningSceneDiff::Response planning_scene_res;
@@ -417,7 +426,7 @@ bool RobotPickPlaceNavigator::getAndSetPlanningScene()
   current_planning_scene_.robot_state.joint_state.header.stamp = ros::Time(ros::WallTime::now().toSec());
   ROS_INFO_STREAM(NODE_NAME<<": Setting took " << (ros::WallTime::now()-start_time).toSec());
   planning_scene_duration_ += ros::WallTime::now()-start_time;
-  return true;
+  return stage.setSucceeded(true);
 }
 
 bool RobotPickPlaceNavigator::moveArm(const std::string& group_name,const std::vector<double>& joint_positions)
@@ -451,16 +460,19 @@ bool RobotPickPlaceNavigator::moveArm(const std::string& group_name,const std::v
   if(!planning_service_client_.call(plan_req, plan_res))
   {
     ROS_WARN_STREAM(NODE_NAME<<": Planner service call failed");
+    latency_monitor_.record(STAGE_MOTION_PLANNING,ros::WallTime::now()-start_time,false);
     return false;
   }
 
   if(plan_res.error_code.val != plan_res.error_code.SUCCESS)
   {
     ROS_WARN_STREAM(NODE_NAME<<": Planner failed");
+    latency_monitor_.record(STAGE_MOTION_PLANNING,ros::WallTime::now()-start_time,false);
     return false;
   }
 
   motion_planning_duration_ += ros::WallTime::now()-start_time;
+  latency_monitor_.record(STAGE_MOTION_PLANNING,ros::WallTime::now()-start_time,true);
   start_time = ros::WallTime::now();
 
   last_mpr_id_ = max_mpr_id_;
@@ -478,14 +490,17 @@ bool RobotPickPlaceNavigator::moveArm(const std::string& group_name,const std::v
 
   if(!trajectory_filter_service_client_.call(filter_req, filter_res)) {
     ROS_WARN_STREAM(NODE_NAME<<": Filter service call failed");
+    latency_monitor_.record(STAGE_TRAJECTORY_FILTERING,ros::WallTime::now()-start_time,false);
     return false;
   }
 
   if(filter_res.error_code.val != filter_res.error_code.SUCCESS) {
     ROS_WARN_STREAM(NODE_NAME<<": Filter failed");
+    latency_monitor_.record(STAGE_TRAJECTORY_FILTERING,ros::WallTime::now()-start_time,false);
     return false;
   }
   trajectory_filtering_duration_ += ros::WallTime::now()-start_time;
+  latency_monitor_.record(STAGE_TRAJECTORY_FILTERING,ros::WallTime::now()-start_time,true);
 
   // requesting trajectory execution action
   trajectories_succeeded_ = false;
@@ -508,6 +523,7 @@ bool RobotPickPlaceNavigator::moveArm(const std::string& group_name,const std::v
   boost::unique_lock<boost::mutex> lock(execution_mutex_);
   execution_completed_.wait(lock);
   execution_duration_ += (ros::WallTime::now()-start_execution);
+  latency_monitor_.record(STAGE_EXECUTION,ros::WallTime::now()-start_execution,trajectories_succeeded_);
 
   arm_navigation_msgs::ArmNavigationErrorCodes error_code;
   if(trajectories_succeeded_)
@@ -748,6 +764,26 @@ bool RobotPickPlaceNavigator::performSegmentation()
 	planning_scene_diff_.collision_objects.clear();
 	recognized_obj_pose_map_.clear();
 
+	//  ===================================== calling service =====================================
+	tabletop_object_detector::TabletopSegmentation::Response segmentation;
+	bool success = callSegmentationService(segmentation);
+	perception_duration_ += ros::WallTime::now()-start;
+	if(!success)
+	{
+		return false;
+	}
+
+	//  ===================================== storing results =====================================
+	storeSegmentationResults(segmentation);
+	return true;
+}
+
+bool RobotPickPlaceNavigator::callSegmentationService(tabletop_object_detector::TabletopSegmentation::Response &segmentation)
+{
+	//  ===================================== saving current time stamp =====================================
+	StageLatencyMonitor::ScopedStage stage(latency_monitor_,STAGE_SEGMENTATION);
+	ros::WallTime start  = ros::WallTime::now();
+
 	//  ===================================== calling service =====================================
 	tabletop_object_detector::TabletopSegmentation segmentation_srv;
 	bool success = seg_srv_.call(segmentation_srv);
@@ -775,17 +811,21 @@ bool RobotPickPlaceNavigator::performSegmentation()
 		return false;
 	}
 
+	segmentation = segmentation_srv.response;
+	return stage.setSucceeded(true);
+}
+
+void RobotPickPlaceNavigator::storeSegmentationResults(const tabletop_object_detector::TabletopSegmentation::Response &segmentation)
+{
 	//  ===================================== storing results =====================================
-	segmentation_results_ = segmentation_srv.response;
-	segmented_clusters_ = segmentation_srv.response.clusters;
+	segmentation_results_ = segmentation;
+	segmented_clusters_ = segmentation.clusters;
 
 	//  ===================================== updating local planning scene =====================================
-	addDetectedTableToPlanningSceneDiff(segmentation_srv.response.table);
+	addDetectedTableToPlanningSceneDiff(segmentation.table);
 
 	// ===================================== printing completion info message =====================================
-	ROS_INFO_STREAM(NODE_NAME<<": Segmentation service succeeded. Detected "<<(int)segmentation_srv.response.clusters.size()<<" clusters");
-
-	return true;
+	ROS_INFO_STREAM(NODE_NAME<<": Segmentation service succeeded. Detected "<<(int)segmentation.clusters.size()<<" clusters");
 }
 
 bool RobotPickPlaceNavigator::performSphereSegmentation()
@@ -871,10 +911,34 @@ bool RobotPickPlaceNavigator::performRecognition()
 	planning_scene_diff_.collision_objects.clear();
 	recognized_obj_pose_map_.clear();
 
+	//  ===================================== calling service =====================================
+	tabletop_object_detector::TabletopObjectRecognition::Response recognition;
+	household_objects_database_msgs::GetModelDescription::Response description;
+	bool success = callRecognitionService(segmentation_results_.table,segmented_clusters_,recognition,description);
+	perception_duration_ += ros::WallTime::now()-start;
+	if(!success)
+	{
+		return false;
+	}
+
+	//  ===================================== storing results =====================================
+	storeRecognitionResults(recognition,description);
+    ROS_INFO_STREAM(NODE_NAME<<": Recognition took " << (ros::WallTime::now()-start));
+
+	return true;
+}
+
+bool RobotPickPlaceNavigator::callRecognitionService(const tabletop_object_detector::Table &table,
+		const std::vector<sensor_msgs::PointCloud> &clusters,
+		tabletop_object_detector::TabletopObjectRecognition::Response &recognition,
+		household_objects_database_msgs::GetModelDescription::Response &description)
+{
+	StageLatencyMonitor::ScopedStage stage(latency_monitor_,STAGE_RECOGNITION);
+
 	//  ===================================== calling service =====================================
 	tabletop_object_detector::TabletopObjectRecognition recognition_srv;
-	recognition_srv.request.table = segmentation_results_.table;
-	recognition_srv.request.clusters = segmented_clusters_;
+	recognition_srv.request.table = table;
+	recognition_srv.request.clusters = clusters;
 	recognition_srv.request.num_models = 1;
 	recognition_srv.request.perform_fit_merge = false;
 
@@ -893,14 +957,10 @@ bool RobotPickPlaceNavigator::performRecognition()
     	return false;
     }
 
-	//  ===================================== storing results =====================================
-    recognized_models_ = recognition_srv.response.models;
-
-
     //  ===================================== calling service =====================================
     household_objects_database_msgs::GetModelDescription::Request des_req;
     household_objects_database_msgs::GetModelDescription::Response des_res;
-    des_req.model_id = recognized_models_[0].model_list[0].model_id;
+    des_req.model_id = recognition_srv.response.models[0].model_list[0].model_id;
 
     success = object_database_model_description_client_.call(des_req, des_res);
 
@@ -920,19 +980,26 @@ bool RobotPickPlaceNavigator::performRecognition()
 		return false;
 	}
 
+	recognition = recognition_srv.response;
+	description = des_res;
+	return stage.setSucceeded(true);
+}
+
+void RobotPickPlaceNavigator::storeRecognitionResults(const tabletop_object_detector::TabletopObjectRecognition::Response &recognition,
+		const household_objects_database_msgs::GetModelDescription::Response &description)
+{
 	//  ===================================== storing results =====================================
-	recognized_model_description_ = des_res;
+    recognized_models_ = recognition.models;
+	recognized_model_description_ = description;
 
 	//  ===================================== updating local planning scene =====================================
-    addDetectedObjectToPlanningSceneDiff(recognition_srv.response.models[0]);
+    addDetectedObjectToPlanningSceneDiff(recognition.models[0]);
 
 	// ===================================== printing completion info message =====================================
-    ROS_INFO_STREAM(NODE_NAME<<": Recognition took " << (ros::WallTime::now()-start));
-    ROS_INFO_STREAM(NODE_NAME<<": Got " << recognition_srv.response.models.size() << " models");
-    recognized_models_ = recognition_srv.response.models;
+    ROS_INFO_STREAM(NODE_NAME<<": Got " << recognition.models.size() << " models");
 	std::stringstream stdout;
 	stdout<<"\nRetrieved models:";
-    BOOST_FOREACH(household_objects_database_msgs::DatabaseModelPose model,recognition_srv.response.models[0].model_list)
+    BOOST_FOREACH(household_objects_database_msgs::DatabaseModelPose model,recognition.models[0].model_list)
     {
     	stdout<<"\n\tModel id: "<<model.model_id;
     	stdout<<"\n\tPose frame id: "<<model.pose.header.frame_id;
@@ -940,11 +1007,102 @@ bool RobotPickPlaceNavigator::performRecognition()
     	stdout<<"\n";
     }
     ROS_INFO_STREAM(stdout.str());
-    ROS_INFO_STREAM(NODE_NAME<<" model database service returned description with name: "<<des_res.name);
+    ROS_INFO_STREAM(NODE_NAME<<" model database service returned description with name: "<<description.name);
+}
+
+void RobotPickPlaceNavigator::startBackgroundPerception()
+{
+	if(!pipelined_cycle_ || configuration_type_ != SETUP_FULL || background_perception_started_)
+	{
+		return;
+	}
+
+	ROS_INFO_STREAM(NODE_NAME<<": Starting segmentation and recognition for the next cycle");
+	background_perception_ = PerceptionResults();
+	background_perception_thread_ = boost::thread(boost::bind(&RobotPickPlaceNavigator::runBackgroundPerception,this));
+	background_perception_started_ = true;
+}
+
+void RobotPickPlaceNavigator::runBackgroundPerception()
+{
+	// only the service clients are used here, the results are stored by applyBackgroundPerception on the main thread
+	ros::WallTime start = ros::WallTime::now();
+	PerceptionResults &results = background_perception_;
+	results.Succeeded = callSegmentationService(results.Segmentation) &&
+			callRecognitionService(results.Segmentation.table,results.Segmentation.clusters,
+					results.Recognition,results.ModelDescription);
+	results.Duration = ros::WallTime::now()-start;
+}
+
+bool RobotPickPlaceNavigator::applyBackgroundPerception()
+{
+	if(!background_perception_started_)
+	{
+		return false;
+	}
+
+	// any time spent waiting here was not hidden behind the arm execution
+	ros::WallTime start_wait = ros::WallTime::now();
+	background_perception_thread_.join();
+	background_perception_started_ = false;
+	ros::WallDuration wait = ros::WallTime::now()-start_wait;
+
+	const PerceptionResults &results = background_perception_;
+	perception_duration_ += results.Duration;
+	if(results.Duration > wait)
+	{
+		overlapped_perception_duration_ += results.Duration-wait;
+	}
+
+	if(!results.Succeeded)
+	{
+		ROS_WARN_STREAM(NODE_NAME<<": Background segmentation and recognition failed, will run them again");
+		return false;
+	}
+
+	// the snapshot was taken while the last object was being placed, dropping it if that is the object it recognized
+	if(!current_place_location_.header.frame_id.empty())
+	{
+		const household_objects_database_msgs::DatabaseModelPose &model = results.Recognition.models[0].model_list[0];
+		geometry_msgs::PoseStamped model_world, place_world;
+		cm_.convertPoseGivenWorldTransform(*current_robot_state_,cm_.getWorldFrameId(),
+				model.pose.header,model.pose.pose,model_world);
+		cm_.convertPoseGivenWorldTransform(*current_robot_state_,cm_.getWorldFrameId(),
+				current_place_location_.header,current_place_location_.pose,place_world);
+
+		tf::Vector3 model_pos, place_pos;
+		tf::pointMsgToTF(model_world.pose.position,model_pos);
+		tf::pointMsgToTF(place_world.pose.position,place_pos);
+		if(model_pos.distance(place_pos) < _GoalParameters.MinObjectSpacing)
+		{
+			ROS_WARN_STREAM(NODE_NAME<<": Background recognition found the object just placed, will run it again");
+			return false;
+		}
+	}
 
+	// same sequence of updates as performSegmentation followed by performRecognition
+	planning_scene_diff_.collision_objects.clear();
+	recognized_obj_pose_map_.clear();
+	storeSegmentationResults(results.Segmentation);
+
+	planning_scene_diff_.collision_objects.clear();
+	recognized_obj_pose_map_.clear();
+	storeRecognitionResults(results.Recognition,results.ModelDescription);
+
+	ROS_INFO_STREAM(NODE_NAME<<": Using segmentation and recognition from the last cycle, waited "<<wait.toSec()
+			<<" of "<<results.Duration.toSec());
 	return true;
 }
 
+void RobotPickPlaceNavigator::discardBackgroundPerception()
+{
+	if(background_perception_started_)
+	{
+		background_perception_thread_.join();
+		background_perception_started_ = false;
+	}
+}
+
 bool RobotPickPlaceNavigator::getMeshFromDatabasePose(const household_objects_database_msgs::DatabaseModelPose &model_pose,
                              arm_navigation_msgs::CollisionObject& obj,
                              const geometry_msgs::PoseStamped& pose)
@@ -999,6 +1157,7 @@ bool RobotPickPlaceNavigator::getMeshFromDatabasePose(const household_objects_da
 bool RobotPickPlaceNavigator::performGraspPlanning()
 {
 	//  ===================================== saving current time stamp =====================================
+	StageLatencyMonitor::ScopedStage stage(latency_monitor_,STAGE_GRASP_PLANNING);
 	ros::WallTime start_time = ros::WallTime::now();
 
 	//  ===================================== clearing results from last call =====================================
@@ -1121,7 +1280,8 @@ bool RobotPickPlaceNavigator::performGraspPlanning()
 	ROS_INFO_STREAM(NODE_NAME<<": Cloud header " << segmented_clusters_[0].header.frame_id);
 	ROS_INFO_STREAM(NODE_NAME<<": Recognition pose frame " << modelPose.pose.header.frame_id);
 
-	return true;
+	grasp_planning_duration_ += ros::WallTime::now()-start_time;
+	return stage.setSucceeded(true);
 }
 
 void RobotPickPlaceNavigator::createPickMoveSequence(
@@ -1153,6 +1313,8 @@ void RobotPickPlaceNavigator::createPlaceMoveSequence(const object_manipulation_
 
 bool RobotPickPlaceNavigator::moveArmThroughPickSequence()
 {
+	StageLatencyMonitor::ScopedStage stage(latency_monitor_,STAGE_PICK);
+
 	// pushing local changes to planning scene
 	getAndSetPlanningScene();
 
@@ -1216,11 +1378,13 @@ bool RobotPickPlaceNavigator::moveArmThroughPickSequence()
 
 		counter++;
 	}
-	return success;
+	return stage.setSucceeded(success);
 }
 
 bool RobotPickPlaceNavigator::moveArmThroughPlaceSequence()
 {
+	StageLatencyMonitor::ScopedStage stage(latency_monitor_,STAGE_PLACE);
+
 	// resetting scene
 	getAndSetPlanningScene();
 
@@ -1260,12 +1424,14 @@ bool RobotPickPlaceNavigator::moveArmThroughPlaceSequence()
 
 	// try each place sequence candidate
 	bool success = false;
+	int counter = 0; // index to place poses array
 	BOOST_FOREACH(object_manipulator::PlaceExecutionInfo placeMove,placeSequence)
 	{
 		bool proceed = placeMove.result_.result_code == object_manipulation_msgs::PlaceLocationResult::SUCCESS;
 
 		if(proceed)
 		{
+			current_place_location_ = placePoses[counter];
 			success = attemptPlaceSequence(arm_group_name_,placeMove);
 			if(success)
 			{
@@ -1283,9 +1449,11 @@ bool RobotPickPlaceNavigator::moveArmThroughPlaceSequence()
 		{
 			ROS_INFO_STREAM(NODE_NAME<<": Grasp place move unreachable, skipping to next.");
 		}
+
+		counter++;
 	}
 
-	return success;
+	return stage.setSucceeded(success);
 }
 
 void RobotPickPlaceNavigator::createCandidateGoalPoses(std::vector<geometry_msgs::PoseStamped> &placePoses)
@@ -1358,6 +1526,7 @@ bool RobotPickPlaceNavigator::attemptGraspSequence(const std::string& group_name
   }
 
   execution_duration_ += (ros::WallTime::now()-start_execution);
+  latency_monitor_.record(STAGE_EXECUTION,ros::WallTime::now()-start_execution,trajectories_succeeded_);
   ROS_INFO_STREAM(NODE_NAME << ": Open gripper trajectory completed");
   ter_reqs.clear();
 
@@ -1451,6 +1620,7 @@ bool RobotPickPlaceNavigator::attemptGraspSequence(const std::string& group_name
   }
 
   execution_duration_ += (ros::WallTime::now()-start_execution);
+  latency_monitor_.record(STAGE_EXECUTION,ros::WallTime::now()-start_execution,trajectories_succeeded_);
 
   return trajectories_succeeded_;
 }
@@ -1464,6 +1634,9 @@ bool RobotPickPlaceNavigator::attemptPlaceSequence(const std::string& group_name
     return false;
   }
 
+  // the arm is now over the place location and out of the camera view
+  startBackgroundPerception();
+
   trajectories_succeeded_ = false;
   std::vector<std::string> segment_names;
 
@@ -1528,6 +1701,7 @@ bool RobotPickPlaceNavigator::attemptPlaceSequence(const std::string& group_name
   }
 
   execution_duration_ += (ros::WallTime::now()-start_execution);
+  latency_monitor_.record(STAGE_EXECUTION,ros::WallTime::now()-start_execution,trajectories_succeeded_);
   return trajectories_succeeded_;
 }
 
@@ -1730,25 +1904,54 @@ void RobotPickPlaceNavigator::collisionObjToMarker(const arm_navigation_msgs::Co
 
 }
 
+void RobotPickPlaceNavigator::setupLatencyMonitor()
+{
+	latency_monitor_.addStage(STAGE_CYCLE);
+	latency_monitor_.addStage(STAGE_SEGMENTATION);
+	latency_monitor_.addStage(STAGE_RECOGNITION);
+	latency_monitor_.addStage(STAGE_PLANNING_SCENE);
+	latency_monitor_.addStage(STAGE_GRASP_PLANNING);
+	latency_monitor_.addStage(STAGE_MOTION_PLANNING);
+	latency_monitor_.addStage(STAGE_TRAJECTORY_FILTERING);
+	latency_monitor_.addStage(STAGE_EXECUTION);
+	latency_monitor_.addStage(STAGE_PICK);
+	latency_monitor_.addStage(STAGE_PLACE);
+	latency_monitor_.start(NAVIGATOR_NAMESPACE);
+}
+
 void RobotPickPlaceNavigator::startCycleTimer() {
+  // a cycle that never reached printTiming was abandoned
+  if(cycle_in_progress_)
+  {
+    latency_monitor_.record(STAGE_CYCLE,ros::WallTime::now()-cycle_start_time_,false);
+  }
+  cycle_in_progress_ = true;
+
   execution_duration_ = ros::WallDuration(0.0);
   perception_duration_ = ros::WallDuration(0.0);
   planning_scene_duration_ = ros::WallDuration(0.0);
   motion_planning_duration_ = ros::WallDuration(0.0);
   trajectory_filtering_duration_ = ros::WallDuration(0.0);
   grasp_planning_duration_ = ros::WallDuration(0.0);
+  overlapped_perception_duration_ = ros::WallDuration(0.0);
   cycle_start_time_ = ros::WallTime::now();
 }
 
 void RobotPickPlaceNavigator::printTiming()
 {
     ros::WallDuration dur = ros::WallTime::now()-cycle_start_time_;
+    latency_monitor_.record(STAGE_CYCLE,dur,true);
+    cycle_in_progress_ = false;
     ROS_INFO_STREAM("Cycle took " << dur.toSec() << " processing " << (dur-execution_duration_).toSec() << " execution " << execution_duration_.toSec());
-    ROS_INFO_STREAM("Perception " << perception_duration_.toSec());
+    ROS_INFO_STREAM("Perception " << perception_duration_.toSec() << " overlapped with execution " << overlapped_perception_duration_.toSec());
     ROS_INFO_STREAM("Planning scene " << planning_scene_duration_.toSec());
     ROS_INFO_STREAM("Planning time " << motion_planning_duration_.toSec());
     ROS_INFO_STREAM("Filtering time " << trajectory_filtering_duration_.toSec());
     ROS_INFO_STREAM("Grasp planning time " << grasp_planning_duration_.toSec());
+    if(pipelined_cycle_)
+    {
+      ROS_INFO_STREAM("Sequential cycle would have taken " << (dur+overlapped_perception_duration_).toSec());
+    }
   }
 
 std::string RobotPickPlaceNavigator::makeCollisionObjectNameFromModelId(unsigned int model_id)
@@ -1835,23 +2038,31 @@ void RobotPickPlaceNavigator::runFullPickPlace()
 //	      break;
 //	    }
 
-		ROS_INFO_STREAM(NODE_NAME + ": Segmentation stage started");
-		if(!performSegmentation())
-		{
-		  ROS_WARN_STREAM(NODE_NAME<<": Segmentation stage failed");
-		  continue;
-		}
-		ROS_INFO_STREAM(NODE_NAME << " Segmentation stage completed");
-
-		ROS_INFO_STREAM(NODE_NAME << ": Recognition stage started");
-		if(!performRecognition())
+		// in pipelined mode the results were produced during the last place move
+		if(applyBackgroundPerception())
 		{
-		  ROS_WARN_STREAM(NODE_NAME << ": Recognition stage failed");
-		  continue;
+			ROS_INFO_STREAM(NODE_NAME << ": Segmentation and recognition stage completed during last cycle");
 		}
 		else
 		{
-			ROS_INFO_STREAM(NODE_NAME << ": Recognition stage completed");
+			ROS_INFO_STREAM(NODE_NAME + ": Segmentation stage started");
+			if(!performSegmentation())
+			{
+			  ROS_WARN_STREAM(NODE_NAME<<": Segmentation stage failed");
+			  continue;
+			}
+			ROS_INFO_STREAM(NODE_NAME << " Segmentation stage completed");
+
+			ROS_INFO_STREAM(NODE_NAME << ": Recognition stage started");
+			if(!performRecognition())
+			{
+			  ROS_WARN_STREAM(NODE_NAME << ": Recognition stage failed");
+			  continue;
+			}
+			else
+			{
+				ROS_INFO_STREAM(NODE_NAME << ": Recognition stage completed");
+			}
 		}
 
 		ROS_INFO_STREAM(NODE_NAME << ": grasp pickup stage started");
@@ -1868,6 +2079,8 @@ void RobotPickPlaceNavigator::runFullPickPlace()
 		ROS_INFO_STREAM(NODE_NAME + ": grasp place stage started");
 		if(!moveArmThroughPlaceSequence())
 		{
+			// the object may have been left anywhere, the scene has to be perceived again
+			discardBackgroundPerception();
 			ROS_WARN_STREAM(NODE_NAME << ": grasp place stage failed");
 		}
 		else
@@ -1883,6 +2096,8 @@ void RobotPickPlaceNavigator::runFullPickPlace()
 
 	    printTiming();
 	  }
+
+	discardBackgroundPerception();
 }
 
 void RobotPickPlaceNavigator::runSpherePickPlace()
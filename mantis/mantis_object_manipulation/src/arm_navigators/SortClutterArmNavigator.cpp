@@ -45,6 +45,39 @@ void SortClutterArmNavigator::clearResultsFromLastSrvCall()
 	zone_selector_.resetAllPlaceZones();
 }
 
+std::string SortClutterArmNavigator::getTaskStageName(uint32_t taskCode)
+{
+	using namespace mantis_object_manipulation;
+	switch(taskCode)
+	{
+	case ArmHandshaking::Request::TASK_RECOGNITION: return "task_recognition";
+	case ArmHandshaking::Request::TASK_PERCEPTION_FOR_SINGULATION: return "task_perception_for_singulation";
+	case ArmHandshaking::Request::TASK_PERCEPTION_FOR_CLUTTERING: return "task_perception_for_cluttering";
+	case ArmHandshaking::Request::TASK_PERCEPTION_FOR_SORTING: return "task_perception_for_sorting";
+	case ArmHandshaking::Request::TASK_GRASP_PLANNING_FOR_SINGULATION: return "task_grasp_planning_for_singulation";
+	case ArmHandshaking::Request::TASK_GRASP_PLANNING_FOR_CLUTTER: return "task_grasp_planning_for_clutter";
+	case ArmHandshaking::Request::TASK_GRASP_PLANNING_FOR_SORT: return "task_grasp_planning_for_sort";
+	case ArmHandshaking::Request::TASK_MOVE_TO_PICK: return "task_move_to_pick";
+	case ArmHandshaking::Request::TASK_MOVE_TO_PLACE: return "task_move_to_place";
+	case ArmHandshaking::Request::TASK_MOVE_HOME: return "task_move_home";
+	case ArmHandshaking::Request::TASK_MOVE_TO_PLACE_THEN_HOME: return "task_move_to_place_then_home";
+	case ArmHandshaking::Request::TASK_MOVE_TO_PICK_PLACE_THEN_HOME: return "task_move_to_pick_place_then_home";
+	case ArmHandshaking::Request::TASK_CLEAR_RESULTS: return "task_clear_results";
+	default: return "task_unknown";
+	}
+}
+
+void SortClutterArmNavigator::addLatencyStages()
+{
+	AutomatedPickerRobotNavigator::addLatencyStages();
+	for(uint32_t task = mantis_object_manipulation::ArmHandshaking::Request::TASK_RECOGNITION;
+			task <= mantis_object_manipulation::ArmHandshaking::Request::TASK_CLEAR_RESULTS; task++)
+	{
+		latency_monitor_.addStage(getTaskStageName(task));
+	}
+	latency_monitor_.addStage(getTaskStageName(0));
+}
+
 void SortClutterArmNavigator::run()
 {
 	ros::NodeHandle nh;
@@ -129,6 +162,7 @@ bool SortClutterArmNavigator::armHandshakingTaskHandler(mantis_object_manipulati
 	for(i = task_codes.begin(); success && i != task_codes.end(); i++)
 	{
 		uint32_t &task_code = *i;
+		ros::WallTime task_start = ros::WallTime::now();
 		switch(task_code)
 		{
 		case ArmHandshaking::Request::TASK_CLEAR_RESULTS:
@@ -318,6 +352,8 @@ bool SortClutterArmNavigator::armHandshakingTaskHandler(mantis_object_manipulati
 			ROS_INFO_STREAM(NODE_NAME << ": Grasp Place stage completed");
 			break;
 		}
+
+		latency_monitor_.recordSince(getTaskStageName(task_code),task_start,success);
 	}
 
 	handshaking_data_.response.completed = success;
@@ -0,0 +1,41 @@
+/*
+ * sensor_data_redirect_nodelet.cpp
+ *
+ *  Runs SensorDataRedirect inside a nodelet manager, loaded in the camera's manager the clouds are passed from the
+ *  driver to the redirect and on to the segmentation as shared pointers without being serialized or copied.
+ */
+
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+#include <mantis_object_manipulation/utils/SensorDataRedirect.h>
+
+namespace mantis_object_manipulation
+{
+
+class SensorDataRedirectNodelet: public nodelet::Nodelet
+{
+public:
+	SensorDataRedirectNodelet()
+	{
+
+	}
+
+	virtual ~SensorDataRedirectNodelet()
+	{
+
+	}
+
+protected:
+
+	virtual void onInit()
+	{
+		redirect_.init(getNodeHandle(),getPrivateNodeHandle());
+	}
+
+	SensorDataRedirect redirect_;
+};
+
+}
+
+PLUGINLIB_DECLARE_CLASS(mantis_object_manipulation,SensorDataRedirectNodelet,
+		mantis_object_manipulation::SensorDataRedirectNodelet,nodelet::Nodelet)
@@ -10,6 +10,8 @@
 #include <boost/thread.hpp>
 #include <boost/assign/list_inserter.hpp>
 #include <boost/assign/list_of.hpp>
+#include <algorithm>
+#include <sstream>
 #include <limits>
 
 const std::string ARM1_HANDSHAKING_SERVICE_NAME = "arm1_handshaking_service";
@@ -153,130 +155,388 @@ public:
 	};
 
 public:
-	typedef std::vector<TaskDetails> ConcurrentTaskSet;
-	typedef std::vector<ConcurrentTaskSet> TaskSequence;
-
-	class TaskSetExecutor
+	typedef std::vector<int> Prerequisites;
+
+	/*
+	 * Tasks for both arms and the order constraints between them.  Tasks of the same arm (the same handshaking
+	 * service) always run in the order they were added, so only the constraints on the other arm need to be given
+	 * as prerequisites.  A graph can be cycled, in which case a task may also wait for a task of the previous cycle.
+	 */
+	class TaskGraph
 	{
 	public:
+		struct TaskNode
+		{
+			TaskDetails task_;
+			std::string arm_;
+			Prerequisites prerequisites_; // tasks of the same cycle that must complete first
+			Prerequisites previous_cycle_prerequisites_; // tasks of the previous cycle that must complete first
+		};
 
-		TaskSetExecutor()
+	public:
+
+		/*
+		 * Prerequisites must have been added before the task, which rules out circular waits.  Returns the task index.
+		 */
+		int addTask(const TaskDetails &task,const Prerequisites &prerequisites = Prerequisites())
 		{
+			TaskNode node;
+			node.task_ = task;
+			node.arm_ = node.task_.arm_client_.getService();
+
+			Prerequisites::const_iterator i;
+			for(i = prerequisites.begin(); i != prerequisites.end(); i++)
+			{
+				if(*i < 0 || *i >= (int)nodes_.size())
+				{
+					ROS_ERROR_STREAM(ros::this_node::getName()<<": Task '"<<task.name_<<"' prerequisite "<<*i
+							<<" was not added before it, ignoring it");
+					continue;
+				}
+				node.prerequisites_.push_back(*i);
+			}
 
+			nodes_.push_back(node);
+			return nodes_.size() - 1;
 		}
 
-		virtual ~TaskSetExecutor()
+		void addPreviousCyclePrerequisite(int task,int prerequisite)
 		{
-
+			nodes_[task].previous_cycle_prerequisites_.push_back(prerequisite);
 		}
 
-		/*
-		 * runs all tasks in a multithreaded fashion.  Returns false if either task wasn't completed,
-		 * returns true otherwise
-		 */
-		bool runTaskSet(ConcurrentTaskSet &task_set)
+		// task indices of each arm in execution order
+		void getArmTasks(std::map<std::string,std::vector<int> > &arm_tasks) const
 		{
+			arm_tasks.clear();
+			for(std::size_t i = 0; i < nodes_.size(); i++)
+			{
+				arm_tasks[nodes_[i].arm_].push_back(i);
+			}
+		}
 
-			boost::thread_group task_thread_group;
+	public:
+		std::vector<TaskNode> nodes_;
+	};
 
-			ConcurrentTaskSet::iterator i;
-			for(i = task_set.begin(); i != task_set.end(); i++)
+	/*
+	 * Runs task graphs on one persistent worker thread per arm.  Each worker walks through its arm's tasks and starts
+	 * the next one as soon as its prerequisites on the other arm are met, so an arm only waits when the cell requires
+	 * it.  The time each arm spends waiting is reported after every graph.
+	 */
+	class TaskGraphExecutor
+	{
+	protected:
+
+		struct ArmWorker
+		{
+			ArmWorker()
+			:cycle_(0),
+			 position_(0),
+			 finished_(true)
 			{
-				TaskDetails &task = *i;
-				task_thread_group.create_thread(boost::bind(&TaskDetails::sendAndMonitorTask,&task));
+
 			}
 
-			// waiting for all tasks to complete
-			task_thread_group.join_all();
+			std::string arm_;
+			std::vector<int> tasks_; // tasks of the current graph in execution order
+			int cycle_;
+			std::size_t position_;
+			bool finished_;
+
+			// metrics
+			ros::WallDuration busy_time_; // current graph
+			ros::WallDuration idle_time_; // current graph, waiting on the other arm
+			ros::WallDuration total_busy_time_;
+			ros::WallDuration total_idle_time_;
+		};
 
-			// collecting completion flags
-			bool success = true;
-			for(i = task_set.begin(); success && i != task_set.end(); i++)
+	public:
+
+		TaskGraphExecutor()
+		:graph_(NULL),
+		 max_cycles_(0),
+		 stop_(false),
+		 termination_error_(false),
+		 shutdown_(false)
+		{
+
+		}
+
+		virtual ~TaskGraphExecutor()
+		{
 			{
-				success= success && i->completed_;
+				boost::mutex::scoped_lock lock(mutex_);
+				shutdown_ = true;
+				condition_.notify_all();
 			}
-			return success;
+			worker_threads_.join_all();
 		}
 
-		bool runTaskSequence(TaskSequence &task_seq,bool &termination_error_found)
+		/*
+		 * runs all tasks once.  Returns false if any task wasn't completed, returns true otherwise
+		 */
+		bool runTaskGraph(TaskGraph &graph,bool &termination_error_found)
 		{
-			bool completed = true;
-			TaskSequence::iterator i;
+			ROS_INFO_STREAM(ros::this_node::getName()<<": Requesting Multithreaded Task(s)");
+			printTaskGraph(graph);
 
-			for(i = task_seq.begin(); i != task_seq.end(); i++)
+			int cycles = 0;
+			bool completed = executeTaskGraph(graph,1,cycles,termination_error_found);
+			if(completed)
 			{
-				ROS_INFO_STREAM(ros::this_node::getName()<<": Requesting Multithreaded Task(s)");
-				printTaskSequence(*i);
-				if(!runTaskSet(*i))
-				{
-					ROS_ERROR_STREAM(ros::this_node::getName()<<": Multithreaded Task(s) Returned Error");
-					termination_error_found =  terminationErrorReceived(*i);
-					completed = false;
-					break;
-				}
 				ROS_INFO_STREAM(ros::this_node::getName()<<": Completed Multithreaded Task(s)");
 			}
-
+			else
+			{
+				ROS_ERROR_STREAM(ros::this_node::getName()<<": Multithreaded Task(s) Returned Error");
+			}
 			return completed;
 		}
 
-		void printTaskSequence(ConcurrentTaskSet &set)
+		/*
+		 * cycle through the task graph until an error is received, an arm moves on to its tasks of the next cycle
+		 * without waiting for the other arm to finish the current one.  Returns false only if a termination error
+		 * is sent back, returns true otherwise.
+		 */
+		bool cycleTaskGraph(TaskGraph &graph)
+		{
+			ROS_INFO_STREAM(ros::this_node::getName()<<": Requesting Multithreaded Task(s) cycle");
+			printTaskGraph(graph);
+
+			int cycles = 0;
+			bool termination_error = false;
+			executeTaskGraph(graph,std::numeric_limits<int>::max(),cycles,termination_error);
+			ROS_INFO_STREAM(ros::this_node::getName()<<": Completed "<<cycles<<" cycle(s)");
+			return !termination_error;
+		}
+
+		void printTaskGraph(TaskGraph &graph)
 		{
 			std::stringstream ss;
 			ss<<"\n\tMultithreaded Tasks:\n";
-			ConcurrentTaskSet::iterator j;
-			int counter =1;
-			for(j = set.begin(); j != set.end(); j++)
+			for(std::size_t i = 0; i < graph.nodes_.size(); i++)
 			{
-				ss<<"\t\t- "<<"arm "<<counter<<": "<<j->name_<<"\n";
-				counter++;
+				TaskGraph::TaskNode &node = graph.nodes_[i];
+				ss<<"\t\t- "<<i<<" "<<node.arm_<<": "<<node.task_.name_;
+				printPrerequisites(graph,node.prerequisites_,"after",ss);
+				printPrerequisites(graph,node.previous_cycle_prerequisites_,"after previous",ss);
+				ss<<"\n";
 			}
 
 			ROS_INFO_STREAM(ros::this_node::getName()<<ss.str());
 		}
 
+	protected:
+
+		void printPrerequisites(TaskGraph &graph,const Prerequisites &prerequisites,const std::string &label,
+				std::stringstream &ss)
+		{
+			Prerequisites::const_iterator i;
+			for(i = prerequisites.begin(); i != prerequisites.end(); i++)
+			{
+				ss<<(i == prerequisites.begin() ? ", "+ label + " " : ", ")<<*i<<" '"<<graph.nodes_[*i].task_.name_<<"'";
+			}
+		}
+
 		/*
-		 * cycle through task set array until an error is received.  Returns false only if a termination error
-		 * is sent back, returns true otherwise.
+		 * hands the graph to the arm workers and waits until they are all done. Returns false if a task failed,
+		 * cycles is set to the number of cycles completed by every task.
 		 */
-		bool cycleTaskSequence(TaskSequence &task_seq)
+		bool executeTaskGraph(TaskGraph &graph,int max_cycles,int &cycles,bool &termination_error_found)
 		{
-			bool proceed_to_next_cycle = true;
-			bool termination_error = false;
-			while(proceed_to_next_cycle)
+			boost::mutex::scoped_lock lock(mutex_);
+
+			graph_ = &graph;
+			max_cycles_ = max_cycles;
+			stop_ = false;
+			termination_error_ = false;
+			completed_cycles_.assign(graph.nodes_.size(),0);
+
+			std::map<std::string,std::vector<int> > arm_tasks;
+			std::map<std::string,std::vector<int> >::iterator i;
+			graph.getArmTasks(arm_tasks);
+			for(i = arm_tasks.begin(); i != arm_tasks.end(); i++)
 			{
-				TaskSequence::iterator i;
-				for(i = task_seq.begin(); i != task_seq.end(); i++)
+				ArmWorker &worker = getArmWorker(i->first);
+				worker.tasks_ = i->second;
+				worker.cycle_ = 0;
+				worker.position_ = 0;
+				worker.busy_time_ = worker.idle_time_ = ros::WallDuration(0.0f);
+				worker.finished_ = false;
+			}
+
+			ros::WallTime start_time = ros::WallTime::now();
+			condition_.notify_all();
+			while(!armWorkersFinished(arm_tasks))
+			{
+				condition_.wait(lock);
+			}
+
+			cycles = completed_cycles_.empty() ? 0 : *std::min_element(completed_cycles_.begin(),completed_cycles_.end());
+			printArmMetrics(arm_tasks,ros::WallTime::now() - start_time,cycles);
+
+			graph_ = NULL;
+			termination_error_found = termination_error_;
+			return !stop_;
+		}
+
+		// creates the worker thread the first time an arm is seen, must be called with the mutex locked
+		ArmWorker& getArmWorker(const std::string &arm)
+		{
+			boost::shared_ptr<ArmWorker> &worker = arm_workers_[arm];
+			if(!worker)
+			{
+				worker.reset(new ArmWorker());
+				worker->arm_ = arm;
+				worker_threads_.create_thread(boost::bind(&TaskGraphExecutor::runArmWorker,this,worker.get()));
+			}
+			return *worker;
+		}
+
+		bool armWorkersFinished(const std::map<std::string,std::vector<int> > &arm_tasks)
+		{
+			std::map<std::string,std::vector<int> >::const_iterator i;
+			for(i = arm_tasks.begin(); i != arm_tasks.end(); i++)
+			{
+				if(!arm_workers_[i->first]->finished_)
 				{
-					ROS_INFO_STREAM(ros::this_node::getName()<<": Requesting Multithreaded Task(s)");
-					printTaskSequence(*i);
-					if(!runTaskSet(*i))
-					{
-						proceed_to_next_cycle = false;
-						termination_error =  terminationErrorReceived(*i);
-						ROS_ERROR_STREAM(ros::this_node::getName()<<": Multithreaded Task(s) Returned Error");
-						break;
-					}
-					ROS_INFO_STREAM(ros::this_node::getName()<<": Completed Multithreaded Task(s)");
+					return false;
 				}
 			}
+			return true;
+		}
 
-			return !termination_error;
+		bool prerequisitesCompleted(int task,int cycle)
+		{
+			const TaskGraph::TaskNode &node = graph_->nodes_[task];
+			Prerequisites::const_iterator i;
+			for(i = node.prerequisites_.begin(); i != node.prerequisites_.end(); i++)
+			{
+				if(completed_cycles_[*i] <= cycle)
+				{
+					return false;
+				}
+			}
+
+			for(i = node.previous_cycle_prerequisites_.begin(); i != node.previous_cycle_prerequisites_.end(); i++)
+			{
+				if(completed_cycles_[*i] < cycle)
+				{
+					return false;
+				}
+			}
+			return true;
 		}
 
-	protected:
+		void runArmWorker(ArmWorker *worker)
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			while(true)
+			{
+				while(!shutdown_ && worker->finished_)
+				{
+					condition_.wait(lock);
+				}
+
+				if(shutdown_)
+				{
+					return;
+				}
+
+				// moving on to the next cycle once all tasks of this arm are done
+				if(worker->position_ == worker->tasks_.size())
+				{
+					worker->position_ = 0;
+					worker->cycle_++;
+				}
+
+				if(worker->tasks_.empty() || worker->cycle_ >= max_cycles_)
+				{
+					worker->finished_ = true;
+					condition_.notify_all();
+					continue;
+				}
+
+				// waiting on the other arm
+				int task_index = worker->tasks_[worker->position_];
+				ros::WallTime idle_start = ros::WallTime::now();
+				while(!shutdown_ && !stop_ && !prerequisitesCompleted(task_index,worker->cycle_))
+				{
+					condition_.wait(lock);
+				}
+				worker->idle_time_ += ros::WallTime::now() - idle_start;
+
+				if(shutdown_)
+				{
+					return;
+				}
+
+				// no new tasks are started once a task has failed
+				if(stop_)
+				{
+					worker->finished_ = true;
+					condition_.notify_all();
+					continue;
+				}
+
+				// tasks of the same arm never overlap, so the task details are only touched by this thread
+				TaskDetails &task = graph_->nodes_[task_index].task_;
+				ros::WallTime busy_start = ros::WallTime::now();
+				lock.unlock();
+				bool succeeded = task.sendAndMonitorTask();
+				lock.lock();
+				worker->busy_time_ += ros::WallTime::now() - busy_start;
+
+				if(succeeded)
+				{
+					completed_cycles_[task_index]++;
+				}
+				else
+				{
+					stop_ = true;
+					termination_error_ = termination_error_ || task.terminationErrorReceived();
+				}
+
+				worker->position_++;
+				condition_.notify_all();
+			}
+		}
 
-		bool terminationErrorReceived(ConcurrentTaskSet &task_set)
+		void printArmMetrics(const std::map<std::string,std::vector<int> > &arm_tasks,const ros::WallDuration &elapsed,
+				int cycles)
 		{
-			ConcurrentTaskSet::iterator i;
-			bool termination = false;
-			for(i = task_set.begin(); !termination && i != task_set.end(); i++)
+			std::stringstream ss;
+			ss<<": "<<cycles<<" cycle(s) in "<<elapsed.toSec()<<" seconds";
+			std::map<std::string,std::vector<int> >::const_iterator i;
+			for(i = arm_tasks.begin(); i != arm_tasks.end(); i++)
 			{
-				termination = termination || i->terminationErrorReceived();
+				ArmWorker &worker = *arm_workers_[i->first];
+				worker.total_busy_time_ += worker.busy_time_;
+				worker.total_idle_time_ += worker.idle_time_;
+				double idle_share = elapsed.toSec() > 0.0f ? 100.0f * worker.idle_time_.toSec()/elapsed.toSec() : 0.0f;
+				ss<<"\n\t\t- "<<worker.arm_<<": busy "<<worker.busy_time_.toSec()<<" s, idle "<<worker.idle_time_.toSec()
+						<<" s ("<<idle_share<<"%), since start busy "<<worker.total_busy_time_.toSec()<<" s, idle "
+						<<worker.total_idle_time_.toSec()<<" s";
 			}
 
-			return termination;
+			ROS_INFO_STREAM(ros::this_node::getName()<<ss.str());
 		}
+
+	protected:
+
+		boost::mutex mutex_;
+		boost::condition_variable condition_;
+		boost::thread_group worker_threads_;
+		std::map<std::string,boost::shared_ptr<ArmWorker> > arm_workers_;
+
+		// current graph
+		TaskGraph *graph_;
+		int max_cycles_;
+		std::vector<int> completed_cycles_; // number of cycles each task has completed
+		bool stop_;
+		bool termination_error_;
+		bool shutdown_;
 	};
 
 public:
@@ -307,34 +567,34 @@ public:
 		ros::ServiceClient &clutter_arm_client = arm1_handshaking_client_;
 		ros::ServiceClient &sorting_arm_client = arm2_handshaking_client_;
 
-		// creating concurrent task sequences
-		TaskSequence clutter_start_seq, clutter_cycle_seq, clutter_end_seq;
-		TaskSequence sort_start_seq, sort_cycle_seq, sort_end_seq;
-		TaskSequence arm1_clear_singulated_zone_seq;
-		TaskSequence arm2_clear_singulated_zone_seq;
-		TaskSequence move_home_seq;
-
-		generateMoveHomeSequence(clutter_arm_client,sorting_arm_client,move_home_seq);
-		generateSortSequences(clutter_arm_client,sorting_arm_client,sort_cycle_seq,sort_start_seq,sort_end_seq);
-		//generateClutterSequences(clutter_arm_client,sorting_arm_client,clutter_cycle_seq,clutter_start_seq);
-		generateSortSequences(sorting_arm_client,clutter_arm_client,clutter_cycle_seq,clutter_start_seq,clutter_end_seq);
-		generateClearSingulationZoneSequence(clutter_arm_client,arm1_clear_singulated_zone_seq);
-		generateClearSingulationZoneSequence(sorting_arm_client,arm2_clear_singulated_zone_seq);
-
-		// creating sequence executor
+		// creating concurrent task graphs
+		TaskGraph clutter_start_seq, clutter_cycle_seq, clutter_end_seq;
+		TaskGraph sort_start_seq, sort_cycle_seq, sort_end_seq;
+		TaskGraph arm1_clear_singulated_zone_seq;
+		TaskGraph arm2_clear_singulated_zone_seq;
+		TaskGraph move_home_seq;
+
+		generateMoveHomeGraph(clutter_arm_client,sorting_arm_client,move_home_seq);
+		generateSortGraphs(clutter_arm_client,sorting_arm_client,sort_cycle_seq,sort_start_seq,sort_end_seq);
+		//generateClutterGraphs(clutter_arm_client,sorting_arm_client,clutter_cycle_seq,clutter_start_seq,clutter_end_seq);
+		generateSortGraphs(sorting_arm_client,clutter_arm_client,clutter_cycle_seq,clutter_start_seq,clutter_end_seq);
+		generateClearSingulationZoneGraph(clutter_arm_client,arm1_clear_singulated_zone_seq);
+		generateClearSingulationZoneGraph(sorting_arm_client,arm2_clear_singulated_zone_seq);
+
+		// creating graph executor, its arm worker threads are kept for the whole run
 		bool stop_running = false;
-		TaskSetExecutor task_executor;
+		TaskGraphExecutor task_executor;
 
 		// clearing singulation zone
 		ROS_INFO_STREAM(": ------------------ Request Clutter Arm Clear Singulation ------------------ ");
-		if(!task_executor.runTaskSequence(arm1_clear_singulated_zone_seq,stop_running) && stop_running)
+		if(!task_executor.runTaskGraph(arm1_clear_singulated_zone_seq,stop_running) && stop_running)
 		{
 			ROS_ERROR_STREAM(node_name_<<": Request not completed, exiting");
 			return;
 		}
 
 		ROS_INFO_STREAM(": ------------------ Request Sorting Arm Clear Singulation ------------------ ");
-		if(!task_executor.runTaskSequence(arm2_clear_singulated_zone_seq,stop_running) && stop_running)
+		if(!task_executor.runTaskGraph(arm2_clear_singulated_zone_seq,stop_running) && stop_running)
 		{
 			ROS_ERROR_STREAM(node_name_<<": Request not completed, exiting");
 			return;
@@ -344,25 +604,25 @@ public:
 		{
 			// start by moving arms home
 			ROS_INFO_STREAM(": ------------------ Request Move home ------------------ ");
-			if(!task_executor.runTaskSequence(move_home_seq,stop_running))
+			if(!task_executor.runTaskGraph(move_home_seq,stop_running))
 			{
 				ROS_ERROR_STREAM(node_name_<<": Request not completed, exiting");
 				break;
 			}
 
 			ROS_INFO_STREAM(": ------------------ Request Sort start sequence ------------------ ");
-			if(task_executor.runTaskSequence(sort_start_seq,stop_running))
+			if(task_executor.runTaskGraph(sort_start_seq,stop_running))
 			{
 				// cycle until sorting is finished
 				ROS_INFO_STREAM(": ------------------ Request Sort Cycle sequence ------------------ ");
-				if(!task_executor.cycleTaskSequence(sort_cycle_seq))
+				if(!task_executor.cycleTaskGraph(sort_cycle_seq))
 				{
 					ROS_ERROR_STREAM(node_name_<<": Request not completed, exiting");
 					break;
 				}
 
 				ROS_INFO_STREAM(": ------------------ Request Sort End sequence ------------------ ");
-				if(!task_executor.runTaskSequence(sort_end_seq,stop_running))
+				if(!task_executor.runTaskGraph(sort_end_seq,stop_running))
 				{
 					ROS_ERROR_STREAM(node_name_<<": Request not completed, exiting");
 					break;
@@ -379,25 +639,25 @@ public:
 
 			// moving arms home (just in case)
 			ROS_INFO_STREAM(": ------------------ Request Move Home ------------------ ");
-			if(!task_executor.runTaskSequence(move_home_seq,stop_running))
+			if(!task_executor.runTaskGraph(move_home_seq,stop_running))
 			{
 				ROS_ERROR_STREAM(node_name_<<": Request not completed, exiting");
 				break;
 			}
 
 			ROS_INFO_STREAM(": ------------------ Request Clutter start sequence ------------------ ");
-			if(task_executor.runTaskSequence(clutter_start_seq,stop_running))
+			if(task_executor.runTaskGraph(clutter_start_seq,stop_running))
 			{
 				// cycle until clutter is finished
 				ROS_INFO_STREAM(": ------------------  Request Clutter Cycle Sequence ------------------ ");
-				if(!task_executor.cycleTaskSequence(clutter_cycle_seq))
+				if(!task_executor.cycleTaskGraph(clutter_cycle_seq))
 				{
 					ROS_ERROR_STREAM(node_name_<<": Request not completed, exiting");
 					break;
 				}
 
 				ROS_INFO_STREAM(": ------------------  Request Clutter End Sequence ------------------ ");
-				if(!task_executor.runTaskSequence(clutter_end_seq,stop_running))
+				if(!task_executor.runTaskGraph(clutter_end_seq,stop_running))
 				{
 					ROS_ERROR_STREAM(node_name_<<": Request not completed, exiting");
 					break;
@@ -612,348 +872,124 @@ protected:
 
 	}
 
-	void generateSortSequences(ros::ServiceClient &clutter_client,ros::ServiceClient &sort_client,
-			TaskSequence &sort_cycle_seq,TaskSequence &sort_start_seq,TaskSequence &sort_end_seq)
+	TaskDetails makeTask(uint32_t task_code,ros::ServiceClient &client)
 	{
-		// defining task sets
-		ConcurrentTaskSet set;
-		TaskDetails task1, task2;
+		TaskDetails task = task_definitions_[task_code];
+		task.arm_client_ = client;
+		return task;
+	}
 
-		/* --------------------------------- Sort Cyclical Sequence definition -------------------------
+	void generateSortGraphs(ros::ServiceClient &clutter_client,ros::ServiceClient &sort_client,
+			TaskGraph &sort_cycle_graph,TaskGraph &sort_start_graph,TaskGraph &sort_end_graph)
+	{
+		using namespace boost::assign;
+
+		/* --------------------------------- Sort Cyclical Graph definition -------------------------
 		 * clutter arm client starts at home position and there's one object in the singulation area
 		*/
-		// clear data
-//		set.clear();
-//		task1 = task_definitions_[ArmRequest::TASK_CLEAR_RESULTS];
-//		task2 = task_definitions_[ArmRequest::TASK_CLEAR_RESULTS];
-//		task1.arm_client_ = clutter_client;
-//		task2.arm_client_ = sort_client;
-//		set.push_back(task1);
-//		set.push_back(task2);
-//		sort_cycle_seq.push_back(set);
-
-		// perception in clutter and singulated zones
-//		set.clear();
-//		task1 = task_definitions_[ArmRequest::TASK_PERCEPTION_FOR_SINGULATION];
-//		task2 = task_definitions_[ArmRequest::TASK_PERCEPTION_FOR_SORTING];
-//		task1.arm_client_ = clutter_client;
-//		task2.arm_client_ = sort_client;
-//		set.push_back(task1);
-//		set.push_back(task2);
-//		sort_cycle_seq.push_back(set);
-
-		// grasp planning in clutter and singulation
-		set.clear();
-		task1 = task_definitions_[ArmRequest::TASK_GRASP_PLANNING_FOR_SINGULATION];
-		task2 = task_definitions_[ArmRequest::TASK_GRASP_PLANNING_FOR_SORT];
-		task1.arm_client_ = clutter_client;
-		task2.arm_client_ = sort_client;
-		set.push_back(task1);
-		set.push_back(task2);
-		sort_cycle_seq.push_back(set);
-
-		// move to pick in clutter and singulation zone
-		set.clear();
-		task1 = task_definitions_[ArmRequest::TASK_MOVE_TO_PICK];// should be at home and moving to clutter pick zone
-		task2 = task_definitions_[ArmRequest::TASK_MOVE_TO_PICK];// should be at home and moving to singulation zone
-		task1.arm_client_ = clutter_client;
-		task2.arm_client_ = sort_client;
-		set.push_back(task1);
-		set.push_back(task2);
-		sort_cycle_seq.push_back(set);
+		// grasp planning in clutter zone
+		int clutter_planning = sort_cycle_graph.addTask(
+				makeTask(ArmRequest::TASK_GRASP_PLANNING_FOR_SINGULATION,clutter_client));
+
+		// grasp planning in singulation zone, needs the object placed there during the previous cycle
+		int sort_planning = sort_cycle_graph.addTask(makeTask(ArmRequest::TASK_GRASP_PLANNING_FOR_SORT,sort_client));
+
+		// move to pick in clutter and singulation zone, an arm only picks once the other one has a plan so that neither
+		// is left holding an object when the cycle ends
+		sort_cycle_graph.addTask(makeTask(ArmRequest::TASK_MOVE_TO_PICK,clutter_client),list_of(sort_planning));
+		sort_cycle_graph.addTask(makeTask(ArmRequest::TASK_MOVE_TO_PICK,sort_client),list_of(clutter_planning));
 
 		// move to place (sort client moves part from singulation to sorted zone)
-		set.clear();
-		task1 = task_definitions_[ArmRequest::TASK_MOVE_TO_PLACE];// moves from singulation to sorted zone
-		task1.arm_client_ = sort_client;
-		set.push_back(task1);
-		sort_cycle_seq.push_back(set);
-
-		// move to place (clutter to singulation) and move home
-		set.clear();
-		task1 = task_definitions_[ArmRequest::TASK_MOVE_TO_PLACE_THEN_HOME];// should be at clutter pick and moving to singulation zone
-		task2 = task_definitions_[ArmRequest::TASK_MOVE_HOME];// should be at sorted and moving to home
-		task1.arm_client_ = clutter_client;
-		task2.arm_client_ = sort_client;
-		set.push_back(task1);
-		set.push_back(task2);
-		sort_cycle_seq.push_back(set);
+		int sort_place = sort_cycle_graph.addTask(makeTask(ArmRequest::TASK_MOVE_TO_PLACE,sort_client));
+
+		// move to place (clutter to singulation) and move home, once the sort arm has cleared the singulation zone
+		int clutter_place = sort_cycle_graph.addTask(makeTask(ArmRequest::TASK_MOVE_TO_PLACE_THEN_HOME,clutter_client),
+				list_of(sort_place));
+		sort_cycle_graph.addTask(makeTask(ArmRequest::TASK_MOVE_HOME,sort_client));
+		sort_cycle_graph.addPreviousCyclePrerequisite(sort_planning,clutter_place);
 
 		/*
-		 * ---------------------------- End of Clutter Cyclical Sequence definition -------------------------
+		 * ---------------------------- End of Sort Cyclical Graph definition -------------------------
 		*/
 
 		/*
-		 * --------------------------------- Sort Start Sequence definition -------------------------
+		 * --------------------------------- Sort Start Graph definition -------------------------
 		 * Moves first object from clutter to singulated and returns home
 		 */
-
-		// clear data
-//		set.clear();
-//		task1 = task_definitions_[ArmRequest::TASK_CLEAR_RESULTS];
-//		task2 = task_definitions_[ArmRequest::TASK_CLEAR_RESULTS];
-//		task1.arm_client_ = sort_client;
-//		task2.arm_client_ = clutter_client;
-//		set.push_back(task1);
-//		set.push_back(task2);
-//		sort_start_seq.push_back(set);
-
-		// perception in clutter zone
-//		set.clear();
-//		task1 = task_definitions_[ArmRequest::TASK_PERCEPTION_FOR_SINGULATION];
-//		task1.arm_client_ = clutter_client;
-//		set.push_back(task1);
-//		sort_start_seq.push_back(set);
-
-		// perception and grasp planning from clutter to singulated zone
-		set.clear();
-		task1 = task_definitions_[ArmRequest::TASK_GRASP_PLANNING_FOR_SINGULATION];
-		task1.arm_client_ = clutter_client;
-		set.push_back(task1);
-		sort_start_seq.push_back(set);
-
-		// move to pick place then home
-		set.clear();
-		task1 = task_definitions_[ArmRequest::TASK_MOVE_TO_PICK_PLACE_THEN_HOME];
-		task1.arm_client_ = clutter_client;
-		set.push_back(task1);
-		sort_start_seq.push_back(set);
+		sort_start_graph.addTask(makeTask(ArmRequest::TASK_GRASP_PLANNING_FOR_SINGULATION,clutter_client));
+		sort_start_graph.addTask(makeTask(ArmRequest::TASK_MOVE_TO_PICK_PLACE_THEN_HOME,clutter_client));
 
 		/*
-		 * --------------------------------- Sort End Sequence definition -------------------------
+		 * --------------------------------- Sort End Graph definition -------------------------
 		 * Moves last object from singulated to sorted and returns home
 		 */
-
-		// clear data
-//		set.clear();
-//		task1 = task_definitions_[ArmRequest::TASK_CLEAR_RESULTS];
-//		task1.arm_client_ = sort_client;
-//		set.push_back(task1);
-//		sort_end_seq.push_back(set);
-
-		// perception in singulated zone
-//		set.clear();
-//		task1 = task_definitions_[ArmRequest::TASK_PERCEPTION_FOR_SORTING];
-//		task1.arm_client_ = sort_client;
-//		set.push_back(task1);
-//		sort_end_seq.push_back(set);
-
-		// grasp planning from singulated to sorted zone
-		set.clear();
-		task1 = task_definitions_[ArmRequest::TASK_GRASP_PLANNING_FOR_SORT];
-		task1.arm_client_ = sort_client;
-		set.push_back(task1);
-		sort_end_seq.push_back(set);
-
-		// move to pick place then home
-		set.clear();
-		task1 = task_definitions_[ArmRequest::TASK_MOVE_TO_PICK_PLACE_THEN_HOME];
-		task1.arm_client_ = sort_client;
-		set.push_back(task1);
-		sort_end_seq.push_back(set);
+		sort_end_graph.addTask(makeTask(ArmRequest::TASK_GRASP_PLANNING_FOR_SORT,sort_client));
+		sort_end_graph.addTask(makeTask(ArmRequest::TASK_MOVE_TO_PICK_PLACE_THEN_HOME,sort_client));
 	}
 
-	void generateClutterSequences(ros::ServiceClient &clutter_client,ros::ServiceClient &sort_client,
-			TaskSequence &clutter_cycle_seq,TaskSequence &clutter_start_seq,TaskSequence &clutter_end_seq)
+	void generateClutterGraphs(ros::ServiceClient &clutter_client,ros::ServiceClient &sort_client,
+			TaskGraph &clutter_cycle_graph,TaskGraph &clutter_start_graph,TaskGraph &clutter_end_graph)
 	{
+		using namespace boost::assign;
 
-		// defining task sets
-		ConcurrentTaskSet set;
-		TaskDetails task1, task2;
-
-		/* --------------------------------- Clutter Cyclical Sequence definition -------------------------
+		/* --------------------------------- Clutter Cyclical Graph definition -------------------------
 		 * sort arm client starts at home position and there's one object in the singulation area
 		*/
-		// clear data
-//		set.clear();
-//		task1 = task_definitions_[ArmRequest::TASK_CLEAR_RESULTS];
-//		task2 = task_definitions_[ArmRequest::TASK_CLEAR_RESULTS];
-//		task1.arm_client_ = clutter_client;
-//		task2.arm_client_ = sort_client;
-//		set.push_back(task1);
-//		set.push_back(task2);
-//		clutter_cycle_seq.push_back(set);
-
-		// perception in sorted and singulated zones
-//		set.clear();
-//		task1 = task_definitions_[ArmRequest::TASK_PERCEPTION_FOR_CLUTTERING];// segmentation in singulation zone
-//		task2 = task_definitions_[ArmRequest::TASK_PERCEPTION_FOR_SINGULATION];// segmentation in sorted zone
-//		task1.arm_client_ = clutter_client;
-//		task2.arm_client_ = sort_client;
-//		set.push_back(task1);
-//		set.push_back(task2);
-//		clutter_cycle_seq.push_back(set);
-
-		// perception and grasp planning in sorted and singulation
-		set.clear();
-		task1 = task_definitions_[ArmRequest::TASK_GRASP_PLANNING_FOR_CLUTTER];
-		task2 = task_definitions_[ArmRequest::TASK_GRASP_PLANNING_FOR_SINGULATION];
-		task1.arm_client_ = clutter_client;
-		task2.arm_client_ = sort_client;
-		set.push_back(task1);
-		set.push_back(task2);
-		clutter_cycle_seq.push_back(set);
-
-		// move to pick in clutter and singulation zone
-		set.clear();
-		task1 = task_definitions_[ArmRequest::TASK_MOVE_TO_PICK];// should be at home and moving to singulated pick zone
-		task2 = task_definitions_[ArmRequest::TASK_MOVE_TO_PICK];// should be at home and moving to sorted zone
-		task1.arm_client_ = clutter_client;
-		task2.arm_client_ = sort_client;
-		set.push_back(task1);
-		set.push_back(task2);
-		clutter_cycle_seq.push_back(set);
+		// grasp planning in singulation zone, needs the object placed there during the previous cycle
+		int clutter_planning = clutter_cycle_graph.addTask(
+				makeTask(ArmRequest::TASK_GRASP_PLANNING_FOR_CLUTTER,clutter_client));
 
-		// move to place (sort client moves part from singulation to sorted zone)
-		set.clear();
-		task1 = task_definitions_[ArmRequest::TASK_MOVE_TO_PLACE];// moves from singulation to clutter zone
-		task1.arm_client_ = clutter_client;
-		set.push_back(task1);
-		clutter_cycle_seq.push_back(set);
-
-		// move to place (clutter to singulation) and move home
-		set.clear();
-		task1 = task_definitions_[ArmRequest::TASK_MOVE_HOME];// should be at clutter and moving home
-		task2 = task_definitions_[ArmRequest::TASK_MOVE_TO_PLACE_THEN_HOME];// should be at sorted and moving singulation then home
-		task1.arm_client_ = clutter_client;
-		task2.arm_client_ = sort_client;
-		set.push_back(task1);
-		set.push_back(task2);
-		clutter_cycle_seq.push_back(set);
+		// grasp planning in sorted zone
+		int sort_planning = clutter_cycle_graph.addTask(
+				makeTask(ArmRequest::TASK_GRASP_PLANNING_FOR_SINGULATION,sort_client));
+
+		// move to pick in singulation and sorted zone once both arms have a plan
+		clutter_cycle_graph.addTask(makeTask(ArmRequest::TASK_MOVE_TO_PICK,clutter_client),list_of(sort_planning));
+		clutter_cycle_graph.addTask(makeTask(ArmRequest::TASK_MOVE_TO_PICK,sort_client),list_of(clutter_planning));
+
+		// move to place (clutter client moves part from singulation to clutter zone) and move home
+		int clutter_place = clutter_cycle_graph.addTask(makeTask(ArmRequest::TASK_MOVE_TO_PLACE,clutter_client));
+		clutter_cycle_graph.addTask(makeTask(ArmRequest::TASK_MOVE_HOME,clutter_client));
+
+		// move to place (sorted to singulation) and move home, once the clutter arm has cleared the singulation zone
+		int sort_place = clutter_cycle_graph.addTask(makeTask(ArmRequest::TASK_MOVE_TO_PLACE_THEN_HOME,sort_client),
+				list_of(clutter_place));
+		clutter_cycle_graph.addPreviousCyclePrerequisite(clutter_planning,sort_place);
 
 		/*
-		 * ---------------------------- End of Clutter Cyclical Sequence definition -------------------------
+		 * ---------------------------- End of Clutter Cyclical Graph definition -------------------------
 		*/
 
 		/*
-		 * --------------------------------- Clutter Start Sequence definition -------------------------
+		 * --------------------------------- Clutter Start Graph definition -------------------------
 		 * Moves first object from sorted to singulated and returns home
 		 */
-
-		// clear data
-//		set.clear();
-//		task1 = task_definitions_[ArmRequest::TASK_CLEAR_RESULTS];
-//		task2 = task_definitions_[ArmRequest::TASK_CLEAR_RESULTS];
-//		task1.arm_client_ = sort_client;
-//		task2.arm_client_ = clutter_client;
-//		set.push_back(task1);
-//		set.push_back(task2);
-//		clutter_start_seq.push_back(set);
-
-		// perception in sorted zone
-//		set.clear();
-//		task1 = task_definitions_[ArmRequest::TASK_PERCEPTION_FOR_SINGULATION];
-//		task1.arm_client_ = sort_client;
-//		set.push_back(task1);
-//		clutter_start_seq.push_back(set);
-
-		// perception and grasp planning from clutter to singulated zone
-		set.clear();
-		task1 = task_definitions_[ArmRequest::TASK_GRASP_PLANNING_FOR_SINGULATION];
-		task1.arm_client_ = sort_client;
-		set.push_back(task1);
-		clutter_start_seq.push_back(set);
-
-		// move to pick place then home
-		set.clear();
-		task1 = task_definitions_[ArmRequest::TASK_MOVE_TO_PICK_PLACE_THEN_HOME];
-		task1.arm_client_ = sort_client;
-		set.push_back(task1);
-		clutter_start_seq.push_back(set);
+		clutter_start_graph.addTask(makeTask(ArmRequest::TASK_GRASP_PLANNING_FOR_SINGULATION,sort_client));
+		clutter_start_graph.addTask(makeTask(ArmRequest::TASK_MOVE_TO_PICK_PLACE_THEN_HOME,sort_client));
 
 		/*
-		 * --------------------------------- Clutter Start Sequence definition -------------------------
+		 * --------------------------------- Clutter End Graph definition -------------------------
 		 * Moves last object from singulated to clutter and returns home
 		 */
-
-		// clear data
-//		set.clear();
-//		task1 = task_definitions_[ArmRequest::TASK_CLEAR_RESULTS];
-//		task1.arm_client_ = clutter_client;
-//		set.push_back(task1);
-//		clutter_end_seq.push_back(set);
-
-		// perception in singulated zone
-//		set.clear();
-//		task1 = task_definitions_[ArmRequest::TASK_PERCEPTION_FOR_CLUTTERING];
-//		task1.arm_client_ = clutter_client;
-//		set.push_back(task1);
-//		clutter_end_seq.push_back(set);
-
-		// perception and grasp planning from singulated to clutter zone
-		set.clear();
-		task1 = task_definitions_[ArmRequest::TASK_GRASP_PLANNING_FOR_CLUTTER];
-		task1.arm_client_ = clutter_client;
-		set.push_back(task1);
-		clutter_end_seq.push_back(set);
-
-		// move to pick place then home
-		set.clear();
-		task1 = task_definitions_[ArmRequest::TASK_MOVE_TO_PICK_PLACE_THEN_HOME];
-		task1.arm_client_ = clutter_client;
-		set.push_back(task1);
-		clutter_end_seq.push_back(set);
+		clutter_end_graph.addTask(makeTask(ArmRequest::TASK_GRASP_PLANNING_FOR_CLUTTER,clutter_client));
+		clutter_end_graph.addTask(makeTask(ArmRequest::TASK_MOVE_TO_PICK_PLACE_THEN_HOME,clutter_client));
 	}
 
-	void generateClearSingulationZoneSequence(ros::ServiceClient &client, TaskSequence &seq)
+	void generateClearSingulationZoneGraph(ros::ServiceClient &client, TaskGraph &graph)
 	{
-		// defining task sets
-		ConcurrentTaskSet set;
-		TaskDetails task;
-
-		// clear data
-		set.clear();
-		task = task_definitions_[ArmRequest::TASK_CLEAR_RESULTS];
-		task.arm_client_ = client;
-		set.push_back(task);
-		seq.push_back(set);
-
-		// move home
-		set.clear();
-		task = task_definitions_[ArmRequest::TASK_MOVE_HOME];
-		task.arm_client_ = client;
-		set.push_back(task);
-		seq.push_back(set);
-
-		// perception
-//		set.clear();
-//		task = task_definitions_[ArmRequest::TASK_PERCEPTION_FOR_SORTING];
-//		task.arm_client_ = client;
-//		set.push_back(task);
-//		seq.push_back(set);
-
-		// perception and grasp planning
-		set.clear();
-		task = task_definitions_[ArmRequest::TASK_GRASP_PLANNING_FOR_SORT];
-		task.arm_client_ = client;
-		set.push_back(task);
-		seq.push_back(set);
-
-		// move pick place then home
-		set.clear();
-		task = task_definitions_[ArmRequest::TASK_MOVE_TO_PICK_PLACE_THEN_HOME];
-		task.arm_client_ = client;
-		set.push_back(task);
-		seq.push_back(set);
-
+		// clear data, move home, perception and grasp planning, then move pick place then home
+		graph.addTask(makeTask(ArmRequest::TASK_CLEAR_RESULTS,client));
+		graph.addTask(makeTask(ArmRequest::TASK_MOVE_HOME,client));
+		graph.addTask(makeTask(ArmRequest::TASK_GRASP_PLANNING_FOR_SORT,client));
+		graph.addTask(makeTask(ArmRequest::TASK_MOVE_TO_PICK_PLACE_THEN_HOME,client));
 	}
 
-	void generateMoveHomeSequence(ros::ServiceClient &clutter_client,ros::ServiceClient &sort_client,
-			TaskSequence &seq)
+	void generateMoveHomeGraph(ros::ServiceClient &clutter_client,ros::ServiceClient &sort_client,
+			TaskGraph &graph)
 	{
-		// defining task sets
-		ConcurrentTaskSet set;
-		TaskDetails task1, task2;
-
-		// clear data
-		set.clear();
-		task1 = task_definitions_[ArmRequest::TASK_MOVE_HOME];
-		task2 = task_definitions_[ArmRequest::TASK_MOVE_HOME];
-		task1.arm_client_ = clutter_client;
-		task2.arm_client_ = sort_client;
-		set.push_back(task1);
-		set.push_back(task2);
-		seq.push_back(set);
+		// both arms move home independently
+		graph.addTask(makeTask(ArmRequest::TASK_MOVE_HOME,clutter_client));
+		graph.addTask(makeTask(ArmRequest::TASK_MOVE_HOME,sort_client));
 	}
 };
 
@@ -0,0 +1,108 @@
+/*
+ * sensor_redirect_benchmark.cpp
+ *
+ * Times the work done per cloud when re-stamping kinect sized PointCloud2 messages: the deep copy the redirect node
+ * used to make, the in place re-stamp it makes now, the serialization round trip paid when the redirect runs in its
+ * own process instead of the camera's nodelet manager, and downsampling.  Reports the time per cloud and the share
+ * of one core needed at the camera frame rate.
+ * usage: sensor_redirect_benchmark [frame_rate] [width] [height] [downsample_step]
+ */
+
+#include <mantis_object_manipulation/utils/SensorDataRedirect.h>
+#include <ros/serialization.h>
+#include <iostream>
+#include <cstdlib>
+
+double FRAME_RATE = 30.0f;
+int WIDTH = 640;
+int HEIGHT = 480;
+int DOWNSAMPLE_STEP = 2;
+const int NUM_FRAMES = 60;
+
+// organized xyz + rgb cloud with the openni driver's layout
+void makeCloud(sensor_msgs::PointCloud2 &cloud)
+{
+	const char* names[] = {"x","y","z","rgb"};
+	const uint32_t offsets[] = {0,4,8,16};
+	cloud.fields.resize(4);
+	for(int i = 0; i < 4; i++)
+	{
+		cloud.fields[i].name = names[i];
+		cloud.fields[i].offset = offsets[i];
+		cloud.fields[i].datatype = sensor_msgs::PointField::FLOAT32;
+		cloud.fields[i].count = 1;
+	}
+
+	cloud.header.frame_id = "camera_rgb_optical_frame";
+	cloud.width = WIDTH;
+	cloud.height = HEIGHT;
+	cloud.point_step = 32;
+	cloud.row_step = cloud.point_step * cloud.width;
+	cloud.is_dense = false;
+	cloud.data.resize(cloud.row_step * cloud.height);
+	for(std::size_t i = 0; i < cloud.data.size(); i++)
+	{
+		cloud.data[i] = rand() % 256;
+	}
+}
+
+void report(const std::string &name,double elapsed,const sensor_msgs::PointCloud2 &last)
+{
+	double perFrame = elapsed/NUM_FRAMES;
+	std::cout<<name<<": "<<perFrame*1e3<<" ms/cloud, "<<100.0f*perFrame*FRAME_RATE<<"% of a core at "<<FRAME_RATE
+			<<" Hz, "<<last.width*last.height<<" points out in "<<last.header.frame_id<<"\n";
+}
+
+int main(int argc,char** argv)
+{
+	FRAME_RATE = argc > 1 ? atof(argv[1]) : FRAME_RATE;
+	WIDTH = argc > 2 ? atoi(argv[2]) : WIDTH;
+	HEIGHT = argc > 3 ? atoi(argv[3]) : HEIGHT;
+	DOWNSAMPLE_STEP = argc > 4 ? atoi(argv[4]) : DOWNSAMPLE_STEP;
+	const std::string frameId = "workcell_frame";
+
+	srand(0);
+	sensor_msgs::PointCloud2Ptr cloud(new sensor_msgs::PointCloud2());
+	makeCloud(*cloud);
+	std::cout<<WIDTH<<"x"<<HEIGHT<<" cloud, "<<cloud->data.size()/(1024.0f*1024.0f)<<" MB\n";
+
+	// deep copy, as the redirect did before
+	sensor_msgs::PointCloud2 copy;
+	ros::WallTime start = ros::WallTime::now();
+	for(int i = 0; i < NUM_FRAMES; i++)
+	{
+		copy = *cloud;
+		copy.header.frame_id = frameId;
+	}
+	report("deep copy",(ros::WallTime::now() - start).toSec(),copy);
+
+	// in place, what the redirect does when roscpp hands it the only reference to the message
+	start = ros::WallTime::now();
+	for(int i = 0; i < NUM_FRAMES; i++)
+	{
+		cloud->header.frame_id = frameId;
+	}
+	report("in place",(ros::WallTime::now() - start).toSec(),*cloud);
+
+	// serialization round trip per hop when the redirect runs as a separate node
+	sensor_msgs::PointCloud2 received;
+	start = ros::WallTime::now();
+	for(int i = 0; i < NUM_FRAMES; i++)
+	{
+		ros::SerializedMessage serialized = ros::serialization::serializeMessage(*cloud);
+		ros::serialization::IStream stream(serialized.message_start,serialized.num_bytes - 4);
+		ros::serialization::deserialize(stream,received);
+	}
+	report("serialize + deserialize",(ros::WallTime::now() - start).toSec(),received);
+
+	// downsampled output
+	sensor_msgs::PointCloud2 downsampled;
+	start = ros::WallTime::now();
+	for(int i = 0; i < NUM_FRAMES; i++)
+	{
+		SensorDataRedirect::downsample(*cloud,DOWNSAMPLE_STEP,downsampled);
+	}
+	report("downsample",(ros::WallTime::now() - start).toSec(),downsampled);
+
+	return 0;
+}
@@ -0,0 +1,111 @@
+/*
+ * zone_fill_benchmark.cpp
+ *
+ * Fills two neighboring place zones to capacity, once testing overlaps against every object in the zones
+ * and once through the object grid, and reports the time per placement and whether both runs placed the
+ * objects at the same locations.
+ * usage: zone_fill_benchmark [zone_size] [object_size] [generation_mode]
+ */
+
+#include <mantis_object_manipulation/zone_selection/PickPlaceZoneSelector.h>
+#include <iostream>
+#include <cstdlib>
+
+typedef PickPlaceZoneSelector::PlaceZone PlaceZone;
+typedef PickPlaceZoneSelector::ObjectDetails ObjectDetails;
+
+double ZONE_SIZE = 1.0f;
+double OBJECT_SIZE = 0.02f;
+int GENERATION_MODE = PlaceZone::GRID_ALONG_X;
+
+void setupZone(PlaceZone &zone,const tf::Vector3 &center,bool useGrid)
+{
+	zone = PlaceZone(tf::Vector3(ZONE_SIZE,ZONE_SIZE,0.0f),center);
+	zone.ZoneName = "benchmark_zone";
+	zone.NumGoalCandidates = 1;
+	zone.MinObjectSpacing = OBJECT_SIZE*1.05f;
+	zone.MaxObjectSpacing = OBJECT_SIZE*1.5f;
+	zone.NextLocationGenMode = GENERATION_MODE;
+	zone.UseObjectGrid = useGrid;
+	zone.resetZone();
+}
+
+// places objects until the zone reports that there is no more room, returns the seconds per placement
+double fillZone(PlaceZone &zone,std::vector<PlaceZone*> &otherZones,std::vector<tf::Vector3> &locations)
+{
+	std::vector<geometry_msgs::PoseStamped> placePoses;
+	ObjectDetails obj(tf::Transform::getIdentity(),tf::Vector3(OBJECT_SIZE,OBJECT_SIZE,OBJECT_SIZE));
+	locations.clear();
+
+	ros::WallTime start = ros::WallTime::now();
+	while(true)
+	{
+		obj.Id = (int)locations.size();
+		zone.setNextObjectDetails(obj);
+		placePoses.clear();
+		if(!zone.generateNextLocationCandidates(placePoses,otherZones))
+		{
+			break;
+		}
+
+		const geometry_msgs::Point &p = placePoses[0].pose.position;
+		locations.push_back(tf::Vector3(p.x,p.y,p.z));
+	}
+	double elapsed = (ros::WallTime::now() - start).toSec();
+	return locations.empty() ? 0.0f : elapsed/locations.size();
+}
+
+bool sameLocations(const std::vector<tf::Vector3> &a,const std::vector<tf::Vector3> &b)
+{
+	if(a.size() != b.size())
+	{
+		return false;
+	}
+
+	for(std::size_t i = 0; i < a.size(); i++)
+	{
+		if(a[i].distance(b[i]) > 1e-9)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc,char** argv)
+{
+	ZONE_SIZE = argc > 1 ? atof(argv[1]) : ZONE_SIZE;
+	OBJECT_SIZE = argc > 2 ? atof(argv[2]) : OBJECT_SIZE;
+	GENERATION_MODE = argc > 3 ? atoi(argv[3]) : GENERATION_MODE;
+
+	// the zone selector reports every failed placement attempt
+	if(ros::console::set_logger_level(ROSCONSOLE_DEFAULT_NAME,ros::console::levels::Fatal))
+	{
+		ros::console::notifyLoggerLevelsChanged();
+	}
+
+	std::vector<tf::Vector3> results[2][2];
+	const char* names[] = {"linear scan","object grid"};
+	for(int g = 0; g < 2; g++)
+	{
+		// same random sequence for both runs
+		srand(0);
+
+		PlaceZone first,second;
+		setupZone(first,tf::Vector3(0.0f,0.0f,0.0f),g == 1);
+		setupZone(second,tf::Vector3(ZONE_SIZE,0.0f,0.0f),g == 1);
+
+		std::vector<PlaceZone*> noZones;
+		std::vector<PlaceZone*> neighborZones(1,&first);
+
+		double firstTime = fillZone(first,noZones,results[g][0]);
+		double secondTime = fillZone(second,neighborZones,results[g][1]);
+		std::cout<<names[g]<<": "<<results[g][0].size()<<" objects at "<<firstTime*1e6<<" us/placement, "
+				<<results[g][1].size()<<" objects next to a full zone at "<<secondTime*1e6<<" us/placement\n";
+	}
+
+	bool identical = sameLocations(results[0][0],results[1][0]) && sameLocations(results[0][1],results[1][1]);
+	std::cout<<"placements "<<(identical ? "identical" : "DIFFER")<<"\n";
+
+	return identical ? 0 : 1;
+}
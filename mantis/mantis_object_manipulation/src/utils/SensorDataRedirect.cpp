@@ -0,0 +1,106 @@
+/*
+ * SensorDataRedirect.cpp
+ */
+
+#include <mantis_object_manipulation/utils/SensorDataRedirect.h>
+#include <cstring>
+
+SensorDataRedirect::SensorDataRedirect()
+:last_publish_stamp_(0),
+ point_cloud_2_frame_id_(""),
+ throttle_rate_(0.0f),
+ downsample_step_(1)
+{
+
+}
+
+SensorDataRedirect::~SensorDataRedirect()
+{
+
+}
+
+void SensorDataRedirect::init(ros::NodeHandle &nh,ros::NodeHandle &pnh)
+{
+	// getting parameters
+	if(!pnh.getParam(POINT_CLOUD2_FRAME_ID_PARAM,point_cloud_2_frame_id_))
+	{
+		nh.getParam(POINT_CLOUD2_FRAME_ID_PARAM,point_cloud_2_frame_id_);
+	}
+	pnh.param(POINT_CLOUD2_THROTTLE_RATE_PARAM,throttle_rate_,throttle_rate_);
+	pnh.param(POINT_CLOUD2_DOWNSAMPLE_STEP_PARAM,downsample_step_,downsample_step_);
+	if(downsample_step_ < 1)
+	{
+		ROS_WARN_STREAM(ros::this_node::getName()<<": Invalid downsample step "<<downsample_step_<<", republishing every point");
+		downsample_step_ = 1;
+	}
+
+	ROS_INFO_STREAM(ros::this_node::getName()<<": Republishing "<<nh.resolveName(POINT_CLOUD2_TOPIC_IN)<<" in frame "
+			<<point_cloud_2_frame_id_<<" on "<<nh.resolveName(POINT_CLOUD2_TOPIC_OUT)<<", throttle rate "<<throttle_rate_
+			<<", downsample step "<<downsample_step_);
+
+	// setting up ros publishers
+	point_cloud2_publ_ = nh.advertise<sensor_msgs::PointCloud2>(POINT_CLOUD2_TOPIC_OUT,1);
+
+	// setting up ros subscribers
+	point_cloud2_subs_ = nh.subscribe(POINT_CLOUD2_TOPIC_IN,1,&SensorDataRedirect::pointCloud2SubsCallback,this);
+}
+
+void SensorDataRedirect::pointCloud2SubsCallback(const sensor_msgs::PointCloud2Ptr &msg)
+{
+	if(point_cloud2_publ_.getNumSubscribers() == 0)
+	{
+		return;
+	}
+
+	if(throttle_rate_ > 0.0f)
+	{
+		// a stamp older than the last one means a bag was restarted
+		if(msg->header.stamp >= last_publish_stamp_ &&
+				(msg->header.stamp - last_publish_stamp_).toSec() < 1.0f/throttle_rate_)
+		{
+			return;
+		}
+		last_publish_stamp_ = msg->header.stamp;
+	}
+
+	if(downsample_step_ > 1)
+	{
+		sensor_msgs::PointCloud2Ptr cloudOut(new sensor_msgs::PointCloud2());
+		downsample(*msg,downsample_step_,*cloudOut);
+		cloudOut->header.frame_id = point_cloud_2_frame_id_;
+		point_cloud2_publ_.publish(cloudOut);
+	}
+	else
+	{
+		msg->header.frame_id = point_cloud_2_frame_id_;
+		point_cloud2_publ_.publish(msg);
+	}
+}
+
+void SensorDataRedirect::downsample(const sensor_msgs::PointCloud2 &cloudIn,int step,sensor_msgs::PointCloud2 &cloudOut)
+{
+	cloudOut.header = cloudIn.header;
+	cloudOut.fields = cloudIn.fields;
+	cloudOut.is_bigendian = cloudIn.is_bigendian;
+	cloudOut.point_step = cloudIn.point_step;
+	cloudOut.is_dense = cloudIn.is_dense;
+
+	// an unorganized cloud is a single row
+	const uint32_t rowStep = cloudIn.height > 1 ? step : 1;
+	cloudOut.width = (cloudIn.width + step - 1)/step;
+	cloudOut.height = (cloudIn.height + rowStep - 1)/rowStep;
+	cloudOut.row_step = cloudOut.width * cloudOut.point_step;
+	cloudOut.data.resize(cloudOut.row_step * cloudOut.height);
+
+	const uint32_t pointStep = cloudIn.point_step;
+	uint8_t *out = cloudOut.data.empty() ? NULL : &cloudOut.data[0];
+	for(uint32_t row = 0; row < cloudIn.height; row += rowStep)
+	{
+		const uint8_t *in = &cloudIn.data[row * cloudIn.row_step];
+		for(uint32_t col = 0; col < cloudIn.width; col += step)
+		{
+			std::memcpy(out,in + col * pointStep,pointStep);
+			out += pointStep;
+		}
+	}
+}
@@ -0,0 +1,258 @@
+/*
+ * StageLatencyMonitor.cpp
+ */
+
+#include <mantis_object_manipulation/utils/StageLatencyMonitor.h>
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+// gcc atomic builtins, the counters are updated from the navigator and the callback threads
+static inline void atomicIncrement(volatile uint64_t *value,uint64_t increment)
+{
+	__sync_fetch_and_add(value,increment);
+}
+
+static inline uint64_t atomicRead(const volatile uint64_t *value)
+{
+	return __sync_fetch_and_add(const_cast<volatile uint64_t*>(value),0);
+}
+
+static inline void atomicMax(volatile uint64_t *value,uint64_t candidate)
+{
+	uint64_t current = atomicRead(value);
+	while(candidate > current)
+	{
+		uint64_t previous = __sync_val_compare_and_swap(value,current,candidate);
+		if(previous == current)
+		{
+			break;
+		}
+		current = previous;
+	}
+}
+
+LatencyHistogram::LatencyHistogram()
+{
+	reset();
+}
+
+void LatencyHistogram::reset()
+{
+	for(int i = 0; i < NUM_BUCKETS; i++)
+	{
+		counts_[i] = 0;
+	}
+	total_count_ = 0;
+	total_usecs_ = 0;
+	max_usecs_ = 0;
+}
+
+int LatencyHistogram::getBucketIndex(uint64_t usecs)
+{
+	const uint64_t linearLimit = 2 << SUB_BUCKET_BITS;
+	if(usecs < linearLimit)
+	{
+		return usecs;
+	}
+
+	if(usecs >> MAX_EXPONENT)
+	{
+		return NUM_BUCKETS - 1;
+	}
+
+	// exponent of the most significant bit, the next SUB_BUCKET_BITS bits select the sub-bucket
+	int exponent = 63 - __builtin_clzll(usecs);
+	int shift = exponent - SUB_BUCKET_BITS;
+	int subBucket = (usecs >> shift) - (1 << SUB_BUCKET_BITS);
+	return linearLimit + (exponent - SUB_BUCKET_BITS - 1)*(1 << SUB_BUCKET_BITS) + subBucket;
+}
+
+uint64_t LatencyHistogram::getBucketLowerBound(int bucket)
+{
+	const int linearLimit = 2 << SUB_BUCKET_BITS;
+	if(bucket < linearLimit)
+	{
+		return bucket;
+	}
+
+	int row = (bucket - linearLimit) >> SUB_BUCKET_BITS;
+	int subBucket = (bucket - linearLimit) & ((1 << SUB_BUCKET_BITS) - 1);
+	int shift = row + 1;
+	return (uint64_t)((1 << SUB_BUCKET_BITS) + subBucket) << shift;
+}
+
+void LatencyHistogram::record(uint64_t usecs)
+{
+	atomicIncrement(&counts_[getBucketIndex(usecs)],1);
+	atomicIncrement(&total_count_,1);
+	atomicIncrement(&total_usecs_,usecs);
+	atomicMax(&max_usecs_,usecs);
+}
+
+uint64_t LatencyHistogram::getCount() const
+{
+	return atomicRead(&total_count_);
+}
+
+double LatencyHistogram::getMean() const
+{
+	uint64_t count = getCount();
+	return count == 0 ? 0.0 : 1.0e-6*atomicRead(&total_usecs_)/count;
+}
+
+double LatencyHistogram::getMax() const
+{
+	return 1.0e-6*atomicRead(&max_usecs_);
+}
+
+double LatencyHistogram::getPercentile(double percentile) const
+{
+	// counts are read one bucket at a time, concurrent records may make the snapshot slightly inconsistent
+	std::vector<uint64_t> counts(NUM_BUCKETS);
+	uint64_t total = 0;
+	for(int i = 0; i < NUM_BUCKETS; i++)
+	{
+		counts[i] = atomicRead(&counts_[i]);
+		total += counts[i];
+	}
+
+	if(total == 0)
+	{
+		return 0.0;
+	}
+
+	if(percentile >= 100.0)
+	{
+		return getMax();
+	}
+
+	uint64_t rank = (uint64_t)std::ceil(total*std::min(std::max(percentile,0.0),100.0)/100.0);
+	rank = std::max<uint64_t>(rank,1);
+	uint64_t accumulated = 0;
+	for(int i = 0; i < NUM_BUCKETS; i++)
+	{
+		accumulated += counts[i];
+		if(accumulated >= rank)
+		{
+			// reporting the middle of the bucket, never more than the largest value recorded
+			uint64_t lower = getBucketLowerBound(i);
+			uint64_t upper = i + 1 < NUM_BUCKETS ? getBucketLowerBound(i + 1) : lower + 1;
+			double value = 0.5*(lower + upper - 1);
+			return 1.0e-6*std::min<double>(value,atomicRead(&max_usecs_));
+		}
+	}
+	return getMax();
+}
+
+StageLatencyMonitor::StageLatencyMonitor()
+:started_(false),
+ publish_period_(10.0f),
+ csv_file_("stage_latency.csv")
+{
+
+}
+
+StageLatencyMonitor::~StageLatencyMonitor()
+{
+	if(started_ && !csv_file_.empty())
+	{
+		writeCsv(csv_file_);
+	}
+}
+
+void StageLatencyMonitor::addStage(const std::string &stage)
+{
+	if(started_)
+	{
+		ROS_ERROR_STREAM(ros::this_node::getName()<<": Latency stage "<<stage<<" must be added before the monitor is started");
+		return;
+	}
+
+	if(stages_.find(stage) == stages_.end())
+	{
+		stages_[stage] = boost::shared_ptr<Stage>(new Stage());
+		stage_order_.push_back(stage);
+	}
+}
+
+void StageLatencyMonitor::start(const std::string &nameSpace,const std::string &topic)
+{
+	ros::NodeHandle nh;
+	ros::param::param(nameSpace + "/" + PARAM_NAME_LATENCY_PUBLISH_PERIOD,publish_period_,publish_period_);
+	ros::param::param(nameSpace + "/" + PARAM_NAME_LATENCY_CSV_FILE,csv_file_,csv_file_);
+
+	summary_pub_ = nh.advertise<mantis_object_manipulation::LatencySummary>(topic,1,true);
+	if(publish_period_ > 0.0f)
+	{
+		summary_timer_ = nh.createTimer(ros::Duration(publish_period_),&StageLatencyMonitor::callbackPublishSummary,this);
+	}
+	started_ = true;
+}
+
+void StageLatencyMonitor::record(const std::string &stage,const ros::WallDuration &duration,bool succeeded)
+{
+	std::map<std::string,boost::shared_ptr<Stage> >::iterator i = stages_.find(stage);
+	if(i == stages_.end())
+	{
+		ROS_WARN_STREAM_ONCE(ros::this_node::getName()<<": Latency stage "<<stage<<" was never added, not recording it");
+		return;
+	}
+
+	Stage &s = *i->second;
+	int64_t usecs = duration.toNSec()/1000;
+	s.Histogram.record(usecs > 0 ? usecs : 0);
+	atomicIncrement(succeeded ? &s.Successes : &s.Failures,1);
+}
+
+void StageLatencyMonitor::getSummary(mantis_object_manipulation::LatencySummary &summary) const
+{
+	summary.header.stamp = ros::Time::now();
+	summary.stages.clear();
+	for(std::size_t i = 0; i < stage_order_.size(); i++)
+	{
+		const Stage &s = *stages_.find(stage_order_[i])->second;
+		mantis_object_manipulation::StageLatency stage;
+		stage.stage = stage_order_[i];
+		stage.count = s.Histogram.getCount();
+		stage.successes = atomicRead(&s.Successes);
+		stage.failures = atomicRead(&s.Failures);
+		stage.mean = s.Histogram.getMean();
+		stage.p50 = s.Histogram.getPercentile(50.0);
+		stage.p95 = s.Histogram.getPercentile(95.0);
+		stage.p99 = s.Histogram.getPercentile(99.0);
+		stage.max = s.Histogram.getMax();
+		summary.stages.push_back(stage);
+	}
+}
+
+bool StageLatencyMonitor::writeCsv(const std::string &fileName) const
+{
+	std::ofstream file(fileName.c_str());
+	if(!file.is_open())
+	{
+		ROS_ERROR_STREAM(ros::this_node::getName()<<": Could not open "<<fileName<<" to save stage latencies");
+		return false;
+	}
+
+	mantis_object_manipulation::LatencySummary summary;
+	getSummary(summary);
+	file<<"stage,count,successes,failures,mean,p50,p95,p99,max\n";
+	for(std::size_t i = 0; i < summary.stages.size(); i++)
+	{
+		const mantis_object_manipulation::StageLatency &s = summary.stages[i];
+		file<<s.stage<<","<<s.count<<","<<s.successes<<","<<s.failures<<","<<s.mean<<","<<s.p50<<","
+				<<s.p95<<","<<s.p99<<","<<s.max<<"\n";
+	}
+
+	ROS_INFO_STREAM(ros::this_node::getName()<<": Stage latencies saved to "<<fileName);
+	return true;
+}
+
+void StageLatencyMonitor::callbackPublishSummary(const ros::TimerEvent &evnt)
+{
+	mantis_object_manipulation::LatencySummary summary;
+	getSummary(summary);
+	summary_pub_.publish(summary);
+}
@@ -470,6 +470,8 @@ void PickPlaceZoneSelector::getAllObjectsMarkers(visualization_msgs::MarkerArray
 void PickPlaceZoneSelector::PlaceZone::resetZone()
 {
 	objects_in_zone_.clear();
+	object_grid_.clear();
+	object_grid_.setCellSize(MinObjectSpacing);
 
 	// computing grid mode
 	tf::Vector3 zoneSize = getSize();
@@ -559,36 +561,50 @@ geometry_msgs::Pose PickPlaceZoneSelector::PlaceZone::getZoneCenterPose()
 	return pose;
 }
 
-bool PickPlaceZoneSelector::PlaceZone::checkOverlaps(ZoneBounds &nextObjBounds,std::vector<PlaceZone* > zones)
+bool PickPlaceZoneSelector::PlaceZone::checkOverlaps(const ZoneBounds &nextObjBounds,const std::vector<PlaceZone* > &zones) const
 {
-	typedef std::vector<PlaceZone* >::iterator Iter;
+	typedef std::vector<PlaceZone* >::const_iterator Iter;
 	for(Iter i = zones.begin();i != zones.end(); i++)
 	{
-		PlaceZone zone = **i;
-//		if(!ZoneBounds::intersect(zone,nextObjBounds) && !ZoneBounds::contains(zone,nextObjBounds))
-//		{
-//			continue;
-//		}
-
+		const PlaceZone &zone = **i;
 		if(ZoneBounds::intersect(zone,nextObjBounds) || ZoneBounds::contains(zone,nextObjBounds))
 		{
 			return true;
 		}
 
-		std::vector<ObjectDetails> &objInZone = (*i)->objects_in_zone_;
-		for(std::size_t j = 0; j < objInZone.size(); j++)
+		if(zone.overlapsObjectInZone(nextObjBounds))
 		{
-			ZoneBounds objBounds = ZoneBounds(objInZone[j].Size,objInZone[j].Trans.getOrigin());
-			if(ZoneBounds::intersect(nextObjBounds,objBounds))
-			{
-				return true;
-			}
+			return true;
 		}
 	}
 
 	return false;
 }
 
+bool PickPlaceZoneSelector::PlaceZone::overlapsObjectInZone(const ZoneBounds &bounds) const
+{
+	if(UseObjectGrid)
+	{
+		return object_grid_.intersectsAny(bounds);
+	}
+
+	for(std::size_t j = 0; j < objects_in_zone_.size(); j++)
+	{
+		ZoneBounds objBounds = ZoneBounds(objects_in_zone_[j].Size,objects_in_zone_[j].Trans.getOrigin());
+		if(ZoneBounds::intersect(bounds,objBounds))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void PickPlaceZoneSelector::PlaceZone::addObjectToZone(const ObjectDetails &obj)
+{
+	objects_in_zone_.push_back(obj);
+	object_grid_.insert(ZoneBounds(obj.Size,obj.Trans.getOrigin()));
+}
+
 bool PickPlaceZoneSelector::PlaceZone::generateNextPlacePoseInRandomizedMode(std::vector<geometry_msgs::PoseStamped> &placePoses,
 		std::vector<PlaceZone* > &otherZones)
 {
@@ -709,17 +725,7 @@ bool PickPlaceZoneSelector::PlaceZone::generateNextPlacePoseInRandomizedMode(std
 		}
 
 		// checking for overlaps against objects already in place region
-		bool overlapFound = false;
-		typedef std::vector<ObjectDetails>::iterator IterType;
-		for(IterType it = objects_in_zone_.begin();it != objects_in_zone_.end(); it++)
-		{
-			ZoneBounds objInZoneBounds(it->Size,it->Trans.getOrigin());
-			if(ZoneBounds::intersect(nextObjectBounds,objInZoneBounds))
-			{
-				overlapFound = true;
-				break;
-			}
-		}
+		bool overlapFound = overlapsObjectInZone(nextObjectBounds);
 
 		if(overlapFound)
 		{
@@ -756,7 +762,7 @@ bool PickPlaceZoneSelector::PlaceZone::generateNextPlacePoseInRandomizedMode(std
 
 	// storing object
 	next_object_details_.Trans = nextTf;
-	objects_in_zone_.push_back(next_object_details_);
+	addObjectToZone(next_object_details_);
 
 	return foundNewPlaceLocation;
 }
@@ -802,16 +808,7 @@ bool PickPlaceZoneSelector::PlaceZone::generateNextPlacePoseInZigZagXMode(std::v
 		}
 
 		// checking if overlaps with objects in place zone
-		typedef std::vector<ObjectDetails>::iterator ConstIter;
-		for(ConstIter iter = objects_in_zone_.begin(); iter != objects_in_zone_.end(); iter++)
-		{
-			ZoneBounds objInZoneBounds(iter->Size,iter->Trans.getOrigin());
-			if(ZoneBounds::intersect(nextObjectBounds,objInZoneBounds))
-			{
-				overlapFound = true;
-				break;
-			}
-		}
+		overlapFound = overlapsObjectInZone(nextObjectBounds);
 		if(overlapFound)
 		{
 			nextIndex++;
@@ -846,7 +843,7 @@ bool PickPlaceZoneSelector::PlaceZone::generateNextPlacePoseInZigZagXMode(std::v
 
 		// storing object
 		next_object_details_.Trans = nextTf;
-		objects_in_zone_.push_back(next_object_details_);
+		addObjectToZone(next_object_details_);
 	}
 
 	return !overlapFound;
@@ -895,16 +892,7 @@ bool PickPlaceZoneSelector::PlaceZone::generateNextPlacePoseInZigZagYMode(std::v
 		}
 
 		// checking if overlaps with objects in place zone
-		typedef std::vector<ObjectDetails>::iterator ConstIter;
-		for(ConstIter iter = objects_in_zone_.begin(); iter != objects_in_zone_.end(); iter++)
-		{
-			ZoneBounds objInZoneBounds(iter->Size,iter->Trans.getOrigin());
-			if(ZoneBounds::intersect(nextObjectBounds,objInZoneBounds))
-			{
-				overlapFound = true;
-				break;
-			}
-		}
+		overlapFound = overlapsObjectInZone(nextObjectBounds);
 		if(overlapFound)
 		{
 			nextIndex++;
@@ -939,7 +927,7 @@ bool PickPlaceZoneSelector::PlaceZone::generateNextPlacePoseInZigZagYMode(std::v
 
 		// storing object
 		next_object_details_.Trans = nextTf;
-		objects_in_zone_.push_back(next_object_details_);
+		addObjectToZone(next_object_details_);
 	}
 
 	return !overlapFound;
@@ -990,16 +978,7 @@ bool PickPlaceZoneSelector::PlaceZone::generateNextPlacePoseInGridXWise(std::vec
 		}
 
 		// checking if overlaps with objects in place zone
-		typedef std::vector<ObjectDetails>::iterator ConstIter;
-		for(ConstIter iter = objects_in_zone_.begin(); iter != objects_in_zone_.end(); iter++)
-		{
-			ZoneBounds objInZoneBounds(iter->Size,iter->Trans.getOrigin());
-			if(ZoneBounds::intersect(nextObjectBounds,objInZoneBounds))
-			{
-				overlapFound = true;
-				break;
-			}
-		}
+		overlapFound = overlapsObjectInZone(nextObjectBounds);
 		if(overlapFound)
 		{
 			nextIndex++;
@@ -1034,7 +1013,7 @@ bool PickPlaceZoneSelector::PlaceZone::generateNextPlacePoseInGridXWise(std::vec
 
 		// storing object
 		next_object_details_.Trans = nextTf;
-		objects_in_zone_.push_back(next_object_details_);
+		addObjectToZone(next_object_details_);
 	}
 
 	return !overlapFound;
@@ -1085,16 +1064,7 @@ bool PickPlaceZoneSelector::PlaceZone::generateNextPlacePoseInGridYWise(std::vec
 		}
 
 		// checking if overlaps with objects in place zone
-		typedef std::vector<ObjectDetails>::iterator ConstIter;
-		for(ConstIter iter = objects_in_zone_.begin(); iter != objects_in_zone_.end(); iter++)
-		{
-			ZoneBounds objInZoneBounds(iter->Size,iter->Trans.getOrigin());
-			if(ZoneBounds::intersect(nextObjectBounds,objInZoneBounds))
-			{
-				overlapFound = true;
-				break;
-			}
-		}
+		overlapFound = overlapsObjectInZone(nextObjectBounds);
 		if(overlapFound)
 		{
 			nextIndex++;
@@ -1129,7 +1099,7 @@ bool PickPlaceZoneSelector::PlaceZone::generateNextPlacePoseInGridYWise(std::vec
 
 		// storing object
 		next_object_details_.Trans = nextTf;
-		objects_in_zone_.push_back(next_object_details_);
+		addObjectToZone(next_object_details_);
 	}
 
 	return !overlapFound;
@@ -1254,7 +1224,7 @@ bool PickPlaceZoneSelector::PlaceZone::generateNextPlacePoseInCircle(std::vector
 
 		// storing object
 		next_object_details_.Trans = nextTf;
-		objects_in_zone_.push_back(next_object_details_);
+		addObjectToZone(next_object_details_);
 	}
 
 	return !overlapFound;
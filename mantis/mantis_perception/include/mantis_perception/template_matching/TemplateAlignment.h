@@ -23,6 +23,8 @@
 #include <ros/ros.h>
 #include <tf/tfMessage.h>
 #include <tf/LinearMath/Transform.h>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
 
 
 
@@ -33,6 +35,7 @@ class TemplateAlignment
 	typedef pcl::PointCloud<pcl::Normal> NormalsCloud;
 	typedef pcl::PointCloud<pcl::FPFHSignature33> LocalFeatures;
 	typedef pcl::search::KdTree<pcl::PointXYZ> SearchMethod;
+	typedef pcl::SampleConsensusInitialAlignment<pcl::PointXYZ, pcl::PointXYZ, pcl::FPFHSignature33> InitialAlignment;
 
 public:
 	struct ModelFeatureData
@@ -92,6 +95,11 @@ public:
 			return true;
 		}
 
+		// Loads fileName like setInputCloud would, reusing the points, normals and features stored in cacheFile when
+		// they were computed from the same file with the same radii, voxel size and view point.  Otherwise they are
+		// computed and cacheFile is rewritten.
+		bool loadInputCloud(std::string fileName, std::string cacheFile, bool downsample = false, float voxelSide = 0.002f);
+
 
 		// data
 		std::string ModelName_;
@@ -147,6 +155,18 @@ public:
 		max_iterations_ = iters;
 	}
 
+	// alignment stops taking new templates once one scores below this, 0 aligns every template
+	void setFitnessThreshold(float score)
+	{
+		fitness_threshold_ = score;
+	}
+
+	// number of templates aligned concurrently, 0 uses one thread per core
+	void setNumThreads(int threads)
+	{
+		num_threads_ = threads;
+	}
+
 	void setCandidateModel(ModelFeatureData &candidate);
 	void addModelTemplate(ModelFeatureData &templateData);
 	std::vector<ModelFeatureData>& getModelTemplates();
@@ -154,16 +174,38 @@ public:
 
 protected:
 
-	void align(const ModelFeatureData &templateData, AlignmentResult &result);
+	// SAC-IA instance owned by one thread.  It keeps the point and feature trees of the candidate it
+	// was last given, so they are only rebuilt when the candidate changes.
+	struct AlignmentWorker
+	{
+		AlignmentWorker()
+		:candidate_revision_(-1)
+		{
+
+		}
+
+		InitialAlignment sac_initial_alignment_;
+		int candidate_revision_;
+	};
+
+	void align(AlignmentWorker &worker,const ModelFeatureData &templateData, AlignmentResult &result);
 	void align(const std::vector<ModelFeatureData> &templates,std::vector<AlignmentResult> &results);
+	void alignTemplates(AlignmentWorker &worker,const std::vector<ModelFeatureData> &templates,
+			std::vector<AlignmentResult> &results,std::vector<char> &completed);
 
 	std::vector<ModelFeatureData> model_templates_;
 	ModelFeatureData model_candidate_;
+	int candidate_revision_;
+
+	std::vector<boost::shared_ptr<AlignmentWorker> > workers_;
+	unsigned int next_template_;
+	int stop_;
 
-	pcl::SampleConsensusInitialAlignment<pcl::PointXYZ, pcl::PointXYZ, pcl::FPFHSignature33> sac_initial_alignment_;
 	float min_sample_distance_;
 	float max_correspondance_distance_;
 	int max_iterations_;
+	float fitness_threshold_;
+	int num_threads_;
 
 };
 
@@ -0,0 +1,373 @@
+//cph_feature_index.h
+//Training set and persistent FLANN index used by the cph recognition node.
+#ifndef CPH_FEATURE_INDEX_H
+#define CPH_FEATURE_INDEX_H
+
+#include <pcl/console/print.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <flann/flann.h>
+
+#include <boost/filesystem.hpp>
+
+#include <nrg_object_recognition/feature_database.h>
+
+typedef std::pair<std::string, std::vector<float> > cph_model;
+typedef flann::Index<flann::ChiSquareDistance<float> > cph_index;
+
+/** \brief Ordering used so that index rows map to the same model on every start up */
+inline bool
+compareModelNames (const cph_model &a, const cph_model &b)
+{
+  return (a.first < b.first);
+}
+
+inline bool
+loadHist (const boost::filesystem::path &path, unsigned int hist_size, cph_model &cph)
+{
+  //path is the location of the file being read.
+  std::ifstream featureFile;
+  featureFile.open(path.string().c_str(), std::ifstream::in);
+  if (!featureFile.is_open())
+    return (false);
+
+  cph.second.clear();
+  cph.second.reserve(hist_size);
+  float value;
+  for(unsigned int i=0; i<hist_size; i++){
+   featureFile >> value;
+   cph.second.push_back(value);
+  }
+  cph.first = path.string ();
+
+  return (true);
+}
+
+/** \brief Splits a training file name of the form <dir>/<label>_<angle>.csv into the label
+  * (with the leading "/home" stripped, as the recognition nodes expect) and the view angle
+  */
+inline void
+parseModelName (const std::string &model_name, std::string &label, int &angle)
+{
+  std::string cloud_name = model_name;
+  cloud_name.erase(cloud_name.end()-3, cloud_name.end());
+  std::string angleStr;
+  angleStr.assign(cloud_name.begin()+cloud_name.rfind("_")+1, cloud_name.end());
+  label.assign(cloud_name.begin()+5, cloud_name.begin()+cloud_name.rfind("_"));
+  angle = atoi(angleStr.c_str());
+}
+
+/** \brief Recursively load every feature file with the given extension below base_dir
+  * \param base_dir the root of the training data
+  * \param extension feature file extension (".csv")
+  * \param hist_size number of values per feature
+  * \param models the loaded models are appended here
+  * \param newest set to the newest modification time of any loaded file
+  */
+inline void
+loadFeatureModels (const boost::filesystem::path &base_dir, const std::string &extension,
+                   unsigned int hist_size, std::vector<cph_model> &models, std::time_t &newest)
+{
+  if (!boost::filesystem::exists (base_dir) && !boost::filesystem::is_directory (base_dir))
+    return;
+
+  for (boost::filesystem::directory_iterator it (base_dir); it != boost::filesystem::directory_iterator (); ++it)
+  {
+    if (boost::filesystem::is_directory (it->status ()))
+    {
+      std::stringstream ss;
+      ss << it->path ();
+      pcl::console::print_highlight ("Loading %s (%lu models loaded so far).\n", ss.str ().c_str (), (unsigned long)models.size ());
+      loadFeatureModels (it->path (), extension, hist_size, models, newest);
+    }
+    if (boost::filesystem::is_regular_file (it->status ()) && boost::filesystem::extension (it->path ()) == extension)
+    {
+      cph_model m;
+      if (loadHist (base_dir / it->path ().filename (), hist_size, m))
+      {
+        models.push_back (m);
+        newest = std::max (newest, boost::filesystem::last_write_time (it->path ()));
+      }
+    }
+  }
+}
+
+/** \brief Holds the cph training matrix and a FLANN index that is built (or loaded) once
+  * and then shared by every recognition request.
+  *
+  * The matrix is either parsed from a directory of per view files or used in place from a mapped
+  * feature database (see build_feature_database), which nodes on the same machine share.
+  */
+class CPHFeatureIndex
+{
+public:
+
+  enum IndexType
+  {
+    LINEAR, KDTREE, KMEANS
+  };
+
+  CPHFeatureIndex() :
+    index_type_(KDTREE), trees_(4), branching_(32), iterations_(11), checks_(512), owns_data_(false), index_(NULL)
+  {
+    data_ = flann::Matrix<float>(NULL, 0, 0);
+    newest_model_ = 0;
+  };
+
+  ~CPHFeatureIndex()
+  {
+    clear();
+  };
+
+  /** \brief Parses "linear", "kdtree" or "kmeans", returns false for anything else */
+  static bool parseIndexType(const std::string &name, IndexType &type)
+  {
+    if(name == "linear")
+      type = LINEAR;
+    else if(name == "kdtree")
+      type = KDTREE;
+    else if(name == "kmeans")
+      type = KMEANS;
+    else
+      return false;
+    return true;
+  };
+
+  void setIndexType(IndexType type) { index_type_ = type; };
+  void setTrees(int trees) { trees_ = trees; };
+  void setBranching(int branching) { branching_ = branching; };
+  void setIterations(int iterations) { iterations_ = iterations; };
+  void setChecks(int checks) { checks_ = checks; };
+
+  IndexType getIndexType() const { return index_type_; };
+  int getChecks() const { return checks_; };
+  unsigned int getNumModels() const { return model_names_.size(); };
+  /** \brief Path of the training file of a row, as parseModelName expects it */
+  const std::string& getModelName(unsigned int row) const { return model_names_.at(row); };
+  const flann::Matrix<float>& getData() const { return data_; };
+
+  /** \brief Reads all training features below base_dir and packs them into the FLANN matrix */
+  bool loadModels(const boost::filesystem::path &base_dir, unsigned int hist_size)
+  {
+    clear();
+    std::vector<cph_model> models;
+    loadFeatureModels (base_dir, ".csv", hist_size, models, newest_model_);
+    if(models.empty())
+      return false;
+    std::sort(models.begin(), models.end(), compareModelNames);
+
+    // Convert data into FLANN format
+    data_ = flann::Matrix<float> (new float[models.size () * hist_size], models.size (), hist_size);
+    owns_data_ = true;
+    model_names_.resize(models.size());
+    for (size_t i = 0; i < data_.rows; ++i)
+    {
+      std::copy(models[i].second.begin(), models[i].second.end(), data_[i]);
+      model_names_[i] = models[i].first;
+    }
+    return true;
+  };
+
+  /** \brief Maps a feature database and uses its matrix in place
+    * \param file the database
+    * \param hist_size number of values per feature, the database must match it
+    * \param base_dir the training directory the row names are relative to
+    */
+  bool loadDatabase(const std::string &file, unsigned int hist_size, const boost::filesystem::path &base_dir)
+  {
+    clear();
+    if(!database_.open(file))
+      return false;
+    if(database_.getCols() != hist_size || database_.getRows() == 0)
+    {
+      pcl::console::print_error ("%s has %d x %d features, expected %d columns\n", file.c_str(),
+                                 (int)database_.getRows(), (int)database_.getCols(), (int)hist_size);
+      database_.close();
+      return false;
+    }
+
+    //FLANN only reads the matrix, so the read only mapping can back it directly.
+    data_ = flann::Matrix<float> (const_cast<float*>(database_.getData()), database_.getRows(), database_.getCols());
+    owns_data_ = false;
+    model_names_.resize(data_.rows);
+    for (size_t i = 0; i < data_.rows; ++i)
+      model_names_[i] = (base_dir / database_.getName(i)).string();
+    newest_model_ = boost::filesystem::last_write_time(file);
+    return true;
+  };
+
+  /** \brief Loads the saved index at index_file if it is newer than all training features and
+    * was built with the current index type and parameters for a training matrix of the same size,
+    * otherwise builds a new one and saves it there.
+    * The type and parameters are kept in <index_file>.params, next to the index.
+    * \param index_file path of the serialized index, empty to skip saving/loading
+    */
+  bool buildIndex(const std::string &index_file)
+  {
+    if(data_.rows == 0)
+      return false;
+
+    delete index_;
+    index_ = NULL;
+
+    const std::string params_file = index_file + ".params";
+    if(!index_file.empty() && boost::filesystem::exists(index_file) &&
+       boost::filesystem::last_write_time(index_file) >= newest_model_ &&
+       readIndexDescription(params_file) == describeIndex())
+    {
+      try
+      {
+        index_ = new cph_index(data_, flann::SavedIndexParams(index_file));
+        pcl::console::print_info ("Loaded saved index %s\n", index_file.c_str());
+        return true;
+      }
+      catch(flann::FLANNException &e)
+      {
+        pcl::console::print_warn ("Saved index %s does not match training data (%s), rebuilding\n",
+                                  index_file.c_str(), e.what());
+        delete index_;
+        index_ = NULL;
+      }
+    }
+
+    index_ = new cph_index(data_, makeIndexParams());
+    index_->buildIndex();
+
+    if(!index_file.empty() && index_type_ != LINEAR)
+    {
+      try
+      {
+        //Drop the old description first so an interrupted save is never taken for a match
+        boost::filesystem::remove(params_file);
+        index_->save(index_file);
+        std::ofstream params(params_file.c_str());
+        params << describeIndex() << std::endl;
+        pcl::console::print_info ("Saved index to %s\n", index_file.c_str());
+      }
+      catch(std::exception &e)
+      {
+        pcl::console::print_warn ("Could not save index to %s: %s\n", index_file.c_str(), e.what());
+      }
+    }
+    return true;
+  };
+
+  /** \brief Search for the closest k neighbors of a single feature
+    * \param feature the query histogram
+    * \param k the number of neighbors to search for
+    * \param indices the resultant neighbor indices (size k)
+    * \param distances the resultant neighbor distances (size k)
+    */
+  bool nearestKSearch(const std::vector<float> &feature, int k,
+                      std::vector<int> &indices, std::vector<float> &distances) const
+  {
+    if(index_ == NULL || feature.size() != data_.cols)
+      return false;
+
+    indices.resize(k);
+    distances.resize(k);
+    flann::Matrix<float> p(const_cast<float*>(&feature[0]), 1, feature.size());
+    flann::Matrix<int> ind(&indices[0], 1, k);
+    flann::Matrix<float> dist(&distances[0], 1, k);
+    index_->knnSearch(p, ind, dist, k, flann::SearchParams(checks_));
+    return true;
+  };
+
+  /** \brief Search for the closest k neighbors of every row of queries in a single call
+    * \param queries one histogram per row
+    * \param k the number of neighbors to search for
+    * \param indices the resultant neighbor indices (queries.rows x k)
+    * \param distances the resultant neighbor distances (queries.rows x k)
+    */
+  bool nearestKSearch(const flann::Matrix<float> &queries, int k,
+                      std::vector<int> &indices, std::vector<float> &distances) const
+  {
+    if(index_ == NULL || queries.cols != data_.cols || queries.rows == 0)
+      return false;
+
+    indices.resize(queries.rows * k);
+    distances.resize(queries.rows * k);
+    flann::Matrix<int> ind(&indices[0], queries.rows, k);
+    flann::Matrix<float> dist(&distances[0], queries.rows, k);
+    index_->knnSearch(queries, ind, dist, k, flann::SearchParams(checks_));
+    return true;
+  };
+
+private:
+
+  CPHFeatureIndex(const CPHFeatureIndex&);
+  CPHFeatureIndex& operator=(const CPHFeatureIndex&);
+
+  flann::IndexParams makeIndexParams() const
+  {
+    switch(index_type_)
+    {
+      case KDTREE:
+        return flann::KDTreeIndexParams(trees_);
+      case KMEANS:
+        return flann::KMeansIndexParams(branching_, iterations_);
+      default:
+        return flann::LinearIndexParams();
+    }
+  };
+
+  /** \brief One line naming the index type, its build parameters and the training matrix size */
+  std::string describeIndex() const
+  {
+    std::stringstream ss;
+    switch(index_type_)
+    {
+      case KDTREE:
+        ss << "kdtree trees " << trees_;
+        break;
+      case KMEANS:
+        ss << "kmeans branching " << branching_ << " iterations " << iterations_;
+        break;
+      default:
+        ss << "linear";
+    }
+    ss << " rows " << data_.rows << " cols " << data_.cols;
+    return ss.str();
+  };
+
+  /** \brief First line of a saved index description, empty if there is none */
+  static std::string readIndexDescription(const std::string &params_file)
+  {
+    std::string line;
+    std::ifstream params(params_file.c_str());
+    if(params.is_open())
+      std::getline(params, line);
+    return line;
+  };
+
+  void clear()
+  {
+    delete index_;
+    index_ = NULL;
+    if(owns_data_)
+      delete[] data_.ptr();
+    data_ = flann::Matrix<float>(NULL, 0, 0);
+    owns_data_ = false;
+    database_.close();
+    model_names_.clear();
+    newest_model_ = 0;
+  };
+
+  IndexType index_type_;
+  int trees_, branching_, iterations_, checks_;
+  std::vector<std::string> model_names_;
+  std::time_t newest_model_;
+  flann::Matrix<float> data_;
+  bool owns_data_;
+  nrg_object_recognition::FeatureDatabase database_;
+  cph_index *index_;
+};
+
+#endif
@@ -0,0 +1,120 @@
+//cph_index_benchmark.cpp
+//Compares per-query recognition latency of the old rebuild-every-call linear index
+//against indices built once at start up.
+//usage: cph_index_benchmark <training data directory> [num_queries] [noise]
+#include <pcl/console/print.h>
+
+#include <iostream>
+#include <vector>
+
+#include <flann/flann.h>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/variate_generator.hpp>
+
+#include "ros/ros.h"
+#include "cph_feature_index.h"
+
+int num_ybins = 5; int num_rbins = 72;
+int histSize = num_ybins*num_rbins+3;
+
+/** \brief Old behavior: build a linear index over all training data for every query */
+double
+benchmarkRebuild (const flann::Matrix<float> &data, const std::vector<std::vector<float> > &queries,
+                  std::vector<int> &labels)
+{
+  labels.resize(queries.size());
+  int index = 0;
+  float distance = 0;
+  ros::WallTime start = ros::WallTime::now();
+  for(unsigned int i=0; i<queries.size(); i++)
+  {
+    cph_index linear(data, flann::LinearIndexParams());
+    linear.buildIndex();
+    flann::Matrix<float> p(const_cast<float*>(&queries[i][0]), 1, queries[i].size());
+    flann::Matrix<int> ind(&index, 1, 1);
+    flann::Matrix<float> dist(&distance, 1, 1);
+    linear.knnSearch(p, ind, dist, 1, flann::SearchParams(512));
+    labels[i] = index;
+  }
+  return (ros::WallTime::now() - start).toSec() / queries.size();
+}
+
+/** \brief New behavior: index is built once, only the query is timed */
+double
+benchmarkPrebuilt (CPHFeatureIndex &feature_index, const std::vector<std::vector<float> > &queries,
+                   std::vector<int> &labels, double &build_time)
+{
+  ros::WallTime start = ros::WallTime::now();
+  feature_index.buildIndex("");
+  build_time = (ros::WallTime::now() - start).toSec();
+
+  labels.resize(queries.size());
+  std::vector<int> indices;
+  std::vector<float> distances;
+  start = ros::WallTime::now();
+  for(unsigned int i=0; i<queries.size(); i++)
+  {
+    feature_index.nearestKSearch(queries[i], 1, indices, distances);
+    labels[i] = indices[0];
+  }
+  return (ros::WallTime::now() - start).toSec() / queries.size();
+}
+
+int main(int argc, char **argv)
+{
+  if(argc < 2)
+  {
+    std::cout << "usage: cph_index_benchmark <training data directory> [num_queries] [noise]\n";
+    return(1);
+  }
+  ros::Time::init();
+
+  int num_queries = argc > 2 ? atoi(argv[2]) : 200;
+  double noise = argc > 3 ? atof(argv[3]) : 0.5;
+
+  CPHFeatureIndex feature_index;
+  if(!feature_index.loadModels(argv[1], histSize))
+  {
+    pcl::console::print_error ("No cph models found in %s\n", argv[1]);
+    return(1);
+  }
+  const flann::Matrix<float> &data = feature_index.getData();
+  pcl::console::print_highlight ("Loaded %d CPH models\n", (int)data.rows);
+
+  //Queries are training features perturbed with gaussian noise
+  boost::mt19937 rng(0);
+  boost::normal_distribution<float> nd(0.0f, noise);
+  boost::variate_generator<boost::mt19937&, boost::normal_distribution<float> > var_nor(rng, nd);
+  std::vector<std::vector<float> > queries(num_queries);
+  for(int i=0; i<num_queries; i++)
+  {
+    const float *row = data[i % data.rows];
+    queries[i].assign(row, row + data.cols);
+    for(unsigned int j=0; j<data.cols; j++)
+      queries[i][j] += var_nor();
+  }
+
+  std::vector<int> exact, labels;
+  double rebuild = benchmarkRebuild(data, queries, exact);
+  std::cout << "rebuild linear per call: " << rebuild*1000.0 << " ms/query\n";
+
+  const char *names[] = {"linear", "kdtree", "kmeans"};
+  for(int t=CPHFeatureIndex::LINEAR; t<=CPHFeatureIndex::KMEANS; t++)
+  {
+    double build_time;
+    feature_index.setIndexType((CPHFeatureIndex::IndexType)t);
+    double query = benchmarkPrebuilt(feature_index, queries, labels, build_time);
+
+    int agree = 0;
+    for(unsigned int i=0; i<labels.size(); i++)
+      if(labels[i] == exact[i])
+        agree++;
+    std::cout << "prebuilt " << names[t] << ": build " << build_time*1000.0 << " ms, "
+              << query*1000.0 << " ms/query, speedup " << rebuild/query << "x, "
+              << 100.0*agree/labels.size() << "% match exact nearest neighbor\n";
+  }
+
+  return(0);
+}
@@ -8,6 +8,7 @@
 
 #include <iostream>
 #include <fstream>
+#include <map>
 
 #include <flann/flann.h>
 
@@ -17,18 +18,15 @@
 #include <boost/random/variate_generator.hpp>
 
 #include <nrg_object_recognition/recognition.h>
+#include <mantis_perception/cph_batch_recognition.h>
 
 #include "ros/ros.h"
 #include "sensor_msgs/PointCloud2.h"
-#include "cph.h"
+#include <nrg_object_recognition/cph.h>
+#include "cph_feature_index.h"
 
 
-typedef std::pair<std::string, std::vector<float> > cph_model;
-std::vector<cph_model> models;
-flann::Matrix<int> k_indices;
-flann::Matrix<float> k_distances;
-flann::Matrix<float> *data;
-sensor_msgs::PointCloud2 fromKinect;
+CPHFeatureIndex feature_index;
 ros::Publisher pub;
 std::ofstream outFile;
 int segCount = 0;
@@ -36,78 +34,10 @@ int num_ybins = 5; int num_rbins = 72;
 int histSize = num_ybins*num_rbins+3;
 
 
-/** \brief Search for the closest k neighbors
-  * \param index the tree
-  * \param model the query model
-  * \param k the number of neighbors to search for
-  * \param indices the resultant neighbor indices
-  * \param distances the resultant neighbor distances
-  */
-inline void
-nearestKSearch (flann::Index<flann::ChiSquareDistance<float> > &index, const cph_model &model, 
-                int k, flann::Matrix<int> &indices, flann::Matrix<float> &distances)
-{
-  // Query point
-  flann::Matrix<float> p = flann::Matrix<float>(new float[model.second.size ()], 1, model.second.size ());
-  memcpy (&p.ptr ()[0], &model.second.at(0), p.cols * p.rows * sizeof (int));
-
-  indices = flann::Matrix<int>(new int[k], 1, k);
-  distances = flann::Matrix<float>(new float[k], 1, k);
-  index.knnSearch (p, indices, distances, k, flann::SearchParams (512));
-  delete[] p.ptr ();
-}
-
-bool
-loadHist (const boost::filesystem::path &path, cph_model &cph)
-{
-  //path is the location of the file being read.
-  std::ifstream featureFile;
-  featureFile.open(path.string().c_str(), std::ifstream::in);
-  cph.second.clear();
-  float value;
-  for(unsigned int i=0; i<histSize; i++){
-   featureFile >> value;
-   cph.second.push_back(value); 
-  }
-  cph.first = path.string ();
-  
-  return (true);
-}
-
-void
-loadFeatureModels (const boost::filesystem::path &base_dir, const std::string &extension, 
-                   std::vector<cph_model> &models)
-{
-  if (!boost::filesystem::exists (base_dir) && !boost::filesystem::is_directory (base_dir))
-    return;
-
-  for (boost::filesystem::directory_iterator it (base_dir); it != boost::filesystem::directory_iterator (); ++it)
-  {
-    if (boost::filesystem::is_directory (it->status ()))
-    {
-      std::stringstream ss;
-      ss << it->path ();
-      pcl::console::print_highlight ("Loading %s (%lu models loaded so far).\n", ss.str ().c_str (), (unsigned long)models.size ());
-      loadFeatureModels (it->path (), extension, models);
-    }
-    if (boost::filesystem::is_regular_file (it->status ()) && boost::filesystem::extension (it->path ()) == extension)
-    {
-      cph_model m;
-      if (loadHist (base_dir / it->path ().filename (), m))
-        models.push_back (m);
-    }
-  }
-}
-
-
 bool recognize_cb(nrg_object_recognition::recognition::Request &srv_request,
 		  nrg_object_recognition::recognition::Response &srv_response)
 {
   
-  //create knn index
-  flann::Index<flann::ChiSquareDistance<float> > index (*data, flann::LinearIndexParams ());
-  index.buildIndex ();
-  
   pcl::PointCloud<pcl::PointXYZ>::Ptr cluster (new pcl::PointCloud<pcl::PointXYZ>);
   pcl::fromROSMsg(srv_request.cluster, *cluster);
   
@@ -115,7 +45,6 @@ bool recognize_cb(nrg_object_recognition::recognition::Request &srv_request,
   CPHEstimation cph(num_ybins,num_rbins);
     
   //Hold results:
-  std::string label, angleStr;
   int angle;
   Eigen::Vector4f translation;
     
@@ -137,32 +66,23 @@ bool recognize_cb(nrg_object_recognition::recognition::Request &srv_request,
  // float thresh = 280; //similarity threshold
   int k = 1; //number of neighbors
   
-  cph_model histogram;
-  histogram.second.resize(histSize);
-  
-  
-  std::cout << "copying feature to histogram... ";
-  for (size_t i = 0; i < histSize; ++i)
+  //KNN classification against the index built at start up
+  std::vector<int> k_indices;
+  std::vector<float> k_distances;
+  if(!feature_index.nearestKSearch (feature, k, k_indices, k_distances))
   {
-      histogram.second[i] = feature.at(i);
+    ROS_ERROR("Feature of size %d does not match training data", (int)feature.size());
+    return(1);
   }
-  std::cout << "done copying to histogram\n";
-  //KNN classification
-  nearestKSearch (index, histogram, k, k_indices, k_distances);
   
   //determine label and pose:
-  if(k_distances[0][0] < srv_request.threshold){
-    //std::cout << "distance: " << k_distances[0][0] << std::endl;
-    ROS_INFO("%f", k_distances[0][0]);
+  if(k_distances[0] < srv_request.threshold){
+    //std::cout << "distance: " << k_distances[0] << std::endl;
+    ROS_INFO("%f", k_distances[0]);
     ROS_INFO("Loading nearest match");
     //Load nearest match
-    std::string cloud_name = models.at(k_indices[0][0]).first;
-
-    cloud_name.erase(cloud_name.end()-3, cloud_name.end());
-    angleStr.assign(cloud_name.begin()+cloud_name.rfind("_")+1, cloud_name.end());
     std::string label;
-    label.assign(cloud_name.begin()+5, cloud_name.begin()+cloud_name.rfind("_"));
-    angle = atoi(angleStr.c_str());
+    parseModelName(feature_index.getModelName(k_indices[0]), label, angle);
     srv_response.label = label;
     srv_response.pose.rotation = angle;        
   }
@@ -173,6 +93,101 @@ bool recognize_cb(nrg_object_recognition::recognition::Request &srv_request,
 		  return(1);
 }
 
+/** \brief Short part name used for voting, i.e. the text after the last '/' of a label */
+std::string
+shortLabel(const std::string &label)
+{
+  std::size_t found = label.find_last_of("/");
+  return found == std::string::npos ? label : label.substr(found+1);
+}
+
+bool batch_recognize_cb(mantis_perception::cph_batch_recognition::Request &srv_request,
+                        mantis_perception::cph_batch_recognition::Response &srv_response)
+{
+  const unsigned int num_clusters = srv_request.clusters.size();
+  const int k = std::max<int>(1, std::min<int>(srv_request.k, feature_index.getNumModels()));
+  srv_response.results.resize(num_clusters);
+  if(num_clusters == 0)
+    return true;
+
+  //Compute every feature once into a single query matrix
+  flann::Matrix<float> queries(new float[num_clusters*histSize], num_clusters, histSize);
+  CPHEstimation cph(num_ybins,num_rbins);
+  pcl::PointCloud<pcl::PointXYZ>::Ptr cluster (new pcl::PointCloud<pcl::PointXYZ>);
+  std::vector<float> feature;
+  for(unsigned int i=0; i<num_clusters; i++)
+  {
+    pcl::fromROSMsg(srv_request.clusters[i], *cluster);
+
+    Eigen::Vector4f centroid;
+    pcl::compute3DCentroid (*cluster, centroid);
+    mantis_perception::cph_result &result = srv_response.results[i];
+    result.pose.x = centroid(0);
+    result.pose.y = centroid(1);
+    result.pose.z = centroid(2);
+
+    cph.setInputCloud (cluster);
+    cph.compute(feature);
+    std::copy(feature.begin(), feature.begin()+histSize, queries[i]);
+  }
+
+  //One knn query for all clusters
+  std::vector<int> k_indices;
+  std::vector<float> k_distances;
+  bool found = feature_index.nearestKSearch (queries, k, k_indices, k_distances);
+  delete[] queries.ptr();
+  if(!found)
+  {
+    ROS_ERROR("Batch knn search failed");
+    return false;
+  }
+
+  //Neighbors within threshold vote on the part label, the closest one of the winning part gives the rotation
+  for(unsigned int i=0; i<num_clusters; i++)
+  {
+    mantis_perception::cph_result &result = srv_response.results[i];
+    std::map<std::string, int> votes;
+    std::map<std::string, int> closest;
+    for(int j=0; j<k; j++)
+    {
+      std::string label;
+      int angle;
+      parseModelName(feature_index.getModelName(k_indices[i*k+j]), label, angle);
+      result.neighbor_labels.push_back(label);
+      result.neighbor_distances.push_back(k_distances[i*k+j]);
+      if(k_distances[i*k+j] < srv_request.threshold)
+      {
+        std::string part = shortLabel(label);
+        if(votes[part]++ == 0)
+          closest[part] = j;
+      }
+    }
+
+    int best_votes = 0;
+    std::string best_part;
+    for(std::map<std::string, int>::iterator v = votes.begin(); v != votes.end(); ++v)
+    {
+      if(v->second > best_votes || (v->second == best_votes && closest[v->first] < closest[best_part]))
+      {
+        best_votes = v->second;
+        best_part = v->first;
+      }
+    }
+
+    if(best_votes == 0)
+    {
+      ROS_INFO("Cluster %d: did not find distance/match within given threshold.", i);
+      continue;
+    }
+    int angle;
+    parseModelName(feature_index.getModelName(k_indices[i*k+closest[best_part]]), result.label, angle);
+    result.pose.rotation = angle;
+    result.confidence = (float)best_votes/k;
+    ROS_INFO("Cluster %d: %s at %d deg, confidence %f", i, best_part.c_str(), angle, result.confidence);
+  }
+  return true;
+}
+
 
 int main(int argc, char **argv)
 {  
@@ -180,21 +195,71 @@ int main(int argc, char **argv)
   ros::init(argc, argv, "cph_recongition_node");
   ros::NodeHandle n;
   
-  loadFeatureModels (argv[1], ".csv", models);
-  pcl::console::print_highlight ("Loaded %d VFH models. Creating training data\n", 
-      (int)models.size ());
+  if(argc < 2)
+  {
+    ROS_ERROR("usage: cph_recognition <training data directory | cph feature database>");
+    return(1);
+  }
 
-  // Convert data into FLANN format
-  data = new flann::Matrix<float> (new float[models.size () * models[0].second.size ()], models.size (), models[0].second.size ());
-  
-  std::cout << "data size: [" << data->rows << " , " << data->cols << "]\n";
-  for (size_t i = 0; i < data->rows; ++i)
-    for (size_t j = 0; j < data->cols; ++j)
-      *(data->ptr()+(i*data->cols + j)) = models[i].second[j];
+  //A feature database is used in place of the per view files when the training directory has one
+  boost::filesystem::path training_dir(argv[1]), database;
+  if(boost::filesystem::is_regular_file(training_dir))
+  {
+    database = training_dir;
+    training_dir = training_dir.parent_path();
+  }
+  else if(boost::filesystem::exists(training_dir / "cph_features.db"))
+    database = training_dir / "cph_features.db";
+
+  //Index parameters
+  ros::NodeHandle pn("~");
+  std::string index_type_name, index_file;
+  int trees, branching, iterations, checks;
+  pn.param("index_type", index_type_name, std::string("kdtree"));
+  pn.param("index_file", index_file, (training_dir / "cph_index.flann").string());
+  pn.param("kdtree_trees", trees, 4);
+  pn.param("kmeans_branching", branching, 32);
+  pn.param("kmeans_iterations", iterations, 11);
+  pn.param("search_checks", checks, 512);
+
+  CPHFeatureIndex::IndexType index_type;
+  if(!CPHFeatureIndex::parseIndexType(index_type_name, index_type))
+  {
+    ROS_WARN("Unknown index_type '%s', using kdtree", index_type_name.c_str());
+    index_type = CPHFeatureIndex::KDTREE;
+  }
+  feature_index.setIndexType(index_type);
+  feature_index.setTrees(trees);
+  feature_index.setBranching(branching);
+  feature_index.setIterations(iterations);
+  feature_index.setChecks(checks);
+
+  if(!database.empty())
+  {
+    if(!feature_index.loadDatabase (database.string(), histSize, training_dir))
+    {
+      ROS_ERROR("Could not map cph feature database %s", database.string().c_str());
+      return(1);
+    }
+  }
+  else if(!feature_index.loadModels (training_dir, histSize))
+  {
+    ROS_ERROR("No cph models found in %s", argv[1]);
+    return(1);
+  }
+  pcl::console::print_highlight ("Loaded %d CPH models. Creating training data\n", 
+      (int)feature_index.getNumModels());
+  std::cout << "data size: [" << feature_index.getData().rows << " , " << feature_index.getData().cols << "]\n";
+
+  //Build (or load) the knn index once, it is reused by every request
+  ros::WallTime start = ros::WallTime::now();
+  feature_index.buildIndex (index_file);
+  ROS_INFO("%s index ready in %f s", index_type_name.c_str(), (ros::WallTime::now() - start).toSec());
     
   pcl::console::print_error ("Training data loaded.\n");
   
   ros::ServiceServer serv = n.advertiseService("/cph_recognition", recognize_cb);
+  ros::ServiceServer batch_serv = n.advertiseService("/cph_batch_recognition", batch_recognize_cb);
   
   ROS_INFO("cph_recognition_node ready.");
   
@@ -24,8 +24,9 @@
 
 #include <boost/filesystem.hpp>
 
-#include "cph.h"
+#include <nrg_object_recognition/cph.h>
 #include "mantis_perception/mantis_recognition.h"
+#include "mantis_perception/cph_batch_recognition.h"
 #include "nrg_object_recognition/recognition.h"
 #include "tabletop_object_detector/Table.h"
 
@@ -153,61 +154,55 @@ bool rec_cb(mantis_perception::mantis_recognition::Request &main_request,
 
   }*/
 
-  //convert segmentation results from array of PointCloud to single PointCloud2
-  sensor_msgs::PointCloud received_clusters;
-  received_clusters=main_request.clusters.at(0);
-  sensor_msgs::PointCloud2 cluster;
-  /*pcl::toROSMsg(highest_cluster, cluster);*/
-  sensor_msgs::convertPointCloudToPointCloud2(received_clusters, cluster);
-  cluster.header.frame_id=main_request.table.pose.header.frame_id;
-  cluster.header.stamp=main_request.table.pose.header.stamp;
+  //convert every segmented cluster from PointCloud to PointCloud2 for one batched request
+  mantis_perception::cph_batch_recognition rec_srv;
+  rec_srv.request.clusters.resize(main_request.clusters.size());
+  for (unsigned int j=0; j<main_request.clusters.size(); j++)
+  {
+    sensor_msgs::convertPointCloudToPointCloud2(main_request.clusters.at(j), rec_srv.request.clusters[j]);
+    rec_srv.request.clusters[j].header.frame_id=main_request.table.pose.header.frame_id;
+    rec_srv.request.clusters[j].header.stamp=main_request.table.pose.header.stamp;
+  }
+  rec_srv.request.threshold = 1500;
+  //the nearest training views vote on the label, replacing repeated calls on the same cluster
+  rec_srv.request.k = 10;
 
-  ROS_INFO_STREAM("Sending highest cluster to cph recognition");
-  //Brian's recognition service
-  nrg_object_recognition::recognition rec_srv;
+  ROS_INFO_STREAM("Sending "<<rec_srv.request.clusters.size()<<" clusters to cph recognition");
+  if (main_request.clusters.empty() || !cph_client.call(rec_srv) || rec_srv.response.results.empty())
+  {
+    ROS_ERROR("Call to cph recognition service failed");
+    return false;
+  }
 
-//////////////////////////Logic for % confidence in recognition result
-  //Need to save recognition results into array (or not...)
-  //std::vector<std::string> response_labels;
+  //the first cluster is the one that gets picked, the others are reported for reference
+  for (unsigned int j=1; j<rec_srv.response.results.size(); j++)
+  {
+    ROS_INFO_STREAM("Cluster "<<j<<" labeled as "<<rec_srv.response.results[j].label<<
+                    " with confidence "<<rec_srv.response.results[j].confidence);
+  }
+  mantis_perception::cph_result &rec_result = rec_srv.response.results[0];
 
-  //Then need to find percentage of label per set/array
+  //Find percentage of votes for the returned label
   int percent_conf_pvct=0, percent_conf_plug=0, percent_conf_encl=0;
-
-  rec_srv.request.cluster = cluster;
-  rec_srv.request.threshold = 1500;
-  //calling flann recognition service 10 times
-  //and increasing percent confidence based on label
-  for (int a=0; a<10; a++)
+  std::size_t found;
+  std::string label = rec_result.label;
+  found=label.find_last_of("/");
+  ROS_INFO_STREAM("Object labeled as "<< label.substr(found+1));
+  int percent_conf = (int)(rec_result.confidence*100.0f + 0.5f);
+  if(label.substr(found+1)=="enclosure")
+  {
+    percent_conf_encl=percent_conf;
+  }
+  else if(label.substr(found+1)=="plug")
+  {
+    percent_conf_plug=percent_conf;
+  }
+  else if(label.substr(found+1)=="pvct" || label.substr(found+1)=="pvct_1")
   {
-    //Call recognition service
-    if (!cph_client.call(rec_srv))
-    {
-      ROS_ERROR("Call to cph recognition service failed");
-    }
-    //response_labels.push_back(rec_srv.response.label);
-    ROS_INFO_STREAM("Object labeled as "<< rec_srv.response.label);
-
-    std::size_t found;
-    std::string label = rec_srv.response.label;
-    found=label.find_last_of("/");
-    //Depending on label and angle, assign marker mesh, model_id, position for mesh and for part frame
-    ROS_INFO_STREAM("Object labeled as "<< label.substr(found+1));
-
-    if(label.substr(found+1)=="enclosure")
-    {
-      percent_conf_encl+=10;
-    }
-    else if(label.substr(found+1)=="plug")
-    {
-      percent_conf_plug+=10;
-    }
-    else if(label.substr(found+1)=="pvct" || label.substr(found+1)=="pvct_1")
-    {
-      percent_conf_pvct+=10;
-    }
+    percent_conf_pvct=percent_conf;
   }
   ROS_INFO("CPH recognition complete");
-  float theta = rec_srv.response.pose.rotation*3.14159/180;//radians
+  float theta = rec_result.pose.rotation*3.14159/180;//radians
 
 ////////////////////Assign response values/////////////////////////
 
@@ -228,12 +223,12 @@ bool rec_cb(mantis_perception::mantis_recognition::Request &main_request,
     main_response.label="NA";
     ROS_ERROR_STREAM("Recognition produced no consistent result");
   }
-  //main_response.label = rec_srv.response.label;
-  main_response.pose = rec_srv.response.pose;
+  //main_response.label = rec_result.label;
+  main_response.pose = rec_result.pose;
 
-  ROS_INFO_STREAM("Recgonized pose: \n x: " << rec_srv.response.pose.x << "\n y: "<<rec_srv.response.pose.y <<
-		  "\n z: "<<rec_srv.response.pose.z << "\n theta: "<<rec_srv.response.pose.rotation);
-  //ROS_INFO_STREAM("Object labeled as "<< rec_srv.response.label);
+  ROS_INFO_STREAM("Recgonized pose: \n x: " << rec_result.pose.x << "\n y: "<<rec_result.pose.y <<
+		  "\n z: "<<rec_result.pose.z << "\n theta: "<<rec_result.pose.rotation);
+  //ROS_INFO_STREAM("Object labeled as "<< rec_result.label);
 
 ////////////////////Take response rotation and make pick pose
   //Get the orientation of the part from the returned recognized object
@@ -275,12 +270,12 @@ bool rec_cb(mantis_perception::mantis_recognition::Request &main_request,
   {
     main_response.model_id=1;
     mesh_marker.mesh_resource = "package://mantis_perception/data/meshes/demo_parts/elec_enclosure.STL";
-    pick_pose.pose.position.x = rec_srv.response.pose.x - (_enc_1_x_offset);//+enc_pick_point_x;//enc_pick.x();
-    pick_pose.pose.position.y = rec_srv.response.pose.y - (_enc_1_y_offset);//enc_pick.y();
-    pick_pose.pose.position.z = rec_srv.response.pose.z - (_enc_1_z_offset)+_enc_pick_point_z;
-    mesh_marker.pose.position.x=rec_srv.response.pose.x - (_enc_1_x_offset);
-    mesh_marker.pose.position.y=rec_srv.response.pose.y - (_enc_1_y_offset);
-    mesh_marker.pose.position.z=rec_srv.response.pose.z - (_enc_1_z_offset);
+    pick_pose.pose.position.x = rec_result.pose.x - (_enc_1_x_offset);//+enc_pick_point_x;//enc_pick.x();
+    pick_pose.pose.position.y = rec_result.pose.y - (_enc_1_y_offset);//enc_pick.y();
+    pick_pose.pose.position.z = rec_result.pose.z - (_enc_1_z_offset)+_enc_pick_point_z;
+    mesh_marker.pose.position.x=rec_result.pose.x - (_enc_1_x_offset);
+    mesh_marker.pose.position.y=rec_result.pose.y - (_enc_1_y_offset);
+    mesh_marker.pose.position.z=rec_result.pose.z - (_enc_1_z_offset);
     ROS_INFO_STREAM("Pick pose z position: "<<pick_pose.pose.position.z);
     ROS_WARN_STREAM("Recognition returned enclosure with "<< percent_conf_encl<<" percent confidence");
   }
@@ -288,12 +283,12 @@ bool rec_cb(mantis_perception::mantis_recognition::Request &main_request,
   {
     main_response.model_id=2;
     mesh_marker.mesh_resource = "package://mantis_perception/data/meshes/demo_parts/small_plug.STL";
-    pick_pose.pose.position.x = rec_srv.response.pose.x-(small_plug_x_offset);
-	pick_pose.pose.position.y = rec_srv.response.pose.y-(small_plug_y_offset);
-	pick_pose.pose.position.z = rec_srv.response.pose.z-(small_plug_z_offset) + _small_plug_pick_point_z;
-	mesh_marker.pose.position.x=rec_srv.response.pose.x-(small_plug_x_offset);
-	mesh_marker.pose.position.y=rec_srv.response.pose.y-(small_plug_y_offset);
-	mesh_marker.pose.position.z=rec_srv.response.pose.z-(small_plug_z_offset);
+    pick_pose.pose.position.x = rec_result.pose.x-(small_plug_x_offset);
+	pick_pose.pose.position.y = rec_result.pose.y-(small_plug_y_offset);
+	pick_pose.pose.position.z = rec_result.pose.z-(small_plug_z_offset) + _small_plug_pick_point_z;
+	mesh_marker.pose.position.x=rec_result.pose.x-(small_plug_x_offset);
+	mesh_marker.pose.position.y=rec_result.pose.y-(small_plug_y_offset);
+	mesh_marker.pose.position.z=rec_result.pose.z-(small_plug_z_offset);
   }*/
   /*else if (label.substr(found+1)=="pvct" ||
 		  label.substr(found+1)=="pvct_a_4" ||
@@ -306,12 +301,12 @@ bool rec_cb(mantis_perception::mantis_recognition::Request &main_request,
   {
     main_response.model_id=3;
     mesh_marker.mesh_resource = "package://mantis_perception/data/meshes/demo_parts/pvc_t.STL";
-    pick_pose.pose.position.x = rec_srv.response.pose.x - (_pvct_1_x_offset);
-    pick_pose.pose.position.y = rec_srv.response.pose.y - (_pvct_1_y_offset);
-    pick_pose.pose.position.z = rec_srv.response.pose.z - (_pvct_1_z_offset)+_pvct_pick_point_z/2;
-    mesh_marker.pose.position.x=rec_srv.response.pose.x - (_pvct_1_x_offset);
-    mesh_marker.pose.position.y=rec_srv.response.pose.y - (_pvct_1_y_offset);
-    mesh_marker.pose.position.z=rec_srv.response.pose.z - (_pvct_1_z_offset);
+    pick_pose.pose.position.x = rec_result.pose.x - (_pvct_1_x_offset);
+    pick_pose.pose.position.y = rec_result.pose.y - (_pvct_1_y_offset);
+    pick_pose.pose.position.z = rec_result.pose.z - (_pvct_1_z_offset)+_pvct_pick_point_z/2;
+    mesh_marker.pose.position.x=rec_result.pose.x - (_pvct_1_x_offset);
+    mesh_marker.pose.position.y=rec_result.pose.y - (_pvct_1_y_offset);
+    mesh_marker.pose.position.z=rec_result.pose.z - (_pvct_1_z_offset);
     ROS_INFO_STREAM("Pick pose z position: "<<pick_pose.pose.position.z);
     ROS_WARN_STREAM("Recognition returned pvc tee with "<< percent_conf_pvct<<" percent confidence");
   }
@@ -325,12 +320,12 @@ bool rec_cb(mantis_perception::mantis_recognition::Request &main_request,
   {
     main_response.model_id=4;
     mesh_marker.mesh_resource = "package://mantis_perception/data/meshes/demo_parts/white_plug.STL";
-    pick_pose.pose.position.x = rec_srv.response.pose.x - (_plug_1_x_offset);
-    pick_pose.pose.position.y = rec_srv.response.pose.y - (_plug_1_y_offset);
-    pick_pose.pose.position.z = rec_srv.response.pose.z - (_plug_1_z_offset)+_plug_pick_point_z;
-    mesh_marker.pose.position.x=rec_srv.response.pose.x - (_plug_1_x_offset);
-    mesh_marker.pose.position.y=rec_srv.response.pose.y - (_plug_1_y_offset);
-    mesh_marker.pose.position.z=rec_srv.response.pose.z - (_plug_1_z_offset);
+    pick_pose.pose.position.x = rec_result.pose.x - (_plug_1_x_offset);
+    pick_pose.pose.position.y = rec_result.pose.y - (_plug_1_y_offset);
+    pick_pose.pose.position.z = rec_result.pose.z - (_plug_1_z_offset)+_plug_pick_point_z;
+    mesh_marker.pose.position.x=rec_result.pose.x - (_plug_1_x_offset);
+    mesh_marker.pose.position.y=rec_result.pose.y - (_plug_1_y_offset);
+    mesh_marker.pose.position.z=rec_result.pose.z - (_plug_1_z_offset);
     ROS_INFO_STREAM("Pick pose z position: "<<pick_pose.pose.position.z);
     ROS_WARN_STREAM("Recognition returned plug with "<< percent_conf_plug<<" percent confidence");
   }
@@ -338,12 +333,12 @@ bool rec_cb(mantis_perception::mantis_recognition::Request &main_request,
   {
     main_response.model_id=5;
     mesh_marker.mesh_resource = "package://mantis_perception/data/meshes/demo_parts/pvc_elbow.STL";
-    pick_pose.pose.position.x = rec_srv.response.pose.x - (pvc_elbow_1_x_offset);
-    pick_pose.pose.position.y = rec_srv.response.pose.y - (pvc_elbow_1_y_offset);
-    pick_pose.pose.position.z = rec_srv.response.pose.z - (pvc_elbow_1_z_offset)+_pvc_elbow_pick_point_z;
-    mesh_marker.pose.position.x=rec_srv.response.pose.x - (pvc_elbow_1_x_offset);
-    mesh_marker.pose.position.y=rec_srv.response.pose.y - (pvc_elbow_1_y_offset);
-    mesh_marker.pose.position.z=rec_srv.response.pose.z - (pvc_elbow_1_z_offset);
+    pick_pose.pose.position.x = rec_result.pose.x - (pvc_elbow_1_x_offset);
+    pick_pose.pose.position.y = rec_result.pose.y - (pvc_elbow_1_y_offset);
+    pick_pose.pose.position.z = rec_result.pose.z - (pvc_elbow_1_z_offset)+_pvc_elbow_pick_point_z;
+    mesh_marker.pose.position.x=rec_result.pose.x - (pvc_elbow_1_x_offset);
+    mesh_marker.pose.position.y=rec_result.pose.y - (pvc_elbow_1_y_offset);
+    mesh_marker.pose.position.z=rec_result.pose.z - (pvc_elbow_1_z_offset);
 
   }*/
   else if (main_response.label=="NA")
@@ -363,13 +358,13 @@ bool rec_cb(mantis_perception::mantis_recognition::Request &main_request,
 
   //finish inputing marker properties and publish
   ROS_INFO_STREAM("Marker pose: \n x: " << mesh_marker.pose.position.x << "\n y: "<<mesh_marker.pose.position.y <<
-		  "\n z: "<<mesh_marker.pose.position.z << "\n theta: "<<rec_srv.response.pose.rotation);
+		  "\n z: "<<mesh_marker.pose.position.z << "\n theta: "<<rec_result.pose.rotation);
   main_response.mesh_marker = mesh_marker;
   vis_pub.publish( mesh_marker );
 
 
 //////Visualization: Matching PointCloud//////////////////////////////////////////////////////
-  publish_matching_PC(rec_srv.response.label, rec_srv.response.pose, main_request.table);
+  publish_matching_PC(rec_result.label, rec_result.pose, main_request.table);
 /////////end visualization////////////////////////////////////////////////////
 
   return true;
@@ -437,7 +432,7 @@ int main(int argc, char **argv)
   ros::NodeHandle n;  
   
   ros::ServiceServer rec_serv = n.advertiseService("/mantis_object_recognition", rec_cb);
-  cph_client = n.serviceClient<nrg_object_recognition::recognition>("/cph_recognition");
+  cph_client = n.serviceClient<mantis_perception::cph_batch_recognition>("/cph_batch_recognition");
   rec_pub = n.advertise<sensor_msgs::PointCloud2>("/recognition_result",1);
   vis_pub = n.advertise<visualization_msgs::Marker>( "matching_mesh_marker", 10 );
   noise_pub=n.advertise<sensor_msgs::PointCloud2>("/noisy_points",1);
@@ -6,6 +6,8 @@
 #include <pcl/point_cloud.h>
 #include <pcl/point_types.h>
 #include <pcl/io/pcd_io.h>
+#include <pcl/common/io.h>
+#include <pcl/common/transforms.h>
 #include <pcl/filters/extract_indices.h>
 #include <pcl/filters/voxel_grid.h>
 #include <pcl/filters/statistical_outlier_removal.h>
@@ -24,11 +26,15 @@
 #include <sensor_msgs/PointCloud2.h>
 #include <sensor_msgs/point_cloud_conversion.h>
 
+#include <pcl_ros/transforms.h>
+
 #include <tf/transform_broadcaster.h>
 #include <tf/transform_listener.h>
 #include <tf/transform_datatypes.h>
 
 #include <visualization_msgs/Marker.h>
+#include <algorithm>
+#include <iterator>
 #include "tabletop_object_detector/marker_generator.h"
 
   ros::Publisher plane_pub;
@@ -96,11 +102,15 @@ class MantisSegmentor
 
   //------------------- Complete processing -----
 
-  //! Complete processing for new style point cloud
-  void processCloud(const sensor_msgs::PointCloud2 &cloud,
+  //! Complete processing of the decoded (and transformed) cloud
+  void processCloud(const pcl::PointCloud<Point>::Ptr &cloud, const std_msgs::Header &header,
 		  tabletop_object_detector::TabletopSegmentationResponse &seg_response,
                       tabletop_object_detector::Table table);
 
+  //! Publishes the indexed points of cloud, only if the topic has subscribers
+  void publishSubset(ros::Publisher &pub, const pcl::PointCloud<Point> &cloud,
+		  const std::vector<int> &indices, const std_msgs::Header &header);
+
   //! Clears old published markers and remembers the current number of published markers
   void clearOldMarkers(std::string frame_id);
 
@@ -187,25 +197,30 @@ bool MantisSegmentor::serviceCallback(tabletop_object_detector::TabletopSegmenta
 
   //pcl::PointCloud<Point>::Ptr table_hull (new pcl::PointCloud<Point>);
   ROS_INFO_STREAM("Point cloud received after " << ros::Time::now() - start_time << " seconds; processing");
+
+  //the message is decoded once, every later stage works on this cloud and index sets into it
+  pcl::PointCloud<Point>::Ptr cloud (new pcl::PointCloud<Point>);
+  pcl::fromROSMsg(*recent_cloud, *cloud);
+  std_msgs::Header header = recent_cloud->header;
+
   if (!processing_frame_.empty())
   {
-    //convert cloud to processing_frame_ (usually base_link)
-    sensor_msgs::PointCloud old_cloud;
-    sensor_msgs::convertPointCloud2ToPointCloud (*recent_cloud, old_cloud);
+    //transform cloud to processing_frame_ (usually base_link) in place
+    tf::StampedTransform transform;
     int current_try=0, max_tries = 3;
     while (1)
     {
       bool transform_success = true;
       try
       {
-        listener_.transformPointCloud(processing_frame_, old_cloud, old_cloud);
+        listener_.lookupTransform(processing_frame_, header.frame_id, header.stamp, transform);
       }
       catch (tf::TransformException ex)
       {
         transform_success = false;
         if (++current_try >= max_tries)
         {
-          ROS_ERROR("Failed to transform cloud from frame %s into frame %s in %d attempt(s)", old_cloud.header.frame_id.c_str(),
+          ROS_ERROR("Failed to transform cloud from frame %s into frame %s in %d attempt(s)", header.frame_id.c_str(),
                     processing_frame_.c_str(), current_try);
           response.result = response.OTHER_ERROR;
           return true;
@@ -216,22 +231,21 @@ bool MantisSegmentor::serviceCallback(tabletop_object_detector::TabletopSegmenta
       }
       if (transform_success) break;
     }
-    sensor_msgs::PointCloud2 converted_cloud;
-    sensor_msgs::convertPointCloudToPointCloud2 (old_cloud, converted_cloud);
+    Eigen::Matrix4f transform_matrix;
+    pcl_ros::transformAsMatrix(transform, transform_matrix);
+    pcl::transformPointCloud(*cloud, *cloud, Eigen::Affine3f(transform_matrix));
+    header.frame_id = processing_frame_;
+    cloud->header.frame_id = processing_frame_;
     ROS_INFO_STREAM("Input cloud converted to " << processing_frame_ << " frame after " <<
                     ros::Time::now() - start_time << " seconds");
-    processCloud(converted_cloud, response, request.table);
-    clearOldMarkers(converted_cloud.header.frame_id);
-  }
-  else
-  {
-    processCloud(*recent_cloud, response, request.table);
-    clearOldMarkers(recent_cloud->header.frame_id);
   }
 
+  processCloud(cloud, header, response, request.table);
+  clearOldMarkers(header.frame_id);
+
   //add the timestamp from the original cloud
   response.table.pose.header.stamp = recent_cloud->header.stamp;
-  for(size_t i; i<response.clusters.size(); i++)
+  for(size_t i=0; i<response.clusters.size(); i++)
   {
     response.clusters[i].header.stamp = recent_cloud->header.stamp;
   }
@@ -240,30 +254,38 @@ bool MantisSegmentor::serviceCallback(tabletop_object_detector::TabletopSegmenta
   return true;
 }
 
-void MantisSegmentor::processCloud(const sensor_msgs::PointCloud2 &in_cloud,
+void MantisSegmentor::publishSubset(ros::Publisher &pub, const pcl::PointCloud<Point> &cloud,
+		const std::vector<int> &indices, const std_msgs::Header &header)
+{
+  //debug clouds are only serialized when someone is listening
+  if (pub.getNumSubscribers() == 0)
+    return;
+  pcl::PointCloud<Point> subset;
+  pcl::copyPointCloud(cloud, indices, subset);
+  sensor_msgs::PointCloud2 subset_pc2;
+  pcl::toROSMsg(subset, subset_pc2);
+  subset_pc2.header = header;
+  pub.publish(subset_pc2);
+}
+
+void MantisSegmentor::processCloud(const pcl::PointCloud<Point>::Ptr &cloud, const std_msgs::Header &header,
 		tabletop_object_detector::TabletopSegmentation::Response &seg_response, tabletop_object_detector::Table table)
 {
-  // Read in the cloud data
-  pcl::PointCloud<pcl::PointXYZ>::Ptr cloud (new pcl::PointCloud<pcl::PointXYZ>), cloud_f (new pcl::PointCloud<pcl::PointXYZ>);
   std::cout << "segmenting image..." << std::endl;
-  pcl::fromROSMsg(in_cloud, *cloud);
 
-  // Create the filtering object: downsample the dataset using a leaf size of 1cm
+  // Create the filtering object: downsample the dataset using a leaf size of 1mm
   //std::cout << "Voxel grid filtering...\n";
-  pcl::VoxelGrid<pcl::PointXYZ> vg;
-  pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_filtered (new pcl::PointCloud<pcl::PointXYZ>);
-  pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_filtered_0 (new pcl::PointCloud<pcl::PointXYZ>);
+  pcl::VoxelGrid<Point> vg;
+  pcl::PointCloud<Point>::Ptr cloud_filtered_0 (new pcl::PointCloud<Point>);
   vg.setInputCloud (cloud);
   vg.setLeafSize (0.001f, 0.001f, 0.001f);
   vg.filter (*cloud_filtered_0);
   //std::cout << "done.\n";
 
   // Create the segmentation object for the planar model and set all the parameters
-  pcl::SACSegmentation<pcl::PointXYZ> seg;
+  pcl::SACSegmentation<Point> seg;
   pcl::PointIndices::Ptr inliers (new pcl::PointIndices);
   pcl::ModelCoefficients::Ptr coefficients (new pcl::ModelCoefficients);
-  pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_plane (new pcl::PointCloud<pcl::PointXYZ> ());
-  pcl::PCDWriter writer;
   seg.setOptimizeCoefficients (true);
   seg.setModelType (pcl::SACMODEL_PLANE);
   seg.setMethodType (pcl::SAC_RANSAC);
@@ -271,8 +293,8 @@ void MantisSegmentor::processCloud(const sensor_msgs::PointCloud2 &in_cloud,
   seg.setDistanceThreshold (plane_dist_thresh_);//0.0075
 
   //std::cout << "Spatial filtering...\n";
-  //Spatial filter.
-  cloud_filtered->resize(0);
+  //Spatial filter, kept as the (sorted) indices of the points inside the box.
+  pcl::PointIndices::Ptr remaining (new pcl::PointIndices);
   //Parameters
  float min_x = x_filter_min_, max_x = x_filter_max_;
  float min_y = y_filter_min_, max_y = y_filter_max_;
@@ -282,25 +304,23 @@ void MantisSegmentor::processCloud(const sensor_msgs::PointCloud2 &in_cloud,
 //  float min_y = -.5, max_y = .5;
 //  float min_z = .55, max_z = 1.15;
 
- for(pcl::PointCloud<pcl::PointXYZ>::iterator position=cloud_filtered_0->begin(); position!=cloud_filtered_0->end(); position++)
- //for (pcl::PointCloud<pcl::PointXYZ>::iterator position=cloud->begin(); position!=cloud->end(); position++)
- {
- if(position->x > min_x && position->x < max_x && position->y > min_y && position->y < max_y && position->z > min_z && position->z < max_z)
-    // if(position->x > min_x && position->x < max_x && position->y > (2.145*position->z - 3.31) && position->y < (-.466*position->z + .400))
-     cloud_filtered->push_back(*position);
+  remaining->indices.reserve(cloud_filtered_0->points.size());
+  for(size_t i=0; i<cloud_filtered_0->points.size(); i++)
+  {
+    const Point &position = cloud_filtered_0->points[i];
+    if(position.x > min_x && position.x < max_x && position.y > min_y && position.y < max_y && position.z > min_z && position.z < max_z)
+      remaining->indices.push_back(i);
   }
+  publishSubset(bound_pub, *cloud_filtered_0, remaining->indices, header);
 
-  sensor_msgs::PointCloud2 cloud_filtered_pc2;
-  pcl::toROSMsg(*cloud_filtered, cloud_filtered_pc2);
-  cloud_filtered_pc2.header = in_cloud.header;
-  bound_pub.publish(cloud_filtered_pc2);
-
-  //std::cout << "num points in spatially filtered cloud: " << cloud_filtered->points.size() << std::endl;
-  int nr_points = (int) cloud_filtered->points.size ();
-  while (cloud_filtered->points.size () > 0.5 * nr_points)
+  //std::cout << "num points in spatially filtered cloud: " << remaining->indices.size() << std::endl;
+  int nr_points = (int) remaining->indices.size ();
+  std::vector<int> rest;
+  while (remaining->indices.size () > 0.5 * nr_points)
   {
-    // Segment the largest planar component from the remaining cloud
-    seg.setInputCloud (cloud_filtered);
+    // Segment the largest planar component from the remaining points
+    seg.setInputCloud (cloud_filtered_0);
+    seg.setIndices (remaining);
     seg.segment (*inliers, *coefficients);
     if (inliers->indices.size () == 0)
     {
@@ -308,111 +328,64 @@ void MantisSegmentor::processCloud(const sensor_msgs::PointCloud2 &in_cloud,
       break;
     }
 
-    //std::cout << "extracting planar inliers..."  << std::endl;
-    // Extract the planar inliers from the input cloud
-    pcl::ExtractIndices<pcl::PointXYZ> extract;
-    extract.setInputCloud (cloud_filtered);
-    extract.setIndices (inliers);
-    extract.setNegative (false);
-
     // Publish dominant plane
-    extract.filter (*cloud_plane); //cloud_plane is a pcl::PointCloud<pcl::PointXYZ>::Ptr
-    sensor_msgs::PointCloud2 plane_pc2;
-    pcl::toROSMsg(*cloud_plane, plane_pc2);
-    plane_pc2.header = in_cloud.header;
-    plane_pub.publish(plane_pc2);
+    publishSubset(plane_pub, *cloud_filtered_0, inliers->indices, header);
 
     //std::cout << "Removing tabletop..."  << std::endl;
-    // Remove the planar inliers, extract the rest
-    extract.setNegative (true);
-    extract.filter (*cloud_f);
-    cloud_filtered = cloud_f;
+    // Remove the planar inliers from the index set, no points are copied
+    std::sort(inliers->indices.begin(), inliers->indices.end());
+    rest.clear();
+    std::set_difference(remaining->indices.begin(), remaining->indices.end(),
+                        inliers->indices.begin(), inliers->indices.end(), std::back_inserter(rest));
+    remaining->indices.swap(rest);
     //std::cout << "done."  << std::endl;
   }
 
-  pcl::toROSMsg(*cloud_filtered, cloud_filtered_pc2);
-  cloud_filtered_pc2.header = in_cloud.header;
-  cluster_pub.publish(cloud_filtered_pc2);
+  publishSubset(cluster_pub, *cloud_filtered_0, remaining->indices, header);
 
-  std::cout << "Number of points in remaining clusters: " << cloud_filtered->points.size()  << std::endl;
+  std::cout << "Number of points in remaining clusters: " << remaining->indices.size()  << std::endl;
   // Creating the KdTree object for the search method of the extraction
-  pcl::search::KdTree<pcl::PointXYZ>::Ptr tree (new pcl::search::KdTree<pcl::PointXYZ>);
-  tree->setInputCloud (cloud_filtered);
+  pcl::search::KdTree<Point>::Ptr tree (new pcl::search::KdTree<Point>);
+  tree->setInputCloud (cloud_filtered_0, remaining);
 
   std::vector<pcl::PointIndices> cluster_indices;
-  pcl::EuclideanClusterExtraction<pcl::PointXYZ> ec;
+  pcl::EuclideanClusterExtraction<Point> ec;
   ec.setClusterTolerance (cluster_distance_); // 2cm
   ec.setMinClusterSize (min_cluster_size_);
   ec.setMaxClusterSize (max_cluster_size_);
   ec.setSearchMethod (tree);
-  ec.setInputCloud (cloud_filtered);
+  ec.setInputCloud (cloud_filtered_0);
+  ec.setIndices (remaining);
   ec.extract (cluster_indices);
 
-  std::vector<sensor_msgs::PointCloud2> pc2_clusters;
+  //Clusters go straight from index sets into the response type
   std::cout << "length of cluster_indices: " << cluster_indices.size() << std::endl;
-  int j = 0;
-  for (std::vector<pcl::PointIndices>::const_iterator it = cluster_indices.begin (); it != cluster_indices.end (); ++it)
+  std::vector<sensor_msgs::PointCloud> out_clusters(cluster_indices.size());
+  for (size_t i=0; i<cluster_indices.size(); i++)
   {
-    pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_cluster (new pcl::PointCloud<pcl::PointXYZ>);
-    for (std::vector<int>::const_iterator pit = it->indices.begin (); pit != it->indices.end (); pit++)
-      cloud_cluster->points.push_back (cloud_filtered->points[*pit]); //*
-    cloud_cluster->width = cloud_cluster->points.size ();
-    cloud_cluster->height = 1;
-    cloud_cluster->is_dense = true;
-    std::cout << "writing cluster to service response. It has " << cloud_cluster->points.size() << " points.\n";
-    sensor_msgs::PointCloud2 tempROSMsg;
-    pcl::toROSMsg(*cloud_cluster, tempROSMsg);
-    pc2_clusters.push_back(tempROSMsg);
-    //seg_response.clusters.push_back(tempROSMsg);
-    j++;
+    const std::vector<int> &indices = cluster_indices[i].indices;
+    sensor_msgs::PointCloud &out_cloud = out_clusters[i];
+    out_cloud.header = header;
+    out_cloud.points.resize(indices.size());
+    for (size_t j=0; j<indices.size(); j++)
+    {
+      const Point &p = cloud_filtered_0->points[indices[j]];
+      out_cloud.points[j].x = p.x;
+      out_cloud.points[j].y = p.y;
+      out_cloud.points[j].z = p.z;
+    }
+    std::cout << "writing cluster to service response. It has " << indices.size() << " points.\n";
   }
-
-//convert array of PointCloud2 to PointCloud
-  //Filter high points and noisy points while doing so
-  std::vector<sensor_msgs::PointCloud> out_clusters;
-  ROS_INFO("Cluster published and put into PointCloud2 array");
-  for (int i=0; i<pc2_clusters.size(); i++)
+  if (!cluster_indices.empty())
   {
-	  sensor_msgs::PointCloud out_cloud;
-	  sensor_msgs::PointCloud2 ocloud;
-	  //pcl::PointCloud<pcl::PointXYZ>::Ptr cluster_ptr (new pcl::PointCloud<pcl::PointXYZ>);
-	  pcl::PointCloud<pcl::PointXYZ> cluster_ptr;
-	  pcl::PointCloud<pcl::PointXYZ> cloud_cut;// (new pcl::PointCloud<pcl::PointXYZ>);
-	  pcl::PointCloud<pcl::PointXYZ> cloud_noise;
-	  pcl::fromROSMsg (pc2_clusters.at(i), cluster_ptr);
-/*
-	  pcl::PassThrough<pcl::PointXYZ> pass;
-	  pass.setInputCloud (cluster_ptr);
-	  pass.setFilterFieldName ("z");
-	  pass.setFilterLimits (0, 1);//0.085
-	  pass.filter (cloud_cut);
-
-	  pcl::StatisticalOutlierRemoval<pcl::PointXYZ> out_remove;
-	  out_remove.setInputCloud(cloud_cut);
-	  out_remove.setNegative(false);
-	  out_remove.setMeanK(cluster_outlier_it_);
-	  out_remove.setStddevMulThresh(1.0);
-	  out_remove.filter(cloud_noise);
-
-	  pcl::toROSMsg (cloud_noise, ocloud);*/
-	  pcl::toROSMsg (cluster_ptr, ocloud);
-	  sensor_msgs::convertPointCloud2ToPointCloud(ocloud, out_cloud);
-	  out_clusters.push_back(out_cloud);
+    publishSubset(first_cluster_pub, *cloud_filtered_0, cluster_indices[0].indices, header);
   }
-  sensor_msgs::PointCloud2 big_cluster;
-  sensor_msgs::PointCloud bcluster;
-  bcluster = out_clusters.at(0);
-  sensor_msgs::convertPointCloudToPointCloud2(bcluster, big_cluster);
-  //big_cluster=pc2_clusters.at(0);
-  big_cluster.header = in_cloud.header;
-  pc2_clusters.at(0).header = in_cloud.header;
-  first_cluster_pub.publish(pc2_clusters.at(0));//(big_cluster);
-  ROS_INFO("Cluster converted from PointCloud2 array to PointCloud array");
+  ROS_INFO("Clusters converted to PointCloud array");
   seg_response.clusters=out_clusters;
   for (size_t i=0; i<out_clusters.size(); i++)
   {
     visualization_msgs::Marker cloud_marker =  tabletop_object_detector::MarkerGenerator::getCloudMarker(out_clusters[i]);
-    cloud_marker.header = in_cloud.header;
+    cloud_marker.header = header;
     cloud_marker.pose.orientation.w = 1;
     cloud_marker.ns = "tabletop_node";
     cloud_marker.id = current_marker_id_++;
@@ -422,26 +395,19 @@ void MantisSegmentor::processCloud(const sensor_msgs::PointCloud2 &in_cloud,
 
 //MAKE THE TABLE ////////////////////////////////////////
   // Step 1 : Filter, remove NaNs and downsample
-  pcl::PointCloud<Point>::Ptr cloud_ptr (new pcl::PointCloud<Point>);
-  pcl::fromROSMsg (in_cloud, *cloud_ptr);
-  pcl::PassThrough<Point> pass_;
-  pass_.setInputCloud (cloud_ptr);
-  pass_.setFilterFieldName ("z");
-  pass_.setFilterLimits (z_filter_min_, z_filter_max_);
-  pcl::PointCloud<Point>::Ptr z_cloud_filtered_ptr (new pcl::PointCloud<Point>);
-  pass_.filter (*z_cloud_filtered_ptr);
-
-  pass_.setInputCloud (z_cloud_filtered_ptr);
-  pass_.setFilterFieldName ("y");
-  pass_.setFilterLimits (y_filter_min_, y_filter_max_);
-  pcl::PointCloud<Point>::Ptr y_cloud_filtered_ptr (new pcl::PointCloud<Point>);
-  pass_.filter (*y_cloud_filtered_ptr);
-
-  pass_.setInputCloud (y_cloud_filtered_ptr);
-  pass_.setFilterFieldName ("x");
-  pass_.setFilterLimits (x_filter_min_, x_filter_max_);
+  pcl::PointIndices::Ptr box_indices (new pcl::PointIndices);
+  box_indices->indices.reserve(cloud->points.size());
+  for(size_t i=0; i<cloud->points.size(); i++)
+  {
+    const Point &p = cloud->points[i];
+    if(p.z >= z_filter_min_ && p.z <= z_filter_max_ && p.y >= y_filter_min_ && p.y <= y_filter_max_ &&
+       p.x >= x_filter_min_ && p.x <= x_filter_max_)
+      box_indices->indices.push_back(i);
+  }
+
+  // VoxelGrid ignores indices, so the box is copied out before it is downsampled
   pcl::PointCloud<Point>::Ptr cloud_filtered_ptr (new pcl::PointCloud<Point>);
-  pass_.filter (*cloud_filtered_ptr);
+  pcl::copyPointCloud (*cloud, box_indices->indices, *cloud_filtered_ptr);
 
   pcl::PointCloud<Point>::Ptr cloud_downsampled_ptr (new pcl::PointCloud<Point>);
   pcl::VoxelGrid<Point> grid_;
@@ -451,7 +417,6 @@ void MantisSegmentor::processCloud(const sensor_msgs::PointCloud2 &in_cloud,
   grid_.setDownsampleAllData (false);
   grid_.setInputCloud (cloud_filtered_ptr);
   grid_.filter (*cloud_downsampled_ptr);
-
   // Step 2 : Estimate normals
   pcl::PointCloud<pcl::Normal>::Ptr cloud_normals_ptr (new pcl::PointCloud<pcl::Normal>);
   pcl::search::KdTree<Point>::Ptr normals_tree_;
@@ -518,7 +483,7 @@ void MantisSegmentor::processCloud(const sensor_msgs::PointCloud2 &in_cloud,
     return;
   }
 
-  seg_response.table = getTable<sensor_msgs::PointCloud>(in_cloud.header, table_plane_trans, table_points);
+  seg_response.table = getTable<sensor_msgs::PointCloud>(header, table_plane_trans, table_points);
   seg_response.result = seg_response.SUCCESS;
 }
 
@@ -20,7 +20,7 @@
 
 #include <boost/filesystem.hpp>
 
-#include "cph.h"
+#include <nrg_object_recognition/cph.h>
 #include "mantis_perception/mantis_recognition.h"
 #include "mantis_perception/mantis_segmentation.h"
 #include "nrg_object_recognition/recognition.h"
@@ -7,20 +7,143 @@
 
 #include <mantis_perception/template_matching/TemplateAlignment.h>
 #include <boost/foreach.hpp>
+#include <boost/bind.hpp>
 #include <tf_conversions/tf_eigen.h>
+#include <sys/stat.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
 
 typedef TemplateAlignment::ModelFeatureData FeatureData;
 typedef TemplateAlignment::AlignmentResult Result;
 
+// Feature cache file: this header, followed by the x y z of every point, the normal_x normal_y normal_z curvature of
+// every normal and the 33 bins of every FPFH signature.  All fields but points identify the data it was computed from.
+struct FeatureCacheHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t points;
+	uint64_t model_size;
+	int64_t model_mtime;
+	double normal_radius;
+	double feature_radius;
+	double voxel_side;
+	double view_point[3];
+};
+
+static const char FEATURE_CACHE_MAGIC[8] = {'T','M','P','L','F','P','F','H'};
+static const uint32_t FEATURE_CACHE_VERSION = 1;
+
+static bool readFeatureCache(const std::string &cacheFile,const FeatureCacheHeader &key,FeatureData &data)
+{
+	std::ifstream in(cacheFile.c_str(),std::ios::binary);
+	FeatureCacheHeader header;
+	if(!in.is_open() || !in.read((char*)&header,sizeof(header)))
+	{
+		return false;
+	}
+
+	// everything but the point count has to match the model file and parameters
+	const uint32_t numPoints = header.points;
+	header.points = key.points;
+	if(memcmp(&header,&key,sizeof(header)) != 0)
+	{
+		return false;
+	}
+
+	std::vector<float> values(numPoints * (3 + 4 + 33));
+	if(!values.empty() && !in.read((char*)&values[0],values.size() * sizeof(float)))
+	{
+		return false;
+	}
+
+	const float *value = values.empty() ? NULL : &values[0];
+	data.PointCloud_ = boost::make_shared<pcl::PointCloud<pcl::PointXYZ> >();
+	data.PointCloud_->points.resize(numPoints);
+	for(unsigned int i = 0; i < numPoints; i++, value += 3)
+	{
+		pcl::PointXYZ &p = data.PointCloud_->points[i];
+		p.x = value[0]; p.y = value[1]; p.z = value[2];
+	}
+
+	data.Normals_ = boost::make_shared<pcl::PointCloud<pcl::Normal> >();
+	data.Normals_->points.resize(numPoints);
+	for(unsigned int i = 0; i < numPoints; i++, value += 4)
+	{
+		pcl::Normal &n = data.Normals_->points[i];
+		n.normal_x = value[0]; n.normal_y = value[1]; n.normal_z = value[2]; n.curvature = value[3];
+	}
+
+	data.Features_ = boost::make_shared<pcl::PointCloud<pcl::FPFHSignature33> >();
+	data.Features_->points.resize(numPoints);
+	for(unsigned int i = 0; i < numPoints; i++, value += 33)
+	{
+		std::copy(value,value + 33,data.Features_->points[i].histogram);
+	}
+
+	data.PointCloud_->width = data.Normals_->width = data.Features_->width = numPoints;
+	data.PointCloud_->height = data.Normals_->height = data.Features_->height = 1;
+	return true;
+}
+
+static bool writeFeatureCache(const std::string &cacheFile,const FeatureCacheHeader &key,const FeatureData &data)
+{
+	const unsigned int numPoints = data.PointCloud_->points.size();
+	if(data.Normals_->points.size() != numPoints || data.Features_->points.size() != numPoints)
+	{
+		return false;
+	}
+
+	FeatureCacheHeader header = key;
+	header.points = numPoints;
+
+	std::vector<float> values;
+	values.reserve(numPoints * (3 + 4 + 33));
+	for(unsigned int i = 0; i < numPoints; i++)
+	{
+		const pcl::PointXYZ &p = data.PointCloud_->points[i];
+		values.push_back(p.x); values.push_back(p.y); values.push_back(p.z);
+	}
+	for(unsigned int i = 0; i < numPoints; i++)
+	{
+		const pcl::Normal &n = data.Normals_->points[i];
+		values.push_back(n.normal_x); values.push_back(n.normal_y); values.push_back(n.normal_z); values.push_back(n.curvature);
+	}
+	for(unsigned int i = 0; i < numPoints; i++)
+	{
+		const float *histogram = data.Features_->points[i].histogram;
+		values.insert(values.end(),histogram,histogram + 33);
+	}
+
+	// written next to the cache and renamed over it, so an interrupted write never leaves a truncated cache
+	const std::string partial = cacheFile + ".partial";
+	std::ofstream out(partial.c_str(),std::ios::binary | std::ios::trunc);
+	if(!out.is_open())
+	{
+		return false;
+	}
+	out.write((const char*)&header,sizeof(header));
+	if(!values.empty())
+	{
+		out.write((const char*)&values[0],values.size() * sizeof(float));
+	}
+	out.close();
+
+	return out && rename(partial.c_str(),cacheFile.c_str()) == 0;
+}
+
 TemplateAlignment::TemplateAlignment(float minSampleDistance, float maxCorrespondanceDistance, int maxIterations)
-:min_sample_distance_(minSampleDistance),
+:candidate_revision_(0),
+ next_template_(0),
+ stop_(0),
+ min_sample_distance_(minSampleDistance),
  max_correspondance_distance_(maxCorrespondanceDistance),
- max_iterations_(maxIterations)
+ max_iterations_(maxIterations),
+ fitness_threshold_(0.0f),
+ num_threads_(0)
 {
-	// TODO Auto-generated constructor stub
-	sac_initial_alignment_.setMinSampleDistance(min_sample_distance_);
-	sac_initial_alignment_.setMaxCorrespondenceDistance(max_correspondance_distance_);
-	sac_initial_alignment_.setMaximumIterations(max_iterations_);
+
 }
 
 TemplateAlignment::~TemplateAlignment() {
@@ -29,9 +152,9 @@ TemplateAlignment::~TemplateAlignment() {
 
 void TemplateAlignment::setCandidateModel(TemplateAlignment::ModelFeatureData &candidate)
 {
+	// workers pick up the new target the next time they align
 	model_candidate_ = candidate;
-	sac_initial_alignment_.setInputTarget(candidate.PointCloud_);
-	sac_initial_alignment_.setTargetFeatures(candidate.Features_);
+	candidate_revision_++;
 }
 
 void TemplateAlignment::addModelTemplate(TemplateAlignment::ModelFeatureData &templateData)
@@ -41,45 +164,48 @@ void TemplateAlignment::addModelTemplate(TemplateAlignment::ModelFeatureData &te
 
 bool TemplateAlignment::findBestAlignment(TemplateAlignment::AlignmentResult &result)
 {
-	if(model_templates_.empty())
+	if(model_templates_.empty() || !model_candidate_.PointCloud_ || !model_candidate_.Features_)
 	{
 		return false;
 	}
 
 	std::vector<Result> results;
 	align(model_templates_,results);
+	if(results.empty())
+	{
+		return false;
+	}
 
 	// finding best fit template (lowest score)
 	float lowestScore = std::numeric_limits<float>::infinity();
 	int index = 0;
-	BOOST_FOREACH(Result res,results)
+	for(unsigned int i = 0; i < results.size(); i++)
 	{
-		if(res.FitnessScore_ < lowestScore)
+		if(results[i].FitnessScore_ < lowestScore)
 		{
-			index = res.Index_;
-			lowestScore = res.FitnessScore_;
+			index = i;
+			lowestScore = results[i].FitnessScore_;
 		}
 	}
 
-	result.FitnessScore_ = results[index].FitnessScore_;
-	result.Transform_ = results[index].Transform_;
-	result.Index_ = index;
+	result = results[index];
 
 	return true;
 }
 
-void TemplateAlignment::align(const FeatureData &templateData,Result &result)
+void TemplateAlignment::align(AlignmentWorker &worker,const FeatureData &templateData,Result &result)
 {
 	ROS_INFO_STREAM(ros::this_node::getName()<<"/TemplateAlignment: Aligning model "<<templateData.ModelName_);
 
-	sac_initial_alignment_.setInputCloud(templateData.PointCloud_);
-	sac_initial_alignment_.setSourceFeatures(templateData.Features_);
+	InitialAlignment &sacInitialAlignment = worker.sac_initial_alignment_;
+	sacInitialAlignment.setInputCloud(templateData.PointCloud_);
+	sacInitialAlignment.setSourceFeatures(templateData.Features_);
 
 	pcl::PointCloud<pcl::PointXYZ> outputCloud;
-	sac_initial_alignment_.align(outputCloud);
+	sacInitialAlignment.align(outputCloud);
 
-	result.FitnessScore_ = static_cast<float>(sac_initial_alignment_.getFitnessScore(max_correspondance_distance_));
-	Eigen::Matrix4f mat = sac_initial_alignment_.getFinalTransformation();
+	result.FitnessScore_ = static_cast<float>(sacInitialAlignment.getFitnessScore(max_correspondance_distance_));
+	Eigen::Matrix4f mat = sacInitialAlignment.getFinalTransformation();
 	Eigen::Matrix3f rot = mat.block<3,3>(0,0);
 	Eigen::Vector3f pos = mat.block<3,1>(0,3);
 
@@ -96,16 +222,88 @@ void TemplateAlignment::align(const FeatureData &templateData,Result &result)
 	ROS_INFO_STREAM(ros::this_node::getName()<<"/TemplateAlignment: Finished alignment with score "<<result.FitnessScore_);
 }
 
+void TemplateAlignment::alignTemplates(AlignmentWorker &worker,const std::vector<FeatureData> &templates,
+		std::vector<Result> &results,std::vector<char> &completed)
+{
+	// templates are handed out in order, a template that already started is always finished
+	for(unsigned int i = __sync_fetch_and_add(&next_template_,1); i < templates.size();
+			i = __sync_fetch_and_add(&next_template_,1))
+	{
+		if(__sync_fetch_and_add(&stop_,0) != 0)
+		{
+			break;
+		}
+
+		align(worker,templates[i],results[i]);
+		results[i].Index_ = i;
+		completed[i] = 1;
+
+		if(results[i].FitnessScore_ < fitness_threshold_)
+		{
+			ROS_INFO_STREAM(ros::this_node::getName()<<"/TemplateAlignment: "<<templates[i].ModelName_
+					<<" is below the fitness threshold, skipping remaining templates");
+			__sync_lock_test_and_set(&stop_,1);
+		}
+	}
+}
+
 void TemplateAlignment::align(const std::vector<FeatureData> &templates,std::vector<Result> &results)
 {
 	results.clear();
+	if(templates.empty())
+	{
+		return;
+	}
 
-	for(int i = 0; i < templates.size(); i++)
+	unsigned int numThreads = num_threads_ > 0 ? num_threads_ : std::max(1u,boost::thread::hardware_concurrency());
+	numThreads = std::min<unsigned int>(numThreads,templates.size());
+	while(workers_.size() < numThreads)
 	{
-		Result result;
-		align(templates[i],result);
-		result.Index_ = i;
-		results.push_back(result);
+		workers_.push_back(boost::make_shared<AlignmentWorker>());
+	}
+
+	// every worker aligns against the same candidate, its trees are only rebuilt after setCandidateModel
+	for(unsigned int i = 0; i < numThreads; i++)
+	{
+		InitialAlignment &sacInitialAlignment = workers_[i]->sac_initial_alignment_;
+		sacInitialAlignment.setMinSampleDistance(min_sample_distance_);
+		sacInitialAlignment.setMaxCorrespondenceDistance(max_correspondance_distance_);
+		sacInitialAlignment.setMaximumIterations(max_iterations_);
+		if(workers_[i]->candidate_revision_ != candidate_revision_)
+		{
+			sacInitialAlignment.setInputTarget(model_candidate_.PointCloud_);
+			sacInitialAlignment.setTargetFeatures(model_candidate_.Features_);
+			workers_[i]->candidate_revision_ = candidate_revision_;
+		}
+	}
+
+	std::vector<Result> templateResults(templates.size());
+	std::vector<char> completed(templates.size(),0);
+	next_template_ = 0;
+	stop_ = 0;
+
+	if(numThreads == 1)
+	{
+		alignTemplates(*workers_[0],templates,templateResults,completed);
+	}
+	else
+	{
+		boost::thread_group threads;
+		for(unsigned int i = 0; i < numThreads; i++)
+		{
+			threads.create_thread(boost::bind(&TemplateAlignment::alignTemplates,this,boost::ref(*workers_[i]),
+					boost::cref(templates),boost::ref(templateResults),boost::ref(completed)));
+		}
+		threads.join_all();
+	}
+
+	// only the templates that were aligned are returned, in template order
+	for(unsigned int i = 0; i < templates.size(); i++)
+	{
+		if(completed[i])
+		{
+			results.push_back(templateResults[i]);
+		}
 	}
 }
 
@@ -114,9 +312,49 @@ std::vector<TemplateAlignment::ModelFeatureData>& TemplateAlignment::getModelTem
 	return model_templates_;
 }
 
+bool TemplateAlignment::ModelFeatureData::loadInputCloud(std::string fileName, std::string cacheFile, bool downsample, float voxelSide)
+{
+	struct stat info;
+	if(stat(fileName.c_str(),&info) != 0)
+	{
+		return false;
+	}
+
+	FeatureCacheHeader key;
+	memset(&key,0,sizeof(key));
+	memcpy(key.magic,FEATURE_CACHE_MAGIC,sizeof(key.magic));
+	key.version = FEATURE_CACHE_VERSION;
+	key.model_size = info.st_size;
+	key.model_mtime = info.st_mtime;
+	key.normal_radius = NormalRadius_;
+	key.feature_radius = FeatureRadius_;
+	key.voxel_side = downsample ? voxelSide : 0.0;
+	key.view_point[0] = ViewPoint_.x();
+	key.view_point[1] = ViewPoint_.y();
+	key.view_point[2] = ViewPoint_.z();
+
+	if(readFeatureCache(cacheFile,key,*this))
+	{
+		ROS_INFO_STREAM(ros::this_node::getName()<<"/TemplateAlignment: loaded cached features of "<<fileName);
+		return true;
+	}
+
+	PtCloud::Ptr cloudPtr = boost::make_shared<PtCloud>();
+	if(pcl::io::loadPCDFile<pcl::PointXYZ>(fileName,*cloudPtr) == -1)
+	{
+		return false;
+	}
+	setInputCloud(cloudPtr,downsample,voxelSide);
+
+	if(!writeFeatureCache(cacheFile,key,*this))
+	{
+		ROS_WARN_STREAM(ros::this_node::getName()<<"/TemplateAlignment: could not write feature cache "<<cacheFile);
+	}
+	return true;
+}
+
 void TemplateAlignment::ModelFeatureData::computeNormals()
 {
-	ros::NodeHandle nh;
 	ROS_INFO_STREAM(ros::this_node::getName()<<"/TemplateAlignment: computing normals");
 
 	Normals_ = boost::make_shared<NormalsCloud>();
@@ -133,7 +371,6 @@ void TemplateAlignment::ModelFeatureData::computeNormals()
 
 void TemplateAlignment::ModelFeatureData::computeFeatures()
 {
-	ros::NodeHandle nh;
 	ROS_INFO_STREAM(ros::this_node::getName()<<"/TemplateAlignment: computing features");
 
 	Features_ = boost::make_shared<LocalFeatures>();
@@ -29,12 +29,15 @@ public:
 	:world_frame_("base_link"),
 	 sensor_frame_("camera_link"),
 	 templates_directory_(""),
+	 template_cache_directory_(""),
 	 template_files_(),
 	 normal_radius_(0.01f),
 	 feature_radius_(0.01f),
 	 min_sample_distance_(0.001f),
 	 max_correspondance_distance_(0.01f),//max_correspondance_distance_(0.01f * 0.01f),
 	 max_iterations_(200),
+	 fitness_threshold_(0.0f),
+	 alignment_threads_(0),
 	 perform_downsampling_(true),
 	 downsampling_voxel_grid_size_(0.005f),
 	 use_template_(false),
@@ -57,11 +60,14 @@ public:
 		ros::param::param(NODE_NAME + "/world_frame",world_frame_,world_frame_);
 		ros::param::param(NODE_NAME + "/sensor_frame",sensor_frame_,sensor_frame_);
 		ros::param::param(NODE_NAME + "/templates_directory",templates_directory_,templates_directory_);
+		ros::param::param(NODE_NAME + "/template_cache_directory",template_cache_directory_,template_cache_directory_);
 		ros::param::param(NODE_NAME + "/normal_radius",normal_radius_,normal_radius_);
 		ros::param::param(NODE_NAME + "/feature_radius",feature_radius_,feature_radius_);
 		ros::param::param(NODE_NAME + "/min_sample_distance",min_sample_distance_,min_sample_distance_);
 		ros::param::param(NODE_NAME + "/max_correspondance_distance",max_correspondance_distance_,max_correspondance_distance_);
 		ros::param::param(NODE_NAME + "/max_iterations",max_iterations_,max_iterations_);
+		ros::param::param(NODE_NAME + "/fitness_threshold",fitness_threshold_,fitness_threshold_);
+		ros::param::param(NODE_NAME + "/alignment_threads",alignment_threads_,alignment_threads_);
 		ros::param::param(NODE_NAME + "/perform_downsampling",perform_downsampling_,perform_downsampling_);
 		ros::param::param(NODE_NAME + "/voxel_side",downsampling_voxel_grid_size_,downsampling_voxel_grid_size_);
 		ros::param::param(NODE_NAME + "/use_template_as_target",use_template_,use_template_);
@@ -90,6 +96,8 @@ public:
 		ros::param::param(NODE_NAME + "/min_sample_distance",min_sample_distance_,min_sample_distance_);
 		ros::param::param(NODE_NAME + "/max_correspondance_distance",max_correspondance_distance_,max_correspondance_distance_);
 		ros::param::param(NODE_NAME + "/max_iterations",max_iterations_,max_iterations_);
+		ros::param::param(NODE_NAME + "/fitness_threshold",fitness_threshold_,fitness_threshold_);
+		ros::param::param(NODE_NAME + "/alignment_threads",alignment_threads_,alignment_threads_);
 		ros::param::param(NODE_NAME + "/use_template_as_target",use_template_,use_template_);
 		ros::param::param(NODE_NAME + "/template_index",template_index_,template_index_);
 	}
@@ -124,6 +132,8 @@ public:
 			template_aligment_.setMaxCorrespondanceDistance(max_correspondance_distance_);
 			template_aligment_.setMinSampleDistance(min_sample_distance_);
 			template_aligment_.setMaxIterations(max_iterations_);
+			template_aligment_.setFitnessThreshold(fitness_threshold_);
+			template_aligment_.setNumThreads(alignment_threads_);
 
 			if(use_template_ && (template_index_ > -1) && ((unsigned int)template_index_ < template_files_.size()))
 			{
@@ -270,6 +280,8 @@ protected:
 		template_aligment_.setMaxCorrespondanceDistance(max_correspondance_distance_);
 		template_aligment_.setMinSampleDistance(min_sample_distance_);
 		template_aligment_.setMaxIterations(max_iterations_);
+		template_aligment_.setFitnessThreshold(fitness_threshold_);
+		template_aligment_.setNumThreads(alignment_threads_);
 
 		// obtaining sensor's frame
 		try
@@ -284,23 +296,24 @@ protected:
 		// adding templates to template aligment;
 		BOOST_FOREACH(std::string fileName, template_files_)
 		{
-			Cloud::Ptr cloudPtr = boost::make_shared<Cloud>();
 			TemplateAlignment::ModelFeatureData templateData;
+			templateData.NormalRadius_ = normal_radius_;
+			templateData.FeatureRadius_ = feature_radius_;
+			templateData.ModelName_ = fileName;
+			templateData.ViewPoint_ = tf::Vector3(sensor_transform_.getOrigin());
+			//templateData.ViewPoint_ = tf::Vector3(0.0f,0.0f,5.0f);
 
+			// normals and features are only recomputed when the template or the parameters changed
 			std::string filePath = templates_directory_ + "/" + fileName;
-			if(pcl::io::loadPCDFile<pcl::PointXYZ>(filePath,*cloudPtr) == -1)
+			std::string cachePath = (template_cache_directory_.empty() ? templates_directory_ : template_cache_directory_)
+					+ "/" + fileName + ".features";
+			if(!templateData.loadInputCloud(filePath,cachePath,perform_downsampling_,downsampling_voxel_grid_size_))
 			{
 				ROS_ERROR_STREAM(NODE_NAME<<": could not read pcd file "<<fileName);
 			}
 			else
 			{
-				ROS_INFO_STREAM(NODE_NAME<<" found pcd file "<<fileName<<" with "<<cloudPtr->size()<<" points, adding data to template list");
-				templateData.NormalRadius_ = normal_radius_;
-				templateData.FeatureRadius_ = feature_radius_;
-				templateData.ModelName_ = fileName;
-				templateData.ViewPoint_ = tf::Vector3(sensor_transform_.getOrigin());
-				//templateData.ViewPoint_ = tf::Vector3(0.0f,0.0f,5.0f);
-				templateData.setInputCloud(cloudPtr,perform_downsampling_,downsampling_voxel_grid_size_);
+				ROS_INFO_STREAM(NODE_NAME<<" found pcd file "<<fileName<<" with "<<templateData.PointCloud_->size()<<" points, adding data to template list");
 				template_aligment_.addModelTemplate(templateData);
 			}
 		}
@@ -333,6 +346,8 @@ protected:
 		double min_sample_distance_;
 		double max_correspondance_distance_;
 		int max_iterations_;
+		double fitness_threshold_;
+		int alignment_threads_;
 
 		// transform resolution
 		std::string world_frame_;
@@ -341,6 +356,7 @@ protected:
 		// template data
 		std::vector<std::string> template_files_;
 		std::string templates_directory_;
+		std::string template_cache_directory_; // feature caches are kept next to the templates when empty
 		bool perform_downsampling_;
 		double downsampling_voxel_grid_size_;
 
@@ -0,0 +1,162 @@
+﻿/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2011, Southwest Research Institute
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *       * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *       * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *       * Neither the name of the Southwest Research Institute, nor the names
+ *       of its contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef INCREMENTAL_JOB_H
+#define INCREMENTAL_JOB_H
+
+namespace armadillo
+{
+namespace incremental_job
+{
+
+/**
+ * \brief Builds the text of a pulse position INFORM job one point at a time.
+ *
+ * Position and MOVJ lines are formatted as points are added, so finishing the
+ * job only writes the header (which needs the point count) in front of the
+ * position lines and appends the instruction lines. The job text lives in
+ * fixed buffers, nothing is allocated after construction.
+ *
+ * The class does not depend on MotoPlus so the job generation can be tested
+ * on the host (see job_harness.cpp).
+ */
+//* IncrementalJob
+/**
+ *
+ * THIS CLASS IS NOT THREAD-SAFE
+ *
+ */
+class IncrementalJob
+{
+
+public:
+
+  /**
+   * \brief Maximum number of points in a job
+   */
+  static const int MAX_POINTS = 200;
+
+  /**
+   * \brief Axes per position (pulse) line
+   */
+  static const int NUM_AXES = 7;
+
+  IncrementalJob();
+
+  /**
+   * \brief Starts a new, empty job
+   *
+   * \param job name (without the .JBI extension, at most 32 characters)
+   *
+   * \return true on success, false if the name is too long
+   */
+  bool init(const char* name);
+
+  /**
+   * \brief Appends a point to the job
+   *
+   * \param pulse counts for each axis
+   * \param joint speed (VJ) in percent, a default speed is used if not in (0,100]
+   *
+   * \return true on success, false if the job is full
+   */
+  bool addPoint(const int pulses[NUM_AXES], float speed);
+
+  /**
+   * \brief Completes the job text, after this getJobString() is valid
+   *
+   * \return true on success, false if the job is empty or a point did not fit
+   */
+  bool finish();
+
+  /**
+   * \brief Returns the completed job text (NULL before finish())
+   */
+  const char* getJobString() const;
+
+  /**
+   * \brief Returns the job name
+   */
+  const char* getName() const
+  {
+    return this->name_;
+  }
+
+  /**
+   * \brief Returns the job file name (name with the .JBI extension)
+   */
+  const char* getFileName() const
+  {
+    return this->fileName_;
+  }
+
+  int getNumPoints() const
+  {
+    return this->numPoints_;
+  }
+
+private:
+
+  static const int NAME_SIZE = 33;
+  static const int HEADER_SIZE = 160;
+  static const int POS_LINE_SIZE = 96;
+  static const int INST_LINE_SIZE = 32;
+  static const int INST_HEADER_SIZE = 96;
+  static const int FOOTER_SIZE = 8;
+
+  char name_[NAME_SIZE];
+  char fileName_[NAME_SIZE + 4];
+
+  /**
+   * \brief Header, position lines and instruction section, in that order. The
+   * header is written backwards from the first position line by finish().
+   */
+  char job_[HEADER_SIZE + MAX_POINTS * POS_LINE_SIZE + INST_HEADER_SIZE + MAX_POINTS * INST_LINE_SIZE
+      + FOOTER_SIZE];
+
+  /**
+   * \brief MOVJ lines, copied behind the position lines by finish()
+   */
+  char inst_[MAX_POINTS * INST_LINE_SIZE];
+
+  int numPoints_;
+  int posLength_;
+  int instLength_;
+  int start_;
+  bool valid_;
+  bool finished_;
+};
+
+}//incremental_job
+}//armadillo
+
+#endif // INCREMENTAL_JOB_H
@@ -0,0 +1,55 @@
+#ifndef IKFAST_BATCH_KINEMATICS_BATCH_KINEMATICS_BASE_H
+#define IKFAST_BATCH_KINEMATICS_BATCH_KINEMATICS_BASE_H
+
+#include <kinematics_base/kinematics_base.h>
+#include <ikfast_batch_kinematics/ik_solution_cache.h>
+
+namespace ikfast_batch_kinematics
+{
+
+/**
+ * \brief Kinematics plugin that can solve many poses in one call.
+ *
+ * Plugins implementing it are still declared and loaded as
+ * kinematics::KinematicsBase, so arm navigation loads them unchanged. A
+ * caller that wants the batch call loads the plugin through pluginlib and
+ * dynamic_casts it to BatchKinematicsBase (see batch_ik_server.cpp).
+ */
+class BatchKinematicsBase : public kinematics::KinematicsBase
+{
+public:
+
+  using kinematics::KinematicsBase::searchPositionIK;
+
+  virtual ~BatchKinematicsBase() {}
+
+  /**
+   * \brief Solves IK for many poses at once. Every pose is searched like
+   * searchPositionIK(pose, seed, timeout, solution, error_code).
+   * \param ik_poses the poses to solve for
+   * \param ik_seed_state seed shared by all poses
+   * \param solutions one solution per pose (empty if none was found)
+   * \param error_codes one error code per pose
+   * \return true if every pose has a solution
+   */
+  virtual bool searchPositionIK(const std::vector<geometry_msgs::Pose> &ik_poses,
+                                const std::vector<double> &ik_seed_state,
+                                const double &timeout,
+                                std::vector<std::vector<double> > &solutions,
+                                std::vector<int> &error_codes) = 0;
+
+  /**
+   * \brief Pose of the tip link for the given joint values
+   */
+  virtual bool getTipPose(const std::vector<double> &joint_angles,
+                          geometry_msgs::Pose &pose) = 0;
+
+  /**
+   * \brief Cache of recent solutions used to seed the free joint search
+   */
+  virtual IKSolutionCache& getSolutionCache() = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef IKFAST_BATCH_KINEMATICS_IK_SOLUTION_CACHE_H
+#define IKFAST_BATCH_KINEMATICS_IK_SOLUTION_CACHE_H
+
+#include <geometry_msgs/Pose.h>
+#include <boost/thread/mutex.hpp>
+#include <cmath>
+#include <list>
+#include <map>
+#include <vector>
+
+namespace ikfast_batch_kinematics
+{
+
+/**
+ * \brief LRU cache of recent IK solutions, keyed by the end-effector pose
+ * rounded to the cache resolution. Used to start the free joint search at
+ * the value that solved a nearby pose. Safe to share between threads.
+ */
+class IKSolutionCache
+{
+  typedef std::vector<int> Key;
+  typedef std::list<std::pair<Key, std::vector<double> > > Entries;
+
+  Entries entries_; // most recently used first
+  std::map<Key, Entries::iterator> index_;
+  size_t capacity_;
+  double resolution_;
+  unsigned int hits_, misses_;
+  boost::mutex mutex_;
+
+  Key makeKey(const geometry_msgs::Pose &pose) const {
+    // q and -q are the same orientation
+    double sign = pose.orientation.w < 0 ? -1.0 : 1.0;
+    double values[7] = {pose.position.x, pose.position.y, pose.position.z,
+                        sign*pose.orientation.x, sign*pose.orientation.y, sign*pose.orientation.z, sign*pose.orientation.w};
+    Key key(7);
+    for(int i = 0; i < 7; ++i)
+      key[i] = (int)floor(values[i]/resolution_ + 0.5);
+    return key;
+  }
+
+public:
+
+  IKSolutionCache(size_t capacity = 256, double resolution = 0.005):
+    capacity_(capacity), resolution_(resolution), hits_(0), misses_(0) {}
+
+  void setCapacity(size_t capacity) { boost::mutex::scoped_lock lock(mutex_); capacity_ = capacity; clearLocked(); }
+  void setResolution(double resolution) { boost::mutex::scoped_lock lock(mutex_); resolution_ = resolution; clearLocked(); }
+
+  bool lookup(const geometry_msgs::Pose &pose, std::vector<double> &solution) {
+    boost::mutex::scoped_lock lock(mutex_);
+    if(capacity_ == 0)
+      return false;
+    std::map<Key, Entries::iterator>::iterator it = index_.find(makeKey(pose));
+    if(it == index_.end()) {
+      misses_++;
+      return false;
+    }
+    entries_.splice(entries_.begin(), entries_, it->second);
+    solution = it->second->second;
+    hits_++;
+    return true;
+  }
+
+  void insert(const geometry_msgs::Pose &pose, const std::vector<double> &solution) {
+    boost::mutex::scoped_lock lock(mutex_);
+    if(capacity_ == 0)
+      return;
+    Key key = makeKey(pose);
+    std::map<Key, Entries::iterator>::iterator it = index_.find(key);
+    if(it != index_.end()) {
+      it->second->second = solution;
+      entries_.splice(entries_.begin(), entries_, it->second);
+      return;
+    }
+    entries_.push_front(std::make_pair(key, solution));
+    index_[key] = entries_.begin();
+    if(entries_.size() > capacity_) {
+      index_.erase(entries_.back().first);
+      entries_.pop_back();
+    }
+  }
+
+  void clear() { boost::mutex::scoped_lock lock(mutex_); clearLocked(); }
+
+  unsigned int getHits() const { return hits_; }
+  unsigned int getMisses() const { return misses_; }
+
+private:
+
+  void clearLocked() {
+    entries_.clear();
+    index_.clear();
+    hits_ = 0;
+    misses_ = 0;
+  }
+};
+
+}
+
+#endif
@@ -0,0 +1,101 @@
+//batch_ik_server.cpp
+//Loads an ikfast kinematics plugin through pluginlib and offers its batch IK
+//search as the get_batch_ik service.
+//usage (with robot_description loaded):
+//  rosrun ikfast_batch_kinematics batch_ik_server _kinematics_solver:=longhorn_manipulator_kinematics/IKFastKinematicsPlugin
+#include <ros/ros.h>
+#include <pluginlib/class_loader.h>
+#include <ikfast_batch_kinematics/batch_kinematics_base.h>
+#include <ikfast_batch_kinematics/GetBatchPositionIK.h>
+#include <boost/shared_ptr.hpp>
+
+static const std::string NODE_NAME = "batch_ik_server";
+static const std::string SERVICE_NAME = "get_batch_ik";
+
+class BatchIKServer
+{
+public:
+
+  BatchIKServer(): loader_("kinematics_base","kinematics::KinematicsBase"), solver_(NULL) {}
+
+  bool init()
+  {
+    ros::NodeHandle pn("~");
+    std::string plugin_name, group, root_name, tip_name;
+    double discretization;
+    pn.param("kinematics_solver", plugin_name, std::string("longhorn_manipulator_kinematics/IKFastKinematicsPlugin"));
+    pn.param("group", group, std::string("manipulator"));
+    pn.param("root_name", root_name, std::string("base_link"));
+    pn.param("tip_name", tip_name, std::string("palm"));
+    pn.param("search_discretization", discretization, 0.01);
+
+    try
+    {
+      plugin_.reset(loader_.createClassInstance(plugin_name));
+    }
+    catch(pluginlib::PluginlibException &e)
+    {
+      ROS_ERROR_STREAM(NODE_NAME<<": Could not load ik plugin "<<plugin_name<<": "<<e.what());
+      return false;
+    }
+
+    solver_ = dynamic_cast<ikfast_batch_kinematics::BatchKinematicsBase*>(plugin_.get());
+    if(solver_ == NULL)
+    {
+      ROS_ERROR_STREAM(NODE_NAME<<": "<<plugin_name<<" does not support batch ik");
+      return false;
+    }
+
+    if(!solver_->initialize(group, root_name, tip_name, discretization))
+    {
+      ROS_ERROR_STREAM(NODE_NAME<<": "<<plugin_name<<" failed to initialize");
+      return false;
+    }
+
+    service_ = nh_.advertiseService(SERVICE_NAME, &BatchIKServer::getBatchIK, this);
+    ROS_INFO_STREAM(NODE_NAME<<": Serving batch ik for "<<plugin_name);
+    return true;
+  }
+
+protected:
+
+  bool getBatchIK(ikfast_batch_kinematics::GetBatchPositionIK::Request &req,
+                  ikfast_batch_kinematics::GetBatchPositionIK::Response &res)
+  {
+    const std::vector<std::string> &joint_names = solver_->getJointNames();
+    if(req.ik_seed_state.size() != joint_names.size())
+    {
+      ROS_ERROR_STREAM(NODE_NAME<<": Seed has "<<req.ik_seed_state.size()<<" values, expected "<<joint_names.size());
+      return false;
+    }
+
+    std::vector<std::vector<double> > solutions;
+    solver_->searchPositionIK(req.ik_poses, req.ik_seed_state, req.timeout, solutions, res.error_codes);
+
+    res.solutions.resize(solutions.size());
+    for(std::size_t i = 0; i < solutions.size(); i++)
+    {
+      res.solutions[i].name = joint_names;
+      res.solutions[i].position = solutions[i];
+    }
+    return true;
+  }
+
+  ros::NodeHandle nh_;
+  ros::ServiceServer service_;
+  pluginlib::ClassLoader<kinematics::KinematicsBase> loader_;
+  boost::shared_ptr<kinematics::KinematicsBase> plugin_;
+  ikfast_batch_kinematics::BatchKinematicsBase *solver_;
+};
+
+int main(int argc, char **argv)
+{
+  ros::init(argc, argv, NODE_NAME);
+
+  BatchIKServer server;
+  if(!server.init())
+    return 1;
+
+  ros::spin();
+  return 0;
+}
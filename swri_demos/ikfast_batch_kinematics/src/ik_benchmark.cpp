@@ -0,0 +1,98 @@
+//ik_benchmark.cpp
+//Solves IK for random reachable poses one at a time, in one batch, and in one
+//batch again with a warm solution cache, and prints solves/sec for each.
+//usage (with robot_description loaded):
+//  rosrun ikfast_batch_kinematics ik_benchmark _kinematics_solver:=longhorn_manipulator_kinematics/IKFastKinematicsPlugin _num_poses:=500
+#include <ros/ros.h>
+#include <pluginlib/class_loader.h>
+#include <ikfast_batch_kinematics/batch_kinematics_base.h>
+#include <boost/shared_ptr.hpp>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real.hpp>
+#include <boost/random/variate_generator.hpp>
+
+void report(const std::string &name, const std::vector<int> &error_codes, double seconds)
+{
+  int solved = 0;
+  for(size_t i = 0; i < error_codes.size(); ++i)
+    if(error_codes[i] == kinematics::SUCCESS)
+      solved++;
+  ROS_INFO("%s: %d/%d solved in %.3f s, %.1f solves/sec", name.c_str(), solved, (int)error_codes.size(),
+           seconds, error_codes.size()/seconds);
+}
+
+int main(int argc, char **argv)
+{
+  ros::init(argc, argv, "ik_benchmark");
+  ros::NodeHandle pn("~");
+
+  std::string plugin_name, group, root_name, tip_name;
+  int num_poses;
+  double discretization;
+  pn.param("kinematics_solver", plugin_name, std::string("longhorn_manipulator_kinematics/IKFastKinematicsPlugin"));
+  pn.param("group", group, std::string("manipulator"));
+  pn.param("root_name", root_name, std::string("base_link"));
+  pn.param("tip_name", tip_name, std::string("palm"));
+  pn.param("search_discretization", discretization, 0.01);
+  pn.param("num_poses", num_poses, 500);
+
+  pluginlib::ClassLoader<kinematics::KinematicsBase> loader("kinematics_base","kinematics::KinematicsBase");
+  boost::shared_ptr<kinematics::KinematicsBase> base;
+  try
+  {
+    base.reset(loader.createClassInstance(plugin_name));
+  }
+  catch(pluginlib::PluginlibException &e)
+  {
+    ROS_ERROR("Could not load ik plugin %s: %s", plugin_name.c_str(), e.what());
+    return 1;
+  }
+
+  ikfast_batch_kinematics::BatchKinematicsBase *plugin =
+      dynamic_cast<ikfast_batch_kinematics::BatchKinematicsBase*>(base.get());
+  if(plugin == NULL)
+  {
+    ROS_ERROR("%s does not support batch ik", plugin_name.c_str());
+    return 1;
+  }
+  if(!plugin->initialize(group, root_name, tip_name, discretization))
+    return 1;
+
+  // Poses from random joint values are always reachable
+  size_t num_joints = plugin->getJointNames().size();
+  boost::mt19937 rng(0);
+  boost::uniform_real<double> range(-1.0, 1.0);
+  boost::variate_generator<boost::mt19937&, boost::uniform_real<double> > random_joint(rng, range);
+  std::vector<geometry_msgs::Pose> poses(num_poses);
+  std::vector<double> joints(num_joints);
+  for(int i = 0; i < num_poses; ++i)
+  {
+    for(size_t j = 0; j < joints.size(); ++j)
+      joints[j] = random_joint();
+    if(!plugin->getTipPose(joints, poses[i]))
+      return 1;
+  }
+  std::vector<double> seed(num_joints, 0.0);
+
+  std::vector<std::vector<double> > solutions(num_poses);
+  std::vector<int> error_codes(num_poses);
+
+  plugin->getSolutionCache().clear();
+  ros::WallTime start = ros::WallTime::now();
+  for(int i = 0; i < num_poses; ++i)
+    plugin->searchPositionIK(poses[i], seed, 1.0, solutions[i], error_codes[i]);
+  report("one at a time", error_codes, (ros::WallTime::now() - start).toSec());
+
+  plugin->getSolutionCache().clear();
+  start = ros::WallTime::now();
+  plugin->searchPositionIK(poses, seed, 1.0, solutions, error_codes);
+  report("batch", error_codes, (ros::WallTime::now() - start).toSec());
+
+  start = ros::WallTime::now();
+  plugin->searchPositionIK(poses, seed, 1.0, solutions, error_codes);
+  report("batch, warm cache", error_codes, (ros::WallTime::now() - start).toSec());
+  ROS_INFO("cache hits %u, misses %u", plugin->getSolutionCache().getHits(), plugin->getSolutionCache().getMisses());
+
+  return 0;
+}
@@ -0,0 +1,130 @@
+﻿/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2011, Southwest Research Institute
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *       * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *       * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *       * Neither the name of the Southwest Research Institute, nor the names
+ *       of its contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "incremental_job.h"
+#include <stdio.h>
+#include <string.h>
+
+namespace longhorn
+{
+namespace incremental_job
+{
+
+static const float DEFAULT_SPEED = 25.0f;
+
+IncrementalJob::IncrementalJob()
+{
+  this->init("");
+}
+
+bool IncrementalJob::init(const char* name)
+{
+  this->numPoints_ = 0;
+  this->posLength_ = 0;
+  this->instLength_ = 0;
+  this->start_ = 0;
+  this->finished_ = false;
+  this->valid_ = strlen(name) < NAME_SIZE;
+  if (this->valid_)
+  {
+    strcpy(this->name_, name);
+    sprintf(this->fileName_, "%s.JBI", name);
+  }
+  else
+  {
+    this->name_[0] = '\0';
+    this->fileName_[0] = '\0';
+  }
+  return this->valid_;
+}
+
+bool IncrementalJob::addPoint(const int pulses[NUM_AXES], float speed)
+{
+  if (this->finished_ || this->numPoints_ >= MAX_POINTS)
+  {
+    this->valid_ = false;
+    return false;
+  }
+
+  if (speed <= 0.0f || speed > 100.0f)
+  {
+    speed = DEFAULT_SPEED;
+  }
+
+  // Every line is far below its reserved size (7 ints of at most 11
+  // characters), so sprintf can not run past the buffers
+  char* pos = this->job_ + HEADER_SIZE + this->posLength_;
+  this->posLength_ += sprintf(pos, "C%05d=%d,%d,%d,%d,%d,%d,%d\r\n", this->numPoints_, pulses[0], pulses[1],
+                              pulses[2], pulses[3], pulses[4], pulses[5], pulses[6]);
+  this->instLength_ += sprintf(this->inst_ + this->instLength_, "MOVJ C%05d VJ=%.2f\r\n", this->numPoints_,
+                               speed);
+  this->numPoints_++;
+  return true;
+}
+
+bool IncrementalJob::finish()
+{
+  char header[HEADER_SIZE];
+  int length;
+
+  if (!this->valid_ || 0 == this->numPoints_)
+  {
+    return false;
+  }
+
+  // Header in front of the position lines
+  length = sprintf(header, "/JOB\r\n//NAME %s\r\n//POS\r\n///NPOS %d,0,0,0,0,0\r\n///TOOL 0\r\n"
+                   "///POSTYPE PULSE\r\n///PULSE\r\n", this->name_, this->numPoints_);
+  this->start_ = HEADER_SIZE - length;
+  memcpy(this->job_ + this->start_, header, length);
+
+  // Instruction section behind them
+  char* inst = this->job_ + HEADER_SIZE + this->posLength_;
+  inst += sprintf(inst, "//INST\r\n///DATE 2012/01/01 00:00\r\n///ATTR SC,RW\r\n///GROUP1 RB1\r\nNOP\r\n");
+  memcpy(inst, this->inst_, this->instLength_);
+  inst += this->instLength_;
+  strcpy(inst, "END\r\n");
+
+  this->finished_ = true;
+  return true;
+}
+
+const char* IncrementalJob::getJobString() const
+{
+  if (!this->finished_)
+  {
+    return NULL;
+  }
+  return this->job_ + this->start_;
+}
+
+}//incremental_job
+}//longhorn
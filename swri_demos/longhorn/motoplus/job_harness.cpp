@@ -0,0 +1,172 @@
+﻿/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2011, Southwest Research Institute
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *       * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *       * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *       * Neither the name of the Southwest Research Institute, nor the names
+ *       of its contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Host side harness for the incremental job generation. Feeds a trajectory
+// point by point, as the download handler does, and measures the time from
+// END_TRAJECTORY to a ready job text against generating the whole job after
+// END_TRAJECTORY (what TrajectoryJob::toJobString did). Also checks that a
+// second job can be built in the other slot without touching the first one.
+//
+// The job text is only checked against the controller's own formatter when a
+// job file written by TrajectoryJob::toJobString for the same pulse positions
+// is given (the harness positions are 100000 * sin(0.05 * point + axis)
+// pulses at the default speed).
+//
+// Build and run on the host (not part of the MotoPlus project):
+//   g++ -O2 -o job_harness job_harness.cpp incremental_job.cpp
+//   ./job_harness [num_points] [expected_job_file]
+
+#include "incremental_job.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+using namespace longhorn::incremental_job;
+
+static const int REPEATS = 1000;
+
+double now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/**
+ * \brief Reads a whole job file, returns NULL if it can not be read
+ */
+char* readJob(const char* path)
+{
+  FILE* file = fopen(path, "rb");
+  if (NULL == file)
+  {
+    return NULL;
+  }
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  char* text = (char*)malloc(size + 1);
+  size = fread(text, 1, size, file);
+  text[size] = '\0';
+  fclose(file);
+  return text;
+}
+
+int main(int argc, char** argv)
+{
+  int num_points = argc > 1 ? atoi(argv[1]) : IncrementalJob::MAX_POINTS;
+  if (num_points < 1 || num_points > IncrementalJob::MAX_POINTS)
+  {
+    printf("number of points must be between 1 and %d\n", IncrementalJob::MAX_POINTS);
+    return 1;
+  }
+
+  static int pulses[IncrementalJob::MAX_POINTS][IncrementalJob::NUM_AXES];
+  for (int i = 0; i < num_points; i++)
+  {
+    for (int j = 0; j < IncrementalJob::NUM_AXES; j++)
+    {
+      pulses[i][j] = (int)(100000.0 * sin(0.05 * i + j));
+    }
+  }
+
+  static IncrementalJob slots[2];
+
+  // Whole job generated after END_TRAJECTORY
+  double start = now();
+  for (int r = 0; r < REPEATS; r++)
+  {
+    slots[0].init("ROS_I_TRAJ0");
+    for (int i = 0; i < num_points; i++)
+    {
+      slots[0].addPoint(pulses[i], 0.0f);
+    }
+    slots[0].finish();
+  }
+  double batch = (now() - start) / REPEATS;
+
+  // Incremental job, only finish() happens after END_TRAJECTORY
+  double feed = 0.0, end = 0.0;
+  for (int r = 0; r < REPEATS; r++)
+  {
+    start = now();
+    slots[0].init("ROS_I_TRAJ0");
+    for (int i = 0; i < num_points; i++)
+    {
+      slots[0].addPoint(pulses[i], 0.0f);
+    }
+    double mid = now();
+    slots[0].finish();
+    end += now() - mid;
+    feed += mid - start;
+  }
+  feed /= REPEATS;
+  end /= REPEATS;
+
+  static char first[sizeof(IncrementalJob)];
+  strcpy(first, slots[0].getJobString());
+
+  // Second slot downloads while the first one is loaded
+  slots[1].init("ROS_I_TRAJ1");
+  for (int i = num_points - 1; i >= 0; i--)
+  {
+    slots[1].addPoint(pulses[i], 50.0f);
+  }
+  bool independent = slots[1].finish() && 0 == strcmp(first, slots[0].getJobString())
+      && 0 != strcmp(slots[0].getJobString(), slots[1].getJobString());
+
+  printf("%d points, %d byte job\n", num_points, (int)strlen(first));
+  printf("END_TRAJECTORY to job ready: whole job %.1f us, incremental %.1f us (%.1fx)\n", batch * 1e6,
+         end * 1e6, batch / end);
+  printf("per point formatting while downloading: %.2f us\n", feed * 1e6 / num_points);
+  printf("double buffered slots %s\n", independent ? "independent" : "OVERLAP");
+
+  bool identical = true;
+  if (argc > 2)
+  {
+    char* expected = readJob(argv[2]);
+    if (NULL == expected)
+    {
+      printf("could not read %s\n", argv[2]);
+      return 1;
+    }
+    identical = 0 == strcmp(expected, first);
+    printf("incremental job %s %s\n", identical ? "matches" : "DOES NOT MATCH", argv[2]);
+    free(expected);
+  }
+  else
+  {
+    printf("job text not checked, no expected job file given\n");
+  }
+  return identical && independent ? 0 : 1;
+}
@@ -36,6 +36,7 @@
 #include "joint_traj_pt.h"
 #include "motoPlus.h"
 #include "smpl_msg_connection.h"
+#include "ros_conversion.h"
 
 using namespace industrial::simple_message;
 using namespace industrial::shared_types;
@@ -44,7 +45,8 @@ using namespace industrial::joint_data;
 using namespace industrial::joint_traj_pt;
 using namespace industrial::joint_traj_pt_message;
 using namespace industrial::smpl_msg_connection;
-using namespace motoman::trajectory_job;
+using namespace motoman::ros_conversion;
+using namespace longhorn::incremental_job;
 using namespace motoman::controller;
 
 namespace longhorn
@@ -56,6 +58,11 @@ namespace trajectory_download_handler
 bool TrajectoryDownloadHandler::init(SmplMsgConnection* connection, Controller* ctrl)
 {
   this->ctrl_ = ctrl;
+  this->jobs_ = new IncrementalJob[2];
+  this->jobs_[0].init(JOB_NAME_0);
+  this->jobs_[1].init(JOB_NAME_1);
+  this->downloadSlot_ = 0;
+  this->loadedSlot_ = -1;
   return this->init(StandardMsgTypes::JOINT_TRAJ_PT, connection);
 }
 
@@ -82,12 +89,15 @@ bool TrajectoryDownloadHandler::internalCB(industrial::simple_message::SimpleMes
     
   case SpecialSeqValues::STOP_TRAJECTORY:
     LOG_DEBUG("Stoping trajectory");
-    this->ctrl_->stopMotionJob(JOB_NAME);
+    if (this->loadedSlot_ >= 0)
+    {
+      this->ctrl_->stopMotionJob((char*)this->jobs_[this->loadedSlot_].getFileName());
+    }
     rtn = true;
     break;
     
   default:
-    rtn = this->traj_.addPoint(jMsg.point_); 
+    rtn = this->addPoint(jMsg.point_);
     break;
   }
   
@@ -118,66 +128,79 @@ bool TrajectoryDownloadHandler::internalCB(industrial::simple_message::SimpleMes
 
 void TrajectoryDownloadHandler::startTrajectory(JointTrajPtMessage & jMsg)
 {
-    LOG_INFO("Trajectory download initialized, adding first point");
-    this->traj_.init();
-    this->traj_.addPoint(jMsg.point_); 
+    // Never overwrite the job that was loaded last, it may be running
+    this->downloadSlot_ = (0 == this->loadedSlot_) ? 1 : 0;
+    IncrementalJob & job = this->jobs_[this->downloadSlot_];
+
+    job.init(0 == this->downloadSlot_ ? JOB_NAME_0 : JOB_NAME_1);
+    LOG_INFO("Trajectory download initialized in job %s, adding first point", job.getName());
+    this->addPoint(jMsg.point_);
+}
+
+bool TrajectoryDownloadHandler::addPoint(JointTrajPt & point)
+{
+    JointData rosJoints;
+    JointData mpJoints;
+    shared_real value;
+    int pulses[IncrementalJob::NUM_AXES];
+
+    point.getJointPosition(rosJoints);
+    toMpJoint(rosJoints, mpJoints);
+    for (int i = 0; i < IncrementalJob::NUM_AXES; i++)
+    {
+        mpJoints.getJoint(i, value);
+        pulses[i] = (int)(value < 0 ? value - 0.5 : value + 0.5);
+    }
+
+    if (!this->jobs_[this->downloadSlot_].addPoint(pulses, point.getVelocity() * 100.0))
+    {
+        LOG_ERROR("Trajectory exceeds %d points, point dropped", IncrementalJob::MAX_POINTS);
+        return false;
+    }
+    return true;
 }
 
 void TrajectoryDownloadHandler::endTrajectory(JointTrajPtMessage & jMsg)
 {
+    IncrementalJob & job = this->jobs_[this->downloadSlot_];
 
     LOG_INFO("Trajecotry ended, starting job");
     
     // Add end point
-    this->traj_.addPoint(jMsg.point_);
-    
-    LOG_DEBUG("Creating trajectory job");
+    this->addPoint(jMsg.point_);
     
-    
-    // Create, load, and execute motion
-    if (this->job_.init(JOB_NAME))
+    // Job text already contains every point, only the header is left
+    if(job.finish())
     {
-        LOG_INFO("Motion job initialized");
-        if(this->job_.toJobString(this->traj_, this->jobBuffer_, JOB_BUFFER_SIZE_))
-        {
+        LOG_INFO("Job string created");
         
-            LOG_INFO("Job string created");
+        if(this->ctrl_->writeJob((char*)job.getFileName(), (char*)job.getJobString()))
+        {
             
-            if(this->ctrl_->writeJob(JOB_NAME, this->jobBuffer_))
+            LOG_INFO("Job file written");
+            if(this->ctrl_->loadJob("\\", (char*)job.getFileName()))
             {
-                
-                LOG_INFO("Job file written");
-                if(this->ctrl_->loadJob("\\", JOB_NAME))
-                {
-                    LOG_INFO("Starting motion job: %s", JOB_NAME);
-                    //this->ctrl_->startMotionJob(JOB_NAME);
-                }
-                else
-                {
-                    LOG_ERROR("Failed to load job");
-                }
-                
+                this->loadedSlot_ = this->downloadSlot_;
+                LOG_INFO("Starting motion job: %s", job.getFileName());
+                this->ctrl_->startMotionJob((char*)job.getFileName());
             }
             else
             {
-                LOG_ERROR("Failed to write job");
+                LOG_ERROR("Failed to load job");
             }
             
         }
         else
         {
-            LOG_ERROR("Failed to convert job to string");
+            LOG_ERROR("Failed to write job");
         }
+        
     }
     else
     {
-        LOG_ERROR("Failed to intialize job trajectory");
+        LOG_ERROR("Failed to convert job to string");
     }
     
-    // Clear out the last downloaded trajectory
-    this->traj_.init();
-    
-    
     return;
 }
 
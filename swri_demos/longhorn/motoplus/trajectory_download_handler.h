@@ -37,7 +37,7 @@
 #include "joint_traj.h"
 #include "joint_traj_pt_message.h"
 #include "controller.h"
-#include "trajectory_job.h"
+#include "incremental_job.h"
 
 namespace longhorn
 {
@@ -46,21 +46,21 @@ namespace trajectory_download_handler
 
 
 /**
-* \brief job name
+* \brief job names, one for each job slot
 */
 //TODO: Should be "class static const" not macro
-#define JOB_NAME "ROS_I_TRAJ.JBI"  
-
-/**
-* \brief size of job buffer
-*/
-//TODO: Should be "class static const" not macro
-#define JOB_BUFFER_SIZE_ 1024   
+#define JOB_NAME_0 "ROS_I_TRAJ0"
+#define JOB_NAME_1 "ROS_I_TRAJ1"
   
   
 /**
  * \brief Message handler that handles the recieiving of entire trajectories
  * and trajectory inform job execution.
+ *
+ * The job text is generated as the points arrive, so END_TRAJECTORY only
+ * has to finish, write and load the job. There are two job slots: a
+ * trajectory is downloaded into the slot that was not loaded last, so the
+ * next trajectory can be received while the current job runs.
  */
 //* TrajectoryDownloadHandler
 /**
@@ -123,6 +123,15 @@ bool init(int msg_type, industrial::smpl_msg_connection::SmplMsgConnection* conn
   *
   */
  void endTrajectory(industrial::joint_traj_pt_message::JointTrajPtMessage & jMsg);
+
+ /**
+  * \brief Converts a point to pulses and adds it to the job being downloaded
+  *
+  * \param point to add
+  *
+  * \return true on success, false otherwise (job full)
+  */
+ bool addPoint(industrial::joint_traj_pt::JointTrajPt & point);
   
 
    /**
@@ -131,19 +140,19 @@ bool init(int msg_type, industrial::smpl_msg_connection::SmplMsgConnection* conn
  motoman::controller::Controller* ctrl_;
  
 /**
-   * \brief joint trajectory (internal buffer)
+   * \brief job slots (allocated in init() to keep them off the task stack)
    */
-  industrial::joint_traj::JointTraj traj_;
-  
+  longhorn::incremental_job::IncrementalJob* jobs_;
+
   /**
-   * \brief joint trajectory job(internal buffer)
+   * \brief slot receiving the current download
    */
-    motoman::trajectory_job::TrajectoryJob job_;
-  
- /**
-   * \brief job sting buffer (limited to JOB_BUFFER_SIZE_ characters);
+  int downloadSlot_;
+
+  /**
+   * \brief slot loaded last (-1 if none)
    */
-   char jobBuffer_[JOB_BUFFER_SIZE_];
+  int loadedSlot_;
  
 };
  
@@ -153,4 +162,4 @@ bool init(int msg_type, industrial::smpl_msg_connection::SmplMsgConnection* conn
 }//motoman
 
 
-#endif // TRAJECTORY_DOWNLOAD_HANDLER_H
\ No newline at end of file
+#endif // TRAJECTORY_DOWNLOAD_HANDLER_H
\ No newline at end of file